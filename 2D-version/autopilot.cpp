@@ -0,0 +1,295 @@
+// Autopilot for the 2D game, see autopilot.h.
+#include "autopilot.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+const float MARGIN = 2.0f;             // pixels kept clear of every obstacle
+const float SLACK  = 0.75f;             // plans assume this much of maxSpeed
+
+// ------------- INTERVALS -------------
+struct Span {
+    float lo, hi;
+};
+
+struct SpanList {
+    int  n;
+    Span s[AUTOPILOT_MAX_BOX + 1];
+};
+
+static void addSpan(SpanList &l, float lo, float hi) {
+    if (lo > hi || l.n > AUTOPILOT_MAX_BOX) return;
+    // kept sorted by lo; lists are short and arrive nearly in order
+    int i = l.n++;
+    while (i > 0 && l.s[i - 1].lo > lo) {
+        l.s[i] = l.s[i - 1];
+        --i;
+    }
+    l.s[i].lo = lo;
+    l.s[i].hi = hi;
+}
+
+static void mergeSpans(SpanList &l) {
+    int out = 0;
+    for (int i = 0; i < l.n; ++i) {
+        if (out > 0 && l.s[i].lo <= l.s[out - 1].hi) {
+            if (l.s[i].hi > l.s[out - 1].hi) l.s[out - 1].hi = l.s[i].hi;
+        } else {
+            l.s[out++] = l.s[i];
+        }
+    }
+    l.n = out;
+}
+
+// the span of l holding x, or -1
+static int findSpan(const SpanList &l, float x) {
+    for (int i = 0; i < l.n; ++i)
+        if (x >= l.s[i].lo && x <= l.s[i].hi) return i;
+    return -1;
+}
+
+// Where the player's X can be while obstacles fall through [t0, t1]
+// without touching any of them.
+static void freeSpans(const AutopilotView &v, const AutopilotBox *boxes, int count,
+                      float t0, float t1, SpanList &out) {
+    float bottom = v.playerY, top = v.playerY + v.playerH;
+    float maxX   = v.fieldWidth - v.playerW;
+    SpanList blocked;
+    blocked.n = 0;
+    for (int i = 0; i < count; ++i) {
+        const AutopilotBox &b = boxes[i];
+        // the box sweeps down over [y - fall * t1, y + h - fall * t0]
+        if (b.y - v.fallSpeed * t1 >= top || b.y + b.h - v.fallSpeed * t0 <= bottom)
+            continue;
+        addSpan(blocked, b.x - v.playerW - MARGIN, b.x + b.w + MARGIN);
+    }
+    mergeSpans(blocked);
+
+    out.n = 0;
+    float from = 0.0f;
+    for (int i = 0; i < blocked.n; ++i) {
+        if (blocked.s[i].lo > from) addSpan(out, from, blocked.s[i].lo < maxX ? blocked.s[i].lo : maxX);
+        if (blocked.s[i].hi > from) from = blocked.s[i].hi;
+    }
+    if (from < maxX) addSpan(out, from, maxX);
+}
+
+// ------------- STEERING -------------
+float autopilotSteer(const AutopilotView &v, const AutopilotBox *boxes, int count, float dt) {
+    if (count > AUTOPILOT_MAX_BOX) count = AUTOPILOT_MAX_BOX;
+    float slice = v.horizon / AUTOPILOT_SLICES;
+    float x     = v.playerX;
+
+    // Slices sit at multiples of `slice` in game time, so the next tick
+    // sees the same ones (the first a little shorter) and a plan made now
+    // still works then. Cutting them from "now" instead would let a gap
+    // that was just reachable close again in the next tick's first slice.
+    float firstEnd = slice - fmodf(v.time, slice);
+
+    // reach[j]: where the player can be at the end of slice j; a move
+    // within a slice has to stay inside one free span of it
+    SpanList freeAt[AUTOPILOT_SLICES + 1], reach[AUTOPILOT_SLICES + 1];
+    reach[0].n = 1;
+    reach[0].s[0].lo = reach[0].s[0].hi = x;
+    int last = 0;
+    for (int j = 1; j <= AUTOPILOT_SLICES; ++j) {
+        float t0 = j == 1 ? 0.0f : firstEnd + slice * (j - 2);
+        float t1 = firstEnd + slice * (j - 1);
+        float step = v.maxSpeed * SLACK * (t1 - t0);
+        freeSpans(v, boxes, count, t0, t1, freeAt[j]);
+        SpanList &r = reach[j];
+        r.n = 0;
+        for (int a = 0; a < reach[j - 1].n; ++a) {
+            const Span &from = reach[j - 1].s[a];
+            for (int g = 0; g < freeAt[j].n; ++g) {
+                const Span &gap = freeAt[j].s[g];
+                if (gap.hi < from.lo || gap.lo > from.hi) continue;
+                float lo = (from.lo > gap.lo ? from.lo : gap.lo) - step;
+                float hi = (from.hi < gap.hi ? from.hi : gap.hi) + step;
+                addSpan(r, lo > gap.lo ? lo : gap.lo, hi < gap.hi ? hi : gap.hi);
+            }
+        }
+        mergeSpans(r);
+        if (r.n == 0) break;
+        last = j;
+    }
+    float most = v.maxSpeed * dt;
+    if (last == 0) {
+        // about to be hit whatever we do; the nearest free spot is the
+        // only hope
+        float best = x, bestDist = -1.0f;
+        for (int g = 0; g < freeAt[1].n; ++g) {
+            float q = x < freeAt[1].s[g].lo ? freeAt[1].s[g].lo : freeAt[1].s[g].hi;
+            float d = q > x ? q - x : x - q;
+            if (bestDist < 0.0f || d < bestDist) {
+                bestDist = d;
+                best     = q;
+            }
+        }
+        return x + (best > x + most ? most : (best < x - most ? -most : best - x));
+    }
+
+    // the widest gap still reachable at the end, aiming for its middle
+    float target = x, bestWidth = -1.0f;
+    for (int a = 0; a < reach[last].n; ++a) {
+        const Span &r = reach[last].s[a];
+        int g = findSpan(freeAt[last], r.lo);
+        if (g < 0) continue;
+        const Span &gap = freeAt[last].s[g];
+        float width = gap.hi - gap.lo;
+        float mid   = (gap.lo + gap.hi) * 0.5f;
+        float aim   = mid < r.lo ? r.lo : (mid > r.hi ? r.hi : mid);
+        float dist  = aim > x ? aim - x : x - aim;
+        float bestDist = target > x ? target - x : x - target;
+        if (width > bestWidth + 1.0f || (width > bestWidth - 1.0f && dist < bestDist)) {
+            bestWidth = width;
+            target    = aim;
+        }
+    }
+
+    // back through the slices, each point the nearest one a slice earlier
+    // from the same free span
+    float p = target;
+    for (int j = last - 1; j >= 1; --j) {
+        int g = findSpan(freeAt[j + 1], p);
+        if (g < 0) break;
+        const Span &gap = freeAt[j + 1].s[g];
+        float best = p, bestDist = -1.0f;
+        for (int a = 0; a < reach[j].n; ++a) {
+            float lo = reach[j].s[a].lo > gap.lo ? reach[j].s[a].lo : gap.lo;
+            float hi = reach[j].s[a].hi < gap.hi ? reach[j].s[a].hi : gap.hi;
+            if (lo > hi) continue;
+            float q = p < lo ? lo : (p > hi ? hi : p);
+            float d = q > p ? q - p : p - q;
+            if (bestDist < 0.0f || d < bestDist) {
+                bestDist = d;
+                best     = q;
+            }
+        }
+        p = best;
+    }
+
+    float move = p - x;
+    if (move > most)  move = most;
+    if (move < -most) move = -most;
+    return x + move;
+}
+
+// ------------- BENCHMARK -------------
+// The rules of main.cpp: a 60 x 50 player at y 40 on an 800 x 600 field,
+// 60 x 30 obstacles at random X falling at 40 px per unit of speed, speed
+// +2 every 15 s, spawns 1.5x as often every 30 s, at most 20 at once.
+const float FIELD_W = 800.0f, FIELD_H = 600.0f;
+const float PLAYER_W = 60.0f, PLAYER_H = 50.0f, PLAYER_Y = 40.0f;
+const float PLAYER_SPEED = 300.0f;     // playerSpeedPixels
+const float OBS_W = 60.0f, OBS_H = 30.0f;
+const int   MAX_OBS = 20;
+const float TICK = 1.0f / 60.0f;
+
+struct BenchGame {
+    float        playerX, time, speed, spawnInterval, spawnTimer, lastSpeedUp, lastSpawnUp;
+    int          count;
+    AutopilotBox obs[MAX_OBS];
+};
+
+static void benchReset(BenchGame &g) {
+    memset(&g, 0, sizeof(g));
+    g.playerX       = FIELD_W / 2.0f - PLAYER_W / 2.0f;
+    g.speed         = 5.0f;
+    g.spawnInterval = 1.0f;
+}
+
+// one tick; false on a crash
+static bool benchStep(BenchGame &g, unsigned &rng) {
+    g.time += TICK;
+    while (g.time - g.lastSpeedUp >= 15.0f) { g.speed += 2.0f; g.lastSpeedUp += 15.0f; }
+    while (g.time - g.lastSpawnUp >= 30.0f) { g.spawnInterval /= 1.5f; g.lastSpawnUp += 30.0f; }
+
+    float fall = g.speed * 40.0f;
+    int kept = 0;
+    for (int i = 0; i < g.count; ++i) {
+        g.obs[i].y -= fall * TICK;
+        if (g.obs[i].y + g.obs[i].h >= 0.0f) g.obs[kept++] = g.obs[i];
+    }
+    g.count = kept;
+
+    g.spawnTimer -= TICK;
+    if (g.spawnTimer <= 0.0f) {
+        if (g.count < MAX_OBS) {
+            rng = rng * 1103515245u + 12345u;
+            AutopilotBox &b = g.obs[g.count++];
+            b.w = OBS_W;
+            b.h = OBS_H;
+            b.x = (float)((rng >> 16) % (unsigned)(FIELD_W - OBS_W));
+            b.y = FIELD_H + OBS_H;
+        }
+        g.spawnTimer = g.spawnInterval;
+    }
+
+    for (int i = 0; i < g.count; ++i) {
+        const AutopilotBox &b = g.obs[i];
+        if (g.playerX < b.x + b.w && g.playerX + PLAYER_W > b.x &&
+            PLAYER_Y < b.y + b.h && PLAYER_Y + PLAYER_H > b.y)
+            return false;
+    }
+    return true;
+}
+
+int autopilotRunBenchmark(int games, float seconds) {
+    if (games < 1) games = 1;
+    if (seconds <= 0.0f) seconds = 60.0f;
+    int ticks = (int)(seconds / TICK);
+    printf("autopilot bench: %d games x %.0f s at 60 Hz\n", games, seconds);
+
+    BenchGame *all = (BenchGame *)malloc(sizeof(BenchGame) * (size_t)games);
+    unsigned  *rng = (unsigned *)malloc(sizeof(unsigned) * (size_t)games);
+    if (!all || !rng) {
+        free(all);
+        free(rng);
+        return 1;
+    }
+
+    // standing still for comparison, then at the keyboard's speed and twice it
+    const float speeds[] = { 0.0f, 1.0f, 2.0f };
+    for (int s = 0; s < 3; ++s) {
+        for (int i = 0; i < games; ++i) {
+            benchReset(all[i]);
+            rng[i] = 12345u + (unsigned)i * 7919u;
+        }
+        long   crashes = 0;
+        double decideSeconds = 0.0, crashedAt = 0.0;
+        for (int t = 0; t < ticks; ++t) {
+            clock_t c0 = clock();
+            for (int i = 0; i < games && speeds[s] > 0.0f; ++i) {
+                BenchGame &g = all[i];
+                AutopilotView v = { g.playerX, PLAYER_Y, PLAYER_W, PLAYER_H, FIELD_W,
+                                    g.speed * 40.0f, PLAYER_SPEED * speeds[s], 0.0f, g.time };
+                v.horizon = (FIELD_H + OBS_H - PLAYER_Y) / v.fallSpeed;
+                g.playerX = autopilotSteer(v, g.obs, g.count, TICK);
+            }
+            decideSeconds += (double)(clock() - c0) / CLOCKS_PER_SEC;
+            for (int i = 0; i < games; ++i) {
+                if (benchStep(all[i], rng[i])) continue;
+                ++crashes;
+                crashedAt += all[i].time;
+                benchReset(all[i]);
+            }
+        }
+        double decisions = (double)games * ticks;
+        if (speeds[s] > 0.0f)
+            printf("  at %.0f px/s: %.2f M decisions/s (%.3f us each), %ld crashes",
+                   PLAYER_SPEED * speeds[s], decisions / decideSeconds / 1e6,
+                   decideSeconds * 1e6 / decisions, crashes);
+        else
+            printf("  standing still: %ld crashes", crashes);
+        if (crashes) printf(", at %.0f s into a game on average", crashedAt / crashes);
+        printf("\n");
+    }
+
+    free(all);
+    free(rng);
+    return 0;
+}
@@ -0,0 +1,46 @@
+// Autopilot for the 2D game: steers the player through the falling
+// obstacles.
+//
+// The player moves continuously along X, so the planner works on
+// intervals instead of lanes. The next `horizon` seconds are cut into
+// AUTOPILOT_SLICES slices; for each one it collects the X ranges where the
+// player's box would touch an obstacle falling through the player's rows
+// and keeps the free intervals between them. Starting from the player's
+// X, it then grows the set of positions reachable at maxSpeed slice by
+// slice, cut down to the free intervals each time, and aims for the widest
+// free gap that is still reachable at the end. The path there is traced
+// back through the slices and the player moves along its first leg; the
+// slices are fixed in game time, so the next tick continues the same plan.
+//
+// Everything is a handful of small interval lists on the stack, so a
+// decision takes about a microsecond and can run every tick in thousands
+// of headless games (--autopilot-bench).
+#ifndef AUTOPILOT_H
+#define AUTOPILOT_H
+
+const int AUTOPILOT_SLICES  = 12;
+const int AUTOPILOT_MAX_BOX = 32;      // obstacles looked at, nearest first
+
+struct AutopilotBox {
+    float x, y, w, h;                  // lower-left corner and size, pixels
+};
+
+struct AutopilotView {
+    float playerX, playerY;            // lower-left corner
+    float playerW, playerH;
+    float fieldWidth;                  // playerX stays in [0, fieldWidth - playerW]
+    float fallSpeed;                   // pixels per second, every obstacle
+    float maxSpeed;                    // how fast the autopilot may move the player
+    float horizon;                     // seconds looked ahead
+    float time;                        // game time, seconds
+};
+
+// The player's X after dt seconds of steering.
+float autopilotSteer(const AutopilotView &v, const AutopilotBox *boxes, int count, float dt);
+
+// --autopilot-bench [games] [seconds]: that many headless games under the
+// game's rules, stepped at 60 Hz with the autopilot deciding every tick;
+// prints decisions/s and how long games last.
+int   autopilotRunBenchmark(int games, float seconds);
+
+#endif // AUTOPILOT_H
@@ -10,6 +10,8 @@
 #include <stdlib.h>
 #include <time.h>
 #include <stdio.h>
+#include <string.h>
+#include "autopilot.h"
 
 bool isDragging = false;
 
@@ -65,6 +67,11 @@ float lastSpawnIncreaseTime = 0.0f;
 
 const float GAME_DURATION = 60.0f;   // seconds of gameplay
 
+// ----------------- AUTOPILOT -----------------
+// A (or --autopilot): steers toward the widest gap it can reach (autopilot.h)
+bool autopilotOn = false;
+const float AUTOPILOT_SPEED = 600.0f;  // pixels per second, twice the keyboard
+
 // ----------------- UTILS -----------------
 void drawString(void *font, const char *str, float x, float y) {
     glRasterPos2f(x, y);
@@ -486,6 +493,9 @@ void drawHUD() {
 
     sprintf(buffer, "Speed: %.1f", gameSpeed);
     drawString(GLUT_BITMAP_HELVETICA_18, buffer, 10.0f, WINDOW_HEIGHT - 90.0f);
+
+    if (autopilotOn)
+        drawString(GLUT_BITMAP_HELVETICA_18, "Autopilot (A)", 10.0f, WINDOW_HEIGHT - 120.0f);
 }
 
 
@@ -723,6 +733,44 @@ void display() {
     glutSwapBuffers();
 }
 
+// ----------------- FRAME PACING -----------------
+// update() only keeps its 16 ms timer alive while a run is being played
+// and the window is visible. Menus, character select and game over are
+// static: they are redrawn when input or a state change asks for it and
+// otherwise GLUT just sleeps waiting for events.
+void update(int value);
+
+bool loopRunning   = false;   // update() timer currently scheduled
+bool windowVisible = true;
+
+bool needsGameLoop() {
+    return gameState == STATE_PLAYING && windowVisible;
+}
+
+void startGameLoop() {
+    if (loopRunning || !needsGameLoop()) return;
+    loopRunning = true;
+    lastTimeMs  = glutGet(GLUT_ELAPSED_TIME);   // idle time is not a dt
+    glutTimerFunc(16, update, 0);
+}
+
+void requestRedraw() {
+    glutPostRedisplay();
+    startGameLoop();
+}
+
+void setGameState(GameState s) {
+    gameState = s;
+    requestRedraw();
+}
+
+void visibility(int state) {
+    // hidden / minimized: the running game pauses until we are shown again
+    windowVisible = (state == GLUT_VISIBLE);
+    if (windowVisible)
+        requestRedraw();
+}
+
 // ----------------- UPDATE (TIMER) -----------------
 void update(int value) {
     (void)value;
@@ -763,6 +811,21 @@ void update(int value) {
             }
         // Move obstacles downward (speed scaled)
         float pixelSpeed = gameSpeed * 40.0f; // convert logical speed to pixels
+
+        if (autopilotOn) {
+            AutopilotBox boxes[MAX_OBS];
+            int count = 0;
+            for (int i = 0; i < MAX_OBS; ++i) {
+                if (!obstacles[i].active) continue;
+                AutopilotBox b = { obstacles[i].x, obstacles[i].y, obstacles[i].w, obstacles[i].h };
+                boxes[count++] = b;
+            }
+            // looks as far ahead as a new obstacle takes to fall past the player
+            AutopilotView v = { playerX, playerY, playerW, playerH, (float)WINDOW_WIDTH,
+                                pixelSpeed, AUTOPILOT_SPEED,
+                                (WINDOW_HEIGHT + 30.0f - playerY) / pixelSpeed, elapsedTime };
+            playerX = autopilotSteer(v, boxes, count, dt);
+        }
         for (int i = 0; i < MAX_OBS; ++i) {
             if (!obstacles[i].active) continue;
             obstacles[i].y -= pixelSpeed * dt;
@@ -785,7 +848,7 @@ void update(int value) {
         // Check collisions
         for (int i = 0; i < MAX_OBS; ++i) {
             if (checkCollision(obstacles[i])) {
-                gameState = STATE_GAMEOVER;
+                setGameState(STATE_GAMEOVER);
                 break;
             }
         }
@@ -794,8 +857,16 @@ void update(int value) {
 
     }
 
+    if (!windowVisible) {
+        loopRunning = false;
+        return;
+    }
+
     glutPostRedisplay();
-    glutTimerFunc(16, update, 0); // ~60 FPS
+    if (needsGameLoop())
+        glutTimerFunc(16, update, 0); // ~60 FPS
+    else
+        loopRunning = false;
 }
 
 // ----------------- INPUT -----------------
@@ -806,9 +877,14 @@ void keyboard(unsigned char key, int x, int y) {
         exit(0);
     }
 
+    if (key == 'a' || key == 'A') {
+        autopilotOn = !autopilotOn;
+        glutPostRedisplay();
+    }
+
     if (gameState == STATE_GAMEOVER && key == ' ') {
         // Restart: go back to character select to choose again
-        gameState = STATE_CHAR_SELECT;
+        setGameState(STATE_CHAR_SELECT);
     }
 }
 
@@ -861,7 +937,7 @@ void mouse(int button, int state, int x, int y) {
         // Start button -> character select
         if (x >= startX && x <= startX + btnW &&
             my >= startY && my <= startY + btnH) {
-            gameState = STATE_CHAR_SELECT;
+            setGameState(STATE_CHAR_SELECT);
             return;
         }
 
@@ -885,21 +961,21 @@ void mouse(int button, int state, int x, int y) {
             my >= cardY && my <= cardY + cardH) {
             currentCharacter = CHAR_CAR;
             resetGame();
-            gameState = STATE_PLAYING;
+            setGameState(STATE_PLAYING);
         }
         // DINO
         else if (x >= card2X && x <= card2X + cardW &&
                  my >= cardY && my <= cardY + cardH) {
             currentCharacter = CHAR_DINO;
             resetGame();
-            gameState = STATE_PLAYING;
+            setGameState(STATE_PLAYING);
         }
         // CAT
         else if (x >= card3X && x <= card3X + cardW &&
                  my >= cardY && my <= cardY + cardH) {
             currentCharacter = CHAR_CAT;
             resetGame();
-            gameState = STATE_PLAYING;
+            setGameState(STATE_PLAYING);
         }
     }
 }
@@ -929,6 +1005,15 @@ void reshape(int w, int h) {
 int main(int argc, char **argv) {
     srand((unsigned int)time(NULL));
 
+    // --autopilot-bench [games] [seconds]: headless games, decisions/s
+    if (argc > 1 && strcmp(argv[1], "--autopilot-bench") == 0)
+        return autopilotRunBenchmark((argc > 2) ? atoi(argv[2]) : 1000,
+                                     (argc > 3) ? (float)atof(argv[3]) : 120.0f);
+    // --autopilot: start with the autopilot on
+    for (int i = 1; i < argc; ++i)
+        if (strcmp(argv[i], "--autopilot") == 0)
+            autopilotOn = true;
+
     glutInit(&argc, argv);
     glutInitDisplayMode(GLUT_DOUBLE | GLUT_RGBA);
     glutInitWindowSize(WINDOW_WIDTH, WINDOW_HEIGHT);
@@ -950,7 +1035,8 @@ int main(int argc, char **argv) {
       glutSpecialFunc(specialKeyboard);
       glutMouseFunc(mouse);
       glutMotionFunc(mouseMotion);   // NEW
-      glutTimerFunc(16, update, 0);
+      glutVisibilityFunc(visibility);
+      startGameLoop();
 
     glutMainLoop();
     return 0;
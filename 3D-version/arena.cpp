@@ -0,0 +1,120 @@
+// Per-session arena and heap checks, see arena.h.
+#include "arena.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <new>
+
+bool arenaInit(Arena &a, size_t capacity) {
+    a.base     = (unsigned char *)malloc(capacity);
+    a.capacity = a.base ? capacity : 0;
+    a.used     = 0;
+    a.peak     = 0;
+    a.failures = 0;
+    if (a.base == NULL) {
+        fprintf(stderr, "arena: could not reserve %lu bytes\n", (unsigned long)capacity);
+        return false;
+    }
+    return true;
+}
+
+void arenaRelease(Arena &a) {
+    free(a.base);
+    a.base     = NULL;
+    a.capacity = a.used = a.peak = 0;
+}
+
+void *arenaAlloc(Arena &a, size_t size, size_t align) {
+    // align is a power of two
+    size_t start = (a.used + align - 1) & ~(align - 1);
+    if (a.base == NULL || start + size > a.capacity) {
+        if (a.failures++ == 0)
+            fprintf(stderr, "arena: out of memory (%lu of %lu bytes used, %lu requested)\n",
+                    (unsigned long)a.used, (unsigned long)a.capacity, (unsigned long)size);
+        return NULL;
+    }
+
+    a.used = start + size;
+    if (a.used > a.peak) a.peak = a.used;
+    return a.base + start;
+}
+
+void arenaReset(Arena &a) {
+    a.used     = 0;
+    a.peak     = 0;
+    a.failures = 0;
+}
+
+// ------------- HEAP CHECKS -------------
+#ifdef ARENA_CHECKS
+
+// Only the thread inside a no-heap region is checked (the mixer thread and
+// GL driver threads are left alone).
+static thread_local bool noHeap = false;
+static long violations = 0;
+
+void arenaBeginNoHeap() { noHeap = true; }
+void arenaEndNoHeap()   { noHeap = false; }
+long arenaHeapViolations() { return violations; }
+
+static void heapUsed(const char *what, size_t size) {
+    if (!noHeap) return;
+    noHeap = false;          // reporting may allocate itself
+    ++violations;
+    fprintf(stderr, "arena: %s(%lu) inside the tick\n", what, (unsigned long)size);
+    assert(!"heap allocation inside the tick");
+    noHeap = true;
+}
+
+void arenaReportSession(const Arena &a) {
+    if (a.peak == 0) return;   // nothing ran since the last report
+    fprintf(stderr, "arena: session peak %lu of %lu bytes (%.1f%%)%s, "
+                    "%ld heap allocations in ticks so far\n",
+            (unsigned long)a.peak, (unsigned long)a.capacity,
+            100.0 * a.peak / a.capacity,
+            a.failures ? ", some allocations failed" : "", violations);
+}
+
+// glibc lets the program replace malloc; everything else is caught at
+// operator new only.
+#if defined(__GLIBC__)
+extern "C" void *__libc_malloc(size_t);
+extern "C" void *__libc_calloc(size_t, size_t);
+extern "C" void *__libc_realloc(void *, size_t);
+
+extern "C" void *malloc(size_t size) {
+    heapUsed("malloc", size);
+    return __libc_malloc(size);
+}
+
+extern "C" void *calloc(size_t n, size_t size) {
+    heapUsed("calloc", n * size);
+    return __libc_calloc(n, size);
+}
+
+extern "C" void *realloc(void *p, size_t size) {
+    heapUsed("realloc", size);
+    return __libc_realloc(p, size);
+}
+
+#define rawMalloc __libc_malloc
+#else
+#define rawMalloc malloc
+#endif
+
+static void *checkedNew(size_t size) {
+    heapUsed("operator new", size);
+    void *p = rawMalloc(size ? size : 1);
+    if (p == NULL) throw std::bad_alloc();
+    return p;
+}
+
+void *operator new(size_t size)   { return checkedNew(size); }
+void *operator new[](size_t size) { return checkedNew(size); }
+void operator delete(void *p) noexcept   { free(p); }
+void operator delete[](void *p) noexcept { free(p); }
+void operator delete(void *p, size_t) noexcept   { free(p); }
+void operator delete[](void *p, size_t) noexcept { free(p); }
+
+#endif // ARENA_CHECKS
@@ -0,0 +1,185 @@
+// Per-session memory for the 3D runner.
+//
+// Everything that lives for one run (obstacles, and whatever else is
+// added per run) is carved out of one arena that is allocated once at
+// startup. Allocation is a pointer bump and resetGame() gives the whole
+// session back at once with arenaReset(); nothing is freed piece by piece
+// and the game loop never touches the general-purpose heap.
+//
+// ChunkPool<T> sits on top for objects that come and go during a run:
+// slots taken from the arena a chunk at a time, with a free list for reuse.
+//
+// Build with -DARENA_CHECKS (the Debug target) to catch heap use in the
+// tick: any malloc/new between ARENA_NO_HEAP_BEGIN() and ARENA_NO_HEAP_END()
+// on that thread is reported and asserts. Each session's peak arena use is
+// printed when it ends.
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+#include <string.h>
+
+struct Arena {
+    unsigned char *base;
+    size_t capacity;
+    size_t used;
+    size_t peak;           // high-water mark of the current session
+    int    failures;       // allocations that didn't fit
+};
+
+bool arenaInit(Arena &a, size_t capacity);
+void arenaRelease(Arena &a);
+
+// Returns NULL (and logs) when the arena is full. Memory is not cleared.
+void *arenaAlloc(Arena &a, size_t size, size_t align = 16);
+
+// Frees everything allocated since the last reset, in O(1).
+void arenaReset(Arena &a);
+
+// Uninitialized array of `count` T; only for types that need no destructor.
+template <typename T>
+T *arenaNew(Arena &a, int count) {
+    return (T *)arenaAlloc(a, sizeof(T) * (size_t)count,
+                           alignof(T) > 16 ? alignof(T) : 16);
+}
+
+// ------------- CHUNKED POOL -------------
+// Slots come from the arena one chunk at a time as they are needed, up to
+// a maximum set at init. Chunks never move, so pointers and handles stay
+// valid while the pool grows. New slots are zeroed.
+//
+// Indices are global (chunk * POOL_CHUNK_SIZE + slot). A handle adds the
+// slot's generation, which changes whenever the slot is freed, so a handle
+// to a released object is recognized as stale.
+const int POOL_CHUNK_SHIFT = 10;
+const int POOL_CHUNK_SIZE  = 1 << POOL_CHUNK_SHIFT;
+
+struct PoolHandle {
+    int      index;
+    unsigned generation;
+};
+
+template <typename T>
+struct PoolChunk {
+    T        items[POOL_CHUNK_SIZE];
+    int      nextFree[POOL_CHUNK_SIZE];
+    unsigned generation[POOL_CHUNK_SIZE];
+};
+
+template <typename T>
+struct ChunkPool {
+    Arena         *arena;
+    PoolChunk<T> **chunks;             // [maxChunks]
+    int            chunkCount;
+    int            maxChunks;
+    int            maxItems;
+    int            freeHead;           // global index, -1 when all chunks are full
+    int            live;
+    int            extent;             // one past the highest index handed out
+};
+
+template <typename T>
+bool chunkPoolInit(ChunkPool<T> &p, Arena &a, int maxItems) {
+    p.arena      = &a;
+    p.maxItems   = maxItems;
+    p.maxChunks  = (maxItems + POOL_CHUNK_SIZE - 1) >> POOL_CHUNK_SHIFT;
+    p.chunks     = arenaNew<PoolChunk<T> *>(a, p.maxChunks);
+    p.chunkCount = 0;
+    p.freeHead   = -1;
+    p.live       = 0;
+    p.extent     = 0;
+    if (p.chunks == NULL) p.maxChunks = p.maxItems = 0;
+    return p.chunks != NULL;
+}
+
+// slots currently backed by memory
+template <typename T>
+int chunkPoolCapacity(const ChunkPool<T> &p) {
+    return p.chunkCount * POOL_CHUNK_SIZE;
+}
+
+// Slots of chunk `c` below the extent; freed slots are reused first, so
+// loops over the pool only need to go this far.
+template <typename T>
+int chunkPoolChunkExtent(const ChunkPool<T> &p, int c) {
+    int n = p.extent - c * POOL_CHUNK_SIZE;
+    return (n < 0) ? 0 : (n > POOL_CHUNK_SIZE ? POOL_CHUNK_SIZE : n);
+}
+
+template <typename T>
+T *chunkPoolAt(const ChunkPool<T> &p, int index) {
+    return &p.chunks[index >> POOL_CHUNK_SHIFT]->items[index & (POOL_CHUNK_SIZE - 1)];
+}
+
+template <typename T>
+bool chunkPoolGrow(ChunkPool<T> &p) {
+    if (p.chunkCount >= p.maxChunks) return false;
+    PoolChunk<T> *c = arenaNew<PoolChunk<T> >(*p.arena, 1);
+    if (c == NULL) return false;
+
+    memset(c, 0, sizeof(*c));
+    int base = p.chunkCount * POOL_CHUNK_SIZE;
+    for (int i = 0; i < POOL_CHUNK_SIZE; ++i)
+        c->nextFree[i] = (i + 1 < POOL_CHUNK_SIZE) ? base + i + 1 : p.freeHead;
+    p.freeHead = base;
+    p.chunks[p.chunkCount++] = c;
+    return true;
+}
+
+// Returns NULL when the pool is at its maximum (or the arena is full).
+template <typename T>
+T *chunkPoolAlloc(ChunkPool<T> &p, PoolHandle *handle = NULL) {
+    if (p.live >= p.maxItems) return NULL;
+    if (p.freeHead < 0 && !chunkPoolGrow(p)) return NULL;
+
+    int i = p.freeHead;
+    PoolChunk<T> *c = p.chunks[i >> POOL_CHUNK_SHIFT];
+    int slot = i & (POOL_CHUNK_SIZE - 1);
+    p.freeHead = c->nextFree[slot];
+    ++p.live;
+    if (i >= p.extent) p.extent = i + 1;
+    if (handle) {
+        handle->index      = i;
+        handle->generation = c->generation[slot];
+    }
+    return &c->items[slot];
+}
+
+template <typename T>
+void chunkPoolFree(ChunkPool<T> &p, int index) {
+    PoolChunk<T> *c = p.chunks[index >> POOL_CHUNK_SHIFT];
+    int slot = index & (POOL_CHUNK_SIZE - 1);
+    ++c->generation[slot];
+    c->nextFree[slot] = p.freeHead;
+    p.freeHead = index;
+    --p.live;
+}
+
+// NULL if the handle's object has been freed since.
+template <typename T>
+T *chunkPoolGet(const ChunkPool<T> &p, PoolHandle h) {
+    if (h.index < 0 || h.index >= chunkPoolCapacity(p)) return NULL;
+    PoolChunk<T> *c = p.chunks[h.index >> POOL_CHUNK_SHIFT];
+    int slot = h.index & (POOL_CHUNK_SIZE - 1);
+    return (c->generation[slot] == h.generation) ? &c->items[slot] : NULL;
+}
+
+// ------------- HEAP CHECKS -------------
+#ifdef ARENA_CHECKS
+
+void arenaBeginNoHeap();
+void arenaEndNoHeap();
+long arenaHeapViolations();           // since startup
+void arenaReportSession(const Arena &a);
+
+#define ARENA_NO_HEAP_BEGIN() arenaBeginNoHeap()
+#define ARENA_NO_HEAP_END()   arenaEndNoHeap()
+
+#else
+
+#define ARENA_NO_HEAP_BEGIN()
+#define ARENA_NO_HEAP_END()
+
+#endif // ARENA_CHECKS
+
+#endif // ARENA_H
@@ -0,0 +1,959 @@
+// Software audio mixer, see audio.h.
+#include "audio.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <atomic>
+#include <chrono>
+#include <vector>
+#include <algorithm>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#include <mmsystem.h>
+#else
+#include <pthread.h>
+#include <time.h>
+#endif
+
+#ifdef HAVE_ALSA
+#include <alsa/asoundlib.h>
+#endif
+
+// ------------- PLATFORM -------------
+static void sleepMicros(long us) {
+    if (us <= 0) return;
+#ifdef _WIN32
+    Sleep((DWORD)((us + 999) / 1000));
+#else
+    struct timespec ts;
+    ts.tv_sec  = us / 1000000;
+    ts.tv_nsec = (us % 1000000) * 1000;
+    nanosleep(&ts, NULL);
+#endif
+}
+
+static double nowMicros() {
+    using namespace std::chrono;
+    return duration_cast<duration<double, std::micro> >(
+        steady_clock::now().time_since_epoch()).count();
+}
+
+// Releases buffers at the rate a sound card would consume them, for sinks
+// that have no device to block on.
+struct RealtimePacer {
+    double nextMicros;
+
+    RealtimePacer() : nextMicros(0.0) {}
+
+    void wait(int frames, int sampleRate) {
+        double now = nowMicros();
+        // first buffer, or we fell far behind: restart the schedule
+        if (nextMicros == 0.0 || now - nextMicros > 100000.0)
+            nextMicros = now;
+        nextMicros += frames * 1000000.0 / sampleRate;
+        sleepMicros((long)(nextMicros - now));
+    }
+};
+
+// ------------- WAV FILES -------------
+struct WavInfo {
+    int  channels;
+    int  sampleRate;
+    int  bits;
+    long dataOffset;
+    long dataBytes;
+};
+
+static unsigned readLE16(const unsigned char *p) {
+    return p[0] | (p[1] << 8);
+}
+
+static unsigned readLE32(const unsigned char *p) {
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((unsigned)p[3] << 24);
+}
+
+static void putLE16(unsigned char *p, unsigned v) {
+    p[0] = v & 0xFF; p[1] = (v >> 8) & 0xFF;
+}
+
+static void putLE32(unsigned char *p, unsigned v) {
+    p[0] = v & 0xFF;         p[1] = (v >> 8) & 0xFF;
+    p[2] = (v >> 16) & 0xFF; p[3] = (v >> 24) & 0xFF;
+}
+
+// Leaves the file positioned at the start of the sample data.
+static bool readWavHeader(FILE *f, WavInfo &info, const char *path) {
+    unsigned char riff[12];
+    if (fread(riff, 1, 12, f) != 12 ||
+        memcmp(riff, "RIFF", 4) != 0 || memcmp(riff + 8, "WAVE", 4) != 0) {
+        fprintf(stderr, "audio: %s is not a WAV file\n", path);
+        return false;
+    }
+
+    bool haveFmt = false;
+    for (;;) {
+        unsigned char chunk[8];
+        if (fread(chunk, 1, 8, f) != 8) break;
+        unsigned size = readLE32(chunk + 4);
+
+        if (memcmp(chunk, "fmt ", 4) == 0) {
+            unsigned char fmt[16];
+            if (size < 16 || fread(fmt, 1, 16, f) != 16) break;
+
+            unsigned tag    = readLE16(fmt);
+            info.channels   = (int)readLE16(fmt + 2);
+            info.sampleRate = (int)readLE32(fmt + 4);
+            info.bits       = (int)readLE16(fmt + 14);
+            if ((tag != 1 && tag != 0xFFFE) || info.bits != 16 ||
+                info.channels < 1 || info.channels > 2 || info.sampleRate <= 0) {
+                fprintf(stderr, "audio: %s: only 16-bit PCM mono/stereo is supported\n", path);
+                return false;
+            }
+            haveFmt = true;
+            fseek(f, (long)(size - 16 + (size & 1)), SEEK_CUR);
+        } else if (memcmp(chunk, "data", 4) == 0) {
+            if (!haveFmt) break;
+            info.dataOffset = ftell(f);
+            info.dataBytes  = (long)size;
+            return true;
+        } else {
+            fseek(f, (long)(size + (size & 1)), SEEK_CUR);
+        }
+    }
+
+    fprintf(stderr, "audio: %s: no PCM data found\n", path);
+    return false;
+}
+
+static void writeWavHeader(FILE *f, int sampleRate, int channels, unsigned dataBytes) {
+    unsigned char h[44];
+    memcpy(h, "RIFF", 4);
+    putLE32(h + 4, 36 + dataBytes);
+    memcpy(h + 8, "WAVEfmt ", 8);
+    putLE32(h + 16, 16);
+    putLE16(h + 20, 1);                            // PCM
+    putLE16(h + 22, (unsigned)channels);
+    putLE32(h + 24, (unsigned)sampleRate);
+    putLE32(h + 28, (unsigned)(sampleRate * channels * 2));
+    putLE16(h + 32, (unsigned)(channels * 2));
+    putLE16(h + 34, 16);
+    memcpy(h + 36, "data", 4);
+    putLE32(h + 40, dataBytes);
+    fwrite(h, 1, sizeof(h), f);
+}
+
+// ------------- BACKENDS -------------
+class NullAudioBackend : public AudioBackend {
+public:
+    explicit NullAudioBackend(bool realtime) : realtime(realtime), sampleRate(0) {}
+
+    bool open(int rate, int channels, int framesPerBuffer) {
+        (void)channels; (void)framesPerBuffer;
+        sampleRate = rate;
+        return true;
+    }
+    bool write(const short *samples, int frames) {
+        (void)samples;
+        if (realtime) pacer.wait(frames, sampleRate);
+        return true;
+    }
+    void close() {}
+    const char *name() const { return "null"; }
+
+private:
+    bool          realtime;
+    int           sampleRate;
+    RealtimePacer pacer;
+};
+
+class WavFileAudioBackend : public AudioBackend {
+public:
+    WavFileAudioBackend(const char *path, bool realtime)
+        : path(path), realtime(realtime), file(NULL),
+          sampleRate(0), channels(0), dataBytes(0) {}
+
+    bool open(int rate, int ch, int framesPerBuffer) {
+        (void)framesPerBuffer;
+        file = fopen(path, "wb");
+        if (file == NULL) {
+            fprintf(stderr, "audio: can't write %s\n", path);
+            return false;
+        }
+        sampleRate = rate;
+        channels   = ch;
+        dataBytes  = 0;
+        writeWavHeader(file, sampleRate, channels, 0);   // sizes patched in close()
+        return true;
+    }
+    bool write(const short *samples, int frames) {
+        size_t bytes = (size_t)frames * channels * sizeof(short);
+        if (fwrite(samples, 1, bytes, file) != bytes) return false;
+        dataBytes += (unsigned)bytes;
+        if (realtime) pacer.wait(frames, sampleRate);
+        return true;
+    }
+    void close() {
+        if (file == NULL) return;
+        fseek(file, 0, SEEK_SET);
+        writeWavHeader(file, sampleRate, channels, dataBytes);
+        fclose(file);
+        file = NULL;
+    }
+    const char *name() const { return "wav"; }
+
+private:
+    const char   *path;
+    bool          realtime;
+    FILE         *file;
+    int           sampleRate;
+    int           channels;
+    unsigned      dataBytes;
+    RealtimePacer pacer;
+};
+
+#ifdef _WIN32
+// waveOut with a few queued buffers; write() waits on the "buffer done"
+// event, which is what paces the mixer thread.
+class WinmmAudioBackend : public AudioBackend {
+public:
+    WinmmAudioBackend() : device(NULL), doneEvent(NULL), next(0), channels(0), bufferBytes(0) {
+        for (int i = 0; i < NUM_BUFFERS; ++i) {
+            memory[i] = NULL;
+            queued[i] = false;
+        }
+    }
+
+    bool open(int rate, int ch, int framesPerBuffer) {
+        WAVEFORMATEX fmt;
+        memset(&fmt, 0, sizeof(fmt));
+        fmt.wFormatTag      = WAVE_FORMAT_PCM;
+        fmt.nChannels       = (WORD)ch;
+        fmt.nSamplesPerSec  = (DWORD)rate;
+        fmt.wBitsPerSample  = 16;
+        fmt.nBlockAlign     = (WORD)(ch * 2);
+        fmt.nAvgBytesPerSec = (DWORD)(rate * ch * 2);
+
+        doneEvent = CreateEvent(NULL, FALSE, FALSE, NULL);
+        if (waveOutOpen(&device, WAVE_MAPPER, &fmt, (DWORD_PTR)doneEvent, 0,
+                        CALLBACK_EVENT) != MMSYSERR_NOERROR) {
+            CloseHandle(doneEvent);
+            doneEvent = NULL;
+            device    = NULL;
+            return false;
+        }
+
+        channels    = ch;
+        bufferBytes = framesPerBuffer * ch * (int)sizeof(short);
+        for (int i = 0; i < NUM_BUFFERS; ++i) {
+            memory[i] = (short *)malloc(bufferBytes);
+            memset(&headers[i], 0, sizeof(WAVEHDR));
+            headers[i].lpData         = (LPSTR)memory[i];
+            headers[i].dwBufferLength = (DWORD)bufferBytes;
+            waveOutPrepareHeader(device, &headers[i], sizeof(WAVEHDR));
+            queued[i] = false;
+        }
+        return true;
+    }
+
+    bool write(const short *samples, int frames) {
+        WAVEHDR &h = headers[next];
+        while (queued[next] && !(h.dwFlags & WHDR_DONE))
+            WaitForSingleObject(doneEvent, 50);
+
+        int bytes = frames * channels * (int)sizeof(short);
+        if (bytes > bufferBytes) bytes = bufferBytes;
+        memcpy(h.lpData, samples, bytes);
+        h.dwBufferLength = (DWORD)bytes;
+        h.dwFlags &= ~WHDR_DONE;
+        if (waveOutWrite(device, &h, sizeof(WAVEHDR)) != MMSYSERR_NOERROR)
+            return false;
+
+        queued[next] = true;
+        next = (next + 1) % NUM_BUFFERS;
+        return true;
+    }
+
+    void close() {
+        if (device == NULL) return;
+        waveOutReset(device);
+        for (int i = 0; i < NUM_BUFFERS; ++i) {
+            waveOutUnprepareHeader(device, &headers[i], sizeof(WAVEHDR));
+            free(memory[i]);
+            memory[i] = NULL;
+        }
+        waveOutClose(device);
+        CloseHandle(doneEvent);
+        device    = NULL;
+        doneEvent = NULL;
+    }
+
+    const char *name() const { return "waveOut"; }
+
+private:
+    static const int NUM_BUFFERS = 3;   // ~35 ms of queued audio
+
+    HWAVEOUT device;
+    HANDLE   doneEvent;
+    WAVEHDR  headers[NUM_BUFFERS];
+    short   *memory[NUM_BUFFERS];
+    bool     queued[NUM_BUFFERS];
+    int      next;
+    int      channels;
+    int      bufferBytes;
+};
+#endif // _WIN32
+
+#ifdef HAVE_ALSA
+class AlsaAudioBackend : public AudioBackend {
+public:
+    AlsaAudioBackend() : pcm(NULL), channels(0) {}
+
+    bool open(int rate, int ch, int framesPerBuffer) {
+        if (snd_pcm_open(&pcm, "default", SND_PCM_STREAM_PLAYBACK, 0) < 0) {
+            pcm = NULL;
+            return false;
+        }
+        // ask for roughly three mixer buffers of device latency
+        unsigned latencyUs = (unsigned)(3LL * framesPerBuffer * 1000000 / rate);
+        if (snd_pcm_set_params(pcm, SND_PCM_FORMAT_S16_LE,
+                               SND_PCM_ACCESS_RW_INTERLEAVED,
+                               (unsigned)ch, (unsigned)rate, 1, latencyUs) < 0) {
+            snd_pcm_close(pcm);
+            pcm = NULL;
+            return false;
+        }
+        channels = ch;
+        return true;
+    }
+
+    bool write(const short *samples, int frames) {
+        while (frames > 0) {
+            snd_pcm_sframes_t n = snd_pcm_writei(pcm, samples, (snd_pcm_uframes_t)frames);
+            if (n < 0) {
+                // underrun or suspend: recover and retry this buffer
+                if (snd_pcm_recover(pcm, (int)n, 1) < 0) return false;
+                continue;
+            }
+            samples += n * channels;
+            frames  -= (int)n;
+        }
+        return true;
+    }
+
+    void close() {
+        if (pcm == NULL) return;
+        snd_pcm_drop(pcm);
+        snd_pcm_close(pcm);
+        pcm = NULL;
+    }
+
+    const char *name() const { return "alsa"; }
+
+private:
+    snd_pcm_t *pcm;
+    int        channels;
+};
+#endif // HAVE_ALSA
+
+AudioBackend *createNullAudioBackend(bool realtime) {
+    return new NullAudioBackend(realtime);
+}
+
+AudioBackend *createWavFileAudioBackend(const char *path, bool realtime) {
+    return new WavFileAudioBackend(path, realtime);
+}
+
+AudioBackend *createDefaultAudioBackend() {
+#if defined(_WIN32)
+    return new WinmmAudioBackend();
+#elif defined(HAVE_ALSA)
+    return new AlsaAudioBackend();
+#else
+    return new NullAudioBackend(true);
+#endif
+}
+
+// ------------- SOUND CLIPS -------------
+// Effects are short mono clips at the output rate, fully in memory.
+// A clip set with audioSetEffectPCM() is used in place; otherwise
+// assets/sfx_<name>.wav, or else the built-in synthesized version.
+static const short        *clipData[NUM_SFX];
+static int                 clipLength[NUM_SFX];
+static std::vector<short>  clipStorage[NUM_SFX];
+
+static const char *clipFiles[NUM_SFX] = {
+    "assets/sfx_collision.wav",
+    "assets/sfx_shield.wav",
+    "assets/sfx_powerup.wav"
+};
+
+static bool loadClip(const char *path, std::vector<short> &out) {
+    FILE *f = fopen(path, "rb");
+    if (f == NULL) return false;
+
+    WavInfo info;
+    if (!readWavHeader(f, info, path)) {
+        fclose(f);
+        return false;
+    }
+
+    long frames = info.dataBytes / (info.channels * 2);
+    std::vector<short> raw((size_t)frames * info.channels);
+    frames = (long)fread(&raw[0], info.channels * 2, (size_t)frames, f);
+    fclose(f);
+    if (frames <= 0) return false;
+
+    // downmix to mono and resample (nearest) to the output rate
+    long outFrames = (long)((double)frames * AUDIO_SAMPLE_RATE / info.sampleRate);
+    out.resize((size_t)outFrames);
+    for (long i = 0; i < outFrames; ++i) {
+        long src = (long)((double)i * info.sampleRate / AUDIO_SAMPLE_RATE);
+        if (src >= frames) src = frames - 1;
+        int v = raw[(size_t)src * info.channels];
+        if (info.channels == 2) v = (v + raw[(size_t)src * 2 + 1]) / 2;
+        out[(size_t)i] = (short)v;
+    }
+    return true;
+}
+
+static void synthClip(SoundEffect sfx, std::vector<short> &out) {
+    const float TWO_PI = 6.2831853f;
+    float seconds = (sfx == SFX_COLLISION) ? 0.30f :
+                    (sfx == SFX_SHIELD_PICKUP) ? 0.22f : 0.35f;
+    int n = (int)(seconds * AUDIO_SAMPLE_RATE);
+    out.resize((size_t)n);
+
+    unsigned noise = 22222u;
+    float    phase = 0.0f;
+    for (int i = 0; i < n; ++i) {
+        float t    = (float)i / AUDIO_SAMPLE_RATE;
+        float fade = 1.0f - t / seconds;
+        float v    = 0.0f;
+
+        if (sfx == SFX_COLLISION) {
+            // noisy crunch over a low thump
+            noise = noise * 1103515245u + 12345u;
+            float white = (float)((noise >> 16) & 0x7FFF) / 16384.0f - 1.0f;
+            v = expf(-t * 14.0f) * (0.55f * white + 0.6f * sinf(TWO_PI * 90.0f * t));
+        } else if (sfx == SFX_SHIELD_PICKUP) {
+            // two-note chime
+            float f = (t < seconds * 0.4f) ? 880.0f : 1320.0f;
+            phase += TWO_PI * f / AUDIO_SAMPLE_RATE;
+            v = 0.5f * sinf(phase) * fade;
+        } else {
+            // rising sweep
+            float f = 400.0f + 800.0f * (t / seconds);
+            phase += TWO_PI * f / AUDIO_SAMPLE_RATE;
+            v = 0.45f * sinf(phase) * fade;
+        }
+
+        if (v >  1.0f) v =  1.0f;
+        if (v < -1.0f) v = -1.0f;
+        out[(size_t)i] = (short)(v * 26000.0f);
+    }
+}
+
+static void loadClips() {
+    for (int i = 0; i < NUM_SFX; ++i) {
+        if (clipData[i] != NULL) continue;
+        if (!loadClip(clipFiles[i], clipStorage[i]))
+            synthClip((SoundEffect)i, clipStorage[i]);
+        clipData[i]   = &clipStorage[i][0];
+        clipLength[i] = (int)clipStorage[i].size();
+    }
+}
+
+// ------------- MUSIC STREAM -------------
+const int MUSIC_CHUNK_FRAMES = 4096;   // 16 KB of stereo samples per read
+const int MUSIC_GAIN         = 2458;   // 0.6 in Q12
+
+// Either streamed from a file, or played straight from memory that the
+// caller keeps alive (memData != NULL).
+struct MusicStream {
+    FILE        *file;
+    WavInfo      info;
+    long         bytesLeft;            // in the data chunk, before looping
+    short        chunk[MUSIC_CHUNK_FRAMES * 2];
+    const short *memData;
+    long         memFrames;
+    long         memPos;               // next frame to hand out
+    const short *chunkData;            // current chunk, file or memory
+    int          chunkFrames;
+    double       pos;                  // read position in chunk (frames)
+    double       step;                 // source frames per output frame
+};
+
+static void closeMusic(MusicStream *m) {
+    if (m == NULL) return;
+    if (m->file) fclose(m->file);
+    delete m;
+}
+
+// Reads the next chunk, wrapping to the start of the data at the end.
+// Samples are used as stored, i.e. a little-endian host is assumed.
+static bool fillMusicChunk(MusicStream *m) {
+    if (m->memData) {
+        if (m->memPos >= m->memFrames) m->memPos = 0;
+        long frames = m->memFrames - m->memPos;
+        if (frames > MUSIC_CHUNK_FRAMES) frames = MUSIC_CHUNK_FRAMES;
+        m->chunkData   = m->memData + m->memPos * m->info.channels;
+        m->chunkFrames = (int)frames;
+        m->memPos     += frames;
+        return frames > 0;
+    }
+
+    int frameBytes = m->info.channels * 2;
+
+    for (int attempt = 0; attempt < 2; ++attempt) {
+        if (m->bytesLeft < frameBytes) {
+            fseek(m->file, m->info.dataOffset, SEEK_SET);
+            m->bytesLeft = m->info.dataBytes;
+        }
+
+        long want = (long)MUSIC_CHUNK_FRAMES * frameBytes;
+        if (want > m->bytesLeft) want = m->bytesLeft - m->bytesLeft % frameBytes;
+
+        size_t got = fread(m->chunk, 1, (size_t)want, m->file);
+        m->bytesLeft = (got < (size_t)want) ? 0 : m->bytesLeft - (long)got;
+
+        int frames = (int)(got / frameBytes);
+        if (frames > 0) {
+            m->chunkData   = m->chunk;
+            m->chunkFrames = frames;
+            return true;
+        }
+    }
+    return false;
+}
+
+static MusicStream *openMusic(const char *path) {
+    FILE *f = fopen(path, "rb");
+    if (f == NULL) {
+        fprintf(stderr, "audio: can't open %s\n", path);
+        return NULL;
+    }
+
+    MusicStream *m = new MusicStream();
+    m->file    = f;
+    m->memData = NULL;
+    if (!readWavHeader(f, m->info, path)) {
+        closeMusic(m);
+        return NULL;
+    }
+    m->bytesLeft   = m->info.dataBytes;
+    m->chunkFrames = 0;
+    m->pos         = 0.0;
+    m->step        = (double)m->info.sampleRate / AUDIO_SAMPLE_RATE;
+
+    // first chunk is read here so the mixer thread starts with data
+    if (!fillMusicChunk(m)) {
+        closeMusic(m);
+        return NULL;
+    }
+    return m;
+}
+
+// ------------- MIXER -------------
+const int MAX_VOICES = 16;
+const int QUEUE_SIZE = 64;    // power of two
+
+struct Voice {
+    const short *data;        // NULL = free
+    int          length;
+    int          pos;
+    int          gain;        // Q12
+};
+
+enum AudioCommandType {
+    CMD_PLAY,
+    CMD_MUSIC
+};
+
+struct AudioCommand {
+    AudioCommandType type;
+    int              sfx;
+    int              gain;
+    MusicStream     *music;
+};
+
+// single producer (game thread) / single consumer (mixer) ring
+static AudioCommand          commandQueue[QUEUE_SIZE];
+static std::atomic<unsigned> queueHead(0);
+static std::atomic<unsigned> queueTail(0);
+
+// owned by whoever is running mixBuffer() (the mixer thread, or the
+// benchmark when there is no thread)
+static Voice        voices[MAX_VOICES];
+static MusicStream *music = NULL;
+
+static AudioBackend        *backend = NULL;
+static std::atomic<bool>    running(false);
+static std::atomic<long>    statBuffers(0);
+static std::atomic<long>    statMixTotalNs(0);
+static std::atomic<long>    statMixMaxNs(0);
+static std::atomic<int>     statVoices(0);
+
+#ifdef _WIN32
+static HANDLE    mixerThread = NULL;
+#else
+static pthread_t mixerThread;
+static bool      mixerThreadStarted = false;
+#endif
+
+static bool pushCommand(const AudioCommand &cmd) {
+    unsigned head = queueHead.load(std::memory_order_relaxed);
+    if (head - queueTail.load(std::memory_order_acquire) >= (unsigned)QUEUE_SIZE)
+        return false;   // full: drop rather than block the frame
+    commandQueue[head & (QUEUE_SIZE - 1)] = cmd;
+    queueHead.store(head + 1, std::memory_order_release);
+    return true;
+}
+
+static bool popCommand(AudioCommand &cmd) {
+    unsigned tail = queueTail.load(std::memory_order_relaxed);
+    if (tail == queueHead.load(std::memory_order_acquire))
+        return false;
+    cmd = commandQueue[tail & (QUEUE_SIZE - 1)];
+    queueTail.store(tail + 1, std::memory_order_release);
+    return true;
+}
+
+static void startVoice(int sfx, int gain) {
+    if (sfx < 0 || sfx >= NUM_SFX || clipData[sfx] == NULL) return;
+
+    // free slot, or steal the one closest to finishing
+    int slot = 0;
+    int best = -1;
+    for (int i = 0; i < MAX_VOICES; ++i) {
+        if (voices[i].data == NULL) { slot = i; break; }
+        int done = voices[i].pos * 256 / voices[i].length;
+        if (done > best) { best = done; slot = i; }
+    }
+
+    voices[slot].data   = clipData[sfx];
+    voices[slot].length = clipLength[sfx];
+    voices[slot].pos    = 0;
+    voices[slot].gain   = gain;
+}
+
+static void mixMusic(int *acc, int frames) {
+    MusicStream *m  = music;
+    int channels    = m->info.channels;
+
+    for (int i = 0; i < frames; ++i) {
+        int idx = (int)m->pos;
+        while (idx >= m->chunkFrames) {
+            m->pos -= m->chunkFrames;
+            if (!fillMusicChunk(m)) {
+                closeMusic(m);   // read error: stop the music, keep effects
+                music = NULL;
+                return;
+            }
+            idx = (int)m->pos;
+        }
+
+        const short *s = m->chunkData + idx * channels;
+        int l = s[0];
+        int r = (channels == 2) ? s[1] : s[0];
+        acc[2 * i]     += (l * MUSIC_GAIN) >> 12;
+        acc[2 * i + 1] += (r * MUSIC_GAIN) >> 12;
+        m->pos += m->step;
+    }
+}
+
+// Drains pending commands and mixes one buffer of interleaved stereo.
+static void mixBuffer(short *out, int frames) {
+    AudioCommand cmd;
+    while (popCommand(cmd)) {
+        if (cmd.type == CMD_PLAY) {
+            startVoice(cmd.sfx, cmd.gain);
+        } else {
+            closeMusic(music);
+            music = cmd.music;
+        }
+    }
+
+    int acc[AUDIO_FRAMES_PER_BUFFER * AUDIO_CHANNELS];
+    if (frames > AUDIO_FRAMES_PER_BUFFER) frames = AUDIO_FRAMES_PER_BUFFER;
+    memset(acc, 0, sizeof(int) * frames * AUDIO_CHANNELS);
+
+    if (music) mixMusic(acc, frames);
+
+    int active = 0;
+    for (int v = 0; v < MAX_VOICES; ++v) {
+        Voice &voice = voices[v];
+        if (voice.data == NULL) continue;
+
+        int n = voice.length - voice.pos;
+        if (n > frames) n = frames;
+        const short *src = voice.data + voice.pos;
+        for (int i = 0; i < n; ++i) {
+            int s = (src[i] * voice.gain) >> 12;
+            acc[2 * i]     += s;
+            acc[2 * i + 1] += s;
+        }
+
+        voice.pos += n;
+        if (voice.pos >= voice.length) voice.data = NULL;
+        else                           ++active;
+    }
+
+    for (int i = 0; i < frames * AUDIO_CHANNELS; ++i) {
+        int s = acc[i];
+        if (s >  32767) s =  32767;
+        if (s < -32768) s = -32768;
+        out[i] = (short)s;
+    }
+
+    statVoices.store(active, std::memory_order_relaxed);
+}
+
+static void recordMixTime(double micros) {
+    long ns = (long)(micros * 1000.0);
+    statBuffers.fetch_add(1, std::memory_order_relaxed);
+    statMixTotalNs.fetch_add(ns, std::memory_order_relaxed);
+    if (ns > statMixMaxNs.load(std::memory_order_relaxed))
+        statMixMaxNs.store(ns, std::memory_order_relaxed);
+}
+
+static void mixerLoop() {
+    short buffer[AUDIO_FRAMES_PER_BUFFER * AUDIO_CHANNELS];
+
+    while (running.load(std::memory_order_acquire)) {
+        double t0 = nowMicros();
+        mixBuffer(buffer, AUDIO_FRAMES_PER_BUFFER);
+        recordMixTime(nowMicros() - t0);
+
+        if (!backend->write(buffer, AUDIO_FRAMES_PER_BUFFER)) {
+            fprintf(stderr, "audio: %s backend failed, stopping mixer\n", backend->name());
+            break;
+        }
+    }
+}
+
+#ifdef _WIN32
+static DWORD WINAPI mixerThreadMain(LPVOID) {
+    mixerLoop();
+    return 0;
+}
+#else
+static void *mixerThreadMain(void *) {
+    mixerLoop();
+    return NULL;
+}
+#endif
+
+// ------------- PUBLIC API -------------
+bool audioInit(AudioBackend *out) {
+    if (running.load()) {
+        delete out;
+        return true;
+    }
+
+    loadClips();
+
+    if (!out->open(AUDIO_SAMPLE_RATE, AUDIO_CHANNELS, AUDIO_FRAMES_PER_BUFFER)) {
+        fprintf(stderr, "audio: no %s output, continuing silently\n", out->name());
+        delete out;
+        out = createNullAudioBackend(true);
+        out->open(AUDIO_SAMPLE_RATE, AUDIO_CHANNELS, AUDIO_FRAMES_PER_BUFFER);
+    }
+    backend = out;
+
+    running.store(true, std::memory_order_release);
+#ifdef _WIN32
+    mixerThread = CreateThread(NULL, 0, mixerThreadMain, NULL, 0, NULL);
+    bool started = (mixerThread != NULL);
+    if (started) SetThreadPriority(mixerThread, THREAD_PRIORITY_TIME_CRITICAL);
+#else
+    mixerThreadStarted = (pthread_create(&mixerThread, NULL, mixerThreadMain, NULL) == 0);
+    bool started = mixerThreadStarted;
+#endif
+    if (!started) {
+        fprintf(stderr, "audio: can't start mixer thread\n");
+        running.store(false);
+        backend->close();
+        delete backend;
+        backend = NULL;
+        return false;
+    }
+
+    static bool registered = false;
+    if (!registered) {
+        atexit(audioShutdown);
+        registered = true;
+    }
+    return true;
+}
+
+static bool queueMusic(MusicStream *m) {
+    AudioCommand cmd;
+    cmd.type  = CMD_MUSIC;
+    cmd.sfx   = 0;
+    cmd.gain  = 0;
+    cmd.music = m;
+    if (!pushCommand(cmd)) {
+        closeMusic(m);
+        return false;
+    }
+    return true;
+}
+
+bool audioStartMusic(const char *wavPath) {
+    MusicStream *m = openMusic(wavPath);
+    return m != NULL && queueMusic(m);
+}
+
+bool audioStartMusicPCM(const short *samples, long frames, int sampleRate, int channels) {
+    if (samples == NULL || frames <= 0 || sampleRate <= 0 ||
+        channels < 1 || channels > 2)
+        return false;
+
+    MusicStream *m = new MusicStream();
+    m->file            = NULL;
+    m->info.channels   = channels;
+    m->info.sampleRate = sampleRate;
+    m->info.bits       = 16;
+    m->memData         = samples;
+    m->memFrames       = frames;
+    m->memPos          = 0;
+    m->pos             = 0.0;
+    m->step            = (double)sampleRate / AUDIO_SAMPLE_RATE;
+    fillMusicChunk(m);
+    return queueMusic(m);
+}
+
+void audioSetEffectPCM(SoundEffect sfx, const short *samples, int frames) {
+    if (running.load() || sfx < 0 || sfx >= NUM_SFX || samples == NULL || frames <= 0)
+        return;   // the mixer thread reads clips without locking
+    clipStorage[sfx].clear();
+    clipData[sfx]   = samples;
+    clipLength[sfx] = frames;
+}
+
+void audioPlay(SoundEffect sfx, float volume) {
+    if (volume < 0.0f) volume = 0.0f;
+    if (volume > 1.0f) volume = 1.0f;
+
+    AudioCommand cmd;
+    cmd.type  = CMD_PLAY;
+    cmd.sfx   = (int)sfx;
+    cmd.gain  = (int)(volume * 4096.0f);
+    cmd.music = NULL;
+    pushCommand(cmd);
+}
+
+AudioStats audioGetStats() {
+    AudioStats s;
+    s.buffersMixed = statBuffers.load(std::memory_order_relaxed);
+    s.avgMixMicros = s.buffersMixed > 0
+        ? statMixTotalNs.load(std::memory_order_relaxed) / 1000.0 / s.buffersMixed
+        : 0.0;
+    s.maxMixMicros = statMixMaxNs.load(std::memory_order_relaxed) / 1000.0;
+    s.activeVoices = statVoices.load(std::memory_order_relaxed);
+    return s;
+}
+
+void audioShutdown() {
+    if (running.exchange(false)) {
+#ifdef _WIN32
+        WaitForSingleObject(mixerThread, INFINITE);
+        CloseHandle(mixerThread);
+        mixerThread = NULL;
+#else
+        if (mixerThreadStarted) pthread_join(mixerThread, NULL);
+        mixerThreadStarted = false;
+#endif
+    }
+
+    if (backend) {
+        backend->close();
+        delete backend;
+        backend = NULL;
+    }
+
+    // music handed over but never picked up by the mixer
+    AudioCommand cmd;
+    while (popCommand(cmd))
+        if (cmd.type == CMD_MUSIC) closeMusic(cmd.music);
+
+    closeMusic(music);
+    music = NULL;
+    for (int i = 0; i < MAX_VOICES; ++i)
+        voices[i].data = NULL;
+}
+
+// ------------- BENCHMARK -------------
+int audioRunBenchmark(const char *musicPath, const char *wavOutPath, float seconds) {
+    if (running.load()) {
+        fprintf(stderr, "audio: benchmark can't run while the mixer thread is active\n");
+        return 1;
+    }
+
+    loadClips();
+
+    AudioBackend *sink = wavOutPath ? createWavFileAudioBackend(wavOutPath, false)
+                                    : createNullAudioBackend(false);
+    if (!sink->open(AUDIO_SAMPLE_RATE, AUDIO_CHANNELS, AUDIO_FRAMES_PER_BUFFER)) {
+        delete sink;
+        return 1;
+    }
+
+    if (musicPath && !audioStartMusic(musicPath)) {
+        fprintf(stderr, "audio: benchmarking effects only\n");
+        musicPath = NULL;
+    }
+
+    int buffers = (int)(seconds * AUDIO_SAMPLE_RATE / AUDIO_FRAMES_PER_BUFFER);
+    if (buffers < 1) buffers = 1;
+
+    std::vector<double> cost((size_t)buffers);
+    short buffer[AUDIO_FRAMES_PER_BUFFER * AUDIO_CHANNELS];
+    int peakVoices = 0;
+
+    double start = nowMicros();
+    for (int b = 0; b < buffers; ++b) {
+        // an effect every 4 buffers (~46 ms) keeps several voices overlapping
+        if (b % 4 == 0)
+            audioPlay((SoundEffect)((b / 4) % NUM_SFX), 0.8f);
+
+        double t0 = nowMicros();
+        mixBuffer(buffer, AUDIO_FRAMES_PER_BUFFER);
+        cost[(size_t)b] = nowMicros() - t0;
+
+        int v = statVoices.load(std::memory_order_relaxed);
+        if (v > peakVoices) peakVoices = v;
+
+        sink->write(buffer, AUDIO_FRAMES_PER_BUFFER);
+    }
+    double total = nowMicros() - start;
+
+    sink->close();
+    delete sink;
+    closeMusic(music);
+    music = NULL;
+
+    std::vector<double> sorted = cost;
+    std::sort(sorted.begin(), sorted.end());
+    double sum = 0.0;
+    for (size_t i = 0; i < cost.size(); ++i) sum += cost[i];
+
+    double budget = AUDIO_FRAMES_PER_BUFFER * 1000000.0 / AUDIO_SAMPLE_RATE;
+    printf("audio mix benchmark: %d buffers of %d frames (%.1f s of audio), sink=%s\n",
+           buffers, AUDIO_FRAMES_PER_BUFFER,
+           (double)buffers * AUDIO_FRAMES_PER_BUFFER / AUDIO_SAMPLE_RATE,
+           wavOutPath ? wavOutPath : "null");
+    printf("  music: %s, peak voices: %d\n", musicPath ? musicPath : "none", peakVoices);
+    printf("  mix cost per buffer (us): avg %.2f  p50 %.2f  p99 %.2f  max %.2f\n",
+           sum / buffers,
+           sorted[sorted.size() / 2],
+           sorted[(size_t)(sorted.size() * 0.99)],
+           sorted.back());
+    printf("  buffer budget %.1f us, %.0fx faster than realtime (incl. sink)\n",
+           budget, (double)buffers * budget / total);
+    return 0;
+}
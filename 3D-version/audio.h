@@ -0,0 +1,83 @@
+// Small software audio mixer for the 3D runner.
+//
+// A mixer thread streams the soundtrack from disk in chunks, mixes short
+// one-shot effects on top and hands fixed-size buffers to a pluggable
+// output backend. The game thread only pushes "play" requests into a
+// lock-free queue, so triggering a sound never blocks a frame.
+//
+// Output is always 16-bit stereo at AUDIO_SAMPLE_RATE. Input WAVs must be
+// 16-bit PCM (mono or stereo); other sample rates are resampled
+// nearest-neighbour.
+#ifndef AUDIO_H
+#define AUDIO_H
+
+const int AUDIO_SAMPLE_RATE       = 44100;
+const int AUDIO_CHANNELS          = 2;
+const int AUDIO_FRAMES_PER_BUFFER = 512;   // ~11.6 ms per buffer
+
+enum SoundEffect {
+    SFX_COLLISION,       // obstacle hit (shield used or game over)
+    SFX_SHIELD_PICKUP,
+    SFX_POWERUP,         // powerup activated
+    NUM_SFX
+};
+
+// Where mixed buffers go. write() is called from the mixer thread and is
+// expected to block until the device can take more data; that is what
+// paces the mixer.
+class AudioBackend {
+public:
+    virtual ~AudioBackend() {}
+    virtual bool open(int sampleRate, int channels, int framesPerBuffer) = 0;
+    virtual bool write(const short *samples, int frames) = 0;
+    virtual void close() = 0;
+    virtual const char *name() const = 0;
+};
+
+// Discards everything. With realtime = true it sleeps like a device would,
+// otherwise it returns immediately (for headless runs and benchmarks).
+AudioBackend *createNullAudioBackend(bool realtime);
+
+// Writes the mix into a .wav file. Same pacing option as the null sink.
+AudioBackend *createWavFileAudioBackend(const char *path, bool realtime);
+
+// The platform's device (waveOut on Windows, ALSA when built with
+// HAVE_ALSA); falls back to a realtime null sink if there is none.
+AudioBackend *createDefaultAudioBackend();
+
+struct AudioStats {
+    long   buffersMixed;
+    double avgMixMicros;     // mixing cost only, not time spent in write()
+    double maxMixMicros;
+    int    activeVoices;
+};
+
+// Starts the mixer thread. Takes ownership of the backend.
+bool audioInit(AudioBackend *backend);
+
+// Streams a WAV from disk on a loop, replacing any current music.
+bool audioStartMusic(const char *wavPath);
+
+// Same, but plays interleaved samples straight from memory (e.g. a mapped
+// asset bundle). The memory must stay valid until the music is replaced
+// or audio is shut down.
+bool audioStartMusicPCM(const short *samples, long frames, int sampleRate, int channels);
+
+// Uses mono samples at AUDIO_SAMPLE_RATE in place for an effect. Must be
+// called before audioInit().
+void audioSetEffectPCM(SoundEffect sfx, const short *samples, int frames);
+
+// Queues a one-shot effect. Safe to call every frame; never blocks.
+void audioPlay(SoundEffect sfx, float volume = 1.0f);
+
+AudioStats audioGetStats();
+
+// Stops the thread and closes the backend (also registered with atexit).
+void audioShutdown();
+
+// Headless run without a thread: mixes `seconds` of audio (music plus an
+// effect every few buffers), optionally into a WAV file, and prints the
+// per-buffer mix cost. Returns a process exit code.
+int audioRunBenchmark(const char *musicPath, const char *wavOutPath, float seconds);
+
+#endif // AUDIO_H
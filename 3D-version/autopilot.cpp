@@ -0,0 +1,150 @@
+// Lane planner autopilot, see autopilot.h.
+#include "autopilot.h"
+#include "vecenv.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+// costs along a plan; a crash outweighs anything else the horizon can hold
+const float CRASH_COST   = 1000.0f;
+const float SHIELD_COST  = 150.0f;     // a shield used up
+const float PICKUP_VALUE = 60.0f;
+const float MOVE_COST    = 0.5f;       // no weaving when staying is as good
+const float EDGE_COST    = 0.25f;      // past the horizon an edge lane has one way out
+const float NO_LANE      = 1e30f;
+
+// ------------- GRID -------------
+void autopilotClear(AutopilotGrid &g, int lanes, float speed, float tickSeconds) {
+    if (lanes > AUTOPILOT_MAX_LANES) lanes = AUTOPILOT_MAX_LANES;
+    g.lanes     = lanes;
+    g.cellDepth = AUTOPILOT_REACH / AUTOPILOT_CELLS;
+    if (speed * tickSeconds > g.cellDepth)
+        g.cellDepth = speed * tickSeconds;
+    memset(g.obstacle, 0, sizeof(g.obstacle));
+    memset(g.pickup, 0, sizeof(g.pickup));
+}
+
+// the cells during which something at z overlaps the player
+static uint32_t cellMask(const AutopilotGrid &g, float z, float halfDepth) {
+    float from = -z - halfDepth, to = -z + halfDepth;   // travel from now
+    if (to < 0.0f) return 0;
+    int first = from <= 0.0f ? 0 : (int)(from / g.cellDepth);
+    if (first >= AUTOPILOT_CELLS) return 0;
+    int last = (int)(to / g.cellDepth);
+    uint32_t upTo = last >= AUTOPILOT_CELLS - 1 ? ~0u : (2u << last) - 1u;
+    return upTo & (~0u << first);
+}
+
+void autopilotAddObstacle(AutopilotGrid &g, int lane, float z, float halfDepth) {
+    if (lane >= 0 && lane < g.lanes)
+        g.obstacle[lane] |= cellMask(g, z, halfDepth);
+}
+
+void autopilotAddPickup(AutopilotGrid &g, int lane, float z, float halfDepth) {
+    if (lane >= 0 && lane < g.lanes)
+        g.pickup[lane] |= cellMask(g, z, halfDepth);
+}
+
+// ------------- PLANNER -------------
+int autopilotDecide(const AutopilotGrid &g, int lane, int shields, int maxShields,
+                    float safeDistance) {
+    const int lanes = g.lanes;
+    float hit  = shields > 0 ? SHIELD_COST : CRASH_COST;
+    float gain = shields < maxShields ? PICKUP_VALUE : 0.0f;
+
+    // cells wholly inside the safe distance can't hurt
+    int safeCells = (int)(safeDistance / g.cellDepth);
+    uint32_t hurts = safeCells >= AUTOPILOT_CELLS ? 0u : ~0u << (safeCells < 0 ? 0 : safeCells);
+
+    // nothing past the last marked cell changes the plan
+    uint32_t any = 0;
+    for (int l = 0; l < lanes; ++l)
+        any |= (g.obstacle[l] & hurts) | (gain > 0.0f ? g.pickup[l] : 0u);
+    int top = AUTOPILOT_CELLS - 1;
+    while (top >= 0 && !(any & (1u << top))) --top;
+
+    // value[1 + l]: best cost from the current cell to the horizon in lane
+    // l; value[0] and value[lanes + 1] are walls
+    float value[AUTOPILOT_MAX_LANES + 2], next[AUTOPILOT_MAX_LANES + 2];
+    value[0] = value[lanes + 1] = next[0] = next[lanes + 1] = NO_LANE;
+    for (int l = 0; l < lanes; ++l)
+        value[1 + l] = (l == 0 || l == lanes - 1) ? EDGE_COST : 0.0f;
+
+    for (int k = top; k >= 0; --k) {
+        uint32_t bit = 1u << k;
+        for (int l = 0; l < lanes; ++l) {
+            float side = value[l] < value[l + 2] ? value[l] : value[l + 2];
+            float best = value[l + 1] < side + MOVE_COST ? value[l + 1] : side + MOVE_COST;
+            if (g.obstacle[l] & hurts & bit) best += hit;
+            if (g.pickup[l] & bit)           best -= gain;
+            next[1 + l] = best;
+        }
+        memcpy(value, next, sizeof(float) * (size_t)(lanes + 2));
+    }
+
+    // the move now: the player is in cell 0 of whichever lane it picks
+    int   move = 0;
+    float best = value[1 + lane];
+    if (lane > 0 && value[lane] + MOVE_COST < best) {
+        move = -1;
+        best = value[lane] + MOVE_COST;
+    }
+    if (lane < lanes - 1 && value[lane + 2] + MOVE_COST < best)
+        move = 1;
+    return move;
+}
+
+// ------------- BENCHMARK -------------
+int autopilotRunBenchmark(int count, int steps) {
+    const int LANES = 5;
+    if (count < 1) count = 1;
+    if (steps < 1) steps = 1;
+    printf("autopilot bench: %d runs x %d steps, %d lanes\n", count, steps, LANES);
+
+    Arena a;
+    VecEnv v;
+    if (!arenaInit(a, vecEnvBytes(count, LANES)) || !vecEnvInit(v, a, count, LANES, 99u, 0))
+        return 1;
+    std::vector<float>         obs((size_t)count * vecEnvObsSize(LANES)), rewards((size_t)count);
+    std::vector<int>           actions((size_t)count);
+    std::vector<unsigned char> dones((size_t)count);
+
+    const char *names[] = { "greedy", "planner" };
+    double ticksPerCrash[2] = { 0.0, 0.0 };
+    for (int p = 0; p < 2; ++p) {
+        vecEnvReset(v, &obs[0]);
+        double policySeconds = 0.0;
+        long   crashes = 0;
+        for (int s = 0; s < steps; ++s) {
+            double t0 = vecEnvSeconds();
+            if (p == 0) vecEnvGreedy(v, &obs[0], &actions[0]);
+            else        vecEnvAutopilot(v, &actions[0]);
+            policySeconds += vecEnvSeconds() - t0;
+            vecEnvStep(v, &actions[0], &obs[0], &rewards[0], &dones[0]);
+            for (int i = 0; i < count; ++i) crashes += dones[(size_t)i];
+        }
+        double decisions = (double)count * steps;
+        ticksPerCrash[p] = crashes ? decisions / crashes : decisions;
+        printf("  %-7s %6.2f M decisions/s, %.3f us each, %ld crashes, %s%.0f s of play per crash\n",
+               names[p], decisions / policySeconds / 1e6, policySeconds * 1e6 / decisions,
+               crashes, crashes ? "" : "over ", ticksPerCrash[p] / VECENV_TICK_RATE);
+    }
+
+    // one decision on a crowded grid, the worst case for the planner
+    AutopilotGrid g;
+    autopilotClear(g, AUTOPILOT_MAX_LANES, 30.0f, 1.0f / VECENV_TICK_RATE);
+    for (int k = 0; k < 40; ++k)
+        autopilotAddObstacle(g, (k * 7) % AUTOPILOT_MAX_LANES, -2.0f * k, 1.85f);
+    autopilotAddPickup(g, 4, -20.0f, 1.35f);
+    const int REPEAT = 1000000;
+    volatile int sink = 0;             // keeps the loop
+    double t0 = vecEnvSeconds();
+    for (int r = 0; r < REPEAT; ++r)
+        sink = sink + autopilotDecide(g, r % AUTOPILOT_MAX_LANES, r & 1, 3, 0.0f);
+    double each = (vecEnvSeconds() - t0) / REPEAT;
+    printf("  full %d-lane grid: %.3f us per decision\n", AUTOPILOT_MAX_LANES, each * 1e6);
+
+    arenaRelease(a);
+    return ticksPerCrash[1] >= ticksPerCrash[0] ? 0 : 1;
+}
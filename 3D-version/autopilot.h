@@ -0,0 +1,56 @@
+// Lane planner autopilot for the 3D runner.
+//
+// The track ahead is cut into AUTOPILOT_CELLS cells of travel, and each
+// lane keeps one bit per cell for "an obstacle overlaps the player here"
+// and one for "a shield pickup does". Everything on the track moves at the
+// same speed, so a cell is just a stretch of distance and the grid doesn't
+// change with time, only with what is on the track.
+//
+// autopilotDecide() then runs a dynamic program backwards over the cells:
+// the best cost from each lane to the end of the horizon, moving at most
+// one lane per cell. A cell is at least one tick of travel at the current
+// speed, so every plan it finds can be keyed in. The answer is the move to
+// make now (-1, 0, +1), as GLUT_KEY_LEFT / GLUT_KEY_RIGHT would. A decision
+// is a few hundred additions on 32-bit masks, well under a microsecond;
+// the planner is re-run every tick, so only its first move is ever used.
+//
+// Nothing here knows about the game or the batched environment: main.cpp
+// fills a grid from the entity store (attract mode, the 'A' key) and
+// vecEnvAutopilot() from a VecEnv's lane rings.
+#ifndef AUTOPILOT_H
+#define AUTOPILOT_H
+
+#include <stdint.h>
+
+const int   AUTOPILOT_CELLS     = 32;      // bits in a lane's mask
+const int   AUTOPILOT_MAX_LANES = 9;
+const float AUTOPILOT_REACH     = 80.0f;   // the spawn distance
+
+struct AutopilotGrid {
+    int      lanes;
+    float    cellDepth;                    // world units of travel per cell
+    uint32_t obstacle[AUTOPILOT_MAX_LANES]; // bit k: overlaps the player in cell k
+    uint32_t pickup[AUTOPILOT_MAX_LANES];
+};
+
+// An empty grid for the current speed; tickSeconds is the longest a move
+// can take to be keyed in (the cells are never shorter than that).
+void autopilotClear(AutopilotGrid &g, int lanes, float speed, float tickSeconds);
+
+// z is relative to the player (negative ahead); halfDepth is half the
+// player's depth plus half the object's, the Z overlap that hits.
+void autopilotAddObstacle(AutopilotGrid &g, int lane, float z, float halfDepth);
+void autopilotAddPickup(AutopilotGrid &g, int lane, float z, float halfDepth);
+
+// The move to make now: -1 left, 0 stay, +1 right. Obstacles in the first
+// safeDistance of travel can't hurt (invincible, or the grace period after
+// a shield breaks); pickups are only worth taking below maxShields.
+int  autopilotDecide(const AutopilotGrid &g, int lane, int shields, int maxShields,
+                     float safeDistance);
+
+// --autopilot-bench [runs] [steps]: drives a batch of runs (vecenv.h) with
+// the planner; prints decisions/s, the cost of one, and how long runs last
+// against vecEnvGreedy(), which only sees the observation.
+int  autopilotRunBenchmark(int count, int steps);
+
+#endif // AUTOPILOT_H
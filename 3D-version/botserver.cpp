@@ -0,0 +1,341 @@
+// Bot server and its load generator, see botserver.h.
+#include "botserver.h"
+#include "vecenv.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+
+int botServerRun(const char *path) {
+    (void)path;
+    fprintf(stderr, "bot server: needs Unix domain sockets\n");
+    return 1;
+}
+
+int botLoadRun(const char *path, double seconds) {
+    (void)path; (void)seconds;
+    fprintf(stderr, "bot load: needs Unix domain sockets\n");
+    return 1;
+}
+
+#else
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <errno.h>
+#include <unistd.h>
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+const int SOCKET_BUFFER = 4 << 20;     // a 4096-run reply in one go
+
+// ------------- CONNECTION -------------
+struct BotConn {
+    int                        fd;
+    std::vector<unsigned char> rx;
+    size_t                     rxStart, rxLen;
+};
+
+static void connInit(BotConn &c, int fd) {
+    c.fd = fd;
+    c.rx.assign(64 * 1024, 0);
+    c.rxStart = c.rxLen = 0;
+    int size = SOCKET_BUFFER;
+    setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &size, sizeof(size));
+    setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &size, sizeof(size));
+}
+
+// buffers at least `need` bytes, reading as much as has arrived each time;
+// false once the peer has gone
+static bool fill(BotConn &c, size_t need) {
+    if (c.rxStart + need > c.rx.size()) {
+        memmove(&c.rx[0], &c.rx[c.rxStart], c.rxLen);
+        c.rxStart = 0;
+        if (need > c.rx.size()) c.rx.resize(need);
+    }
+    while (c.rxLen < need) {
+        ssize_t n = recv(c.fd, &c.rx[c.rxStart + c.rxLen],
+                         c.rx.size() - c.rxStart - c.rxLen, 0);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        c.rxLen += (size_t)n;
+    }
+    return true;
+}
+
+// valid until the next fill()
+static const unsigned char *take(BotConn &c, size_t n) {
+    const unsigned char *p = &c.rx[c.rxStart];
+    c.rxStart += n;
+    c.rxLen   -= n;
+    if (c.rxLen == 0) c.rxStart = 0;
+    return p;
+}
+
+static bool sendAll(int fd, const void *data, size_t len) {
+    const char *p = (const char *)data;
+    while (len > 0) {
+        ssize_t n = send(fd, p, len, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        p   += n;
+        len -= (size_t)n;
+    }
+    return true;
+}
+
+static bool readHeader(BotConn &c, BotHeader &h) {
+    if (!fill(c, sizeof(h))) return false;
+    memcpy(&h, take(c, sizeof(h)), sizeof(h));
+    return h.magic == BOT_MAGIC;
+}
+
+static void putHeader(unsigned char *out, uint32_t type, uint32_t count, uint32_t seq) {
+    BotHeader h = { BOT_MAGIC, type, count, seq };
+    memcpy(out, &h, sizeof(h));
+}
+
+static bool unixAddress(const char *path, struct sockaddr_un &un) {
+    memset(&un, 0, sizeof(un));
+    un.sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(un.sun_path)) {
+        fprintf(stderr, "bot: socket path too long: %s\n", path);
+        return false;
+    }
+    memcpy(un.sun_path, path, strlen(path) + 1);
+    return true;
+}
+
+// ------------- SERVER -------------
+static void serveClient(int fd, int id) {
+    BotConn c;
+    connInit(c, fd);
+
+    Arena  arena;
+    VecEnv env;
+    bool   ready = false;
+    int    runs = 0, obsSize = 0;
+    std::vector<unsigned char> reply;  // header | payload, vecenv writes in place
+    std::vector<int>           actions;
+    long   batches = 0;
+    double stepSeconds = 0.0;
+    const char *error = NULL;
+
+    BotHeader h;
+    while (!error && readHeader(c, h)) {
+        if (h.type == BOT_HELLO) {
+            if (ready) {
+                error = "HELLO twice";
+                break;
+            }
+            if (!fill(c, 3 * sizeof(int32_t))) break;
+            int32_t cfg[3];
+            memcpy(cfg, take(c, sizeof(cfg)), sizeof(cfg));
+            runs = (int)h.count;
+            if (runs < 1 || runs > BOT_MAX_RUNS || cfg[0] < 3 || cfg[0] > 9) {
+                error = "bad HELLO";
+                break;
+            }
+            if (!arenaInit(arena, vecEnvBytes(runs, cfg[0])) ||
+                !vecEnvInit(env, arena, runs, cfg[0], (unsigned)cfg[1], cfg[2])) {
+                error = "out of memory";
+                break;
+            }
+            ready   = true;
+            obsSize = vecEnvObsSize(cfg[0]);
+            actions.assign((size_t)runs, 0);
+            reply.resize(sizeof(BotHeader) + (size_t)runs * (obsSize * sizeof(float) + sizeof(float) + 1));
+            printf("bot server: client %d, %d runs of %d lanes\n", id, runs, cfg[0]);
+        }
+        if (h.type == BOT_HELLO || (h.type == BOT_RESET && ready)) {
+            // READY: header | obsSize | obs
+            unsigned char *out = &reply[0];
+            putHeader(out, BOT_READY, (uint32_t)runs, h.seq);
+            int32_t size = obsSize;
+            memcpy(out + sizeof(BotHeader), &size, sizeof(size));
+            std::vector<float> obs((size_t)runs * obsSize);
+            vecEnvReset(env, &obs[0]);
+            if (!sendAll(fd, out, sizeof(BotHeader) + sizeof(size)) ||
+                !sendAll(fd, &obs[0], obs.size() * sizeof(float)))
+                break;
+        } else if (h.type == BOT_STEP && ready && (int)h.count == runs) {
+            if (!fill(c, (size_t)runs * sizeof(int32_t))) break;
+            memcpy(&actions[0], take(c, (size_t)runs * sizeof(int32_t)),
+                   (size_t)runs * sizeof(int32_t));
+
+            unsigned char *out     = &reply[0];
+            float         *obs     = (float *)(out + sizeof(BotHeader));
+            float         *rewards = obs + (size_t)runs * obsSize;
+            unsigned char *dones   = (unsigned char *)(rewards + runs);
+            putHeader(out, BOT_RESULT, (uint32_t)runs, h.seq);
+
+            double t0 = vecEnvSeconds();
+            vecEnvStep(env, &actions[0], obs, rewards, dones);
+            stepSeconds += vecEnvSeconds() - t0;
+            ++batches;
+            if (!sendAll(fd, out, reply.size())) break;
+        } else {
+            error = "unexpected message";
+        }
+    }
+
+    if (error) {
+        unsigned char out[sizeof(BotHeader)];
+        putHeader(out, BOT_ERROR, 0, 0);
+        sendAll(fd, out, sizeof(out));
+        printf("bot server: client %d: %s\n", id, error);
+    }
+    close(fd);
+    if (ready) {
+        printf("bot server: client %d left after %ld batches (%.1f M steps), "
+               "step %.1f us per batch\n", id, batches, batches * (double)runs / 1e6,
+               batches ? stepSeconds * 1e6 / batches : 0.0);
+        arenaRelease(arena);
+    }
+}
+
+int botServerRun(const char *path) {
+    struct sockaddr_un un;
+    if (!unixAddress(path, un)) return 1;
+
+    int l = socket(AF_UNIX, SOCK_STREAM, 0);
+    unlink(path);                      // left over from a server that was killed
+    if (l < 0 || bind(l, (struct sockaddr *)&un, sizeof(un)) != 0 || listen(l, 64) != 0) {
+        fprintf(stderr, "bot server: can't listen on %s\n", path);
+        if (l >= 0) close(l);
+        return 1;
+    }
+    setvbuf(stdout, NULL, _IOLBF, 0);  // client threads print as they come and go
+    printf("bot server: listening on %s\n", path);
+
+    for (int id = 1;; ++id) {
+        int fd = accept(l, NULL, NULL);
+        if (fd < 0) {
+            if (errno == EINTR) continue;
+            fprintf(stderr, "bot server: accept() failed\n");
+            break;
+        }
+        std::thread(serveClient, fd, id).detach();
+    }
+    close(l);
+    unlink(path);
+    return 1;
+}
+
+// ------------- LOAD GENERATOR -------------
+struct LoadResult {
+    bool                ok;
+    long                batches;
+    std::vector<double> latencies;     // seconds per round trip
+};
+
+static void loadClient(const char *path, int runs, double seconds, unsigned seed,
+                       LoadResult &r) {
+    r.ok      = false;
+    r.batches = 0;
+    r.latencies.clear();
+
+    struct sockaddr_un un;
+    if (!unixAddress(path, un)) return;
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0 || connect(fd, (struct sockaddr *)&un, sizeof(un)) != 0) {
+        if (fd >= 0) close(fd);
+        return;
+    }
+    BotConn c;
+    connInit(c, fd);
+
+    unsigned char hello[sizeof(BotHeader) + 3 * sizeof(int32_t)];
+    int32_t cfg[3] = { 5, (int32_t)seed, 0 };
+    putHeader(hello, BOT_HELLO, (uint32_t)runs, 0);
+    memcpy(hello + sizeof(BotHeader), cfg, sizeof(cfg));
+
+    BotHeader h;
+    int32_t obsSize = 0;
+    if (!sendAll(fd, hello, sizeof(hello)) || !readHeader(c, h) || h.type != BOT_READY ||
+        !fill(c, sizeof(obsSize))) {
+        close(fd);
+        return;
+    }
+    memcpy(&obsSize, take(c, sizeof(obsSize)), sizeof(obsSize));
+    size_t obsBytes = (size_t)runs * obsSize * sizeof(float);
+    if (!fill(c, obsBytes)) { close(fd); return; }
+    take(c, obsBytes);
+
+    // STEP goes out in one send; RESULT has a known size and comes back
+    // in one buffered read
+    std::vector<unsigned char> step(sizeof(BotHeader) + (size_t)runs * sizeof(int32_t));
+    size_t resultBytes = sizeof(BotHeader) + obsBytes + (size_t)runs * (sizeof(float) + 1);
+    unsigned rng = seed;
+
+    double end = vecEnvSeconds() + seconds;
+    r.ok = true;
+    for (uint32_t seq = 1; vecEnvSeconds() < end; ++seq) {
+        int32_t *actions = (int32_t *)(&step[0] + sizeof(BotHeader));
+        for (int i = 0; i < runs; ++i) {
+            rng = rng * 1103515245u + 12345u;
+            actions[i] = (int32_t)((rng >> 16) % 3);   // stay / left / right
+        }
+        putHeader(&step[0], BOT_STEP, (uint32_t)runs, seq);
+
+        double t0 = vecEnvSeconds();
+        if (!sendAll(fd, &step[0], step.size()) || !fill(c, resultBytes)) { r.ok = false; break; }
+        memcpy(&h, take(c, resultBytes), sizeof(h));
+        r.latencies.push_back(vecEnvSeconds() - t0);
+        if (h.type != BOT_RESULT || h.seq != seq) { r.ok = false; break; }
+        ++r.batches;
+    }
+    close(fd);
+}
+
+int botLoadRun(const char *path, double seconds) {
+    static const int CLIENTS[] = { 1, 2, 4, 8 };
+    static const int BATCHES[] = { 1, 16, 256, 4096 };
+    if (seconds <= 0.0) seconds = 1.0;
+
+    printf("bot load: %s, %.1f s per case, random actions\n", path, seconds);
+    printf("  clients  batch   M steps/s   batches/s   p50 us    p99 us\n");
+
+    for (size_t ci = 0; ci < sizeof(CLIENTS) / sizeof(CLIENTS[0]); ++ci) {
+        for (size_t bi = 0; bi < sizeof(BATCHES) / sizeof(BATCHES[0]); ++bi) {
+            int clients = CLIENTS[ci], batch = BATCHES[bi];
+            std::vector<LoadResult>  results((size_t)clients);
+            std::vector<std::thread> threads;
+
+            double t0 = vecEnvSeconds();
+            for (int k = 0; k < clients; ++k)
+                threads.push_back(std::thread(loadClient, path, batch, seconds,
+                                              1000u + (unsigned)k, std::ref(results[(size_t)k])));
+            for (size_t k = 0; k < threads.size(); ++k) threads[k].join();
+            double wall = vecEnvSeconds() - t0;
+
+            long batches = 0;
+            std::vector<double> latencies;
+            for (size_t k = 0; k < results.size(); ++k) {
+                if (!results[k].ok) {
+                    fprintf(stderr, "bot load: client lost (is a server running on %s?)\n", path);
+                    return 1;
+                }
+                batches += results[k].batches;
+                latencies.insert(latencies.end(), results[k].latencies.begin(),
+                                 results[k].latencies.end());
+            }
+            std::sort(latencies.begin(), latencies.end());
+            double p50 = latencies.empty() ? 0.0 : latencies[latencies.size() / 2];
+            double p99 = latencies.empty() ? 0.0 : latencies[(latencies.size() - 1) * 99 / 100];
+
+            printf("  %7d %6d %11.2f %11.0f %9.1f %9.1f\n", clients, batch,
+                   batches * (double)batch / wall / 1e6, batches / wall, p50 * 1e6, p99 * 1e6);
+            fflush(stdout);
+        }
+    }
+    return 0;
+}
+
+#endif // _WIN32
@@ -0,0 +1,53 @@
+// Headless bot server: batched runner environments (vecenv.h) for
+// policies running in other processes, over a Unix domain socket.
+//
+// Each connection gets its own batch of runs and its own thread. A round
+// trip is one message each way for the whole batch: the client sends every
+// run's action, the server steps them all and sends back every observation,
+// reward and done flag. Payloads are flat arrays laid out the way vecenv
+// writes them, so nothing is converted on either side, and reads are
+// buffered so a message normally costs a single recv.
+//
+// Messages start with a BotHeader; all fields are in host byte order (the
+// socket is local):
+//   HELLO   client  count = runs   int32 lanes, seed, maxSteps
+//   READY   server  count = runs   int32 obsSize, float obs[runs][obsSize]
+//   STEP    client  count = runs   int32 actions[runs]
+//   RESULT  server  count = runs   float obs[runs][obsSize], float rewards[runs],
+//                                  uint8 dones[runs]
+//   RESET   client  count = 0      answered with READY
+//   ERROR   server  count = 0      and the connection is closed
+// `seq` is echoed back, so a client can check replies match.
+#ifndef BOTSERVER_H
+#define BOTSERVER_H
+
+#include <stdint.h>
+
+const uint32_t BOT_MAGIC    = 0x31544F42;   // "BOT1"
+const int      BOT_MAX_RUNS = 1 << 16;      // per connection
+
+enum BotMessage {
+    BOT_HELLO = 1,
+    BOT_READY,
+    BOT_STEP,
+    BOT_RESULT,
+    BOT_RESET,
+    BOT_ERROR
+};
+
+struct BotHeader {
+    uint32_t magic;
+    uint32_t type;
+    uint32_t count;
+    uint32_t seq;
+};
+
+// --bot-server PATH: serves until killed.
+int botServerRun(const char *path);
+
+// --bot-load PATH [seconds]: clients x batch sizes against a running
+// server, each case for `seconds`; prints env steps/s and round-trip
+// latency (p50 / p99).
+int botLoadRun(const char *path, double seconds);
+
+#endif // BOTSERVER_H
@@ -0,0 +1,148 @@
+// Memory-mapped asset bundle reader, see bundle.h.
+#include "bundle.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static const unsigned char *bundleBase    = NULL;
+static size_t               bundleSize    = 0;
+static const BundleEntry   *bundleEntries = NULL;
+static int                  bundleCount   = 0;
+
+#ifdef _WIN32
+static HANDLE bundleFile    = INVALID_HANDLE_VALUE;
+static HANDLE bundleMapping = NULL;
+#endif
+
+// ------------- MAPPING -------------
+static bool mapFile(const char *path) {
+#ifdef _WIN32
+    bundleFile = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL,
+                             OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (bundleFile == INVALID_HANDLE_VALUE) return false;
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(bundleFile, &size) || size.QuadPart == 0) {
+        CloseHandle(bundleFile);
+        bundleFile = INVALID_HANDLE_VALUE;
+        return false;
+    }
+    bundleMapping = CreateFileMappingA(bundleFile, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (bundleMapping != NULL)
+        bundleBase = (const unsigned char *)MapViewOfFile(bundleMapping, FILE_MAP_READ, 0, 0, 0);
+    if (bundleBase == NULL) {
+        if (bundleMapping) CloseHandle(bundleMapping);
+        CloseHandle(bundleFile);
+        bundleMapping = NULL;
+        bundleFile    = INVALID_HANDLE_VALUE;
+        return false;
+    }
+    bundleSize = (size_t)size.QuadPart;
+    return true;
+#else
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return false;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        close(fd);
+        return false;
+    }
+    void *p = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);   // the mapping keeps the file alive
+    if (p == MAP_FAILED) return false;
+
+    bundleBase = (const unsigned char *)p;
+    bundleSize = (size_t)st.st_size;
+    return true;
+#endif
+}
+
+static void unmapFile() {
+    if (bundleBase == NULL) return;
+#ifdef _WIN32
+    UnmapViewOfFile(bundleBase);
+    CloseHandle(bundleMapping);
+    CloseHandle(bundleFile);
+    bundleMapping = NULL;
+    bundleFile    = INVALID_HANDLE_VALUE;
+#else
+    munmap((void *)bundleBase, bundleSize);
+#endif
+    bundleBase = NULL;
+    bundleSize = 0;
+}
+
+// ------------- PUBLIC API -------------
+bool bundleOpen(const char *path) {
+    bundleClose();
+    if (!mapFile(path)) return false;
+
+    const BundleHeader *h = (const BundleHeader *)bundleBase;
+    const char *problem = NULL;
+
+    if (bundleSize < sizeof(BundleHeader) || h->magic != BUNDLE_MAGIC)
+        problem = "not an asset bundle";
+    else if (h->version != BUNDLE_VERSION)
+        problem = "unsupported version";
+    else if (h->fileSize != bundleSize)
+        problem = "truncated";
+    else if (h->tocOffset % 4 != 0 ||
+             h->tocOffset > bundleSize ||
+             (bundleSize - h->tocOffset) / sizeof(BundleEntry) < h->entryCount)
+        problem = "bad table of contents";
+
+    // every blob must lie inside the file and be aligned, so callers can
+    // use the pointers directly
+    const BundleEntry *toc = (const BundleEntry *)(bundleBase + (problem ? 0 : h->tocOffset));
+    for (uint32_t i = 0; problem == NULL && i < h->entryCount; ++i) {
+        const BundleEntry &e = toc[i];
+        if (e.offset % BUNDLE_ALIGN != 0 || e.offset > bundleSize ||
+            e.size > bundleSize - e.offset ||
+            memchr(e.name, 0, BUNDLE_NAME_LEN) == NULL)
+            problem = "bad entry";
+    }
+
+    if (problem) {
+        fprintf(stderr, "bundle: %s: %s\n", path, problem);
+        unmapFile();
+        return false;
+    }
+
+    bundleEntries = toc;
+    bundleCount   = (int)h->entryCount;
+    return true;
+}
+
+void bundleClose() {
+    unmapFile();
+    bundleEntries = NULL;
+    bundleCount   = 0;
+}
+
+const BundleEntry *bundleFind(const char *name, BundleType type) {
+    for (int i = 0; i < bundleCount; ++i) {
+        if (bundleEntries[i].type == (uint32_t)type &&
+            strcmp(bundleEntries[i].name, name) == 0)
+            return &bundleEntries[i];
+    }
+    return NULL;
+}
+
+const void *bundleData(const BundleEntry *entry) {
+    return bundleBase + entry->offset;
+}
+
+int bundleEntryCount() {
+    return bundleCount;
+}
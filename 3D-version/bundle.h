@@ -0,0 +1,64 @@
+// Packed asset bundle, memory-mapped at startup.
+//
+// Layout (all little-endian):
+//   BundleHeader
+//   blobs, each starting on a BUNDLE_ALIGN boundary
+//   BundleEntry[entryCount] at tocOffset
+//
+// Blobs are stored in the exact form the game consumes them (interleaved
+// s16 PCM, GL-ready texels, float vertex arrays), so nothing is parsed or
+// copied at load time: the game gets pointers into the mapping (meshes
+// are the exception: they go straight from the mapping into GL buffers). The
+// builder is bundle_builder.cpp (BundleBuilder.cbp).
+#ifndef BUNDLE_H
+#define BUNDLE_H
+
+#include <stdint.h>
+
+const uint32_t BUNDLE_MAGIC    = 0x444E4252;   // "RBND"
+const uint32_t BUNDLE_VERSION  = 2;
+const uint32_t BUNDLE_ALIGN    = 64;
+const int      BUNDLE_NAME_LEN = 32;
+
+enum BundleType {
+    BUNDLE_MESH    = 1,   // params: vertexCount, indexCount, partCount
+                          // data:   binary mesh, see meshfile.h
+    BUNDLE_PCM     = 2,   // params: sampleRate, channels, frames
+                          // data:   int16 interleaved samples
+    BUNDLE_TEXTURE = 3,   // params: width, height, components (1, 3 or 4)
+                          // data:   uint8 rows, bottom row first, unpadded
+    BUNDLE_FONT    = 4    // params: width, height, cellW, cellH, firstChar
+                          // data:   uint8 alpha atlas, grid of fixed cells
+};
+
+struct BundleHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t entryCount;
+    uint32_t tocOffset;
+    uint64_t fileSize;
+    uint32_t reserved[2];
+};
+
+struct BundleEntry {
+    char     name[BUNDLE_NAME_LEN];   // NUL-terminated
+    uint32_t type;
+    uint32_t offset;                  // from start of file, aligned
+    uint32_t size;                    // bytes
+    uint32_t params[5];
+};
+
+// Maps the file and validates the table of contents. Only one bundle is
+// open at a time; opening another closes the previous one.
+bool bundleOpen(const char *path);
+void bundleClose();
+
+// NULL if missing or of another type.
+const BundleEntry *bundleFind(const char *name, BundleType type);
+
+// Pointer into the mapping; valid until bundleClose().
+const void *bundleData(const BundleEntry *entry);
+
+int bundleEntryCount();
+
+#endif // BUNDLE_H
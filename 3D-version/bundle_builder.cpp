@@ -0,0 +1,333 @@
+// Builds an asset bundle (see bundle.h) from a manifest.
+//
+//   bundle_builder <manifest> <out.bundle>
+//
+// Manifest lines, paths relative to the current directory:
+//   pcm     <name> <file.wav>                 16-bit PCM, kept as is
+//   sfx     <name> <file.wav>                 mono, resampled to the mixer rate
+//   texture <name> <file.ppm|file.pgm>        binary P6 / P5
+//   font    <name> <file.pgm> <cellW> <cellH> <firstChar>
+//   mesh    <name> <file.obj>                 OBJ subset, see meshfile.h
+// Blank lines and lines starting with '#' are ignored.
+#include "bundle.h"
+#include "audio.h"   // AUDIO_SAMPLE_RATE
+#include "meshfile.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+typedef std::vector<unsigned char> Blob;
+
+struct Item {
+    BundleEntry entry;
+    Blob        data;
+};
+
+static unsigned readLE16(const unsigned char *p) { return p[0] | (p[1] << 8); }
+static unsigned readLE32(const unsigned char *p) {
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((unsigned)p[3] << 24);
+}
+
+static bool readFile(const char *path, Blob &out) {
+    FILE *f = fopen(path, "rb");
+    if (f == NULL) {
+        fprintf(stderr, "bundle_builder: can't open %s\n", path);
+        return false;
+    }
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    out.resize(size > 0 ? (size_t)size : 0);
+    bool ok = size > 0 && fread(&out[0], 1, out.size(), f) == out.size();
+    fclose(f);
+    if (!ok) fprintf(stderr, "bundle_builder: can't read %s\n", path);
+    return ok;
+}
+
+template <typename T>
+static void append(Blob &b, const T *items, size_t count) {
+    const unsigned char *p = (const unsigned char *)items;
+    b.insert(b.end(), p, p + count * sizeof(T));
+}
+
+// ------------- AUDIO -------------
+static bool loadWav(const char *path, std::vector<short> &samples,
+                    int &rate, int &channels) {
+    Blob file;
+    if (!readFile(path, file)) return false;
+
+    if (file.size() < 12 || memcmp(&file[0], "RIFF", 4) != 0 ||
+        memcmp(&file[8], "WAVE", 4) != 0) {
+        fprintf(stderr, "bundle_builder: %s is not a WAV file\n", path);
+        return false;
+    }
+
+    bool   haveFmt = false;
+    size_t pos     = 12;
+    while (pos + 8 <= file.size()) {
+        const unsigned char *chunk = &file[pos];
+        size_t size = readLE32(chunk + 4);
+        size_t body = pos + 8;
+        if (size > file.size() - body) size = file.size() - body;
+
+        if (memcmp(chunk, "fmt ", 4) == 0 && size >= 16) {
+            unsigned tag = readLE16(chunk + 8);
+            channels     = (int)readLE16(chunk + 10);
+            rate         = (int)readLE32(chunk + 12);
+            int bits     = (int)readLE16(chunk + 22);
+            if ((tag != 1 && tag != 0xFFFE) || bits != 16 ||
+                channels < 1 || channels > 2 || rate <= 0) {
+                fprintf(stderr, "bundle_builder: %s: only 16-bit PCM mono/stereo\n", path);
+                return false;
+            }
+            haveFmt = true;
+        } else if (memcmp(chunk, "data", 4) == 0 && haveFmt) {
+            size_t count = size / 2;
+            samples.resize(count);
+            for (size_t i = 0; i < count; ++i)
+                samples[i] = (short)readLE16(&file[body + 2 * i]);
+            samples.resize(count - count % channels);
+            return !samples.empty();
+        }
+        pos = body + size + (size & 1);
+    }
+
+    fprintf(stderr, "bundle_builder: %s: no PCM data\n", path);
+    return false;
+}
+
+static bool buildPcm(Item &item, const char *path, bool effect) {
+    std::vector<short> in;
+    int rate = 0, channels = 0;
+    if (!loadWav(path, in, rate, channels)) return false;
+
+    long frames = (long)(in.size() / channels);
+    if (!effect) {
+        append(item.data, &in[0], in.size());
+    } else {
+        // effects are mixed in place: mono at the output rate
+        long outFrames = (long)((double)frames * AUDIO_SAMPLE_RATE / rate);
+        std::vector<short> out((size_t)outFrames);
+        for (long i = 0; i < outFrames; ++i) {
+            long src = (long)((double)i * rate / AUDIO_SAMPLE_RATE);
+            if (src >= frames) src = frames - 1;
+            int v = in[(size_t)src * channels];
+            if (channels == 2) v = (v + in[(size_t)src * 2 + 1]) / 2;
+            out[(size_t)i] = (short)v;
+        }
+        append(item.data, &out[0], out.size());
+        frames   = outFrames;
+        rate     = AUDIO_SAMPLE_RATE;
+        channels = 1;
+    }
+
+    item.entry.type      = BUNDLE_PCM;
+    item.entry.params[0] = (uint32_t)rate;
+    item.entry.params[1] = (uint32_t)channels;
+    item.entry.params[2] = (uint32_t)frames;
+    return true;
+}
+
+// ------------- IMAGES -------------
+static bool skipPnmSpace(const Blob &file, size_t &pos) {
+    while (pos < file.size()) {
+        if (file[pos] == '#') {
+            while (pos < file.size() && file[pos] != '\n') ++pos;
+        } else if (file[pos] == ' ' || file[pos] == '\t' ||
+                   file[pos] == '\r' || file[pos] == '\n') {
+            ++pos;
+        } else {
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool readPnmInt(const Blob &file, size_t &pos, int &value) {
+    if (!skipPnmSpace(file, pos)) return false;
+    value = 0;
+    int digits = 0;
+    while (pos < file.size() && file[pos] >= '0' && file[pos] <= '9') {
+        value = value * 10 + (file[pos++] - '0');
+        ++digits;
+    }
+    return digits > 0;
+}
+
+// Binary PGM/PPM, rows flipped so the first row is the bottom one (GL order).
+static bool loadPnm(const char *path, Blob &pixels, int &w, int &h, int &comps) {
+    Blob file;
+    if (!readFile(path, file)) return false;
+
+    int maxVal = 0;
+    size_t pos = 2;
+    if (file.size() < 2 || file[0] != 'P' || (file[1] != '5' && file[1] != '6') ||
+        !readPnmInt(file, pos, w) || !readPnmInt(file, pos, h) ||
+        !readPnmInt(file, pos, maxVal) || maxVal != 255 || w <= 0 || h <= 0) {
+        fprintf(stderr, "bundle_builder: %s: expected 8-bit binary PGM/PPM\n", path);
+        return false;
+    }
+    ++pos;   // single whitespace before the raster
+
+    comps = (file[1] == '6') ? 3 : 1;
+    size_t row = (size_t)w * comps;
+    if (file.size() - pos < row * h) {
+        fprintf(stderr, "bundle_builder: %s: truncated\n", path);
+        return false;
+    }
+
+    pixels.resize(row * h);
+    for (int y = 0; y < h; ++y)
+        memcpy(&pixels[row * (h - 1 - y)], &file[pos + row * y], row);
+    return true;
+}
+
+static bool buildTexture(Item &item, const char *path) {
+    int w, h, comps;
+    if (!loadPnm(path, item.data, w, h, comps)) return false;
+
+    item.entry.type      = BUNDLE_TEXTURE;
+    item.entry.params[0] = (uint32_t)w;
+    item.entry.params[1] = (uint32_t)h;
+    item.entry.params[2] = (uint32_t)comps;
+    return true;
+}
+
+static bool buildFont(Item &item, const char *path, int cellW, int cellH, int firstChar) {
+    int w, h, comps;
+    if (!loadPnm(path, item.data, w, h, comps)) return false;
+    if (comps != 1 || cellW <= 0 || cellH <= 0 || w % cellW != 0 || h % cellH != 0) {
+        fprintf(stderr, "bundle_builder: %s: font atlas must be a PGM grid of %dx%d cells\n",
+                path, cellW, cellH);
+        return false;
+    }
+
+    item.entry.type      = BUNDLE_FONT;
+    item.entry.params[0] = (uint32_t)w;
+    item.entry.params[1] = (uint32_t)h;
+    item.entry.params[2] = (uint32_t)cellW;
+    item.entry.params[3] = (uint32_t)cellH;
+    item.entry.params[4] = (uint32_t)firstChar;
+    return true;
+}
+
+// ------------- MESHES -------------
+static bool buildMesh(Item &item, const char *path) {
+    MeshData mesh;
+    if (!meshParseObj(path, mesh)) return false;
+
+    item.data            = mesh.storage;
+    item.entry.type      = BUNDLE_MESH;
+    item.entry.params[0] = mesh.header->vertexCount;
+    item.entry.params[1] = mesh.header->indexCount;
+    item.entry.params[2] = mesh.header->partCount;
+    return true;
+}
+
+// ------------- OUTPUT -------------
+static size_t alignUp(size_t v) {
+    return (v + BUNDLE_ALIGN - 1) / BUNDLE_ALIGN * BUNDLE_ALIGN;
+}
+
+static bool writeBundle(const char *path, const std::vector<Item> &items) {
+    BundleHeader header;
+    memset(&header, 0, sizeof(header));
+    header.magic      = BUNDLE_MAGIC;
+    header.version    = BUNDLE_VERSION;
+    header.entryCount = (uint32_t)items.size();
+
+    std::vector<BundleEntry> toc;
+    size_t offset = alignUp(sizeof(BundleHeader));
+    for (size_t i = 0; i < items.size(); ++i) {
+        BundleEntry e = items[i].entry;
+        e.offset = (uint32_t)offset;
+        e.size   = (uint32_t)items[i].data.size();
+        toc.push_back(e);
+        offset = alignUp(offset + e.size);
+    }
+    header.tocOffset = (uint32_t)offset;
+    header.fileSize  = offset + toc.size() * sizeof(BundleEntry);
+    if (header.fileSize > 0xFFFFFFFFull) {
+        fprintf(stderr, "bundle_builder: bundle would exceed 4 GB\n");
+        return false;
+    }
+
+    Blob out((size_t)header.fileSize, 0);
+    memcpy(&out[0], &header, sizeof(header));
+    for (size_t i = 0; i < items.size(); ++i)
+        if (!items[i].data.empty())
+            memcpy(&out[toc[i].offset], &items[i].data[0], items[i].data.size());
+    if (!toc.empty())
+        memcpy(&out[header.tocOffset], &toc[0], toc.size() * sizeof(BundleEntry));
+
+    FILE *f = fopen(path, "wb");
+    if (f == NULL) {
+        fprintf(stderr, "bundle_builder: can't write %s\n", path);
+        return false;
+    }
+    bool ok = fwrite(&out[0], 1, out.size(), f) == out.size();
+    ok = (fclose(f) == 0) && ok;
+    if (!ok) fprintf(stderr, "bundle_builder: error writing %s\n", path);
+    return ok;
+}
+
+int main(int argc, char **argv) {
+    if (argc != 3) {
+        fprintf(stderr, "usage: %s <manifest> <out.bundle>\n", argv[0]);
+        return 2;
+    }
+
+    FILE *manifest = fopen(argv[1], "r");
+    if (manifest == NULL) {
+        fprintf(stderr, "bundle_builder: can't open %s\n", argv[1]);
+        return 1;
+    }
+
+    std::vector<Item> items;
+    char line[512];
+    int  lineNo = 0;
+    bool ok = true;
+
+    while (ok && fgets(line, sizeof(line), manifest)) {
+        ++lineNo;
+        char type[16], name[64], path[400];
+        int  a = 0, b = 0, c = 0;
+        int  fields = sscanf(line, "%15s %63s %399s %d %d %d", type, name, path, &a, &b, &c);
+        if (fields <= 0 || type[0] == '#') continue;
+
+        if (fields < 3 || strlen(name) >= (size_t)BUNDLE_NAME_LEN) {
+            fprintf(stderr, "bundle_builder: %s:%d: expected <type> <name> <file> "
+                            "(name under %d chars)\n", argv[1], lineNo, BUNDLE_NAME_LEN);
+            ok = false;
+            break;
+        }
+
+        Item item;
+        memset(&item.entry, 0, sizeof(item.entry));
+        strcpy(item.entry.name, name);
+
+        if      (strcmp(type, "pcm") == 0)     ok = buildPcm(item, path, false);
+        else if (strcmp(type, "sfx") == 0)     ok = buildPcm(item, path, true);
+        else if (strcmp(type, "texture") == 0) ok = buildTexture(item, path);
+        else if (strcmp(type, "mesh") == 0)    ok = buildMesh(item, path);
+        else if (strcmp(type, "font") == 0 && fields == 6)
+            ok = buildFont(item, path, a, b, c);
+        else {
+            fprintf(stderr, "bundle_builder: %s:%d: unknown entry '%s'\n", argv[1], lineNo, type);
+            ok = false;
+        }
+
+        if (ok) {
+            printf("  %-8s %-24s %9lu bytes\n", type, name, (unsigned long)item.data.size());
+            items.push_back(item);
+        }
+    }
+    fclose(manifest);
+
+    if (!ok || !writeBundle(argv[2], items)) return 1;
+
+    printf("wrote %s: %lu entries\n", argv[2], (unsigned long)items.size());
+    return 0;
+}
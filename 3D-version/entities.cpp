@@ -0,0 +1,92 @@
+// Chunked SoA entity storage, see entities.h.
+#include "entities.h"
+
+static int chunksFor(int count) {
+    return (count + ENTITY_CHUNK_SIZE - 1) >> ENTITY_CHUNK_SHIFT;
+}
+
+bool entityStoreInit(EntityStore &st, Arena &a, const int maxPerArchetype[NUM_ARCHETYPES]) {
+    st.arena = &a;
+
+    int total = 0;
+    for (int i = 0; i < NUM_ARCHETYPES; ++i) {
+        EntityArchetype &arch = st.archetypes[i];
+        arch.maxChunks  = chunksFor(maxPerArchetype[i]);
+        arch.chunks     = arenaNew<EntityChunk *>(a, arch.maxChunks);
+        arch.chunkCount = 0;
+        arch.count      = 0;
+        arch.max        = arch.chunks ? maxPerArchetype[i] : 0;
+        total += arch.max;
+    }
+    return chunkPoolInit(st.refs, a, total);
+}
+
+size_t entityStoreBytes(const int maxPerArchetype[NUM_ARCHETYPES]) {
+    size_t bytes = 0;
+    int total = 0;
+    for (int i = 0; i < NUM_ARCHETYPES; ++i) {
+        size_t chunks = (size_t)chunksFor(maxPerArchetype[i]);
+        bytes += chunks * (sizeof(EntityChunk) + sizeof(EntityChunk *) + 64);
+        total += maxPerArchetype[i];
+    }
+    size_t refChunks = (size_t)(total + POOL_CHUNK_SIZE - 1) / POOL_CHUNK_SIZE;
+    return bytes + refChunks * (sizeof(PoolChunk<EntityRef>) + sizeof(void *) + 64);
+}
+
+int entityCreate(EntityStore &st, int arch, int kind, int lane, float z,
+                 int flags, PoolHandle *handle) {
+    EntityArchetype &a = st.archetypes[arch];
+    if (a.count >= a.max) return -1;
+
+    if (a.count == a.chunkCount * ENTITY_CHUNK_SIZE) {
+        EntityChunk *c = arenaNew<EntityChunk>(*st.arena, 1);
+        if (c == NULL) return -1;
+        a.chunks[a.chunkCount++] = c;
+    }
+
+    PoolHandle h;
+    EntityRef *ref = chunkPoolAlloc(st.refs, &h);
+    if (ref == NULL) return -1;
+
+    int index = a.count++;
+    ref->arch  = arch;
+    ref->index = index;
+
+    EntityChunk *c = a.chunks[index >> ENTITY_CHUNK_SHIFT];
+    int slot = index & (ENTITY_CHUNK_SIZE - 1);
+    c->z[slot]     = z;
+    c->lane[slot]  = (unsigned char)lane;
+    c->kind[slot]  = (unsigned char)kind;
+    c->flags[slot] = (unsigned char)flags;
+    c->id[slot]    = h.index;
+
+    if (handle) *handle = h;
+    return index;
+}
+
+void entityDestroy(EntityStore &st, int arch, int index) {
+    EntityArchetype &a = st.archetypes[arch];
+    EntityChunk *c = a.chunks[index >> ENTITY_CHUNK_SHIFT];
+    int slot = index & (ENTITY_CHUNK_SIZE - 1);
+    chunkPoolFree(st.refs, c->id[slot]);
+
+    // keep the archetype dense: the last entity takes the hole
+    int last = --a.count;
+    if (index != last) {
+        EntityChunk *lc = a.chunks[last >> ENTITY_CHUNK_SHIFT];
+        int ls = last & (ENTITY_CHUNK_SIZE - 1);
+        c->z[slot]     = lc->z[ls];
+        c->lane[slot]  = lc->lane[ls];
+        c->kind[slot]  = lc->kind[ls];
+        c->flags[slot] = lc->flags[ls];
+        c->id[slot]    = lc->id[ls];
+        chunkPoolAt(st.refs, c->id[slot])->index = index;
+    }
+}
+
+int entityFind(const EntityStore &st, PoolHandle h, int *arch) {
+    const EntityRef *ref = chunkPoolGet(st.refs, h);
+    if (ref == NULL) return -1;
+    if (arch) *arch = ref->arch;
+    return ref->index;
+}
@@ -0,0 +1,101 @@
+// Entity storage for everything that scrolls down the runway.
+//
+// Entities are grouped by archetype (obstacles, pickups), and each
+// archetype keeps its components in separate contiguous arrays (SoA):
+// z, lane, kind and flags. The arrays are chunked so an archetype can grow
+// without moving anything, and kept dense: destroying an entity moves the
+// archetype's last entity into its place. Per-tick passes therefore walk
+// plain arrays with no gaps and no `active` checks.
+//
+// Because dense indices change, entities are referred to from outside by
+// handle (see ChunkPool in arena.h): a handle stays valid until its entity
+// is destroyed, however the storage grows or is reordered.
+//
+// All memory comes from the arena passed to entityStoreInit().
+#ifndef ENTITIES_H
+#define ENTITIES_H
+
+#include "arena.h"
+
+enum Archetype {
+    ARCH_OBSTACLE,
+    ARCH_PICKUP,
+    NUM_ARCHETYPES
+};
+
+enum EntityKind {
+    KIND_OBSTACLE,
+    KIND_SHIELD,
+    NUM_KINDS
+};
+
+// what touching the player does
+enum EntityFlags {
+    ENTITY_HARMFUL     = 1,
+    ENTITY_COLLECTIBLE = 2
+};
+
+const int ENTITY_CHUNK_SHIFT = 10;
+const int ENTITY_CHUNK_SIZE  = 1 << ENTITY_CHUNK_SHIFT;
+
+struct EntityChunk {
+    float         z[ENTITY_CHUNK_SIZE];
+    unsigned char lane[ENTITY_CHUNK_SIZE];
+    unsigned char kind[ENTITY_CHUNK_SIZE];
+    unsigned char flags[ENTITY_CHUNK_SIZE];
+    int           id[ENTITY_CHUNK_SIZE];     // handle slot, see EntityStore::refs
+};
+
+struct EntityArchetype {
+    EntityChunk **chunks;              // [maxChunks]
+    int           chunkCount;
+    int           maxChunks;
+    int           count;               // live entities, dense from 0
+    int           max;
+};
+
+// where a handle's entity currently lives
+struct EntityRef {
+    int arch;
+    int index;
+};
+
+struct EntityStore {
+    Arena          *arena;
+    EntityArchetype archetypes[NUM_ARCHETYPES];
+    ChunkPool<EntityRef> refs;
+};
+
+bool entityStoreInit(EntityStore &st, Arena &a, const int maxPerArchetype[NUM_ARCHETYPES]);
+
+// Returns the new entity's dense index, or -1 when the archetype is full.
+int  entityCreate(EntityStore &st, int arch, int kind, int lane, float z,
+                  int flags, PoolHandle *handle = 0);
+void entityDestroy(EntityStore &st, int arch, int index);
+
+// Dense index of a handle's entity, or -1 once it has been destroyed.
+int  entityFind(const EntityStore &st, PoolHandle h, int *arch);
+
+// handle slot id -> dense index (ids are what EntityChunk::id holds)
+inline const EntityRef &entityRef(const EntityStore &st, int id) {
+    return *chunkPoolAt(st.refs, id);
+}
+
+inline int entityCount(const EntityStore &st, int arch) {
+    return st.archetypes[arch].count;
+}
+
+inline EntityChunk *entityChunk(const EntityStore &st, int arch, int index) {
+    return st.archetypes[arch].chunks[index >> ENTITY_CHUNK_SHIFT];
+}
+
+// entities in chunk `c` of an archetype
+inline int entityChunkCount(const EntityArchetype &a, int c) {
+    int n = a.count - (c << ENTITY_CHUNK_SHIFT);
+    return (n < 0) ? 0 : (n > ENTITY_CHUNK_SIZE ? ENTITY_CHUNK_SIZE : n);
+}
+
+// arena bytes a store with these limits can use at most
+size_t entityStoreBytes(const int maxPerArchetype[NUM_ARCHETYPES]);
+
+#endif // ENTITIES_H
@@ -0,0 +1,87 @@
+// GL call / vertex accounting, see glstats.h.
+// Each frame is written as one CSV row per scope to glstats.csv.
+#ifdef GL_STATS
+
+#include "glstats.h"
+#include <stdio.h>
+#include <string.h>
+
+static GLStatsScopeRow scopes[GLSTATS_MAX_SCOPES];
+static GLStatsScopeRow lastFrame[GLSTATS_MAX_SCOPES];
+static int             numScopes = 0;
+
+// scopes currently on the call stack
+static int activeScopes[GLSTATS_MAX_SCOPES];
+static int numActive = 0;
+
+static FILE *csvFile    = NULL;
+static long  frameIndex = 0;
+
+int glStatsRegister(const char *name) {
+    // draw functions split into several parts share one row by name
+    for (int i = 0; i < numScopes; ++i)
+        if (strcmp(scopes[i].name, name) == 0)
+            return i;
+
+    if (numScopes >= GLSTATS_MAX_SCOPES) {
+        fprintf(stderr, "glstats: too many scopes, ignoring '%s'\n", name);
+        return -1;
+    }
+
+    scopes[numScopes].name = name;
+    lastFrame[numScopes].name = name;
+    return numScopes++;
+}
+
+void glStatsCount(GLStatsCounter counter) {
+    for (int i = 0; i < numActive; ++i)
+        scopes[activeScopes[i]].counts[counter]++;
+}
+
+GLStatsScope::GLStatsScope(int id) {
+    if (id < 0 || numActive >= GLSTATS_MAX_SCOPES) {
+        activeScopes[numActive++] = -1;
+        return;
+    }
+    scopes[id].counts[GLSTAT_CALLS]++;
+    activeScopes[numActive++] = id;
+}
+
+GLStatsScope::~GLStatsScope() {
+    --numActive;
+}
+
+void glStatsBeginFrame() {
+    if (csvFile == NULL) {
+        csvFile = fopen("glstats.csv", "w");
+        if (csvFile)
+            fprintf(csvFile, "frame,scope,calls,begins,vertices,pushes,"
+                             "state_changes,glut_prims\n");
+    }
+
+    for (int i = 0; i < numScopes; ++i) {
+        const int *c = scopes[i].counts;
+        if (csvFile && c[GLSTAT_CALLS] > 0)
+            fprintf(csvFile, "%ld,%s,%d,%d,%d,%d,%d,%d\n", frameIndex,
+                    scopes[i].name, c[GLSTAT_CALLS], c[GLSTAT_BEGINS],
+                    c[GLSTAT_VERTICES], c[GLSTAT_PUSHES], c[GLSTAT_STATE],
+                    c[GLSTAT_GLUT_PRIMS]);
+
+        lastFrame[i] = scopes[i];
+        memset(scopes[i].counts, 0, sizeof(scopes[i].counts));
+    }
+
+    if (csvFile && frameIndex % 60 == 0)
+        fflush(csvFile);
+    ++frameIndex;
+}
+
+int glStatsScopeCount() {
+    return numScopes;
+}
+
+const GLStatsScopeRow &glStatsLastFrame(int scope) {
+    return lastFrame[scope];
+}
+
+#endif // GL_STATS
@@ -0,0 +1,77 @@
+// GL call / vertex accounting for the 3D runner.
+//
+// Build with -DGL_STATS (the "Profile" target) to count, per frame and per
+// draw function, how many glBegin/glEnd pairs, vertices, matrix pushes,
+// state changes and glut* primitives the game issues. Without GL_STATS
+// every macro below expands to nothing and the GL calls are untouched.
+//
+// Attribution is inclusive: a call is counted for every GL_STATS_SCOPE that
+// is active on the call stack, so drawCharacterSelect() also includes the
+// previews it draws.
+#ifndef GLSTATS_H
+#define GLSTATS_H
+
+#ifdef GL_STATS
+
+#include <GL/glut.h>
+
+enum GLStatsCounter {
+    GLSTAT_CALLS,        // times the scope was entered
+    GLSTAT_BEGINS,       // glBegin/glEnd pairs
+    GLSTAT_VERTICES,     // glVertex* calls
+    GLSTAT_PUSHES,       // glPushMatrix calls
+    GLSTAT_STATE,        // state changes that reached GL
+    GLSTAT_GLUT_PRIMS,   // glutSolid* / glutWire* calls
+    NUM_GLSTATS
+};
+
+const int GLSTATS_MAX_SCOPES = 32;
+
+struct GLStatsScopeRow {
+    const char *name;
+    int counts[NUM_GLSTATS];
+};
+
+int  glStatsRegister(const char *name);
+void glStatsCount(GLStatsCounter counter);
+void glStatsBeginFrame();   // closes the previous frame (CSV + overlay copy)
+
+// last finished frame, for the profiler overlay
+int                    glStatsScopeCount();
+const GLStatsScopeRow &glStatsLastFrame(int scope);
+
+struct GLStatsScope {
+    explicit GLStatsScope(int id);
+    ~GLStatsScope();
+};
+
+#define GL_STATS_SCOPE(name) \
+    static int glStatsScopeId_ = glStatsRegister(name); \
+    GLStatsScope glStatsScope_(glStatsScopeId_)
+
+#define GL_STATS_STATE() glStatsCount(GLSTAT_STATE)
+
+// Interception: each macro counts, then calls the real GL/GLUT function
+// (a function-like macro is not expanded again inside its own body).
+#define glBegin(mode)          (glStatsCount(GLSTAT_BEGINS), glBegin(mode))
+#define glVertex2f(x, y)       (glStatsCount(GLSTAT_VERTICES), glVertex2f(x, y))
+#define glVertex3f(x, y, z)    (glStatsCount(GLSTAT_VERTICES), glVertex3f(x, y, z))
+#define glPushMatrix()         (glStatsCount(GLSTAT_PUSHES), glPushMatrix())
+#define glutSolidCube(s)       (glStatsCount(GLSTAT_GLUT_PRIMS), glutSolidCube(s))
+#define glutSolidSphere(r, a, b) \
+    (glStatsCount(GLSTAT_GLUT_PRIMS), glutSolidSphere(r, a, b))
+#define glutWireSphere(r, a, b) \
+    (glStatsCount(GLSTAT_GLUT_PRIMS), glutWireSphere(r, a, b))
+#define glutSolidCone(r, h, a, b) \
+    (glStatsCount(GLSTAT_GLUT_PRIMS), glutSolidCone(r, h, a, b))
+#define glutSolidTorus(r, R, a, b) \
+    (glStatsCount(GLSTAT_GLUT_PRIMS), glutSolidTorus(r, R, a, b))
+
+#else
+
+#define GL_STATS_SCOPE(name)
+#define GL_STATS_STATE()
+
+#endif // GL_STATS
+
+#endif // GLSTATS_H
@@ -0,0 +1,328 @@
+// Lane kernel instantiations and the dispatcher, see lanesim.h.
+#include "lanesim.h"
+
+#include <stdio.h>
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+// plain aggregates, so the table is ready before any constructor runs
+#define LANE_OPS(n) { n, LaneTable<n>::x, LaneSim<n>::randomLane, \
+                      LaneSim<n>::step<false>, LaneSim<n>::step<true> }
+
+static const LaneOps laneOpsTable[] = {
+    LANE_OPS(3),
+    LANE_OPS(5),
+    LANE_OPS(7),
+    LANE_OPS(9)
+};
+
+const LaneOps &laneOps(int lanes) {
+    for (size_t i = 0; i < sizeof(laneOpsTable) / sizeof(laneOpsTable[0]); ++i)
+        if (laneOpsTable[i].lanes == lanes) return laneOpsTable[i];
+
+    fprintf(stderr, "lanes: %d lanes not supported (3, 5, 7 or 9), using %d\n",
+            lanes, DEFAULT_LANES);
+    return laneOps(DEFAULT_LANES);
+}
+
+// ------------- BENCHMARK -------------
+static double nowMicros() {
+    using namespace std::chrono;
+    return duration_cast<duration<double, std::micro> >(
+        steady_clock::now().time_since_epoch()).count();
+}
+
+// deterministic, so every variant sees the same obstacles
+static unsigned benchSeed;
+
+static unsigned benchRand() {
+    benchSeed = benchSeed * 1103515245u + 12345u;
+    return (benchSeed >> 16) & 0x7FFF;
+}
+
+const float BENCH_FAR_Z   = -80.0f;
+const float BENCH_DESPAWN = 25.0f;
+const float BENCH_SPAN    = BENCH_DESPAWN - BENCH_FAR_Z;
+
+// passed obstacles go back to the far end, which keeps the density constant
+static LaneStep benchStep() {
+    LaneStep s;
+    s.dz          = 10.0f / 60.0f;     // base speed at 60 ticks/s
+    s.despawnZ    = BENCH_DESPAWN;
+    s.recycleSpan = BENCH_SPAN;
+    s.playerLane  = 0;
+    s.hitFlags    = ENTITY_HARMFUL;
+    for (int a = 0; a < NUM_ARCHETYPES; ++a) {
+        s.hitMinZ[a] = -1.85f;         // player 1.2 + obstacle 2.5, halved
+        s.hitMaxZ[a] =  1.85f;
+    }
+    return s;
+}
+
+static volatile float benchSink;
+static const int BENCH_RUNS = 5;
+
+// Without recycling a fill is gone in about 630 ticks, so the destroy
+// benches refill this often, off the clock.
+static const int BENCH_FILL_TICKS = 600;
+
+// The array and loops update() and display() used before the kernels, with
+// the lane count fixed at 5: move, collide, then lane X per obstacle.
+struct RefObstacle {
+    int   lane;
+    float z;
+    bool  active;
+};
+
+static void refFill(std::vector<RefObstacle> &obs) {
+    benchSeed = 1;
+    for (size_t i = 0; i < obs.size(); ++i) {
+        obs[i].active = true;
+        obs[i].lane   = (int)(benchRand() % 5);
+        obs[i].z      = BENCH_FAR_Z + BENCH_SPAN * (benchRand() % 1000) / 1000.0f;
+    }
+}
+
+static double benchRecycleReference(std::vector<RefObstacle> &obs, int ticks) {
+    const int NUM_LANES = 5;
+    LaneStep s = benchStep();
+    int count = (int)obs.size();
+    float sink = 0.0f;
+
+    double t0 = nowMicros();
+    for (int t = 0; t < ticks; ++t) {
+        for (int i = 0; i < count; ++i) {
+            if (!obs[i].active) continue;
+            obs[i].z += s.dz;
+            if (obs[i].z > s.despawnZ)
+                obs[i].z -= s.recycleSpan;
+        }
+        for (int i = 0; i < count; ++i) {
+            const RefObstacle &o = obs[i];
+            if (!o.active || o.lane != s.playerLane) continue;
+            if (o.z >= s.hitMinZ[0] && o.z <= s.hitMaxZ[0]) { sink += 1.0f; break; }
+        }
+        for (int i = 0; i < count; ++i) {
+            if (!obs[i].active) continue;
+            sink += (obs[i].lane - (NUM_LANES - 1) / 2.0f) * LANE_SPACING;
+        }
+    }
+    double elapsed = nowMicros() - t0;
+    benchSink = sink;
+    return elapsed;
+}
+
+// The same, but the collide loop buckets every hit by lane as the kernels
+// do, rather than stopping at the first in the player's lane.
+static double benchBucketReference(std::vector<RefObstacle> &obs, int ticks) {
+    const int NUM_LANES = 5;
+    LaneStep s = benchStep();
+    int count = (int)obs.size();
+    float sink = 0.0f;
+
+    double t0 = nowMicros();
+    for (int t = 0; t < ticks; ++t) {
+        for (int i = 0; i < count; ++i) {
+            if (!obs[i].active) continue;
+            obs[i].z += s.dz;
+            if (obs[i].z > s.despawnZ)
+                obs[i].z -= s.recycleSpan;
+        }
+        int bucket[NUM_LANES][LANE_BUCKET_SIZE];
+        int bucketCount[NUM_LANES] = {};
+        for (int i = 0; i < count; ++i) {
+            const RefObstacle &o = obs[i];
+            if (!o.active || o.z < s.hitMinZ[0] || o.z > s.hitMaxZ[0]) continue;
+            if (bucketCount[o.lane] < LANE_BUCKET_SIZE)
+                bucket[o.lane][bucketCount[o.lane]++] = i;
+        }
+        if (bucketCount[s.playerLane] > 0) sink += (float)bucket[s.playerLane][0];
+        for (int i = 0; i < count; ++i) {
+            if (!obs[i].active) continue;
+            sink += (obs[i].lane - (NUM_LANES - 1) / 2.0f) * LANE_SPACING;
+        }
+    }
+    double elapsed = nowMicros() - t0;
+    benchSink = sink;
+    return elapsed;
+}
+
+static void storeFill(EntityStore &st, Arena &arena, int count, int lanes) {
+    int max[NUM_ARCHETYPES] = { count, 0 };
+    arenaReset(arena);
+    entityStoreInit(st, arena, max);
+
+    benchSeed = 1;
+    for (int i = 0; i < count; ++i) {
+        int lane = (int)(benchRand() % (unsigned)lanes);
+        float z  = BENCH_FAR_Z + BENCH_SPAN * (benchRand() % 1000) / 1000.0f;
+        entityCreate(st, ARCH_OBSTACLE, KIND_OBSTACLE, lane, z, ENTITY_HARMFUL);
+    }
+}
+
+static double benchRecycleKernel(const LaneOps &ops, EntityStore &st, int ticks) {
+    LaneStep s = benchStep();
+    LaneHit hits[4];
+    float sink = 0.0f;
+    const EntityArchetype &a = st.archetypes[ARCH_OBSTACLE];
+
+    double t0 = nowMicros();
+    for (int t = 0; t < ticks; ++t) {
+        if (ops.recycleStep(st, s, hits, 4) > 0) sink += 1.0f;
+        for (int c = 0; c < a.chunkCount; ++c) {
+            const unsigned char *lane = a.chunks[c]->lane;
+            int n = entityChunkCount(a, c);
+            for (int i = 0; i < n; ++i)
+                sink += ops.laneX[lane[i]];
+        }
+    }
+    double elapsed = nowMicros() - t0;
+    benchSink = sink;
+    return elapsed;
+}
+
+// update() before the kernels, as the game runs it: passed obstacles go
+// inactive, and the collide loop stops at the first hit in the player's lane.
+static double benchDestroyReference(std::vector<RefObstacle> &obs, int ticks) {
+    const int NUM_LANES = 5;
+    LaneStep s = benchStep();
+    int count = (int)obs.size();
+    float sink = 0.0f;
+    double elapsed = 0.0;
+
+    for (int done = 0; done < ticks; done += BENCH_FILL_TICKS) {
+        int segment = std::min(BENCH_FILL_TICKS, ticks - done);
+        refFill(obs);
+        double t0 = nowMicros();
+        for (int t = 0; t < segment; ++t) {
+            for (int i = 0; i < count; ++i) {
+                if (!obs[i].active) continue;
+                obs[i].z += s.dz;
+                if (obs[i].z > s.despawnZ)
+                    obs[i].active = false;
+            }
+            for (int i = 0; i < count; ++i) {
+                const RefObstacle &o = obs[i];
+                if (!o.active || o.lane != s.playerLane) continue;
+                if (o.z >= s.hitMinZ[0] && o.z <= s.hitMaxZ[0]) { sink += 1.0f; break; }
+            }
+            for (int i = 0; i < count; ++i) {
+                if (!obs[i].active) continue;
+                sink += (obs[i].lane - (NUM_LANES - 1) / 2.0f) * LANE_SPACING;
+            }
+        }
+        elapsed += nowMicros() - t0;
+    }
+    benchSink = sink;
+    return elapsed;
+}
+
+// ops.step, the game's kernel: passed entities are destroyed
+static double benchDestroyKernel(const LaneOps &ops, EntityStore &st, Arena &arena,
+                                 int count, int ticks) {
+    LaneStep s = benchStep();
+    s.recycleSpan = 0.0f;
+    LaneHit hits[4];
+    float sink = 0.0f;
+    double elapsed = 0.0;
+
+    for (int done = 0; done < ticks; done += BENCH_FILL_TICKS) {
+        int segment = std::min(BENCH_FILL_TICKS, ticks - done);
+        storeFill(st, arena, count, ops.lanes);
+        const EntityArchetype &a = st.archetypes[ARCH_OBSTACLE];
+        double t0 = nowMicros();
+        for (int t = 0; t < segment; ++t) {
+            if (ops.step(st, s, hits, 4) > 0) sink += 1.0f;
+            for (int c = 0; c < a.chunkCount; ++c) {
+                const unsigned char *lane = a.chunks[c]->lane;
+                int n = entityChunkCount(a, c);
+                for (int i = 0; i < n; ++i)
+                    sink += ops.laneX[lane[i]];
+            }
+        }
+        elapsed += nowMicros() - t0;
+    }
+    benchSink = sink;
+    return elapsed;
+}
+
+// A shield pickup and an obstacle on the player in the same tick, with no
+// shields: the pickup has to come first or the run ends.
+static bool checkHitOrder(const LaneOps &ops, EntityStore &st, Arena &arena) {
+    int max[NUM_ARCHETYPES] = { 4, 4 };
+    arenaReset(arena);
+    entityStoreInit(st, arena, max);
+    entityCreate(st, ARCH_OBSTACLE, KIND_OBSTACLE, 0, -0.1f, ENTITY_HARMFUL);
+    entityCreate(st, ARCH_PICKUP,   KIND_SHIELD,   0, -0.1f, ENTITY_COLLECTIBLE);
+
+    LaneStep s = benchStep();
+    s.hitFlags = ENTITY_HARMFUL | ENTITY_COLLECTIBLE;
+    LaneHit hits[4];
+    int n = ops.step(st, s, hits, 4);
+    return n == 2 && hits[0].arch == ARCH_PICKUP && hits[1].arch == ARCH_OBSTACLE;
+}
+
+int lanesRunBenchmark(int ticks) {
+    if (ticks < 1) ticks = 1;
+    static const int sizes[2] = { 40, 4096 };   // the game's default capacity, and dense
+
+    int max[NUM_ARCHETYPES] = { sizes[1], 0 };
+    Arena arena;
+    if (!arenaInit(arena, entityStoreBytes(max))) return 1;
+    EntityStore st;
+
+    const int kernels = (int)(sizeof(laneOpsTable) / sizeof(laneOpsTable[0]));
+    for (int i = 0; i < kernels; ++i)
+        if (!checkHitOrder(laneOpsTable[i], st, arena)) {
+            printf("lane kernels: %d lanes: an obstacle came before a pickup in the same tick\n",
+                   laneOpsTable[i].lanes);
+            arenaRelease(arena);
+            return 1;
+        }
+    printf("lane kernels: pickups come before obstacles in the same tick\n");
+
+    for (int k = 0; k < 2; ++k) {
+        std::vector<RefObstacle> obs((size_t)sizes[k]);
+        int n = (int)((long long)ticks * sizes[0] / sizes[k]);
+        if (n < 1) n = 1;
+
+        printf("lane kernels: %d obstacles, %d ticks, best of %d (ns per tick)\n",
+               sizes[k], n, BENCH_RUNS);
+
+        // the variants take turns within each run, so a slow patch of the
+        // machine costs them all alike
+        const int MAX_KERNELS = sizeof(laneOpsTable) / sizeof(laneOpsTable[0]);
+        double ref = 0.0, refBucket = 0.0, us[MAX_KERNELS];
+        double refDestroy = 0.0, usDestroy[MAX_KERNELS];
+        for (int r = 0; r < BENCH_RUNS; ++r) {
+            refFill(obs);
+            double t = benchRecycleReference(obs, n);
+            if (r == 0 || t < ref) ref = t;
+            refFill(obs);
+            t = benchBucketReference(obs, n);
+            if (r == 0 || t < refBucket) refBucket = t;
+            t = benchDestroyReference(obs, n);
+            if (r == 0 || t < refDestroy) refDestroy = t;
+            for (int i = 0; i < kernels; ++i) {
+                storeFill(st, arena, sizes[k], laneOpsTable[i].lanes);
+                t = benchRecycleKernel(laneOpsTable[i], st, n);
+                if (r == 0 || t < us[i]) us[i] = t;
+                t = benchDestroyKernel(laneOpsTable[i], st, arena, sizes[k], n);
+                if (r == 0 || t < usDestroy[i]) usDestroy[i] = t;
+            }
+        }
+        printf("                                   recycle (stress)     destroy (game)\n");
+        printf("  reference, 5 lanes hard-coded  %9.1f            %9.1f\n",
+               ref * 1000.0 / n, refDestroy * 1000.0 / n);
+        printf("  reference, bucketing by lane   %9.1f  (%.2fx)\n",
+               refBucket * 1000.0 / n, refBucket / ref);
+        for (int i = 0; i < kernels; ++i)
+            printf("  dispatched, %d lanes           %9.1f  (%.2fx)   %9.1f  (%.2fx)\n",
+                   laneOpsTable[i].lanes, us[i] * 1000.0 / n, us[i] / ref,
+                   usDestroy[i] * 1000.0 / n, usDestroy[i] / refDestroy);
+    }
+
+    arenaRelease(arena);
+    return 0;
+}
@@ -0,0 +1,210 @@
+// Lane-dependent simulation for the 3D runner, specialized per lane count.
+//
+// The runway can have 3, 5, 7 or 9 lanes. Everything that depends on the
+// count is compiled once per count: lane X positions come from constexpr
+// tables and the per-tick entity kernel (with its per-lane buckets) is
+// instantiated for each count, so a tick makes one indirect call (through
+// LaneOps) and otherwise runs the same code as a hard-coded lane count
+// would.
+#ifndef LANESIM_H
+#define LANESIM_H
+
+#include <math.h>
+#include <stdlib.h>
+#include "entities.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define LANESIM_SSE 1
+#endif
+
+constexpr float LANE_SPACING  = 4.0f;   // world units
+const int       DEFAULT_LANES = 5;
+
+// lane index -> X, lanes centred on X = 0
+constexpr float laneOffset(int lane, int lanes) {
+    return (lane - (lanes - 1) / 2.0f) * LANE_SPACING;
+}
+
+// ------------- LANE TABLES -------------
+template <int... I> struct LaneIndices {};
+
+template <int N, int... I>
+struct MakeLaneIndices : MakeLaneIndices<N - 1, N - 1, I...> {};
+
+template <int... I>
+struct MakeLaneIndices<0, I...> { typedef LaneIndices<I...> type; };
+
+template <int Lanes, typename Seq = typename MakeLaneIndices<Lanes>::type>
+struct LaneTable;
+
+template <int Lanes, int... I>
+struct LaneTable<Lanes, LaneIndices<I...> > {
+    static constexpr float x[Lanes] = { laneOffset(I, Lanes)... };
+};
+
+template <int Lanes, int... I>
+constexpr float LaneTable<Lanes, LaneIndices<I...> >::x[Lanes];
+
+// ------------- KERNELS -------------
+struct LaneStep {
+    float dz;                          // distance every entity moves
+    float despawnZ;                    // destroyed once past this...
+    float recycleSpan;                 // ...or moved back this far (recycleStep)
+    int   playerLane;
+    int   hitFlags;                    // EntityFlags that can hit this tick
+    float hitMinZ[NUM_ARCHETYPES];     // player overlap range along Z
+    float hitMaxZ[NUM_ARCHETYPES];
+};
+
+// An entity touching the player. `id` is its handle slot (entityRef()),
+// which stays correct while other hits are resolved and destroyed.
+struct LaneHit {
+    int arch;
+    int id;
+};
+
+const int LANE_BUCKET_SIZE = 8;        // hit candidates kept per lane
+
+// The order archetypes are bucketed in, so hits come out in it: pickups
+// first, then a shield collected in the same tick as a crash is there to
+// absorb it (as the game always resolved them).
+const int LANE_HIT_ORDER[NUM_ARCHETYPES] = { ARCH_PICKUP, ARCH_OBSTACLE };
+static_assert(NUM_ARCHETYPES == 2, "LANE_HIT_ORDER lists every archetype");
+
+// The recycling move over one chunk's z, four at a time with SSE2: nothing
+// is destroyed, so the move itself doesn't branch. The indices that end up
+// in [midZ - halfZ, midZ + halfZ] go into `candidate`; returns how many.
+inline int laneMoveRecycle(float *z, int n, float dz, float despawnZ, float recycleSpan,
+                           float midZ, float halfZ, int *candidate) {
+    int found = 0, k = 0;
+#ifdef LANESIM_SSE
+    const __m128 vdz   = _mm_set1_ps(dz),   vdespawn = _mm_set1_ps(despawnZ);
+    const __m128 vspan = _mm_set1_ps(recycleSpan);
+    const __m128 vmid  = _mm_set1_ps(midZ), vhalf    = _mm_set1_ps(halfZ);
+    const __m128 vabs  = _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF));
+    for (; k + 4 <= n; k += 4) {
+        __m128 v = _mm_add_ps(_mm_loadu_ps(z + k), vdz);
+        v = _mm_sub_ps(v, _mm_and_ps(_mm_cmpgt_ps(v, vdespawn), vspan));
+        _mm_storeu_ps(z + k, v);
+        int in = _mm_movemask_ps(_mm_cmple_ps(_mm_and_ps(_mm_sub_ps(v, vmid), vabs), vhalf));
+        if (in == 0) continue;             // most groups: nothing near the player
+        candidate[found] = k;     found += in & 1;
+        candidate[found] = k + 1; found += (in >> 1) & 1;
+        candidate[found] = k + 2; found += (in >> 2) & 1;
+        candidate[found] = k + 3; found += (in >> 3) & 1;
+    }
+#endif
+    for (; k < n; ++k) {
+        float zk = z[k] + dz;
+        zk -= zk > despawnZ ? recycleSpan : 0.0f;
+        z[k] = zk;
+        candidate[found] = k;
+        found += fabsf(zk - midZ) <= halfZ;
+    }
+    return found;
+}
+
+template <int Lanes>
+struct LaneSim {
+    static int randomLane() { return rand() % Lanes; }
+
+    // One pass over every entity of every archetype:
+    //   move     z += dz
+    //   despawn  whatever passed the player: destroyed, or with Recycle
+    //            moved back LaneStep::recycleSpan
+    //   bucket   by lane, whatever overlaps the player's Z and can hit
+    // The player's lane bucket then becomes the hit list, in LANE_HIT_ORDER
+    // by archetype. Recycle is a
+    // template parameter so each kernel does no more per entity than a
+    // hard-coded loop with that policy would.
+    template <bool Recycle>
+    static int step(EntityStore &st, const LaneStep &s, LaneHit *hits, int maxHits) {
+        LaneHit bucket[Lanes][LANE_BUCKET_SIZE];
+        int     bucketCount[Lanes] = {};
+
+        for (int order = 0; order < NUM_ARCHETYPES; ++order) {
+            const int arch = LANE_HIT_ORDER[order];
+            EntityArchetype &a = st.archetypes[arch];
+
+            // locals, so the bucket stores and entityDestroy() calls don't
+            // force them to be reloaded from `s` every iteration
+            const float dz   = s.dz;
+            const float midZ  = (s.hitMinZ[arch] + s.hitMaxZ[arch]) * 0.5f;
+            const float halfZ = (s.hitMaxZ[arch] - s.hitMinZ[arch]) * 0.5f;
+            const float despawnZ = s.despawnZ, recycleSpan = s.recycleSpan;
+            const int   hitFlags = s.hitFlags;
+
+            for (int ci = a.chunkCount - 1; ci >= 0; --ci) {
+                EntityChunk *c = a.chunks[ci];
+                float *z = c->z;
+                int    n = entityChunkCount(a, ci);
+
+                if (Recycle) {
+                    // only the few that overlap the player are looked at
+                    int candidate[ENTITY_CHUNK_SIZE];
+                    int found = laneMoveRecycle(z, n, dz, despawnZ, recycleSpan,
+                                                midZ, halfZ, candidate);
+                    if (hitFlags == 0) continue;
+                    for (int j = 0; j < found; ++j) {
+                        int k = candidate[j];
+                        if (c->flags[k] & hitFlags)
+                            addHit(bucket, bucketCount, c->lane[k], arch, c->id[k]);
+                    }
+                    continue;
+                }
+
+                // walked backwards, so the swap in entityDestroy only brings
+                // in entities already visited
+                for (int k = n - 1; k >= 0; --k) {
+                    float zk = z[k] + dz;
+                    if (zk > despawnZ) {
+                        entityDestroy(st, arch, (ci << ENTITY_CHUNK_SHIFT) + k);
+                        continue;
+                    }
+                    z[k] = zk;
+
+                    // one compare, almost always false: with entities spread
+                    // along the runway, `zk < minZ || zk > maxZ` mispredicts
+                    if (fabsf(zk - midZ) > halfZ || !(c->flags[k] & hitFlags))
+                        continue;
+                    addHit(bucket, bucketCount, c->lane[k], arch, c->id[k]);
+                }
+            }
+        }
+
+        int n = 0;
+        for (int j = 0; j < bucketCount[s.playerLane] && n < maxHits; ++j)
+            hits[n++] = bucket[s.playerLane][j];
+        return n;
+    }
+
+    static void addHit(LaneHit (*bucket)[LANE_BUCKET_SIZE], int *bucketCount,
+                       int lane, int arch, int id) {
+        if (bucketCount[lane] < LANE_BUCKET_SIZE) {
+            LaneHit &h = bucket[lane][bucketCount[lane]++];
+            h.arch = arch;
+            h.id   = id;
+        }
+    }
+};
+
+// ------------- DISPATCH -------------
+struct LaneOps {
+    int          lanes;
+    const float *laneX;                // [lanes]
+    int        (*randomLane)();
+    int        (*step)(EntityStore &st, const LaneStep &s, LaneHit *hits, int maxHits);
+    int        (*recycleStep)(EntityStore &st, const LaneStep &s, LaneHit *hits, int maxHits);
+};
+
+// 3, 5, 7 or 9; anything else logs and falls back to DEFAULT_LANES.
+const LaneOps &laneOps(int lanes);
+
+// --lane-bench: checks that a pickup and an obstacle reached in the same
+// tick come out pickup first, then times the dispatched kernels on the
+// entity store against the original hard-coded five-lane loops over an
+// obstacle array, doing the same work, headless.
+int lanesRunBenchmark(int ticks);
+
+#endif // LANESIM_H
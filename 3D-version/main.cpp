@@ -1,11 +1,35 @@
 #include <GL/glut.h>
+#ifdef FREEGLUT
+#include <GL/freeglut_ext.h>   // glutGetProcAddress
+#endif
+#include "glstats.h"
 #include <stdlib.h>
 #include <time.h>
 #include <stdio.h>
+#include <string.h>
 #include <math.h>
-#include <windows.h>
-#include <mmsystem.h>
-#pragma comment(lib, "winmm.lib")
+#include <algorithm>
+#include <chrono>
+#if defined(_WIN32) && !defined(FREEGLUT)
+#include <windows.h>                // wglGetProcAddress
+#endif
+#include "audio.h"
+#include "bundle.h"
+#include "mesh.h"
+#include "mat4.h"
+#include "scene.h"
+#include "arena.h"
+#include "entities.h"
+#include "lanesim.h"
+#include "particles.h"
+#include "netplay.h"
+#include "spectate.h"
+#include "vecenv.h"
+#include "botserver.h"
+#include "shmexport.h"
+#include "autopilot.h"
+#include "mlp.h"
+#include "recorder.h"
 
 
 
@@ -17,6 +41,7 @@ enum GameState {
     STATE_MENU,
     STATE_CHAR_SELECT,
     STATE_PLAYING,
+    STATE_CRASHED,         // run over, the crash plays out before game over
     STATE_GAMEOVER
 };
 GameState gameState = STATE_MENU;
@@ -43,48 +68,163 @@ float       nextPowerupTime = 10.0f;     // first offer at 10 seconds
 // We separate "base" speed from the actual speed used in movement
 float baseGameSpeed = 10.0f;            // increases every 15s
 // ------------- LANE / PLAYER -------------
-const int   NUM_LANES    = 5;
-const float LANE_SPACING = 4.0f;   // world units
-int   playerLane = NUM_LANES / 2;  // start in middle lane (index 2)
+// lane count is picked at startup (--lanes); the simulation code for it
+// comes from lanesim.h
+const LaneOps *laneSim = &laneOps(DEFAULT_LANES);
+int   playerLane = DEFAULT_LANES / 2;  // start in middle lane
 float playerX    = 0.0f;
 float playerY    = 0.5f;
 float playerZ    = 0.0f;
 float playerSize = 1.2f;           // cube size for collision
 float roadOffset = 0.0f;   // how far the road pattern has scrolled
-float animTime   = 0.0f;  // global animation time
-float carBob     = 0.0f;  // vertical bob for car
-float legSwing   = 0.0f;  // angle (degrees) for legs (dino + cat)
+const float STRIPE_SPACING = 6.0f;  // distance between dash groups
+const float STRIPE_LENGTH  = 3.0f;  // length of each dash
+float animTime   = 0.0f;  // global animation time (walk cycles)
 int currentWindowWidth  = WINDOW_WIDTH;
 int currentWindowHeight = WINDOW_HEIGHT;
 float lastShieldHitTime = -100.0f;   // time of last shield usage
 
-// ------------- OBSTACLES -------------
-struct Obstacle {
-    int   lane;
-    float z;       // world Z position
-    bool  active;
-};
+// ------------- ENTITIES -------------
+// Obstacles and pickups live in one entity store (entities.h), per
+// session. They share the move / despawn / collision pass in the lane
+// kernel; what a hit does depends on the entity's flags and kind.
+//
+// Obstacle capacity is set with --obstacles N. Only the first
+// SCENE_OBSTACLES obstacles get scene nodes and their own render commands,
+// the rest are drawn as a batch.
+const int DEFAULT_MAX_OBS = 40;
+const int SCENE_OBSTACLES = 64;
+const int MAX_PICKUPS     = 8;
+int maxObstacles = DEFAULT_MAX_OBS;
+EntityStore entities;
+
+const float ENTITY_SPAWN_Z   = -80.0f;   // spawn far ahead
+const float ENTITY_DESPAWN_Z = 25.0f;    // behind the camera
 
 // ---------- HEART (extra lives) ----------
-struct HeartPickup {
-    int   lane;
-    float z;
-    bool  active;
-};
-
-HeartPickup heartPickup;
 int   heartCount          = 0;
 const int MAX_HEARTS      = 3;
 float nextHeartSpawnTime  = 20.0f;   // first spawn between 20..40s
-
-
-const int MAX_OBS = 40;
-Obstacle obstacles[MAX_OBS];
+const float PICKUP_LENGTH = 1.5f;    // depth for collision
 
 float obstacleLength = 2.5f;       // depth for collision
+const float OBSTACLE_Y      = 1.2f;    // a bit above ground
+const float OBSTACLE_RADIUS = 1.0f;    // sphere radius
 float spawnInterval  = 1.0f;       // seconds between spawns
 float spawnTimer     = 0.0f;
 
+// ------------- PARTICLES -------------
+// Effects for shield breaks, pickups and the final crash (particles.h).
+// Up to PARTICLE_QUAD_LIMIT particles are drawn as camera-facing quads,
+// beyond that as points, which cost a quarter of the vertices.
+const int   MAX_PARTICLES       = 8192;
+const int   PARTICLE_QUAD_LIMIT = 2048;
+const float PARTICLE_SIZE       = 0.18f;   // quad edge, world units
+const float CRASH_SECONDS       = 1.2f;    // STATE_CRASHED -> STATE_GAMEOVER
+ParticleSystem  particles;
+ParticleVertex *particleVerts      = NULL;
+int             particleVertsCount = 0;    // capacity of particleVerts
+float           crashTimer         = 0.0f;
+
+// ------------- RACE (NETPLAY) -------------
+// --race P LOCALPORT HOST:PORT: head-to-head against another window over
+// UDP (netplay.h). The rollback session owns the race; every frame its
+// objects are copied into the entity store and the rival gets a scene
+// node, so the drawing code is the same as in a normal run.
+bool       raceMode       = false;
+NetSession raceSession;
+NetShim    raceShim       = { 0, 0, 0 };   // --net-delay / --net-jitter / --net-loss
+int        racePlayer     = 0;
+int        raceLocalPort  = 0;
+char       racePeerHost[64];
+int        racePeerPort   = 0;
+unsigned   raceSeed       = 1;             // --seed, both peers must agree
+float      raceTickTime   = 0.0f;          // real time not yet simulated
+int        raceLastShields = 0;            // for the shield break effect
+
+// ------------- SPECTATOR STREAM -------------
+// --spectate-serve ADDRESS: every tick of a single-player run goes out to
+// viewers (spectate.h). --spectate ADDRESS: watch one; the stream is
+// copied into the entity store and the player state each frame, so it is
+// drawn like a run of our own.
+bool       spectateServing   = false;
+bool       spectating        = false;
+const char *spectateAddress  = NULL;
+SpecServer spectateServer;
+SpecViewer spectateViewer;
+SpecState  spectateFrame;                  // this tick, for the publisher
+int        spectateTick      = 0;
+double     spectateTravel    = 0.0;        // distance scrolled over all runs
+int        spectateLastRun   = -1;         // viewer: last SpecRunState seen
+int        spectateLastShields = 0;
+
+// ------------- STATE EXPORT -------------
+// --shm-export NAME: the state of every tick goes into shared memory for
+// overlays and other tools (shmstate.h), without ever waiting on them.
+const int  SHM_EXPORT_MAX_OBJECTS = 65536; // the rest are only counted
+bool       shmExporting      = false;
+const char *shmExportName    = NULL;
+double     shmExportMicros   = 0.0;        // summed over frames
+long       shmExportFrames   = 0;
+
+// ------------- AUTOPILOT -------------
+// A (or --autopilot): the lane planner (autopilot.h) plays, pressing the
+// same keys a player would. Left on in the menus or at game over it starts
+// a new run after a few seconds: attract mode.
+const int  ATTRACT_DELAY_MS  = 4000;
+bool       autopilotOn       = false;
+bool       attractPending    = false;      // a start is scheduled
+double     autopilotMicros   = 0.0;        // summed over decisions
+long       autopilotDecisions = 0;
+
+// --mlp FILE: a learned policy (mlp.h) plays instead of the planner. It
+// sees what a VecEnv run would (vecenv.h) and its actions are keys too.
+const char *mlpPath          = NULL;
+Mlp        mlpNet;
+Arena      mlpArena;                      // one input's scratch, obs, logits
+float      *mlpScratchBuf    = NULL;
+float      *mlpObs           = NULL;
+float      *mlpLogits        = NULL;
+
+// ------------- RECORDING -------------
+// --record FILE: a row per tick of a single-player run goes to a columnar
+// file (recorder.h): what was on screen, what was pressed, what came of
+// it. Imitation training data; recread reads it back.
+enum RecordColumn {
+    REC_COL_RUN,                           // u32, one up for each run
+    REC_COL_TICK,                          // u32, within the run
+    REC_COL_TIME,                          // f32, elapsed in the run
+    REC_COL_DT,                            // f32, the tick's length
+    REC_COL_SCORE,                         // u32, after the tick
+    REC_COL_ACTION,                        // u8, what the inputs came to (ACT_*)
+    REC_COL_KEYS,                          // u8, REC_KEY_* pressed since the row before
+    REC_COL_MOUSE_X,                       // f32, last drag 0..1 across, -1 = none
+    REC_COL_DRIVER,                        // u8, 0 player, 1 planner, 2 policy net
+    REC_COL_DONE,                          // u8, the run ended in this tick
+    REC_COL_OBS                            // + k: the observation (vecenv.h)
+};
+enum RecordKey {
+    REC_KEY_LEFT  = 1,
+    REC_KEY_RIGHT = 2,
+    REC_KEY_E     = 4,
+    REC_KEY_R     = 8,
+    REC_KEY_T     = 16,
+    REC_KEY_DRAG  = 32
+};
+bool       recording         = false;
+const char *recordPath       = NULL;
+Recorder   recorder;
+uint32_t   recordRun         = 0;
+uint32_t   recordTickIndex   = 0;
+bool       recordHaveObs     = false;      // a snapshot waits for its row
+float      recordObs[VECENV_MAX_OBS];      // the snapshot, at the end of the last tick
+int        recordLane        = 0;
+float      recordTime        = 0.0f;
+int        recordKeys        = 0;          // since the snapshot
+float      recordMouseX      = -1.0f;
+double     recordMicros      = 0.0;        // summed over rows
+long       recordRows        = 0;
+
 // ------------- TIME / SCORE / SPEED -------------
 int   lastTimeMs              = 0;
 float elapsedTime             = 0.0f;
@@ -95,7 +235,8 @@ int   score                   = 0;
 float gameSpeed               = 10.0f;  // forward speed (world units per second)
 
 // ------------- INPUT -------------
-bool isDragging = false;
+bool isDragging   = false;
+bool showProfiler = false;   // F3 toggles the profiler overlay
 
 // ------------- TEXT UTILS -------------
 void drawString(void *font, const char *str, float x, float y) {
@@ -115,19 +256,54 @@ void drawStringCentered(void *font, const char *str, float centerX, float y) {
 }
 
 // ------------- RESET / INIT -------------
-void resetObstacles() {
-    for (int i = 0; i < MAX_OBS; ++i)
-        obstacles[i].active = false;
+// Run-scoped data is allocated from sessionArena; resetGame() drops the
+// previous run's allocations in one go and builds the new run's pools.
+const size_t SESSION_ARENA_BYTES = 1 << 20;   // plus the entity store
+Arena sessionArena;
+
+void entityLimits(int max[NUM_ARCHETYPES]) {
+    max[ARCH_OBSTACLE] = maxObstacles;
+    max[ARCH_PICKUP]   = MAX_PICKUPS;
+}
+
+int particleVertexCapacity() {
+    int quads = PARTICLE_QUAD_LIMIT * 4;
+    return (MAX_PARTICLES > quads) ? MAX_PARTICLES : quads;
+}
+
+size_t sessionArenaBytes() {
+    int max[NUM_ARCHETYPES];
+    entityLimits(max);
+    return SESSION_ARENA_BYTES + entityStoreBytes(max) + particlesBytes(MAX_PARTICLES) +
+           sizeof(ParticleVertex) * (size_t)particleVertexCapacity();
+}
+
+void resetEntities() {
+    int max[NUM_ARCHETYPES];
+    entityLimits(max);
+    entityStoreInit(entities, sessionArena, max);
+}
+
+void resetParticles() {
+    particlesInit(particles, sessionArena, MAX_PARTICLES);
+    particles.floorY   = 0.0f;                 // runway surface
+    particleVerts      = arenaNew<ParticleVertex>(sessionArena, particleVertexCapacity());
+    particleVertsCount = particleVerts ? particleVertexCapacity() : 0;
 }
 
 void recalcPlayerX() {
-    // lanes: 0..4 mapped to x = -2*spacing .. +2*spacing
-    playerX = (playerLane - (NUM_LANES - 1) / 2.0f) * LANE_SPACING;
+    // lanes are centred on x = 0, LANE_SPACING apart
+    playerX = laneSim->laneX[playerLane];
 }
 
 void resetGame() {
-    resetObstacles();
-    playerLane = NUM_LANES / 2;
+#ifdef ARENA_CHECKS
+    arenaReportSession(sessionArena);
+#endif
+    arenaReset(sessionArena);
+    resetEntities();
+    resetParticles();
+    playerLane = laneSim->lanes / 2;
     recalcPlayerX();
     playerY = 0.5f;
     playerZ = 0.0f;
@@ -135,9 +311,6 @@ void resetGame() {
 
 
       // hearts
-    heartPickup.active   = false;
-    heartPickup.lane     = 0;
-    heartPickup.z        = -80.0f;
     heartCount           = 0;
     nextHeartSpawnTime   = 20.0f;   // first spawn window starts at t≈20
 
@@ -155,89 +328,343 @@ void resetGame() {
     roadOffset    = 0.0f;
 
     animTime = 0.0f;
-    carBob   = 0.0f;
-    legSwing = 0.0f;
 
     // powerups
     activePowerup   = PWR_NONE;
     choosingPowerup = false;
     powerupTimer    = 0.0f;
     nextPowerupTime = 10.0f;
+
+    ++recordRun;
+    recordTickIndex = 0;
+    recordHaveObs   = false;
 }
 
 
 // ------------- SPAWN OBSTACLES -------------
+// at maxObstacles the spawn is skipped
 void spawnObstacle() {
-    for (int i = 0; i < MAX_OBS; ++i) {
-        if (!obstacles[i].active) {
-            obstacles[i].active = true;
-            obstacles[i].lane   = rand() % NUM_LANES;
-            obstacles[i].z      = -80.0f;   // spawn far ahead
-            break;
-        }
-    }
+    entityCreate(entities, ARCH_OBSTACLE, KIND_OBSTACLE, laneSim->randomLane(),
+                 ENTITY_SPAWN_Z, ENTITY_HARMFUL);
 }
 
-// ------------- COLLISION -------------
-bool checkCollision(const Obstacle &o) {
-    if (!o.active) return false;
-    if (o.lane != playerLane) return false;
+void spawnPickup(int kind) {
+    entityCreate(entities, ARCH_PICKUP, kind, laneSim->randomLane(),
+                 ENTITY_SPAWN_Z, ENTITY_COLLECTIBLE);
+}
 
-    // Overlap along Z axis
+// ------------- COLLISION -------------
+// Entities in the player's lane hit when their Z overlaps the player's;
+// the test itself runs inside the lane kernel (LaneSim::step).
+void entityHitRange(float length, float &minZ, float &maxZ) {
     float halfPlayer = playerSize * 0.5f;
-    float halfObs    = obstacleLength * 0.5f;
-    float minZ = playerZ - halfPlayer - halfObs;
-    float maxZ = playerZ + halfPlayer + halfObs;
+    minZ = playerZ - halfPlayer - length * 0.5f;
+    maxZ = playerZ + halfPlayer + length * 0.5f;
+}
 
-    if (o.z >= minZ && o.z <= maxZ)
-        return true;
-    return false;
+// ------------- EFFECTS -------------
+void effectShieldBreak(float x, float z) {
+    ParticleBurst shards = { x, OBSTACLE_Y, z, 160, 7.0f, 0.6f, 0.9f, 0.40f, 0.75f, 1.0f };
+    ParticleBurst sparks = { x, OBSTACLE_Y, z,  60, 4.0f, 0.3f, 0.6f, 1.0f,  0.25f, 0.25f };
+    particlesEmit(particles, shards);
+    particlesEmit(particles, sparks);
 }
 
-// ------------- PROJECTION HELPERS -------------
-void set2D() {
-    glMatrixMode(GL_PROJECTION);
-    glLoadIdentity();
-    gluOrtho2D(0, WINDOW_WIDTH, 0, WINDOW_HEIGHT);
-    glMatrixMode(GL_MODELVIEW);
-    glLoadIdentity();
-    glDisable(GL_DEPTH_TEST);
+void effectPickup(float x, float z) {
+    ParticleBurst glow = { x, 1.3f, z, 90, 3.0f, 1.0f, 0.7f, 0.85f, 0.85f, 0.3f };
+    particlesEmit(particles, glow);
 }
 
-void set3D() {
+void effectCrash(float x, float y, float z) {
+    ParticleBurst fire  = { x, y + 1.0f, z, 900, 9.0f, 0.5f, 1.1f, 1.0f, 0.45f, 0.1f };
+    ParticleBurst smoke = { x, y + 1.0f, z, 300, 3.0f, 0.8f, 1.2f, 0.5f, 0.5f,  0.5f };
+    particlesEmit(particles, fire);
+    particlesEmit(particles, smoke);
+}
+
+// ------------- GL STATE CACHE -------------
+// Thin layer over the GL state calls the game makes. Each setter remembers
+// the value it last sent and drops calls that would not change anything.
+// All color / line width / depth test / projection changes must go through
+// here, otherwise the cached values no longer match the real GL state.
+enum GLStateKind {
+    GLS_COLOR,
+    GLS_LINE_WIDTH,
+    GLS_DEPTH_TEST,
+    GLS_PROJECTION,
+    NUM_GLS
+};
+
+const char *glStateNames[NUM_GLS] = { "color", "line width", "depth test", "projection" };
+
+struct GLStateStats {
+    int issued[NUM_GLS];    // calls forwarded to GL
+    int skipped[NUM_GLS];   // calls dropped because nothing would change
+};
+
+GLStateStats glStateFrame;       // frame being counted
+GLStateStats glStateLastFrame;   // last finished frame (for the profiler)
+
+enum ProjectionKind {
+    PROJ_UNKNOWN,
+    PROJ_2D,
+    PROJ_3D
+};
+
+struct GLStateCache {
+    float r, g, b;
+    float lineWidth;
+    int   depthTest;              // -1 unknown, 0 off, 1 on
+    ProjectionKind projection;    // matrix currently loaded in GL_PROJECTION
+    int   projW, projH;           // window size the matrices were built for
+    GLdouble ortho[16];
+    GLdouble perspective[16];
+};
+
+GLStateCache glCache = { -1.0f, -1.0f, -1.0f, -1.0f, -1, PROJ_UNKNOWN, 0, 0, {0}, {0} };
+
+void glStateBeginFrame() {
+    glStateLastFrame = glStateFrame;
+    for (int i = 0; i < NUM_GLS; ++i) {
+        glStateFrame.issued[i]  = 0;
+        glStateFrame.skipped[i] = 0;
+    }
+}
+
+void setColor(float r, float g, float b) {
+    if (r == glCache.r && g == glCache.g && b == glCache.b) {
+        glStateFrame.skipped[GLS_COLOR]++;
+        return;
+    }
+    glColor3f(r, g, b);
+    glCache.r = r; glCache.g = g; glCache.b = b;
+    glStateFrame.issued[GLS_COLOR]++;
+    GL_STATS_STATE();
+}
+
+// drawing with a color array (meshes) leaves the current color undefined
+void forgetColor() {
+    glCache.r = glCache.g = glCache.b = -1.0f;
+}
+
+void setLineWidth(float w) {
+    if (w == glCache.lineWidth) {
+        glStateFrame.skipped[GLS_LINE_WIDTH]++;
+        return;
+    }
+    glLineWidth(w);
+    glCache.lineWidth = w;
+    glStateFrame.issued[GLS_LINE_WIDTH]++;
+    GL_STATS_STATE();
+}
+
+void setDepthTest(bool on) {
+    if (glCache.depthTest == (on ? 1 : 0)) {
+        glStateFrame.skipped[GLS_DEPTH_TEST]++;
+        return;
+    }
+    if (on) glEnable(GL_DEPTH_TEST);
+    else    glDisable(GL_DEPTH_TEST);
+    glCache.depthTest = on ? 1 : 0;
+    glStateFrame.issued[GLS_DEPTH_TEST]++;
+    GL_STATS_STATE();
+}
+
+// Same matrices gluOrtho2D / gluPerspective would build (column-major),
+// computed once per window size instead of on every set2D() / set3D().
+void buildProjectionMatrices() {
+    for (int i = 0; i < 16; ++i) {
+        glCache.ortho[i]       = 0.0;
+        glCache.perspective[i] = 0.0;
+    }
+
+    // gluOrtho2D(0, WINDOW_WIDTH, 0, WINDOW_HEIGHT)
+    glCache.ortho[0]  =  2.0 / WINDOW_WIDTH;
+    glCache.ortho[5]  =  2.0 / WINDOW_HEIGHT;
+    glCache.ortho[10] = -1.0;
+    glCache.ortho[12] = -1.0;
+    glCache.ortho[13] = -1.0;
+    glCache.ortho[15] =  1.0;
+
+    // gluPerspective(60, WINDOW_WIDTH / WINDOW_HEIGHT, 0.1, 500)
+    double zNear  = 0.1, zFar = 500.0;
+    double aspect = (double)WINDOW_WIDTH / (double)WINDOW_HEIGHT;
+    double f      = 1.0 / tan(60.0 * 3.14159265358979 / 360.0);
+    glCache.perspective[0]  = f / aspect;
+    glCache.perspective[5]  = f;
+    glCache.perspective[10] = (zFar + zNear) / (zNear - zFar);
+    glCache.perspective[11] = -1.0;
+    glCache.perspective[14] = 2.0 * zFar * zNear / (zNear - zFar);
+
+    glCache.projW = currentWindowWidth;
+    glCache.projH = currentWindowHeight;
+}
+
+void setProjection(ProjectionKind kind) {
+    if (glCache.projW != currentWindowWidth || glCache.projH != currentWindowHeight) {
+        buildProjectionMatrices();
+        glCache.projection = PROJ_UNKNOWN;
+    }
+    if (glCache.projection == kind) {
+        glStateFrame.skipped[GLS_PROJECTION]++;
+        return;
+    }
     glMatrixMode(GL_PROJECTION);
-    glLoadIdentity();
-    gluPerspective(60.0, (double)WINDOW_WIDTH / (double)WINDOW_HEIGHT, 0.1, 500.0);
+    glLoadMatrixd(kind == PROJ_3D ? glCache.perspective : glCache.ortho);
     glMatrixMode(GL_MODELVIEW);
-    glLoadIdentity();
-    glEnable(GL_DEPTH_TEST);
+    glCache.projection = kind;
+    glStateFrame.issued[GLS_PROJECTION]++;
+    GL_STATS_STATE();
 }
-void drawShieldPickup3D(float x, float z)
-{
-    glPushMatrix();
 
-    // --- Position + bobbing animation ---
-    float bob = sinf(elapsedTime * 4.0f) * 0.25f;   // up/down motion
-    glTranslatef(x, 1.3f + bob, z);
-      glRotatef(180.0f, 1, 0, 0);   // flip shield upside-down
+// ------------- SCENE -------------
+// World matrices for everything the playing screen places in 3D, cached in
+// a scene graph (scene.h). Static transforms (spike layout, shield tilt)
+// are computed once in initScene(); updateScene() only sets what moves
+// this frame and lets sceneUpdate() rebuild the affected nodes.
+const int   NUM_SPIKES   = 26;     // 6 axes + ring of 8 + two tilted rings of 6
+const float SPIKE_LENGTH = 0.8f;   // length of each spike
+const float SPIKE_RADIUS = 0.25f;  // radius of each spike base
+
+SceneGraph scene;
+int obstacleNodes[SCENE_OBSTACLES];
+int spikeNodes[NUM_SPIKES];        // relative to the obstacle centre
+int playerNode;
+int rivalNode;                         // race mode only
+int pickupNodes[MAX_PICKUPS];          // lane / z
+int pickupBobNodes[MAX_PICKUPS];       // bob + upside-down flip
+int pickupSpinNodes[MAX_PICKUPS];      // spin around Y
+int pickupShieldNodes[MAX_PICKUPS];    // tilt + scale, what the shield is drawn in
+
+// spike pointing along the rotated +Z, its base on the sphere surface
+void addSpikeNode(int parent, int index, const float rotation[16]) {
+    float m[16];
+    mat4Translation(m, 0.0f, 0.0f, OBSTACLE_RADIUS);
+    mat4Multiply(rotation, m, m);
+    spikeNodes[index] = sceneAddNode(scene, parent);
+    sceneSetLocal(scene, spikeNodes[index], m);
+}
 
-    // --- Rotate around the vertical axis (like your drawing) ---
-    float rot = fmodf(elapsedTime * 60.0f, 360.0f);
-    glRotatef(rot, 0.0f, 1.0f, 0.0f);               // spin around Y
+void initScene() {
+    sceneInit(scene);
+
+    for (int i = 0; i < SCENE_OBSTACLES; ++i)
+        obstacleNodes[i] = sceneAddNode(scene, -1);
+    playerNode = sceneAddNode(scene, -1);
+    rivalNode  = sceneAddNode(scene, -1);
+
+    // -------- spike layout --------
+    // front / back / up / down / left / right, then the rings
+    int spikeRoot = sceneAddNode(scene, -1);
+    float r[16], tilt[16];
+    int n = 0;
+    mat4Identity(r);               addSpikeNode(spikeRoot, n++, r);   // +Z
+    mat4RotationY(r, 180.0f);      addSpikeNode(spikeRoot, n++, r);   // -Z
+    mat4RotationX(r, -90.0f);      addSpikeNode(spikeRoot, n++, r);   // +Y
+    mat4RotationX(r, 90.0f);       addSpikeNode(spikeRoot, n++, r);   // -Y
+    mat4RotationY(r, -90.0f);      addSpikeNode(spikeRoot, n++, r);   // +X
+    mat4RotationY(r, 90.0f);       addSpikeNode(spikeRoot, n++, r);   // -X
+
+    for (int i = 0; i < 8; ++i) {  // ring around the middle
+        mat4RotationY(r, i * 45.0f);
+        addSpikeNode(spikeRoot, n++, r);
+    }
+    for (int i = 0; i < 6; ++i) {  // upper and lower tilted rings
+        mat4RotationY(r, i * 60.0f);
+        mat4RotationX(tilt, 25.0f);
+        mat4Multiply(tilt, r, tilt);
+        addSpikeNode(spikeRoot, n++, tilt);
+
+        mat4RotationX(tilt, -25.0f);
+        mat4Multiply(tilt, r, tilt);
+        addSpikeNode(spikeRoot, n++, tilt);
+    }
+
+    // -------- shield pickups --------
+    float scale[16];
+    mat4RotationX(tilt, -20.0f);   // slight tilt so it's visible
+    mat4Scaling(scale, 1.6f, 1.6f, 1.6f);
+    mat4Multiply(tilt, scale, tilt);
+
+    for (int i = 0; i < MAX_PICKUPS; ++i) {
+        pickupNodes[i]       = sceneAddNode(scene, -1);
+        pickupBobNodes[i]    = sceneAddNode(scene, pickupNodes[i]);
+        pickupSpinNodes[i]   = sceneAddNode(scene, pickupBobNodes[i]);
+        pickupShieldNodes[i] = sceneAddNode(scene, pickupSpinNodes[i]);
+        sceneSetLocal(scene, pickupShieldNodes[i], tilt);
+    }
+
+    sceneUpdate(scene);
+}
 
-    // slight tilt so it's visible
-    glRotatef(-20.0f, 1.0f, 0.0f, 0.0f);
+// obstacles drawn through their own scene nodes (the first ones; the
+// store is dense, so these are simply indices 0..n-1)
+int sceneObstacleCount() {
+    int n = entityCount(entities, ARCH_OBSTACLE);
+    return (n < SCENE_OBSTACLES) ? n : SCENE_OBSTACLES;
+}
 
-    // --- Scale ---
-    glScalef(1.6f, 1.6f, 1.6f);
+void updateScene() {
+    // SCENE_OBSTACLES and MAX_PICKUPS are both within the first chunk
+    int shown = sceneObstacleCount();
+    if (shown > 0) {
+        const EntityChunk *obs = entities.archetypes[ARCH_OBSTACLE].chunks[0];
+        for (int i = 0; i < shown; ++i)
+            sceneSetTranslation(scene, obstacleNodes[i], laneSim->laneX[obs->lane[i]],
+                                OBSTACLE_Y, obs->z[i]);
+    }
+
+    sceneSetTranslation(scene, playerNode, playerX, playerY + 1.0f, playerZ);
+    if (raceMode) {
+        const RacePlayer &rival = raceSession.state.players[raceSession.remotePlayer];
+        sceneSetTranslation(scene, rivalNode, laneSim->laneX[rival.lane],
+                            playerY + 1.0f, playerZ);
+    }
 
+    int pickups = entityCount(entities, ARCH_PICKUP);
+    if (pickups > 0) {
+        const EntityChunk *pk = entities.archetypes[ARCH_PICKUP].chunks[0];
+        float bobSpin[16], spin[16], flip[16];
+
+        float bob = sinf(elapsedTime * 4.0f) * 0.25f;   // up/down motion
+        mat4Translation(bobSpin, 0.0f, 1.3f + bob, 0.0f);
+        mat4RotationX(flip, 180.0f);                    // flip shield upside-down
+        mat4Multiply(bobSpin, flip, bobSpin);
+        mat4RotationY(spin, fmodf(elapsedTime * 60.0f, 360.0f));
+
+        for (int i = 0; i < pickups; ++i) {
+            sceneSetTranslation(scene, pickupNodes[i], laneSim->laneX[pk->lane[i]], 0.0f, pk->z[i]);
+            sceneSetLocal(scene, pickupBobNodes[i], bobSpin);
+            sceneSetLocal(scene, pickupSpinNodes[i], spin);
+        }
+    }
+
+    sceneUpdate(scene);
+}
+
+// ------------- PROJECTION HELPERS -------------
+void set2D() {
+    setProjection(PROJ_2D);
+    glLoadIdentity();
+    setDepthTest(false);
+}
+
+void set3D() {
+    setProjection(PROJ_3D);
+    glLoadIdentity();
+    setDepthTest(true);
+}
+// drawn in a pickupShieldNodes[] space; bob, spin, tilt and scale all come
+// from the scene graph (see updateScene)
+void drawShieldPickup3D()
+{
     // ======================================
     //           DRAW THE SHIELD
     // ======================================
 
     // FRONT (blue shield surface)
     glBegin(GL_POLYGON);
-        glColor3f(0.15f, 0.50f, 1.0f);  // main blue
+        setColor(0.15f, 0.50f, 1.0f);  // main blue
         glVertex3f( 0.0f,  0.60f, 0.0f);
         glVertex3f( 0.45f, 0.20f, 0.0f);
         glVertex3f( 0.32f,-0.45f, 0.0f);
@@ -247,7 +674,7 @@ void drawShieldPickup3D(float x, float z)
 
     // highlight (brighter blue)
     glBegin(GL_POLYGON);
-        glColor3f(0.40f, 0.75f, 1.0f);
+        setColor(0.40f, 0.75f, 1.0f);
         glVertex3f( 0.0f,  0.50f, 0.001f);
         glVertex3f( 0.30f, 0.15f, 0.001f);
         glVertex3f( 0.20f,-0.30f, 0.001f);
@@ -256,9 +683,9 @@ void drawShieldPickup3D(float x, float z)
     glEnd();
 
     // METAL BORDER (silver)
-    glLineWidth(6);
+    setLineWidth(6);
     glBegin(GL_LINE_LOOP);
-        glColor3f(0.85f, 0.85f, 0.90f);  // shiny silver
+        setColor(0.85f, 0.85f, 0.90f);  // shiny silver
         glVertex3f( 0.0f,  0.60f, 0.0f);
         glVertex3f( 0.45f, 0.20f, 0.0f);
         glVertex3f( 0.32f,-0.45f, 0.0f);
@@ -268,7 +695,7 @@ void drawShieldPickup3D(float x, float z)
 
     // BACK SIDE (dark silver)
     glBegin(GL_POLYGON);
-        glColor3f(0.4f, 0.4f, 0.45f);
+        setColor(0.4f, 0.4f, 0.45f);
         glVertex3f( 0.0f,  0.60f, -0.05f);
         glVertex3f( 0.45f, 0.20f, -0.05f);
         glVertex3f( 0.32f,-0.45f, -0.05f);
@@ -276,146 +703,317 @@ void drawShieldPickup3D(float x, float z)
         glVertex3f(-0.45f, 0.20f, -0.05f);
     glEnd();
     // after drawing the shield border
-glLineWidth(1.0f);   // reset to default thin lines
-glPopMatrix();
+    setLineWidth(1.0f);   // reset to default thin lines
+}
 
 
-    glPopMatrix();
+// ------------- ASSETS -------------
+// Optional packed bundle, built by BundleBuilder from bundle.manifest.
+// Whatever it contains is used straight out of the mapping; anything
+// missing falls back to the loose file or the procedural version.
+const char *BUNDLE_PATH = "assets/game.bundle";
+
+const std::chrono::steady_clock::time_point launchTime = std::chrono::steady_clock::now();
+bool   bundleLoaded      = false;
+double bundleOpenMs      = 0.0;
+bool   firstMenuReported = false;
+
+double millisSinceLaunch() {
+    return std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - launchTime).count();
 }
 
+void loadBundle() {
+    double t0 = millisSinceLaunch();
+    bundleLoaded = bundleOpen(BUNDLE_PATH);
+    bundleOpenMs = millisSinceLaunch() - t0;
+    if (!bundleLoaded) return;
+
+    // effects have to be in place before the mixer starts
+    static const char *sfxNames[NUM_SFX] = {
+        "sfx_collision", "sfx_shield", "sfx_powerup"
+    };
+    for (int i = 0; i < NUM_SFX; ++i) {
+        const BundleEntry *e = bundleFind(sfxNames[i], BUNDLE_PCM);
+        if (e && e->params[0] == (uint32_t)AUDIO_SAMPLE_RATE && e->params[1] == 1)
+            audioSetEffectPCM((SoundEffect)i, (const short *)bundleData(e),
+                              (int)e->params[2]);
+    }
+}
+
+void startMusic() {
+    const BundleEntry *e = bundleFind("soundtrack", BUNDLE_PCM);
+    if (e && audioStartMusicPCM((const short *)bundleData(e), (long)e->params[2],
+                                (int)e->params[0], (int)e->params[1]))
+        return;
+    audioStartMusic("assets/soundtrack.wav");
+}
+
+// launch -> first menu frame on screen, once
+void reportFirstMenuFrame() {
+    if (firstMenuReported) return;
+    firstMenuReported = true;
+
+    glFinish();
+    if (bundleLoaded)
+        fprintf(stderr, "startup: first menu frame after %.1f ms "
+                        "(bundle: %d entries mapped in %.2f ms)\n",
+                millisSinceLaunch(), bundleEntryCount(), bundleOpenMs);
+    else
+        fprintf(stderr, "startup: first menu frame after %.1f ms (no bundle)\n",
+                millisSinceLaunch());
+}
 
 // ------------- 3D DRAWING -------------
-void drawRunway() {
-    glColor3f(0.15f, 0.15f, 0.18f);
+// The runway is one static textured quad. The texture holds a single
+// dash period (asphalt + lane lines across the full width), repeated
+// along Z, so scrolling the road is just a texture-matrix translate.
+// A "runway" texture in the asset bundle replaces the generated one.
+const float RUNWAY_NEAR_Z = 20.0f;
+const float RUNWAY_FAR_Z  = -200.0f;
+const int   RUNWAY_TEX_W  = 256;   // across the runway (X)
+const int   RUNWAY_TEX_H  = 32;    // one dash period (Z)
+
+GLuint runwayTexture = 0;   // 0 = not available, use the line fallback
+GLuint runwayList    = 0;
+
+// at least as wide as the original five lanes, half a lane past the edges
+float runwayHalfWidth() {
+    float half = (laneSim->lanes / 2.0f + 0.5f) * LANE_SPACING;
+    return (half > LANE_SPACING * 3) ? half : LANE_SPACING * 3;
+}
+
+// X of the line between lane i - 1 and lane i
+float laneLineX(int i) {
+    return (i - laneSim->lanes / 2.0f) * LANE_SPACING;
+}
+
+void initRunwayMesh() {
+    static unsigned char texels[RUNWAY_TEX_H][RUNWAY_TEX_W][3];
+
+    float halfW  = runwayHalfWidth();
+    int   dashRows = (int)(RUNWAY_TEX_H * STRIPE_LENGTH / STRIPE_SPACING);
+
+    // bundled texture: RGB, power-of-two, uploaded from the mapping
+    const void *pixels = texels;
+    int texW = RUNWAY_TEX_W;
+    int texH = RUNWAY_TEX_H;
+    const BundleEntry *tex = bundleFind("runway", BUNDLE_TEXTURE);
+    if (tex != NULL) {
+        int w = (int)tex->params[0];
+        int h = (int)tex->params[1];
+        if (tex->params[2] == 3 && (w & (w - 1)) == 0 && (h & (h - 1)) == 0) {
+            pixels = bundleData(tex);
+            texW   = w;
+            texH   = h;
+        } else {
+            fprintf(stderr, "bundle: runway texture must be RGB with power-of-two size\n");
+        }
+    }
+
+    // asphalt everywhere
+    for (int t = 0; pixels == texels && t < RUNWAY_TEX_H; ++t)
+        for (int s = 0; s < RUNWAY_TEX_W; ++s) {
+            texels[t][s][0] = 38;   // 0.15
+            texels[t][s][1] = 38;   // 0.15
+            texels[t][s][2] = 46;   // 0.18
+        }
+
+    // lane lines: 2 texels wide, only on the dash rows of the period
+    for (int i = 1; pixels == texels && i < laneSim->lanes; ++i) {
+        float x  = laneLineX(i);
+        int   s0 = (int)((x + halfW) / (2.0f * halfW) * RUNWAY_TEX_W) - 1;
+        for (int t = 0; t < dashRows; ++t)
+            for (int s = s0; s < s0 + 2; ++s) {
+                if (s < 0 || s >= RUNWAY_TEX_W) continue;
+                texels[t][s][0] = 204;   // 0.8
+                texels[t][s][1] = 204;
+                texels[t][s][2] = 204;
+            }
+    }
+
+    glGenTextures(1, &runwayTexture);
+    glBindTexture(GL_TEXTURE_2D, runwayTexture);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, texW, texH, 0,
+                 GL_RGB, GL_UNSIGNED_BYTE, pixels);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    if (glGetError() != GL_NO_ERROR) {
+        glDeleteTextures(1, &runwayTexture);
+        runwayTexture = 0;
+        return;
+    }
+
+    // t = 0 at the near edge, one unit of t per dash period going away
+    float farT = (RUNWAY_NEAR_Z - RUNWAY_FAR_Z) / STRIPE_SPACING;
+
+    runwayList = glGenLists(1);
+    glNewList(runwayList, GL_COMPILE);
+    glEnable(GL_TEXTURE_2D);
+    glBindTexture(GL_TEXTURE_2D, runwayTexture);
+    glTexEnvi(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_REPLACE);
+    glBegin(GL_QUADS);
+    glTexCoord2f(0.0f, 0.0f); glVertex3f(-halfW, 0.0f, RUNWAY_NEAR_Z);
+    glTexCoord2f(1.0f, 0.0f); glVertex3f( halfW, 0.0f, RUNWAY_NEAR_Z);
+    glTexCoord2f(1.0f, farT); glVertex3f( halfW, 0.0f, RUNWAY_FAR_Z);
+    glTexCoord2f(0.0f, farT); glVertex3f(-halfW, 0.0f, RUNWAY_FAR_Z);
+    glEnd();
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glDisable(GL_TEXTURE_2D);
+    glEndList();
+}
+
+// Old path: flat quad + dashes rebuilt every frame as GL_LINES.
+// Only used when the runway texture could not be created.
+void drawRunwayLines() {
+    float halfW = runwayHalfWidth();
+    setColor(0.15f, 0.15f, 0.18f);
 
     glBegin(GL_QUADS);
-    glVertex3f(-LANE_SPACING * 3, 0.0f,  20.0f);
-    glVertex3f( LANE_SPACING * 3, 0.0f,  20.0f);
-    glVertex3f( LANE_SPACING * 3, 0.0f, -200.0f);
-    glVertex3f(-LANE_SPACING * 3, 0.0f, -200.0f);
+    glVertex3f(-halfW, 0.0f, RUNWAY_NEAR_Z);
+    glVertex3f( halfW, 0.0f, RUNWAY_NEAR_Z);
+    glVertex3f( halfW, 0.0f, RUNWAY_FAR_Z);
+    glVertex3f(-halfW, 0.0f, RUNWAY_FAR_Z);
     glEnd();
 
      // lane lines (patterned, scrolling like a treadmill)
-    float stripeSpacing = 6.0f;  // distance between dash groups
-    float stripeLength  = 3.0f;  // length of each dash
-    float offset        = fmod(roadOffset, stripeSpacing);
+    float offset = fmod(roadOffset, STRIPE_SPACING);
 
-    glLineWidth(2.0f);
-    glColor3f(0.8f, 0.8f, 0.8f);
+    setLineWidth(2.0f);
+    setColor(0.8f, 0.8f, 0.8f);
 
-    for (int i = 1; i < NUM_LANES; ++i) {
-        float x = (i - (NUM_LANES / 2.0f)) * LANE_SPACING;
+    for (int i = 1; i < laneSim->lanes; ++i) {
+        float x = laneLineX(i);
 
         glBegin(GL_LINES);
         // start at 20 + offset so all dashes move towards camera (+Z)
-        for (float z = 20.0f + offset; z > -200.0f; z -= stripeSpacing) {
+        for (float z = RUNWAY_NEAR_Z + offset; z > RUNWAY_FAR_Z; z -= STRIPE_SPACING) {
             glVertex3f(x, 0.01f, z);
-            glVertex3f(x, 0.01f, z - stripeLength);
+            glVertex3f(x, 0.01f, z - STRIPE_LENGTH);
         }
         glEnd();
     }
 
-    glLineWidth(1.0f);
-}
-// Draw one spike pointing along +Z, starting ON the sphere surface
-void drawSpikeForward(float radius, float spikeLen, float spikeR) {
-    glPushMatrix();
-    // Move to sphere surface: base of cone right on the sphere
-    glTranslatef(0.0f, 0.0f, radius);
-    // Cone axis is +Z, base at (0,0,0), tip at (0,0,spikeLen)
-    glutSolidCone(spikeR, spikeLen, 12, 2);
-    glPopMatrix();
+    setLineWidth(1.0f);
 }
 
-void drawObstacle(const Obstacle &o) {
-    if (!o.active) return;
+void drawRunway() {
+    GL_STATS_SCOPE("drawRunway");
+    if (runwayTexture == 0) {
+        drawRunwayLines();
+        return;
+    }
+
+    // shifting t by +offset/period moves every dash toward the camera (+Z)
+    glMatrixMode(GL_TEXTURE);
+    glLoadIdentity();
+    glTranslatef(0.0f, roadOffset / STRIPE_SPACING, 0.0f);
+    glMatrixMode(GL_MODELVIEW);
 
-    // lane position -> X, fixed height -> Y, Z from obstacle
-    float x = (o.lane - (NUM_LANES - 1) / 2.0f) * LANE_SPACING;
-    float y = 1.2f;          // a bit above ground
-    float radius  = 1.0f;    // sphere radius
-    float spikeLen = 0.8f;   // length of each spike
-    float spikeR   = 0.25f;  // radius of each spike base
+    glCallList(runwayList);
 
-    glPushMatrix();
-    glTranslatef(x, y, o.z);
+    glMatrixMode(GL_TEXTURE);
+    glLoadIdentity();
+    glMatrixMode(GL_MODELVIEW);
+}
+// Obstacle parts, drawn around the obstacle centre. They are submitted as
+// separate commands so the queue can batch every core, shell and spike
+// set by material instead of switching colors per obstacle.
 
+void drawObstacleCore() {
+    GL_STATS_SCOPE("drawObstacle");
     // -------- central black sphere --------
-    glColor3f(0.02f, 0.02f, 0.02f);      // dark red core
-    glutSolidSphere(radius, 18, 18);
+    glutSolidSphere(OBSTACLE_RADIUS, 18, 18);
+}
 
+void drawObstacleShell() {
+    GL_STATS_SCOPE("drawObstacle");
     // slightly brighter highlight sphere (optional)
-    glColor3f(0.3f, 0.0f, 0.0f);
-    glutWireSphere(radius * 1.01f, 10, 10);
+    glutWireSphere(OBSTACLE_RADIUS * 1.01f, 10, 10);
+}
 
+void drawObstacleSpikes() {
+    GL_STATS_SCOPE("drawObstacle");
     // -------- spikes around the sphere --------
-    glColor3f(1.0f, 0.25f, 0.25f);    // brighter red for spikes
-
-    // front / back / up / down / left / right spikes
-    glPushMatrix();                   // +Z
-    drawSpikeForward(radius, spikeLen, spikeR);
-    glPopMatrix();
-
-    glPushMatrix();                   // -Z
-    glRotatef(180.0f, 0, 1, 0);
-    drawSpikeForward(radius, spikeLen, spikeR);
-    glPopMatrix();
-
-    glPushMatrix();                   // +Y
-    glRotatef(-90.0f, 1, 0, 0);
-    drawSpikeForward(radius, spikeLen, spikeR);
-    glPopMatrix();
-
-    glPushMatrix();                   // -Y
-    glRotatef(90.0f, 1, 0, 0);
-    drawSpikeForward(radius, spikeLen, spikeR);
-    glPopMatrix();
-
-    glPushMatrix();                   // +X
-    glRotatef(-90.0f, 0, 1, 0);
-    drawSpikeForward(radius, spikeLen, spikeR);
-    glPopMatrix();
-
-    glPushMatrix();                   // -X
-    glRotatef(90.0f, 0, 1, 0);
-    drawSpikeForward(radius, spikeLen, spikeR);
-    glPopMatrix();
-
-    // ring of spikes around middle
-    for (int i = 0; i < 8; ++i) {
-        float ang = i * 45.0f;        // 0,45,...315
+    // cone axis is +Z with its base at the origin; the node matrices put
+    // each one on the sphere surface (see initScene)
+    for (int i = 0; i < NUM_SPIKES; ++i) {
         glPushMatrix();
-        glRotatef(ang, 0, 1, 0);      // rotate around Y
-        drawSpikeForward(radius, spikeLen, spikeR);
+        glMultMatrixf(sceneWorld(scene, spikeNodes[i]));
+        glutSolidCone(SPIKE_RADIUS, SPIKE_LENGTH, 12, 2);
         glPopMatrix();
     }
+}
 
-    // upper and lower tilted rings
-    for (int i = 0; i < 6; ++i) {
-        float ang = i * 60.0f;
+// Obstacles past the first SCENE_OBSTACLES slots (only reachable with a
+// raised --obstacles, e.g. in stress mode): a low-detail core each, from
+// one display list, positioned straight from the pool.
+GLuint obstacleBatchList = 0;
 
-        // upper ring
-        glPushMatrix();
-        glRotatef(25.0f, 1, 0, 0);    // tilt up
-        glRotatef(ang, 0, 1, 0);
-        drawSpikeForward(radius, spikeLen, spikeR);
-        glPopMatrix();
+void initObstacleBatch() {
+    obstacleBatchList = glGenLists(1);
+    glNewList(obstacleBatchList, GL_COMPILE);
+    glutSolidSphere(OBSTACLE_RADIUS, 8, 6);
+    glEndList();
+}
 
-        // lower ring
-        glPushMatrix();
-        glRotatef(-25.0f, 1, 0, 0);   // tilt down
-        glRotatef(ang, 0, 1, 0);
-        drawSpikeForward(radius, spikeLen, spikeR);
-        glPopMatrix();
+void drawObstacleBatch() {
+    GL_STATS_SCOPE("drawObstacleBatch");
+    const EntityArchetype &a = entities.archetypes[ARCH_OBSTACLE];
+    for (int c = 0; c < a.chunkCount; ++c) {
+        const EntityChunk *chunk = a.chunks[c];
+        int first = (c == 0) ? SCENE_OBSTACLES : 0;
+        int n     = entityChunkCount(a, c);
+        for (int i = first; i < n; ++i) {
+            glPushMatrix();
+            glTranslatef(laneSim->laneX[chunk->lane[i]], OBSTACLE_Y, chunk->z[i]);
+            glCallList(obstacleBatchList);
+            glPopMatrix();
+        }
     }
-
-    glPopMatrix();
 }
 
+// Every live particle in one draw, additive, without depth writes so they
+// don't hide each other. Submitted with PRIM_BLENDED at the runway's depth,
+// so it runs after all opaque geometry.
+void drawParticles() {
+    GL_STATS_SCOPE("drawParticles");
+    int vertices;
+    GLenum mode;
+    if (particles.count <= PARTICLE_QUAD_LIMIT) {
+        float m[16];
+        glGetFloatv(GL_MODELVIEW_MATRIX, m);
+        const float right[3] = { m[0], m[4], m[8] };   // camera axes, world space
+        const float up[3]    = { m[1], m[5], m[9] };
+        vertices = particlesBuildQuads(particles, right, up, PARTICLE_SIZE,
+                                       particleVerts, particleVertsCount);
+        mode = GL_QUADS;
+    } else {
+        vertices = particlesBuildPoints(particles, particleVerts, particleVertsCount);
+        mode = GL_POINTS;
+        glPointSize(2.0f);
+    }
 
-void drawObstacles3D() {
-    for (int i = 0; i < MAX_OBS; ++i)
-        drawObstacle(obstacles[i]);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE);
+    glDepthMask(GL_FALSE);
+
+    glEnableClientState(GL_VERTEX_ARRAY);
+    glEnableClientState(GL_COLOR_ARRAY);
+    glVertexPointer(3, GL_FLOAT, sizeof(ParticleVertex), &particleVerts[0].x);
+    glColorPointer(4, GL_UNSIGNED_BYTE, sizeof(ParticleVertex), &particleVerts[0].r);
+    glDrawArrays(mode, 0, vertices);
+    glDisableClientState(GL_COLOR_ARRAY);
+    glDisableClientState(GL_VERTEX_ARRAY);
+    forgetColor();
+
+    glDepthMask(GL_TRUE);
+    glDisable(GL_BLEND);
 }
 // Simple wheel model for the car
 void drawCarWheel() {
@@ -426,22 +1024,22 @@ void drawCarWheel() {
     glPopMatrix();
 }
 
-void drawCarBackModel() {
-    glPushMatrix();
-
-    // vertical bobbing to simulate engine vibration
-    glTranslatef(0.0f, carBob, 0.0f);
+// Character bodies: everything that doesn't move. They are compiled into
+// display lists once (see ANIMATION); the car's bob and the legs come from
+// the walk cycle tables.
+void drawCarBody() {
+    GL_STATS_SCOPE("drawCarBody");
 
     // ===== BODY =====
     // base body
-    glColor3f(1.0f, 0.0f, 0.0f); // red
+    setColor(1.0f, 0.0f, 0.0f); // red
     glPushMatrix();
     glScalef(1.8f, 0.7f, 3.0f);  // wider in X, longer in Z (forward)
     glutSolidCube(1.0f);
     glPopMatrix();
 
     // roof (toward the front, -Z)
-    glColor3f(0.8f, 0.8f, 0.9f);
+    setColor(0.8f, 0.8f, 0.9f);
     glPushMatrix();
     glTranslatef(0.0f, 0.6f, -0.4f);
     glScalef(1.2f, 0.6f, 1.2f);
@@ -449,7 +1047,7 @@ void drawCarBackModel() {
     glPopMatrix();
 
     // back trunk (toward +Z, closest to camera)
-    glColor3f(0.9f, 0.0f, 0.0f);
+    setColor(0.9f, 0.0f, 0.0f);
     glPushMatrix();
     glTranslatef(0.0f, 0.25f, 1.1f);
     glScalef(1.4f, 0.4f, 0.8f);
@@ -457,7 +1055,7 @@ void drawCarBackModel() {
     glPopMatrix();
 
     // bumper
-    glColor3f(0.2f, 0.2f, 0.2f);
+    setColor(0.2f, 0.2f, 0.2f);
     glPushMatrix();
     glTranslatef(0.0f, -0.1f, 1.6f);
     glScalef(1.2f, 0.2f, 0.3f);
@@ -465,7 +1063,7 @@ void drawCarBackModel() {
     glPopMatrix();
 
     // ===== WHEELS =====
-    glColor3f(0.05f, 0.05f, 0.05f); // dark wheel color
+    setColor(0.05f, 0.05f, 0.05f); // dark wheel color
 
     // front-left (-x, -z)
     glPushMatrix();
@@ -490,14 +1088,13 @@ void drawCarBackModel() {
     glTranslatef( 0.9f, -0.55f, 1.0f);
     drawCarWheel();
     glPopMatrix();
-
-    glPopMatrix();
 }
 
 
-void drawDinoBackModel() {
+void drawDinoBody() {
+    GL_STATS_SCOPE("drawDinoBody");
     // main body – medium green
-    glColor3f(0.2f, 0.6f, 0.2f);
+    setColor(0.2f, 0.6f, 0.2f);
 
     // torso
     glPushMatrix();
@@ -535,26 +1132,8 @@ void drawDinoBackModel() {
     glutSolidCube(1.0f);
     glPopMatrix();
 
-    // ---------- legs with animation ----------
-    glColor3f(0.2f, 0.6f, 0.2f);
-    // right leg
-    glPushMatrix();
-    glTranslatef(0.5f, -0.7f, 0.4f);     // hip position
-    glRotatef( legSwing, 1.0f, 0.0f, 0.0f); // swing forward/back along Z
-    glScalef(0.4f, 1.2f, 0.4f);
-    glutSolidCube(1.0f);
-    glPopMatrix();
-
-    // left leg (opposite phase)
-    glPushMatrix();
-    glTranslatef(-0.5f, -0.7f, 0.4f);
-    glRotatef(-legSwing, 1.0f, 0.0f, 0.0f);
-    glScalef(0.4f, 1.2f, 0.4f);
-    glutSolidCube(1.0f);
-    glPopMatrix();
-
     // ---------- dark green stripes ----------
-    glColor3f(0.05f, 0.35f, 0.05f);
+    setColor(0.05f, 0.35f, 0.05f);
 
     // stripes across back
     for (int i = 0; i < 4; ++i) {
@@ -577,9 +1156,10 @@ void drawDinoBackModel() {
     }
 }
 
-void drawCatBackModel() {
+void drawCatBody() {
+    GL_STATS_SCOPE("drawCatBody");
     // orange tabby body
-    glColor3f(0.95f, 0.65f, 0.2f);   // orange
+    setColor(0.95f, 0.65f, 0.2f);   // orange
     glPushMatrix();
     glTranslatef(0.0f, -0.1f, 0.2f); // slightly toward camera
     glScalef(1.5f, 1.0f, 1.6f);
@@ -620,27 +1200,8 @@ void drawCatBackModel() {
     glutSolidCube(1.0f);
     glPopMatrix();
 
-    // ---------- legs with animation ----------
-    glColor3f(0.85f, 0.55f, 0.15f); // slightly darker orange for legs
-
-    // right leg
-    glPushMatrix();
-    glTranslatef(0.4f, -0.7f, 0.3f);  // hip
-    glRotatef( legSwing, 1.0f, 0.0f, 0.0f);
-    glScalef(0.35f, 1.2f, 0.35f);
-    glutSolidCube(1.0f);
-    glPopMatrix();
-
-    // left leg (opposite phase)
-    glPushMatrix();
-    glTranslatef(-0.4f, -0.7f, 0.3f);
-    glRotatef(-legSwing, 1.0f, 0.0f, 0.0f);
-    glScalef(0.35f, 1.2f, 0.35f);
-    glutSolidCube(1.0f);
-    glPopMatrix();
-
     // ---------- brown stripes on body ----------
-    glColor3f(0.5f, 0.25f, 0.05f);   // dark brown
+    setColor(0.5f, 0.25f, 0.05f);   // dark brown
 
     // horizontal stripes across the back
     for (int i = 0; i < 3; ++i) {
@@ -662,6 +1223,240 @@ void drawCatBackModel() {
         glPopMatrix();
     }
 }
+// ------------- ANIMATION -------------
+// Each character's walk cycle is baked once into WALK_FRAMES keyframes:
+// a root offset (the car's bob) and one joint matrix per leg, a swing about
+// the hip. The rest of the body never moves, so it is compiled into a
+// display list; per frame only the legs are looked up in the table.
+const int WALK_FRAMES   = 32;
+const int MAX_LIMBS     = 2;
+const int PREVIEW_FRAME = 3;   // mid-stride pose used by the 2D previews
+
+struct LimbDesc {
+    float hip[3];        // pivot, model space
+    float size[3];       // leg cube scale
+    float sign;          // +1 right leg, -1 left leg (opposite phase)
+};
+
+struct WalkCycle {
+    // source description
+    float    period;     // seconds per cycle
+    float    bobAmp;     // root Y amplitude
+    float    swingAmp;   // leg swing amplitude (degrees)
+    int      limbCount;
+    LimbDesc limbs[MAX_LIMBS];
+    float    limbColor[3];
+    void   (*drawBody)();
+
+    // baked by initWalkCycles()
+    float    rootY[WALK_FRAMES];
+    float    swing[WALK_FRAMES][MAX_LIMBS];       // degrees
+    float    joint[WALK_FRAMES][MAX_LIMBS][16];   // T(hip) R(swing) T(-hip)
+    float    limbShape[MAX_LIMBS][16];            // T(hip) S(size), static
+    GLuint   bodyList;
+};
+
+// by CharacterType
+WalkCycle walkCycles[3] = {
+    // car: whole body bobs (engine vibration), no legs
+    { 6.2831853f / 12.0f, 0.12f, 0.0f, 0,
+      { }, { 0.0f, 0.0f, 0.0f }, drawCarBody,
+      { 0 }, { { 0 } }, { { { 0 } } }, { { 0 } }, 0 },
+    // dino
+    { 6.2831853f / 10.0f, 0.0f, 40.0f, 2,
+      { { {  0.5f, -0.7f, 0.4f }, { 0.4f, 1.2f, 0.4f },  1.0f },
+        { { -0.5f, -0.7f, 0.4f }, { 0.4f, 1.2f, 0.4f }, -1.0f } },
+      { 0.2f, 0.6f, 0.2f }, drawDinoBody,
+      { 0 }, { { 0 } }, { { { 0 } } }, { { 0 } }, 0 },
+    // cat (legs slightly darker orange)
+    { 6.2831853f / 10.0f, 0.0f, 40.0f, 2,
+      { { {  0.4f, -0.7f, 0.3f }, { 0.35f, 1.2f, 0.35f },  1.0f },
+        { { -0.4f, -0.7f, 0.3f }, { 0.35f, 1.2f, 0.35f }, -1.0f } },
+      { 0.85f, 0.55f, 0.15f }, drawCatBody,
+      { 0 }, { { 0 } }, { { { 0 } } }, { { 0 } }, 0 }
+};
+
+// current pose, interpolated between two keyframes
+struct Pose {
+    float rootY;
+    float joint[MAX_LIMBS][16];
+};
+
+void bakeWalkCycle(WalkCycle &w) {
+    for (int l = 0; l < w.limbCount; ++l) {
+        const LimbDesc &limb = w.limbs[l];
+        float t[16], sc[16];
+        mat4Translation(t, limb.hip[0], limb.hip[1], limb.hip[2]);
+        mat4Scaling(sc, limb.size[0], limb.size[1], limb.size[2]);
+        mat4Multiply(t, sc, w.limbShape[l]);
+    }
+
+    for (int f = 0; f < WALK_FRAMES; ++f) {
+        float wave = sinf(6.2831853f * f / WALK_FRAMES);
+        w.rootY[f] = w.bobAmp * wave;
+
+        for (int l = 0; l < w.limbCount; ++l) {
+            const LimbDesc &limb = w.limbs[l];
+            float to[16], rot[16], back[16];
+            w.swing[f][l] = limb.sign * w.swingAmp * wave;
+            mat4Translation(to, limb.hip[0], limb.hip[1], limb.hip[2]);
+            mat4RotationX(rot, w.swing[f][l]);
+            mat4Translation(back, -limb.hip[0], -limb.hip[1], -limb.hip[2]);
+            mat4Multiply(to, rot, w.joint[f][l]);
+            mat4Multiply(w.joint[f][l], back, w.joint[f][l]);
+        }
+    }
+}
+
+// needs a GL context (display lists)
+void initWalkCycles() {
+    for (int c = 0; c < 3; ++c) {
+        WalkCycle &w = walkCycles[c];
+        bakeWalkCycle(w);
+
+        w.bodyList = glGenLists(1);
+        glNewList(w.bodyList, GL_COMPILE);
+        w.drawBody();
+        glEndList();
+        forgetColor();   // colors set while compiling never reached GL
+    }
+}
+
+void samplePose(const WalkCycle &w, float time, Pose &out) {
+    float pos  = fmodf(time / w.period, 1.0f) * WALK_FRAMES;
+    int   f0   = (int)pos % WALK_FRAMES;
+    int   f1   = (f0 + 1) % WALK_FRAMES;
+    float frac = pos - floorf(pos);
+
+    out.rootY = w.rootY[f0] + (w.rootY[f1] - w.rootY[f0]) * frac;
+    for (int l = 0; l < w.limbCount; ++l)
+        mat4Lerp(w.joint[f0][l], w.joint[f1][l], frac, out.joint[l]);
+}
+
+// hand-coded character: cached body + legs from the table
+void drawCharacterPosed(CharacterType c) {
+    GL_STATS_SCOPE("drawCharacter");
+    const WalkCycle &w = walkCycles[c];
+    Pose pose;
+    samplePose(w, animTime, pose);
+
+    glPushMatrix();
+    glTranslatef(0.0f, pose.rootY, 0.0f);
+
+    if (w.bodyList) {
+        glCallList(w.bodyList);
+        forgetColor();
+    } else {
+        w.drawBody();
+    }
+
+    if (w.limbCount > 0)
+        setColor(w.limbColor[0], w.limbColor[1], w.limbColor[2]);
+    for (int l = 0; l < w.limbCount; ++l) {
+        glPushMatrix();
+        glMultMatrixf(pose.joint[l]);
+        glMultMatrixf(w.limbShape[l]);
+        glutSolidCube(1.0f);
+        glPopMatrix();
+    }
+
+    glPopMatrix();
+}
+
+// 2D preview leg: a quad swung about the middle of its top edge
+void drawPreviewLeg(float x0, float y0, float x1, float y1, float degrees) {
+    float hx = (x0 + x1) * 0.5f;
+    glPushMatrix();
+    glTranslatef(hx, y1, 0.0f);
+    glRotatef(degrees, 0.0f, 0.0f, 1.0f);
+    glTranslatef(-hx, -y1, 0.0f);
+    glBegin(GL_QUADS);
+    glVertex2f(x0, y0);
+    glVertex2f(x1, y0);
+    glVertex2f(x1, y1);
+    glVertex2f(x0, y1);
+    glEnd();
+    glPopMatrix();
+}
+
+// ------------- MODELS -------------
+// Characters and the obstacle can come from meshes instead of the
+// hand-coded models above: a "model_<name>" mesh in the asset bundle, or
+// assets/models/<name>.obj (parsed once, then loaded from its .bin cache).
+// They are posed by the same walk cycles: parts named "leg_right" /
+// "leg_left" use the joint matrices of the first / second limb.
+void *getGLProcAddress(const char *name);
+
+const char *characterModelNames[3] = { "car", "dino", "cat" };   // by CharacterType
+
+Mesh characterModels[3];
+int  legRightPart[3] = { -1, -1, -1 };
+int  legLeftPart[3]  = { -1, -1, -1 };
+Mesh obstacleModel;
+
+bool loadModel(Mesh &mesh, const char *name) {
+    char key[BUNDLE_NAME_LEN];
+    snprintf(key, sizeof(key), "model_%s", name);
+    const BundleEntry *e = bundleFind(key, BUNDLE_MESH);
+    if (e && meshLoadBinary(mesh, bundleData(e), e->size))
+        return true;
+
+    char path[128];
+    snprintf(path, sizeof(path), "assets/models/%s.obj", name);
+    return meshLoad(mesh, path);
+}
+
+void loadModels() {
+    meshInitBuffers(getGLProcAddress);
+
+    for (int c = 0; c < 3; ++c) {
+        if (!loadModel(characterModels[c], characterModelNames[c])) continue;
+        if (walkCycles[c].limbCount < MAX_LIMBS) continue;
+        legRightPart[c] = meshFindPart(characterModels[c], "leg_right");
+        legLeftPart[c]  = meshFindPart(characterModels[c], "leg_left");
+    }
+    loadModel(obstacleModel, "obstacle");
+}
+
+// false when the character has no model and must be drawn by hand
+bool drawCharacterModel(CharacterType c) {
+    const Mesh &mesh = characterModels[c];
+    if (!meshLoaded(mesh)) return false;
+    GL_STATS_SCOPE("drawCharacterModel");
+
+    Pose pose;
+    samplePose(walkCycles[c], animTime, pose);
+
+    glPushMatrix();
+    glTranslatef(0.0f, pose.rootY, 0.0f);
+
+    if (legRightPart[c] < 0 && legLeftPart[c] < 0) {
+        meshDraw(mesh);   // nothing animated: one draw call
+    } else {
+        for (int i = 0; i < mesh.partCount; ++i) {
+            int limb = (i == legRightPart[c]) ? 0 : (i == legLeftPart[c]) ? 1 : -1;
+            if (limb >= 0) {
+                glPushMatrix();
+                glMultMatrixf(pose.joint[limb]);
+                meshDrawPart(mesh, i);
+                glPopMatrix();
+            } else {
+                meshDrawPart(mesh, i);
+            }
+        }
+    }
+
+    glPopMatrix();
+    forgetColor();
+    return true;
+}
+
+void drawObstacleModel() {
+    GL_STATS_SCOPE("drawObstacle");
+    meshDraw(obstacleModel);
+    forgetColor();
+}
+
 void drawShieldAuraAroundPlayer() {
     if (heartCount <= 0) return;  // no shields -> no aura
       bool isInvincible = (activePowerup == PWR_INVINCIBLE);
@@ -681,12 +1476,12 @@ void drawShieldAuraAroundPlayer() {
         if (g > 1.0f) g = 1.0f;
         if (b > 1.0f) b = 1.0f;
         if (isInvincible) {
-            glColor3f(1.0f, 1.0f, 0.0f);  // bright yellow for invincible
+            setColor(1.0f, 1.0f, 0.0f);  // bright yellow for invincible
         } else {
-            glColor3f(0.0f, g, b);
+            setColor(0.0f, g, b);
         }
 
-        glColor3f(0.0f, g, b);
+        setColor(0.0f, g, b);
 
         // each ring rotates at a slightly different speed
         float angle = fmodf(elapsedTime * (60.0f + i * 20.0f), 360.0f);
@@ -704,21 +1499,21 @@ void drawShieldAuraAroundPlayer() {
     }
 }
 
+// drawn at the player position; the render queue applies that translation
 void drawPlayer3D() {
-    glPushMatrix();
-    glTranslatef(playerX, playerY + 1.0f, playerZ);
-
     // draw character
-    switch (currentCharacter) {
-        case CHAR_CAR:  drawCarBackModel();  break;
-        case CHAR_DINO: drawDinoBackModel(); break;
-        case CHAR_CAT:  drawCatBackModel();  break;
-    }
+    if (!drawCharacterModel(currentCharacter))
+        drawCharacterPosed(currentCharacter);
 
     // draw shield aura *around* the character if we have shields
     drawShieldAuraAroundPlayer();   // <- uses the new fancy aura
+}
 
-    glPopMatrix();
+// the other racer: a different character, no aura
+void drawRival3D() {
+    CharacterType rival = (CharacterType)((currentCharacter + 1) % 3);
+    if (!drawCharacterModel(rival))
+        drawCharacterPosed(rival);
 }
 
 void drawPowerupIcon(float x, float y, float w, float h,
@@ -728,12 +1523,12 @@ void drawPowerupIcon(float x, float y, float w, float h,
                      PowerupType activePowerup)
 {
     // always use thin lines for HUD borders
-    glLineWidth(1.0f);
+    setLineWidth(1.0f);
 
     // Background colors per type
-    if (type == PWR_SCORE_X2)       glColor3f(0.1f, 0.35f, 0.1f);
-    else if (type == PWR_SLOW_HALF) glColor3f(0.1f, 0.1f, 0.35f);
-    else if (type == PWR_INVINCIBLE)glColor3f(0.35f, 0.1f, 0.1f);
+    if (type == PWR_SCORE_X2)       setColor(0.1f, 0.35f, 0.1f);
+    else if (type == PWR_SLOW_HALF) setColor(0.1f, 0.1f, 0.35f);
+    else if (type == PWR_INVINCIBLE)setColor(0.35f, 0.1f, 0.1f);
 
     // background panel
     glBegin(GL_QUADS);
@@ -745,11 +1540,11 @@ void drawPowerupIcon(float x, float y, float w, float h,
 
     // border color
     if (highlight) {
-        glColor3f(1.0f, 1.0f, 0.0f);  // yellow = selecting
+        setColor(1.0f, 1.0f, 0.0f);  // yellow = selecting
     } else if (activePowerup == type) {
-        glColor3f(0.0f, 1.0f, 0.0f);  // green = active
+        setColor(0.0f, 1.0f, 0.0f);  // green = active
     } else {
-        glColor3f(1.0f, 1.0f, 1.0f);  // normal white
+        setColor(1.0f, 1.0f, 1.0f);  // normal white
     }
 
     // border
@@ -761,7 +1556,7 @@ void drawPowerupIcon(float x, float y, float w, float h,
     glEnd();
 
     // text
-    glColor3f(1,1,1);
+    setColor(1,1,1);
     drawStringCentered(GLUT_BITMAP_HELVETICA_12,
                        text,
                        x + w/2.0f,
@@ -780,7 +1575,7 @@ void drawPowerupsHUD() {
     bool highlight = (choosingPowerup && activePowerup == PWR_NONE);
 
     // header
-    glColor3f(1,1,1);
+    setColor(1,1,1);
     drawStringCentered(GLUT_BITMAP_HELVETICA_12,
                        "POWERUPS",
                        baseX + iconW/2.0f,
@@ -802,7 +1597,7 @@ drawPowerupIcon(baseX, y3, iconW, iconH, " T: INVINCIBLE",
 
     // hint text
     if (highlight) {
-        glColor3f(1,1,0);
+        setColor(1,1,0);
         drawStringCentered(GLUT_BITMAP_HELVETICA_12,
                            "Click a powerup!",
                            baseX + iconW/2.0f,
@@ -810,8 +1605,8 @@ drawPowerupIcon(baseX, y3, iconW, iconH, " T: INVINCIBLE",
     }
 }
 void drawShieldIcon2D(float x, float y, float size, bool active) {
-    if (active) glColor3f(0.0f, 1.0f, 0.7f); // active = cyan-green
-    else        glColor3f(0.3f, 0.3f, 0.3f); // inactive = grey
+    if (active) setColor(0.0f, 1.0f, 0.7f); // active = cyan-green
+    else        setColor(0.3f, 0.3f, 0.3f); // inactive = grey
 
     float r = size * 0.5f;
 
@@ -826,11 +1621,20 @@ void drawShieldIcon2D(float x, float y, float size, bool active) {
 
 
 // ------------- HUD / MENUS (2D) -------------
+// HUD text is white; the render queue sets that color before calling us
+
+// Status lines under the shields, one row for each mode that is on; the
+// profiler overlay starts below them.
+const float HUD_STATUS_Y    = WINDOW_HEIGHT - 160.0f;
+const float HUD_STATUS_STEP = 26.0f;
+
+int hudStatusLines() {
+    return (raceMode ? 1 : 0) + (spectating ? 1 : 0) + (autopilotOn ? 1 : 0);
+}
+
 void drawHUD() {
-    set2D();
     char buffer[64];
 
-    glColor3f(1.0f, 1.0f, 1.0f);
     sprintf(buffer, "Score: %d", score);
     drawString(GLUT_BITMAP_HELVETICA_18, buffer, 10.0f, WINDOW_HEIGHT - 30.0f);
 
@@ -848,7 +1652,21 @@ void drawHUD() {
    for (int i = 0; i < MAX_HEARTS; i++) {
     drawShieldIcon2D(40 + i * 25, WINDOW_HEIGHT - 120, 20.0f, i < heartCount);
 }
-    drawPowerupsHUD();
+    setColor(1.0f, 1.0f, 1.0f);         // the icons leave their color set
+
+    float y = HUD_STATUS_Y;
+    if (raceMode) {
+        const RacePlayer &rival = raceSession.state.players[raceSession.remotePlayer];
+        sprintf(buffer, "Rival: %d shields%s", rival.shields, rival.alive ? "" : ", crashed");
+        drawString(GLUT_BITMAP_HELVETICA_18, buffer, 10.0f, y);
+        y -= HUD_STATUS_STEP;
+    }
+    if (spectating) {
+        drawString(GLUT_BITMAP_HELVETICA_18, "Spectating", 10.0f, y);
+        y -= HUD_STATUS_STEP;
+    }
+    if (autopilotOn)
+        drawString(GLUT_BITMAP_HELVETICA_18, "Autopilot (A to take over)", 10.0f, y);
 }
 
 void drawBackground2D() {
@@ -856,8 +1674,8 @@ void drawBackground2D() {
     float stripeWidth = 50.0f;
     bool dark = false;
     for (float x = 0; x < WINDOW_WIDTH; x += stripeWidth) {
-        if (dark) glColor3f(0.2f, 0.2f, 0.3f);
-        else      glColor3f(0.1f, 0.1f, 0.2f);
+        if (dark) setColor(0.2f, 0.2f, 0.3f);
+        else      setColor(0.1f, 0.1f, 0.2f);
         glBegin(GL_QUADS);
         glVertex2f(x, 0.0f);
         glVertex2f(x + stripeWidth, 0.0f);
@@ -867,6 +1685,162 @@ void drawBackground2D() {
         dark = !dark;
     }
 }
+// ------------- SCREEN CACHE -------------
+// The menu and character select screens don't change between frames, so
+// each one is rendered once per window size into a texture and then drawn
+// as a single quad. Rendering goes through a framebuffer object when the
+// driver has one; on plain GL 1.1 the screen is drawn into the back buffer
+// once and copied into the texture instead.
+#ifndef APIENTRY
+#define APIENTRY
+#endif
+#ifndef GL_FRAMEBUFFER
+#define GL_FRAMEBUFFER          0x8D40
+#define GL_COLOR_ATTACHMENT0    0x8CE0
+#define GL_FRAMEBUFFER_COMPLETE 0x8CD5
+#endif
+
+typedef void   (APIENTRY *GenFramebuffersFn)(GLsizei, GLuint *);
+typedef void   (APIENTRY *BindFramebufferFn)(GLenum, GLuint);
+typedef void   (APIENTRY *FramebufferTexture2DFn)(GLenum, GLenum, GLenum, GLuint, GLint);
+typedef GLenum (APIENTRY *CheckFramebufferStatusFn)(GLenum);
+
+GenFramebuffersFn        pGenFramebuffers        = NULL;
+BindFramebufferFn        pBindFramebuffer        = NULL;
+FramebufferTexture2DFn   pFramebufferTexture2D   = NULL;
+CheckFramebufferStatusFn pCheckFramebufferStatus = NULL;
+bool framebuffersLoaded = false;
+
+void *getGLProcAddress(const char *name) {
+#if defined(FREEGLUT)
+    return (void *)glutGetProcAddress(name);
+#elif defined(_WIN32)
+    return (void *)wglGetProcAddress(name);
+#else
+    (void)name;
+    return NULL;
+#endif
+}
+
+// core names first (GL 3.0 / ARB_framebuffer_object), then the EXT ones
+void *getFramebufferProc(const char *core, const char *ext) {
+    void *p = getGLProcAddress(core);
+    if (p == NULL) p = getGLProcAddress(ext);
+    return p;
+}
+
+bool haveFramebuffers() {
+    if (!framebuffersLoaded) {
+        framebuffersLoaded = true;
+        pGenFramebuffers = (GenFramebuffersFn)
+            getFramebufferProc("glGenFramebuffers", "glGenFramebuffersEXT");
+        pBindFramebuffer = (BindFramebufferFn)
+            getFramebufferProc("glBindFramebuffer", "glBindFramebufferEXT");
+        pFramebufferTexture2D = (FramebufferTexture2DFn)
+            getFramebufferProc("glFramebufferTexture2D", "glFramebufferTexture2DEXT");
+        pCheckFramebufferStatus = (CheckFramebufferStatusFn)
+            getFramebufferProc("glCheckFramebufferStatus", "glCheckFramebufferStatusEXT");
+    }
+    return pGenFramebuffers && pBindFramebuffer &&
+           pFramebufferTexture2D && pCheckFramebufferStatus;
+}
+
+struct ScreenCache {
+    GLuint texture;
+    GLuint fbo;
+    int    w, h;         // window size the texture was rendered at
+    int    texW, texH;   // power-of-two texture size (GL 1.1 friendly)
+    bool   failed;       // texture couldn't be made: draw directly
+};
+
+ScreenCache menuCache       = { 0, 0, 0, 0, 0, 0, false };
+ScreenCache charSelectCache = { 0, 0, 0, 0, 0, 0, false };
+
+bool renderScreenCache(ScreenCache &c, void (*drawStatic)()) {
+    int w = currentWindowWidth;
+    int h = currentWindowHeight;
+    int texW = 1, texH = 1;
+    while (texW < w) texW <<= 1;
+    while (texH < h) texH <<= 1;
+
+    if (c.texture == 0)
+        glGenTextures(1, &c.texture);
+    glBindTexture(GL_TEXTURE_2D, c.texture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, texW, texH, 0,
+                 GL_RGB, GL_UNSIGNED_BYTE, NULL);
+    if (glGetError() != GL_NO_ERROR) {
+        glBindTexture(GL_TEXTURE_2D, 0);
+        return false;
+    }
+
+    bool rendered = false;
+    if (haveFramebuffers()) {
+        if (c.fbo == 0)
+            pGenFramebuffers(1, &c.fbo);
+        pBindFramebuffer(GL_FRAMEBUFFER, c.fbo);
+        pFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+                              GL_TEXTURE_2D, c.texture, 0);
+
+        if (pCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE) {
+            // the texture's lower-left w x h matches the window viewport
+            set2D();
+            glClear(GL_COLOR_BUFFER_BIT);
+            drawStatic();
+            rendered = true;
+        }
+        pBindFramebuffer(GL_FRAMEBUFFER, 0);
+    }
+
+    if (!rendered) {
+        // GL 1.1 path: draw into the back buffer once, copy it out
+        set2D();
+        glClear(GL_COLOR_BUFFER_BIT);
+        drawStatic();
+        glCopyTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, 0, 0, w, h);
+    }
+
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    c.w    = w;
+    c.h    = h;
+    c.texW = texW;
+    c.texH = texH;
+    return true;
+}
+
+// Draws the cached screen as one quad, re-rendering it first if the window
+// size changed. Returns false if caching isn't possible, in which case the
+// caller should draw the screen directly.
+bool drawCachedScreen(ScreenCache &c, void (*drawStatic)()) {
+    if (c.failed) return false;
+
+    if (c.texture == 0 || c.w != currentWindowWidth || c.h != currentWindowHeight) {
+        if (!renderScreenCache(c, drawStatic)) {
+            c.failed = true;
+            return false;
+        }
+    }
+
+    float s = (float)c.w / (float)c.texW;
+    float t = (float)c.h / (float)c.texH;
+
+    set2D();
+    glEnable(GL_TEXTURE_2D);
+    glBindTexture(GL_TEXTURE_2D, c.texture);
+    glTexEnvi(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_REPLACE);
+    glBegin(GL_QUADS);
+    glTexCoord2f(0.0f, 0.0f); glVertex2f(0.0f,                0.0f);
+    glTexCoord2f(s,    0.0f); glVertex2f((float)WINDOW_WIDTH, 0.0f);
+    glTexCoord2f(s,    t);    glVertex2f((float)WINDOW_WIDTH, (float)WINDOW_HEIGHT);
+    glTexCoord2f(0.0f, t);    glVertex2f(0.0f,                (float)WINDOW_HEIGHT);
+    glEnd();
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glDisable(GL_TEXTURE_2D);
+    return true;
+}
+
 // Small collage of car/dino/cat icons in the background
 
 
@@ -878,7 +1852,7 @@ void drawCarPreview2D(float cx, float cy, float s) {
     float y1 = cy - h / 2.0f;
 
     // main body (side)
-    glColor3f(0.9f, 0.0f, 0.0f);           // bright red side
+    setColor(0.9f, 0.0f, 0.0f);           // bright red side
     glBegin(GL_QUADS);
     glVertex2f(x1,          y1 + h * 0.25f);
     glVertex2f(x1 + w,      y1 + h * 0.25f);
@@ -887,7 +1861,7 @@ void drawCarPreview2D(float cx, float cy, float s) {
     glEnd();
 
     // top of car (roof) – lighter red to look 3D
-    glColor3f(1.0f, 0.25f, 0.25f);
+    setColor(1.0f, 0.25f, 0.25f);
     glBegin(GL_QUADS);
     glVertex2f(x1 + w * 0.20f, y1 + h * 0.55f);
     glVertex2f(x1 + w * 0.80f, y1 + h * 0.55f);
@@ -896,7 +1870,7 @@ void drawCarPreview2D(float cx, float cy, float s) {
     glEnd();
 
     // windows
-    glColor3f(0.8f, 0.9f, 1.0f);
+    setColor(0.8f, 0.9f, 1.0f);
     glBegin(GL_QUADS);
     glVertex2f(x1 + w * 0.25f, y1 + h * 0.60f);
     glVertex2f(x1 + w * 0.75f, y1 + h * 0.60f);
@@ -908,7 +1882,7 @@ void drawCarPreview2D(float cx, float cy, float s) {
     float rw = h * 0.55f;
     float ry = y1 + h * 0.12f;
 
-    glColor3f(0.05f, 0.05f, 0.05f);
+    setColor(0.05f, 0.05f, 0.05f);
     glBegin(GL_QUADS);
     glVertex2f(x1 + w * 0.20f - rw*0.5f, ry);
     glVertex2f(x1 + w * 0.20f + rw*0.5f, ry);
@@ -921,7 +1895,7 @@ void drawCarPreview2D(float cx, float cy, float s) {
     glVertex2f(x1 + w * 0.80f - rw*0.5f, ry + rw);
     glEnd();
 
-    glColor3f(0.2f, 0.2f, 0.2f);
+    setColor(0.2f, 0.2f, 0.2f);
     glBegin(GL_QUADS);
     glVertex2f(x1 + w * 0.20f - rw*0.25f, ry + rw*0.25f);
     glVertex2f(x1 + w * 0.20f + rw*0.25f, ry + rw*0.25f);
@@ -935,7 +1909,7 @@ void drawCarPreview2D(float cx, float cy, float s) {
     glEnd();
 
     // little front light
-    glColor3f(1.0f, 1.0f, 0.3f);
+    setColor(1.0f, 1.0f, 0.3f);
     glBegin(GL_QUADS);
     glVertex2f(x1 + w * 0.02f, y1 + h * 0.40f);
     glVertex2f(x1 + w * 0.08f, y1 + h * 0.40f);
@@ -951,7 +1925,7 @@ void drawDinoPreview2D(float cx, float cy, float s) {
     float y1 = cy - h / 2.0f;
 
     // torso (side)
-    glColor3f(0.2f, 0.6f, 0.2f);
+    setColor(0.2f, 0.6f, 0.2f);
     glBegin(GL_QUADS);
     glVertex2f(x1 + w * 0.15f, y1 + h * 0.30f);
     glVertex2f(x1 + w * 0.85f, y1 + h * 0.30f);
@@ -960,7 +1934,7 @@ void drawDinoPreview2D(float cx, float cy, float s) {
     glEnd();
 
     // darker belly / underside
-    glColor3f(0.15f, 0.45f, 0.15f);
+    setColor(0.15f, 0.45f, 0.15f);
     glBegin(GL_QUADS);
     glVertex2f(x1 + w * 0.15f, y1 + h * 0.30f);
     glVertex2f(x1 + w * 0.85f, y1 + h * 0.30f);
@@ -969,7 +1943,7 @@ void drawDinoPreview2D(float cx, float cy, float s) {
     glEnd();
 
     // tail (backwards, up a bit)
-    glColor3f(0.2f, 0.6f, 0.2f);
+    setColor(0.2f, 0.6f, 0.2f);
     glBegin(GL_TRIANGLES);
     glVertex2f(x1 + w * 0.85f, y1 + h * 0.55f);
     glVertex2f(x1 + w * 1.05f, y1 + h * 0.60f);
@@ -993,7 +1967,7 @@ void drawDinoPreview2D(float cx, float cy, float s) {
     glEnd();
 
     // stripes on back (dark green)
-    glColor3f(0.05f, 0.35f, 0.05f);
+    setColor(0.05f, 0.35f, 0.05f);
     for (int i = 0; i < 3; ++i) {
         float t = 0.30f + i * 0.15f;
         glBegin(GL_QUADS);
@@ -1004,22 +1978,13 @@ void drawDinoPreview2D(float cx, float cy, float s) {
         glEnd();
     }
 
-    // legs (two, slightly offset to look 3D)
-    glColor3f(0.18f, 0.55f, 0.18f);
+    // legs (two, slightly offset to look 3D), mid-stride from the walk cycle
+    const float *swing = walkCycles[CHAR_DINO].swing[PREVIEW_FRAME];
+    setColor(0.18f, 0.55f, 0.18f);
     // back leg
-    glBegin(GL_QUADS);
-    glVertex2f(x1 + w * 0.55f, y1 + h * 0.05f);
-    glVertex2f(x1 + w * 0.65f, y1 + h * 0.05f);
-    glVertex2f(x1 + w * 0.65f, y1 + h * 0.35f);
-    glVertex2f(x1 + w * 0.55f, y1 + h * 0.35f);
-    glEnd();
+    drawPreviewLeg(x1 + w * 0.55f, y1 + h * 0.05f, x1 + w * 0.65f, y1 + h * 0.35f, swing[1]);
     // front leg
-    glBegin(GL_QUADS);
-    glVertex2f(x1 + w * 0.35f, y1 + h * 0.05f);
-    glVertex2f(x1 + w * 0.45f, y1 + h * 0.05f);
-    glVertex2f(x1 + w * 0.45f, y1 + h * 0.35f);
-    glVertex2f(x1 + w * 0.35f, y1 + h * 0.35f);
-    glEnd();
+    drawPreviewLeg(x1 + w * 0.35f, y1 + h * 0.05f, x1 + w * 0.45f, y1 + h * 0.35f, swing[0]);
 }
 
 
@@ -1030,7 +1995,7 @@ void drawCatPreview2D(float cx, float cy, float s) {
     float y1 = cy - h / 2.0f;
 
     // body
-    glColor3f(0.95f, 0.65f, 0.2f);   // orange
+    setColor(0.95f, 0.65f, 0.2f);   // orange
     glBegin(GL_QUADS);
     glVertex2f(x1 + w * 0.15f, y1 + h * 0.25f);
     glVertex2f(x1 + w * 0.85f, y1 + h * 0.25f);
@@ -1066,7 +2031,7 @@ void drawCatPreview2D(float cx, float cy, float s) {
     glEnd();
 
     // darker belly
-    glColor3f(0.85f, 0.55f, 0.15f);
+    setColor(0.85f, 0.55f, 0.15f);
     glBegin(GL_QUADS);
     glVertex2f(x1 + w * 0.15f, y1 + h * 0.25f);
     glVertex2f(x1 + w * 0.85f, y1 + h * 0.25f);
@@ -1075,7 +2040,7 @@ void drawCatPreview2D(float cx, float cy, float s) {
     glEnd();
 
     // stripes on body
-    glColor3f(0.5f, 0.25f, 0.05f);
+    setColor(0.5f, 0.25f, 0.05f);
     for (int i = 0; i < 3; ++i) {
         float t = 0.30f + i * 0.12f;
         glBegin(GL_QUADS);
@@ -1086,21 +2051,14 @@ void drawCatPreview2D(float cx, float cy, float s) {
         glEnd();
     }
 
-    // legs (two, side view)
-    glColor3f(0.85f, 0.55f, 0.15f);
-    glBegin(GL_QUADS);
-    glVertex2f(x1 + w * 0.35f, y1 + h * 0.05f);
-    glVertex2f(x1 + w * 0.45f, y1 + h * 0.05f);
-    glVertex2f(x1 + w * 0.45f, y1 + h * 0.25f);
-    glVertex2f(x1 + w * 0.35f, y1 + h * 0.25f);
-
-    glVertex2f(x1 + w * 0.60f, y1 + h * 0.05f);
-    glVertex2f(x1 + w * 0.70f, y1 + h * 0.05f);
-    glVertex2f(x1 + w * 0.70f, y1 + h * 0.25f);
-    glVertex2f(x1 + w * 0.60f, y1 + h * 0.25f);
-    glEnd();
+    // legs (two, side view), mid-stride from the walk cycle
+    const float *swing = walkCycles[CHAR_CAT].swing[PREVIEW_FRAME];
+    setColor(0.85f, 0.55f, 0.15f);
+    drawPreviewLeg(x1 + w * 0.35f, y1 + h * 0.05f, x1 + w * 0.45f, y1 + h * 0.25f, swing[0]);
+    drawPreviewLeg(x1 + w * 0.60f, y1 + h * 0.05f, x1 + w * 0.70f, y1 + h * 0.25f, swing[1]);
 }
 void drawMenuCharacterCollage() {
+    GL_STATS_SCOPE("drawMenuCharacterCollage");
     // We are already in 2D (set2D called in drawMenu)
     float startX = 80.0f;
     float startY = 110.0f;
@@ -1130,10 +2088,8 @@ void drawMenuCharacterCollage() {
     }
 }
 
-void drawMenu() {
-    set2D();
-    glClear(GL_COLOR_BUFFER_BIT);
-
+// everything on the main menu; rendered into menuCache, not every frame
+void drawMenuStatic() {
     // base striped background
     drawBackground2D();
 
@@ -1146,7 +2102,7 @@ void drawMenu() {
     float panelX = (WINDOW_WIDTH  - panelW) / 2.0f;
     float panelY = WINDOW_HEIGHT / 2.0f - panelH / 2.5f;
 
-    glColor3f(0.03f, 0.05f, 0.12f);
+    setColor(0.03f, 0.05f, 0.12f);
     glBegin(GL_QUADS);
     glVertex2f(panelX,           panelY);
     glVertex2f(panelX + panelW,  panelY);
@@ -1154,7 +2110,7 @@ void drawMenu() {
     glVertex2f(panelX,           panelY + panelH);
     glEnd();
 
-    glColor3f(0.7f, 0.7f, 0.9f);
+    setColor(0.7f, 0.7f, 0.9f);
     glBegin(GL_LINE_LOOP);
     glVertex2f(panelX,           panelY);
     glVertex2f(panelX + panelW,  panelY);
@@ -1168,7 +2124,7 @@ void drawMenu() {
     float titleBoxX = panelX + (panelW - titleBoxW) / 2.0f;
     float titleBoxY = panelY + panelH - titleBoxH - 20.0f;
 
-    glColor3f(0.09f, 0.12f, 0.25f);
+    setColor(0.09f, 0.12f, 0.25f);
     glBegin(GL_QUADS);
     glVertex2f(titleBoxX,              titleBoxY);
     glVertex2f(titleBoxX + titleBoxW,  titleBoxY);
@@ -1176,7 +2132,7 @@ void drawMenu() {
     glVertex2f(titleBoxX,              titleBoxY + titleBoxH);
     glEnd();
 
-    glColor3f(1.0f, 1.0f, 1.0f);
+    setColor(1.0f, 1.0f, 1.0f);
     glBegin(GL_LINE_LOOP);
     glVertex2f(titleBoxX,              titleBoxY);
     glVertex2f(titleBoxX + titleBoxW,  titleBoxY);
@@ -1206,7 +2162,7 @@ void drawMenu() {
     float startY = panelY + panelH * 0.40f;
 
     // shadow under buttons
-    glColor3f(0.0f, 0.0f, 0.0f);
+    setColor(0.0f, 0.0f, 0.0f);
     glBegin(GL_QUADS);
     glVertex2f(startX + 3.0f,        startY - 3.0f);
     glVertex2f(startX + btnW + 3.0f, startY - 3.0f);
@@ -1215,7 +2171,7 @@ void drawMenu() {
     glEnd();
 
     // START button
-    glColor3f(0.0f, 0.55f, 0.90f);
+    setColor(0.0f, 0.55f, 0.90f);
     glBegin(GL_QUADS);
     glVertex2f(startX,        startY);
     glVertex2f(startX+btnW,   startY);
@@ -1223,7 +2179,7 @@ void drawMenu() {
     glVertex2f(startX,        startY+btnH);
     glEnd();
 
-    glColor3f(1.0f, 1.0f, 1.0f);
+    setColor(1.0f, 1.0f, 1.0f);
     drawStringCentered(GLUT_BITMAP_HELVETICA_18,
                        "START",
                        centerX,
@@ -1232,7 +2188,7 @@ void drawMenu() {
     // EXIT button (below)
     float exitY = startY - 80.0f;
 
-    glColor3f(0.0f, 0.0f, 0.0f);
+    setColor(0.0f, 0.0f, 0.0f);
     glBegin(GL_QUADS);
     glVertex2f(startX + 3.0f,        exitY - 3.0f);
     glVertex2f(startX + btnW + 3.0f, exitY - 3.0f);
@@ -1240,7 +2196,7 @@ void drawMenu() {
     glVertex2f(startX + 3.0f,        exitY + btnH - 3.0f);
     glEnd();
 
-    glColor3f(0.85f, 0.20f, 0.20f);
+    setColor(0.85f, 0.20f, 0.20f);
     glBegin(GL_QUADS);
     glVertex2f(startX,        exitY);
     glVertex2f(startX+btnW,   exitY);
@@ -1248,22 +2204,31 @@ void drawMenu() {
     glVertex2f(startX,        exitY+btnH);
     glEnd();
 
-    glColor3f(1.0f, 1.0f, 1.0f);
+    setColor(1.0f, 1.0f, 1.0f);
     drawStringCentered(GLUT_BITMAP_HELVETICA_18,
                        "EXIT",
                        centerX,
                        exitY + 18.0f);
-
-    glutSwapBuffers();
 }
 
-void drawCharacterSelect() {
+void drawMenu() {
     set2D();
     glClear(GL_COLOR_BUFFER_BIT);
+
+    if (!drawCachedScreen(menuCache, drawMenuStatic))
+        drawMenuStatic();
+
+    glutSwapBuffers();
+    reportFirstMenuFrame();
+}
+
+// everything on character select; rendered into charSelectCache
+void drawCharacterSelectStatic() {
+    GL_STATS_SCOPE("drawCharacterSelect");
     drawBackground2D();
 
     // ----- Title -----
-    glColor3f(1.0f, 1.0f, 1.0f);
+    setColor(1.0f, 1.0f, 1.0f);
     drawStringCentered(GLUT_BITMAP_HELVETICA_18,
                        "CHOOSE YOUR CHARACTER",
                        WINDOW_WIDTH / 2.0f,
@@ -1287,7 +2252,7 @@ void drawCharacterSelect() {
     float c3CenterX = card3X + cardW / 2.0f;
 
     // ----- Background panel behind all cards -----
-    glColor3f(0.05f, 0.05f, 0.12f);
+    setColor(0.05f, 0.05f, 0.12f);
     glBegin(GL_QUADS);
     glVertex2f(rowStartX - 15.0f,          cardY - 20.0f);
     glVertex2f(rowStartX + totalRowW + 15.0f, cardY - 20.0f);
@@ -1295,7 +2260,7 @@ void drawCharacterSelect() {
     glVertex2f(rowStartX - 15.0f,          cardY + cardH + 25.0f);
     glEnd();
 
-    glColor3f(0.7f, 0.7f, 0.8f);
+    setColor(0.7f, 0.7f, 0.8f);
     glBegin(GL_LINE_LOOP);
     glVertex2f(rowStartX - 15.0f,          cardY - 20.0f);
     glVertex2f(rowStartX + totalRowW + 15.0f, cardY - 20.0f);
@@ -1304,7 +2269,7 @@ void drawCharacterSelect() {
     glEnd();
 
     // ---------- CAR CARD ----------
-    glColor3f(0.07f, 0.09f, 0.22f);
+    setColor(0.07f, 0.09f, 0.22f);
     glBegin(GL_QUADS);
     glVertex2f(card1X,          cardY);
     glVertex2f(card1X + cardW,  cardY);
@@ -1312,7 +2277,7 @@ void drawCharacterSelect() {
     glVertex2f(card1X,          cardY + cardH);
     glEnd();
 
-    glColor3f(0.8f, 0.8f, 0.9f);
+    setColor(0.8f, 0.8f, 0.9f);
     glBegin(GL_LINE_LOOP);
     glVertex2f(card1X,          cardY);
     glVertex2f(card1X + cardW,  cardY);
@@ -1326,7 +2291,7 @@ void drawCharacterSelect() {
     drawCarPreview2D(c1CenterX, centerY, 1.1f);
 
     // ---------- DINO CARD ----------
-    glColor3f(0.05f, 0.20f, 0.09f);
+    setColor(0.05f, 0.20f, 0.09f);
     glBegin(GL_QUADS);
     glVertex2f(card2X,          cardY);
     glVertex2f(card2X + cardW,  cardY);
@@ -1334,7 +2299,7 @@ void drawCharacterSelect() {
     glVertex2f(card2X,          cardY + cardH);
     glEnd();
 
-    glColor3f(0.8f, 0.8f, 0.9f);
+    setColor(0.8f, 0.8f, 0.9f);
     glBegin(GL_LINE_LOOP);
     glVertex2f(card2X,          cardY);
     glVertex2f(card2X + cardW,  cardY);
@@ -1348,7 +2313,7 @@ void drawCharacterSelect() {
     drawDinoPreview2D(c2CenterX, centerY, 1.1f);
 
     // ---------- CAT CARD ----------
-    glColor3f(0.18f, 0.18f, 0.22f);
+    setColor(0.18f, 0.18f, 0.22f);
     glBegin(GL_QUADS);
     glVertex2f(card3X,          cardY);
     glVertex2f(card3X + cardW,  cardY);
@@ -1356,7 +2321,7 @@ void drawCharacterSelect() {
     glVertex2f(card3X,          cardY + cardH);
     glEnd();
 
-    glColor3f(0.8f, 0.8f, 0.9f);
+    setColor(0.8f, 0.8f, 0.9f);
     glBegin(GL_LINE_LOOP);
     glVertex2f(card3X,          cardY);
     glVertex2f(card3X + cardW,  cardY);
@@ -1368,6 +2333,14 @@ void drawCharacterSelect() {
                        c3CenterX,
                        cardY + cardH + 20.0f);
     drawCatPreview2D(c3CenterX, centerY, 1.1f);
+}
+
+void drawCharacterSelect() {
+    set2D();
+    glClear(GL_COLOR_BUFFER_BIT);
+
+    if (!drawCachedScreen(charSelectCache, drawCharacterSelectStatic))
+        drawCharacterSelectStatic();
 
     glutSwapBuffers();
 }
@@ -1378,7 +2351,7 @@ void drawGameOver() {
     glClear(GL_COLOR_BUFFER_BIT);
     drawBackground2D();
 
-    glColor3f(1.0f, 1.0f, 0.0f);
+    setColor(1.0f, 1.0f, 0.0f);
     drawStringCentered(GLUT_BITMAP_HELVETICA_18,
                        "GAME OVER!",
                        WINDOW_WIDTH / 2.0f,
@@ -1397,16 +2370,376 @@ void drawGameOver() {
                        WINDOW_WIDTH / 2.0f,
                        WINDOW_HEIGHT / 2.0f);
 
+    if (raceMode) {
+        int winner = raceSession.state.winner;
+        drawStringCentered(GLUT_BITMAP_HELVETICA_18,
+                           winner < 0 ? "Draw!" :
+                           winner == racePlayer ? "You win!" : "Your rival wins.",
+                           WINDOW_WIDTH / 2.0f,
+                           WINDOW_HEIGHT / 2.0f - 30.0f);
+    }
+
     drawStringCentered(GLUT_BITMAP_HELVETICA_18,
-                       "Press SPACE to play again, or ESC to quit.",
+                       spectating ? "Waiting for the next run, ESC to quit." :
+                       raceMode   ? "Press ESC to quit."
+                                  : "Press SPACE to play again, or ESC to quit.",
                        WINDOW_WIDTH / 2.0f,
                        WINDOW_HEIGHT / 2.0f - 60.0f);
 
     glutSwapBuffers();
 }
 
+// ------------- PROFILER OVERLAY -------------
+void drawProfilerOverlay() {
+    char buffer[96];
+    float x = 10.0f;
+    float y = HUD_STATUS_Y - HUD_STATUS_STEP * hudStatusLines();
+
+    setColor(1.0f, 1.0f, 0.4f);
+    drawString(GLUT_BITMAP_HELVETICA_12, "GL state calls (issued / skipped)", x, y);
+
+    for (int i = 0; i < NUM_GLS; ++i) {
+        y -= 14.0f;
+        sprintf(buffer, "%-10s %4d / %4d", glStateNames[i],
+                glStateLastFrame.issued[i], glStateLastFrame.skipped[i]);
+        drawString(GLUT_BITMAP_HELVETICA_12, buffer, x, y);
+    }
+
+    AudioStats audio = audioGetStats();
+    y -= 14.0f;
+    sprintf(buffer, "audio mix  %.1f us avg, %.1f max, %d voices",
+            audio.avgMixMicros, audio.maxMixMicros, audio.activeVoices);
+    drawString(GLUT_BITMAP_HELVETICA_12, buffer, x, y);
+
+    y -= 14.0f;
+    sprintf(buffer, "arena      %lu / %lu KB peak this run",
+            (unsigned long)(sessionArena.peak / 1024),
+            (unsigned long)(sessionArena.capacity / 1024));
+    drawString(GLUT_BITMAP_HELVETICA_12, buffer, x, y);
+
+    y -= 14.0f;
+    sprintf(buffer, "entities   %d / %d obstacles, %d pickups",
+            entityCount(entities, ARCH_OBSTACLE), maxObstacles,
+            entityCount(entities, ARCH_PICKUP));
+    drawString(GLUT_BITMAP_HELVETICA_12, buffer, x, y);
+
+    y -= 14.0f;
+    sprintf(buffer, "particles  %d / %d live, %d dropped",
+            particles.count, particles.capacity, particles.dropped);
+    drawString(GLUT_BITMAP_HELVETICA_12, buffer, x, y);
+
+    if (raceMode) {
+        const NetStats &st = raceSession.stats;
+        y -= 14.0f;
+        sprintf(buffer, "net        rollback %d (max %d), resim %.3f ms (max %.3f), ahead %d",
+                st.lastRollback, st.maxRollback, st.lastResimMs, st.maxResimMs, st.ahead);
+        drawString(GLUT_BITMAP_HELVETICA_12, buffer, x, y);
+
+        y -= 14.0f;
+        sprintf(buffer, "           %ld stalls, %ld sent / %ld dropped / %ld received",
+                st.stalls, st.sent, st.dropped, st.received);
+        drawString(GLUT_BITMAP_HELVETICA_12, buffer, x, y);
+    }
+
+    if (spectateServing) {
+        const SpecStats &st = spectateServer.stats;
+        y -= 14.0f;
+        sprintf(buffer, "spectate   %d viewers, %.0f B/s, encode %.2f us/tick, last frame %d B",
+                st.clients, st.bytesPerSecond,
+                st.frames ? st.encodeMicros / st.frames : 0.0, st.lastFrameBytes);
+        drawString(GLUT_BITMAP_HELVETICA_12, buffer, x, y);
+    }
+    if (spectating) {
+        y -= 14.0f;
+        sprintf(buffer, "spectate   watching tick %d, %.0f B/s received",
+                spectateViewer.decoder.state.tick, spectateViewer.bytesPerSecond);
+        drawString(GLUT_BITMAP_HELVETICA_12, buffer, x, y);
+    }
+    if (autopilotOn) {
+        y -= 14.0f;
+        sprintf(buffer, "autopilot  %s, %ld decisions, %.2f us each",
+                mlpPath ? mlpKernelName(mlpNet.kernel) : "planner", autopilotDecisions,
+                autopilotDecisions ? autopilotMicros / autopilotDecisions : 0.0);
+        drawString(GLUT_BITMAP_HELVETICA_12, buffer, x, y);
+    }
+    if (recording) {
+        RecorderStats st = recorderStats(recorder);
+        y -= 14.0f;
+        sprintf(buffer, "record     %.2f us/row, %llu rows, %llu dropped, %.1fx, %.0f us/chunk",
+                recordRows ? recordMicros / recordRows : 0.0,
+                (unsigned long long)st.rows, (unsigned long long)st.dropped,
+                st.fileBytes ? (double)st.rawBytes / st.fileBytes : 0.0, st.encodeMicros);
+        drawString(GLUT_BITMAP_HELVETICA_12, buffer, x, y);
+    }
+    if (shmExporting) {
+        y -= 14.0f;
+        sprintf(buffer, "shm        /%s, %ld frames, %.2f us/frame",
+                shmExportName, shmExportFrames,
+                shmExportFrames ? shmExportMicros / shmExportFrames : 0.0);
+        drawString(GLUT_BITMAP_HELVETICA_12, buffer, x, y);
+    }
+
+    y -= 14.0f;
+    sprintf(buffer, "scene      %d / %d matrices rebuilt",
+            scene.lastRecomputed, scene.count);
+    drawString(GLUT_BITMAP_HELVETICA_12, buffer, x, y);
+
+#ifdef GL_STATS
+    // per draw function counts from glstats.h (inclusive of callees)
+    y -= 22.0f;
+    drawString(GLUT_BITMAP_HELVETICA_12,
+               "calls  begins  verts  push  state  glut", x + 150.0f, y);
+    for (int i = 0; i < glStatsScopeCount(); ++i) {
+        const GLStatsScopeRow &row = glStatsLastFrame(i);
+        if (row.counts[GLSTAT_CALLS] == 0) continue;
+
+        y -= 14.0f;
+        drawString(GLUT_BITMAP_HELVETICA_12, row.name, x, y);
+        sprintf(buffer, "%5d  %6d  %5d  %4d  %5d  %4d",
+                row.counts[GLSTAT_CALLS],    row.counts[GLSTAT_BEGINS],
+                row.counts[GLSTAT_VERTICES], row.counts[GLSTAT_PUSHES],
+                row.counts[GLSTAT_STATE],    row.counts[GLSTAT_GLUT_PRIMS]);
+        drawString(GLUT_BITMAP_HELVETICA_12, buffer, x + 150.0f, y);
+    }
+#endif
+}
+
+// ------------- RENDER QUEUE -------------
+// The playing screen is drawn from one command list per frame. Draw
+// functions are submitted with a sort key instead of being called in
+// whatever order display() happens to reach them; the list is then sorted
+// and executed once, and pass/material state is only changed when it
+// actually differs from the previous command.
+//
+// Sort key, high bits to low:
+//   pass (2) | depth (16) | material (8) | primitive (8) | sequence (30)
+// For PASS_3D depth is a front-to-back distance bucket; for PASS_HUD it is
+// the layer, so 2D elements keep painter's order.
+enum RenderPass {
+    PASS_3D,
+    PASS_HUD
+};
+
+enum RenderMaterial {
+    MAT_CUSTOM,            // draw function sets its own colors / line width
+    MAT_OBSTACLE_CORE,
+    MAT_OBSTACLE_SHELL,
+    MAT_OBSTACLE_SPIKE,
+    MAT_HUD_TEXT,
+    NUM_MATERIALS
+};
+
+enum RenderPrimitive {
+    PRIM_SOLID,
+    PRIM_WIRE,
+    PRIM_TEXT,
+    PRIM_BLENDED           // after the opaque commands at the same depth
+};
+
+struct RenderMaterialDesc {
+    float r, g, b;
+    float lineWidth;
+};
+
+const RenderMaterialDesc renderMaterials[NUM_MATERIALS] = {
+    { 1.0f,  1.0f,  1.0f,  1.0f },   // MAT_CUSTOM (never applied)
+    { 0.02f, 0.02f, 0.02f, 1.0f },   // dark core
+    { 0.3f,  0.0f,  0.0f,  1.0f },   // dark red wire shell
+    { 1.0f,  0.25f, 0.25f, 1.0f },   // brighter red spikes
+    { 1.0f,  1.0f,  1.0f,  1.0f }    // white HUD text
+};
+
+struct RenderCommand {
+    unsigned long long key;
+    void (*draw)();
+    const float *world;    // model matrix applied around draw(), or NULL
+    const char *name;      // for diagnostics
+};
+
+const int      MAX_RENDER_CMDS  = 512;
+const unsigned RENDER_DEPTH_MAX = 0xFFFF;
+const float    CAMERA_Z         = 18.0f;   // eye z used by gluLookAt below
+const float    DEPTH_BUCKET     = 8.0f;    // world units per depth bucket
+
+RenderCommand renderQueue[MAX_RENDER_CMDS];
+int           renderQueueCount = 0;
+
+unsigned renderDepthBucket(float z) {
+    float dist = CAMERA_Z - z;
+    if (dist < 0.0f) dist = 0.0f;
+    unsigned bucket = (unsigned)(dist / DEPTH_BUCKET);
+    if (bucket > RENDER_DEPTH_MAX - 1) bucket = RENDER_DEPTH_MAX - 1;
+    return bucket;
+}
+
+void submitRender(RenderPass pass, unsigned depth, RenderMaterial mat,
+                  RenderPrimitive prim, void (*draw)(),
+                  const float *world, const char *name) {
+    if (renderQueueCount >= MAX_RENDER_CMDS) {
+        fprintf(stderr, "render queue full, dropping '%s'\n", name);
+        return;
+    }
+
+    RenderCommand &cmd = renderQueue[renderQueueCount];
+    cmd.key = ((unsigned long long)pass                   << 62) |
+              ((unsigned long long)(depth & 0xFFFF)       << 46) |
+              ((unsigned long long)(mat   & 0xFF)         << 38) |
+              ((unsigned long long)(prim  & 0xFF)         << 30) |
+               (unsigned long long)(renderQueueCount & 0x3FFFFFFF);
+    cmd.draw  = draw;
+    cmd.world = world;
+    cmd.name  = name;
+    ++renderQueueCount;
+}
+
+bool renderCommandLess(const RenderCommand &a, const RenderCommand &b) {
+    return a.key < b.key;
+}
+
+void beginRenderPass(int pass) {
+    if (pass == PASS_3D) {
+        set3D();
+
+        // camera looking down the runway
+        gluLookAt(0.0, 6.0, CAMERA_Z,
+                  0.0, 1.0, 0.0,
+                  0.0, 1.0, 0.0);
+    } else {
+        set2D();
+    }
+}
+
+void executeRenderQueue() {
+    std::sort(renderQueue, renderQueue + renderQueueCount, renderCommandLess);
+
+    int curPass = -1;
+    int curMat  = -1;
+
+    for (int i = 0; i < renderQueueCount; ++i) {
+        const RenderCommand &cmd = renderQueue[i];
+        int pass = (int)(cmd.key >> 62);
+        int mat  = (int)((cmd.key >> 38) & 0xFF);
+
+        if (pass != curPass) {
+            beginRenderPass(pass);
+            curPass = pass;
+            curMat  = -1;
+        }
+
+        if (mat != MAT_CUSTOM && mat != curMat) {
+            const RenderMaterialDesc &m = renderMaterials[mat];
+            setColor(m.r, m.g, m.b);
+            setLineWidth(m.lineWidth);
+            curMat = mat;
+        }
+
+#ifndef NDEBUG
+        GLint stackBefore = 0;
+        glGetIntegerv(GL_MODELVIEW_STACK_DEPTH, &stackBefore);
+#endif
+
+        glPushMatrix();
+        if (cmd.world) glMultMatrixf(cmd.world);
+        cmd.draw();
+        glPopMatrix();
+
+#ifndef NDEBUG
+        GLint stackAfter = 0;
+        glGetIntegerv(GL_MODELVIEW_STACK_DEPTH, &stackAfter);
+        if (stackAfter != stackBefore) {
+            fprintf(stderr, "render queue: '%s' left the modelview stack "
+                            "unbalanced (%d -> %d)\n",
+                    cmd.name, (int)stackBefore, (int)stackAfter);
+            // put the stack back so one bad command can't break the frame
+            while (stackAfter > stackBefore) { glPopMatrix();  --stackAfter; }
+            while (stackAfter < stackBefore) { glPushMatrix(); ++stackAfter; }
+        }
+#endif
+
+        // custom commands may have changed color or line width
+        if (mat == MAT_CUSTOM)
+            curMat = -1;
+    }
+
+    renderQueueCount = 0;
+}
+
+// ------------- STRESS MODE -------------
+// --stress: capacity test. The run is filled to each density in turn and
+// held there for a few seconds; obstacles that pass the player respawn at
+// the far end instead of being released, and nothing collides. One line per
+// density goes to stdout, then the game exits.
+const int   STRESS_COUNTS[]     = { 10000, 100000, 1000000 };
+const int   NUM_STRESS_STEPS    = sizeof(STRESS_COUNTS) / sizeof(STRESS_COUNTS[0]);
+const float STRESS_STEP_SECONDS = 3.0f;
+const int   STRESS_MIN_FRAMES   = 5;    // slow steps still average a few frames
+const float STRESS_SPAN         = RUNWAY_NEAR_Z + 5.0f - RUNWAY_FAR_Z;
+
+bool   stressMode   = false;
+int    stressStep   = -1;      // index into STRESS_COUNTS, -1 before the first
+float  stressTimer  = 0.0f;
+int    stressTicks  = 0;
+int    stressFrames = 0;
+double stressTickMs = 0.0;
+double stressDrawMs = 0.0;
+
+void stressFill(int count) {
+    while (entityCount(entities, ARCH_OBSTACLE) < count) {
+        float z = RUNWAY_FAR_Z + STRESS_SPAN * (float)rand() / RAND_MAX;
+        if (entityCreate(entities, ARCH_OBSTACLE, KIND_OBSTACLE,
+                         laneSim->randomLane(), z, ENTITY_HARMFUL) < 0)
+            break;
+    }
+}
+
+void stressReport() {
+    printf("stress: %8d obstacles  tick %9.3f ms  draw %9.2f ms  "
+           "memory %7.1f MB (%d chunks)\n",
+           entityCount(entities, ARCH_OBSTACLE), stressTickMs / stressTicks,
+           stressFrames ? stressDrawMs / stressFrames : 0.0,
+           sessionArena.used / (1024.0 * 1024.0),
+           entities.archetypes[ARCH_OBSTACLE].chunkCount);
+    fflush(stdout);
+}
+
+void stressTick(float dt) {
+    bool stepDone = stressTimer >= STRESS_STEP_SECONDS && stressFrames >= STRESS_MIN_FRAMES;
+    if (stressStep < 0 || stepDone) {
+        if (stressStep >= 0) stressReport();
+        if (++stressStep >= NUM_STRESS_STEPS) exit(0);
+
+        stressFill(STRESS_COUNTS[stressStep]);
+        stressTimer  = 0.0f;
+        stressTicks  = stressFrames = 0;
+        stressTickMs = stressDrawMs = 0.0;
+        return;
+    }
+
+    if (dt > 0.1f) dt = 0.1f;          // slow frames shouldn't skip the runway
+    double t0 = millisSinceLaunch();
+
+    // passed obstacles go back to the far end (same lane), nothing hits
+    LaneStep step = {};
+    step.dz          = gameSpeed * dt;
+    step.despawnZ    = RUNWAY_NEAR_Z + 5.0f;
+    step.recycleSpan = STRESS_SPAN;
+    step.playerLane  = playerLane;
+    step.hitFlags    = 0;
+    laneSim->recycleStep(entities, step, NULL, 0);
+
+    stressTickMs += millisSinceLaunch() - t0;
+    ++stressTicks;
+    stressTimer += dt;
+    animTime    += dt;
+}
+
 // ------------- DISPLAY -------------
 void display() {
+    glStateBeginFrame();
+#ifdef GL_STATS
+    glStatsBeginFrame();
+#endif
+
     if (gameState == STATE_MENU) {
         drawMenu();
         return;
@@ -1420,32 +2753,547 @@ void display() {
         return;
     }
 
-    // STATE_PLAYING: 3D + HUD
+    // STATE_PLAYING / STATE_CRASHED: 3D + HUD, built as one sorted command list
+    double drawStart = stressMode ? millisSinceLaunch() : 0.0;
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-    set3D();
 
-    // camera looking down the runway
-    gluLookAt(0.0, 6.0, 18.0,
-              0.0, 1.0, 0.0,
-              0.0, 1.0, 0.0);
+    // runway covers every depth; drawing it last lets the depth test
+    // reject the parts hidden behind obstacles and the player
+    updateScene();
 
-    drawRunway();
-    drawObstacles3D();
-    if (heartPickup.active)
-{
-    float x = (heartPickup.lane - (NUM_LANES - 1) / 2.0f) * LANE_SPACING;
-    float z = heartPickup.z;
+    submitRender(PASS_3D, RENDER_DEPTH_MAX, MAT_CUSTOM, PRIM_SOLID,
+                 drawRunway, NULL, "runway");
 
-    drawShieldPickup3D(x, z);
-}
+    for (int i = 0; i < sceneObstacleCount(); ++i) {
+        const float *world = sceneWorld(scene, obstacleNodes[i]);
+        unsigned depth = renderDepthBucket(entityChunk(entities, ARCH_OBSTACLE, i)->z[i]);
+
+        if (meshLoaded(obstacleModel)) {
+            submitRender(PASS_3D, depth, MAT_CUSTOM, PRIM_SOLID,
+                         drawObstacleModel, world, "obstacle model");
+            continue;
+        }
 
-    drawPlayer3D();
-    drawHUD();
+        submitRender(PASS_3D, depth, MAT_OBSTACLE_CORE,  PRIM_SOLID,
+                     drawObstacleCore,   world, "obstacle core");
+        submitRender(PASS_3D, depth, MAT_OBSTACLE_SHELL, PRIM_WIRE,
+                     drawObstacleShell,  world, "obstacle shell");
+        submitRender(PASS_3D, depth, MAT_OBSTACLE_SPIKE, PRIM_SOLID,
+                     drawObstacleSpikes, world, "obstacle spikes");
+    }
+
+    if (entityCount(entities, ARCH_OBSTACLE) > SCENE_OBSTACLES)
+        submitRender(PASS_3D, RENDER_DEPTH_MAX - 1, MAT_OBSTACLE_CORE, PRIM_SOLID,
+                     drawObstacleBatch, NULL, "obstacle batch");
+
+    for (int i = 0; i < entityCount(entities, ARCH_PICKUP); ++i) {
+        const EntityChunk *pk = entityChunk(entities, ARCH_PICKUP, i);
+        if (pk->kind[i] != KIND_SHIELD) continue;
+        submitRender(PASS_3D, renderDepthBucket(pk->z[i]), MAT_CUSTOM,
+                     PRIM_SOLID, drawShieldPickup3D,
+                     sceneWorld(scene, pickupShieldNodes[i]), "shield pickup");
+    }
+
+    // gone in the crash; in a race the winner stays
+    bool playerShown = raceMode ? raceSession.state.players[racePlayer].alive != 0
+                                : gameState == STATE_PLAYING;
+    if (playerShown)
+        submitRender(PASS_3D, renderDepthBucket(playerZ), MAT_CUSTOM, PRIM_SOLID,
+                     drawPlayer3D, sceneWorld(scene, playerNode), "player");
+
+    if (raceMode && raceSession.state.players[raceSession.remotePlayer].alive)
+        submitRender(PASS_3D, renderDepthBucket(playerZ), MAT_CUSTOM, PRIM_SOLID,
+                     drawRival3D, sceneWorld(scene, rivalNode), "rival");
+
+    if (particles.count > 0 && particleVerts)
+        submitRender(PASS_3D, RENDER_DEPTH_MAX, MAT_CUSTOM, PRIM_BLENDED,
+                     drawParticles, NULL, "particles");
+
+    // HUD layers are drawn in painter's order: the depth field is the layer
+    submitRender(PASS_HUD, 0, MAT_HUD_TEXT, PRIM_TEXT,
+                 drawHUD, NULL, "hud");
+    submitRender(PASS_HUD, 1, MAT_CUSTOM, PRIM_SOLID,
+                 drawPowerupsHUD, NULL, "powerups hud");
+    if (showProfiler)
+        submitRender(PASS_HUD, 2, MAT_CUSTOM, PRIM_TEXT,
+                     drawProfilerOverlay, NULL, "profiler");
+
+    executeRenderQueue();
+
+    if (stressMode) {
+        glFinish();                    // count the GPU's part too
+        stressDrawMs += millisSinceLaunch() - drawStart;
+        ++stressFrames;
+    }
 
     glutSwapBuffers();
 }
 
-// ------------- UPDATE -------------
+// ------------- FRAME PACING -------------
+// update() only keeps its 16 ms timer alive while a run is being played
+// (or its crash plays out) and the window is visible. Menus, character select and game over are
+// static: they are redrawn when input or a state change asks for it and
+// otherwise GLUT just sleeps waiting for events.
+void update(int value);
+void shmPublish();
+void attractSchedule();
+void keyboard(unsigned char key, int x, int y);
+void specialKeyboard(int key, int x, int y);
+
+bool loopRunning   = false;   // update() timer currently scheduled
+bool windowVisible = true;
+
+bool needsGameLoop() {
+    // a viewer keeps reading the stream through the publisher's game over
+    bool watching = spectating && spectateViewer.sock >= 0;
+    // hidden, only a race and a viewer keep ticking: the peer waits on our
+    // inputs, and the stream would back up in the socket
+    return (gameState == STATE_PLAYING || gameState == STATE_CRASHED || watching) &&
+           (windowVisible || raceMode || watching);
+}
+
+void startGameLoop() {
+    if (loopRunning || !needsGameLoop()) return;
+    loopRunning = true;
+    lastTimeMs  = glutGet(GLUT_ELAPSED_TIME);   // idle time is not a dt
+    glutTimerFunc(16, update, 0);
+}
+
+void requestRedraw() {
+    glutPostRedisplay();
+    startGameLoop();
+}
+
+void setGameState(GameState s) {
+    gameState = s;
+    requestRedraw();
+    // the menus don't tick, so nothing else would export them
+    if (shmExporting && !loopRunning)
+        shmPublish();
+    attractSchedule();
+}
+
+void visibility(int state) {
+    // hidden / minimized: the running game pauses until we are shown again,
+    // unless needsGameLoop() says it can't; then it ticks without drawing
+    windowVisible = (state == GLUT_VISIBLE);
+    if (windowVisible)
+        requestRedraw();
+}
+
+// ------------- RACE TICK -------------
+bool raceStart() {
+    if (!netOpen(raceSession, racePlayer, raceLocalPort, racePeerHost, racePeerPort,
+                 raceSeed, laneSim->lanes, raceShim))
+        return false;
+    raceTickTime    = 0.0f;
+    raceLastShields = 0;
+    return true;
+}
+
+// mirrored modes rebuild the store from their own state every frame
+void clearEntities() {
+    for (int arch = 0; arch < NUM_ARCHETYPES; ++arch)
+        while (entityCount(entities, arch) > 0)
+            entityDestroy(entities, arch, entityCount(entities, arch) - 1);
+}
+
+// the race state as the rest of the game sees it
+void raceMirror() {
+    const RaceState  &s  = raceSession.state;
+    const RacePlayer &me = s.players[racePlayer];
+
+    clearEntities();
+    for (int i = 0; i < s.objectCount; ++i) {
+        const RaceObject &o = s.objects[i];
+        if (o.kind == RACE_SHIELD)
+            entityCreate(entities, ARCH_PICKUP, KIND_SHIELD, o.lane, o.z, ENTITY_COLLECTIBLE);
+        else
+            entityCreate(entities, ARCH_OBSTACLE, KIND_OBSTACLE, o.lane, o.z, ENTITY_HARMFUL);
+    }
+
+    // the local lane stays whatever the player last chose: it is our input
+    // and the race applies it as is
+    if (me.shields < raceLastShields) effectShieldBreak(playerX, playerZ);
+    if (me.shields > raceLastShields) effectPickup(playerX, playerZ);
+    raceLastShields = me.shields;
+
+    heartCount  = me.shields;
+    score       = me.score / RACE_TICK_RATE;
+    elapsedTime = s.tick * RACE_TICK_SECONDS;
+    gameSpeed   = s.speed;
+}
+
+void raceUpdate(float dt) {
+    raceTickTime += dt;
+    if (raceTickTime > 0.25f) raceTickTime = 0.25f;   // don't spiral after a stall
+
+    bool ticked = false;
+    while (raceTickTime >= RACE_TICK_SECONDS) {
+        if (!netAdvance(raceSession, (RaceInput)playerLane, millisSinceLaunch()))
+            break;                     // too far ahead of the peer; wait
+        raceTickTime -= RACE_TICK_SECONDS;
+        ticked = true;
+    }
+    if (!ticked)
+        netSync(raceSession, millisSinceLaunch());
+
+    animTime   += dt;
+    roadOffset += gameSpeed * dt;
+    if (roadOffset > STRIPE_SPACING)
+        roadOffset = fmod(roadOffset, STRIPE_SPACING);
+    particlesUpdate(particles, dt);
+    raceMirror();
+
+    // only a finish that used no predicted input is final
+    const RaceState &s = raceSession.state;
+    if (s.finished && netConfirmed(raceSession)) {
+        for (int p = 0; p < RACE_PLAYERS; ++p) {
+            if (s.players[p].alive) continue;
+            float x = laneSim->laneX[s.players[p].lane];
+            effectCrash(x, playerY, playerZ);
+        }
+        audioPlay(SFX_COLLISION);
+
+        const NetStats &st = raceSession.stats;
+        printf("race over after %d ticks, winner %d: %ld rollbacks, max depth %d, "
+               "resim max %.3f ms, %ld stalls\n",
+               s.tick, s.winner, st.rollbacks, st.maxRollback, st.maxResimMs, st.stalls);
+        crashTimer = CRASH_SECONDS;
+        setGameState(STATE_CRASHED);
+    }
+}
+
+// ------------- SPECTATOR STREAM -------------
+void spectatePublish() {
+    SpecState &f = spectateFrame;
+    f.tick     = ++spectateTick;
+    f.runState = (gameState == STATE_PLAYING) ? SPEC_RUN_PLAYING :
+                 (gameState == STATE_CRASHED) ? SPEC_RUN_CRASHED : SPEC_RUN_OVER;
+    f.lanes    = laneSim->lanes;
+    f.score    = score;
+    f.shields  = heartCount;
+    f.lane     = playerLane;
+    f.powerup  = activePowerup;
+    f.speed    = gameSpeed;
+    f.elapsed  = elapsedTime;
+    f.travel   = spectateTravel;
+
+    f.objectCount = 0;
+    for (int arch = 0; arch < NUM_ARCHETYPES; ++arch) {
+        const EntityArchetype &a = entities.archetypes[arch];
+        for (int c = 0; c < a.chunkCount; ++c) {
+            const EntityChunk *ch = a.chunks[c];
+            int n = entityChunkCount(a, c);
+            for (int k = 0; k < n && f.objectCount < SPEC_MAX_OBJECTS; ++k) {
+                SpecObject &o = f.objects[f.objectCount++];
+                o.id   = ch->id[k];
+                o.kind = ch->kind[k];
+                o.lane = ch->lane[k];
+                o.z    = ch->z[k];
+            }
+        }
+    }
+
+    specServerPublish(spectateServer, f, millisSinceLaunch());
+
+    if (f.runState == SPEC_RUN_OVER) {
+        const SpecStats &st = spectateServer.stats;
+        printf("spectate: %ld frames (%ld keyframes) so far, %.0f B/s, "
+               "encode %.2f us/tick, %d viewers\n",
+               st.frames, st.keyframes, st.bytesPerSecond,
+               st.frames ? st.encodeMicros / st.frames : 0.0, st.clients);
+    }
+}
+
+// the stream as the rest of the game sees it
+void spectateMirror() {
+    const SpecState &s = spectateViewer.decoder.state;
+
+    if (s.lanes != laneSim->lanes && spectateLastRun < 0)
+        printf("spectate: the stream has %d lanes, start the viewer with --lanes %d\n",
+               s.lanes, s.lanes);
+
+    if (s.runState != spectateLastRun) {
+        if (s.runState == SPEC_RUN_PLAYING) {
+            resetGame();
+            setGameState(STATE_PLAYING);
+        } else if (s.runState == SPEC_RUN_CRASHED) {
+            effectCrash(playerX, playerY, playerZ);
+            audioPlay(SFX_COLLISION);
+            setGameState(STATE_CRASHED);
+        } else {
+            setGameState(STATE_GAMEOVER);
+        }
+        spectateLastShields = s.shields;
+        spectateLastRun     = s.runState;
+    }
+
+    clearEntities();
+    for (int i = 0; i < s.objectCount; ++i) {
+        const SpecObject &o = s.objects[i];
+        int lane = (o.lane < laneSim->lanes) ? o.lane : laneSim->lanes - 1;
+        if (o.kind == KIND_SHIELD)
+            entityCreate(entities, ARCH_PICKUP, KIND_SHIELD, lane, o.z, ENTITY_COLLECTIBLE);
+        else
+            entityCreate(entities, ARCH_OBSTACLE, KIND_OBSTACLE, lane, o.z, ENTITY_HARMFUL);
+    }
+
+    if (s.shields < spectateLastShields) effectShieldBreak(playerX, playerZ);
+    if (s.shields > spectateLastShields) effectPickup(playerX, playerZ);
+    spectateLastShields = s.shields;
+
+    playerLane    = (s.lane < laneSim->lanes) ? s.lane : laneSim->lanes - 1;
+    recalcPlayerX();
+    heartCount    = s.shields;
+    score         = s.score;
+    elapsedTime   = s.elapsed;
+    gameSpeed     = s.speed;
+    activePowerup = (PowerupType)s.powerup;
+}
+
+void spectateUpdate(float dt) {
+    if (specViewerPoll(spectateViewer, millisSinceLaunch()) < 0) {
+        printf("spectate: the stream has ended\n");
+        setGameState(STATE_GAMEOVER);
+        return;
+    }
+
+    animTime   += dt;
+    roadOffset += gameSpeed * dt;
+    if (roadOffset > STRIPE_SPACING)
+        roadOffset = fmod(roadOffset, STRIPE_SPACING);
+    particlesUpdate(particles, dt);
+    if (spectateViewer.decoder.synced)
+        spectateMirror();
+}
+
+// ------------- STATE EXPORT -------------
+// straight into the slot the readers will copy, no staging
+void shmPublish() {
+    double start = millisSinceLaunch();
+    ShmFrame *f = shmExportBegin();
+    if (!f) return;
+    f->state           = gameState;
+    f->lanes           = laneSim->lanes;
+    f->playerLane      = playerLane;
+    f->score           = score;
+    f->shields         = heartCount;
+    f->powerup         = activePowerup;
+    f->choosingPowerup = choosingPowerup;
+    f->speed           = gameSpeed;
+    f->elapsed         = elapsedTime;
+    f->powerupTimer    = powerupTimer;
+    f->nextPowerupTime = nextPowerupTime;
+    f->nextShieldTime  = nextHeartSpawnTime;
+    f->spawnInterval   = spawnInterval;
+    f->spawnTimer      = spawnTimer;
+
+    uint32_t count = 0, total = 0;
+    uint32_t max   = (uint32_t)shmExportMaxObjects();
+    for (int arch = 0; arch < NUM_ARCHETYPES; ++arch) {
+        const EntityArchetype &a = entities.archetypes[arch];
+        for (int c = 0; c < a.chunkCount; ++c) {
+            const EntityChunk *ch = a.chunks[c];
+            int n = entityChunkCount(a, c);
+            total += n;
+            for (int k = 0; k < n && count < max; ++k) {
+                ShmObject &o = f->objects[count++];
+                o.z     = ch->z[k];
+                o.x     = laneSim->laneX[ch->lane[k]];
+                o.id    = ch->id[k];
+                o.lane  = ch->lane[k];
+                o.kind  = (ch->kind[k] == KIND_SHIELD) ? SHM_SHIELD : SHM_OBSTACLE;
+                o.flags = ch->flags[k];
+                o.pad   = 0;
+            }
+        }
+    }
+    f->objectCount  = count;
+    f->totalObjects = total;
+    shmExportEnd();
+
+    shmExportMicros += (millisSinceLaunch() - start) * 1000.0;
+    ++shmExportFrames;
+}
+
+// ------------- AUTOPILOT -------------
+// one decision, before the tick moves anything; dt is how far it will
+void autopilotTick(float dt) {
+    double start = millisSinceLaunch();
+
+    AutopilotGrid g;
+    autopilotClear(g, laneSim->lanes, gameSpeed, dt);
+    float minZ, maxZ[NUM_ARCHETYPES];
+    entityHitRange(obstacleLength, minZ, maxZ[ARCH_OBSTACLE]);
+    entityHitRange(PICKUP_LENGTH,  minZ, maxZ[ARCH_PICKUP]);
+    for (int arch = 0; arch < NUM_ARCHETYPES; ++arch) {
+        const EntityArchetype &a = entities.archetypes[arch];
+        float halfDepth = maxZ[arch] - playerZ;
+        for (int c = 0; c < a.chunkCount; ++c) {
+            const EntityChunk *ch = a.chunks[c];
+            int n = entityChunkCount(a, c);
+            for (int k = 0; k < n; ++k) {
+                if (ch->flags[k] & ENTITY_HARMFUL)
+                    autopilotAddObstacle(g, ch->lane[k], ch->z[k] - playerZ, halfDepth);
+                else if (ch->flags[k] & ENTITY_COLLECTIBLE)
+                    autopilotAddPickup(g, ch->lane[k], ch->z[k] - playerZ, halfDepth);
+            }
+        }
+    }
+
+    // how far ahead obstacles can't hurt: invincible, or just lost a shield
+    float safeSeconds = 0.4f - (elapsedTime - lastShieldHitTime);
+    if (activePowerup == PWR_INVINCIBLE && 5.0f - powerupTimer > safeSeconds)
+        safeSeconds = 5.0f - powerupTimer;
+    float safe = safeSeconds > dt ? (safeSeconds - dt) * gameSpeed : 0.0f;
+
+    int move = autopilotDecide(g, playerLane, heartCount, MAX_HEARTS, safe);
+    autopilotMicros += (millisSinceLaunch() - start) * 1000.0;
+    ++autopilotDecisions;
+
+    if (move < 0)
+        specialKeyboard(GLUT_KEY_LEFT, 0, 0);
+    else if (move > 0)
+        specialKeyboard(GLUT_KEY_RIGHT, 0, 0);
+    else if (choosingPowerup && activePowerup == PWR_NONE)
+        keyboard('t', 0, 0);                // invincible
+}
+
+// What a VecEnv run's observation would be in this state (vecenv.h):
+// distances are to the nearest thing not yet past the player, / the spawn
+// distance.
+void gameObservation(float *o) {
+    const int lanes = laneSim->lanes;
+    o[OBS_LANE]            = (float)playerLane / (float)(lanes - 1);
+    o[OBS_SHIELDS]         = (float)heartCount / MAX_HEARTS;
+    o[OBS_SPEED]           = gameSpeed / 40.0f;
+    o[OBS_POWERUP_OFFERED] = choosingPowerup && activePowerup == PWR_NONE;
+    o[OBS_SCORE_X2]        = activePowerup == PWR_SCORE_X2;
+    o[OBS_SLOW_HALF]       = activePowerup == PWR_SLOW_HALF;
+    o[OBS_INVINCIBLE]      = activePowerup == PWR_INVINCIBLE;
+    o[OBS_POWERUP_LEFT]    = activePowerup != PWR_NONE ? 1.0f - powerupTimer / 5.0f : 0.0f;
+    o[OBS_PICKUP_DISTANCE] = 1.0f;
+    o[OBS_PICKUP_LANE]     = 0.0f;
+    for (int l = 0; l < lanes; ++l)
+        o[OBS_LANE_DISTANCE + l] = 1.0f;
+
+    float minZ, maxZ[NUM_ARCHETYPES];
+    entityHitRange(obstacleLength, minZ, maxZ[ARCH_OBSTACLE]);
+    entityHitRange(PICKUP_LENGTH,  minZ, maxZ[ARCH_PICKUP]);
+    for (int arch = 0; arch < NUM_ARCHETYPES; ++arch) {
+        const EntityArchetype &a = entities.archetypes[arch];
+        for (int c = 0; c < a.chunkCount; ++c) {
+            const EntityChunk *ch = a.chunks[c];
+            int n = entityChunkCount(a, c);
+            for (int k = 0; k < n; ++k) {
+                if (ch->z[k] > maxZ[arch]) continue;        // gone past
+                float d = (playerZ - ch->z[k]) / -ENTITY_SPAWN_Z;
+                if (d < 0.0f) d = 0.0f;
+                int lane = ch->lane[k];
+                if ((ch->flags[k] & ENTITY_HARMFUL) && lane >= 0 && lane < lanes) {
+                    if (d < o[OBS_LANE_DISTANCE + lane]) o[OBS_LANE_DISTANCE + lane] = d;
+                } else if ((ch->flags[k] & ENTITY_COLLECTIBLE) && d < o[OBS_PICKUP_DISTANCE]) {
+                    o[OBS_PICKUP_DISTANCE] = d;
+                    o[OBS_PICKUP_LANE]     = (float)lane / (float)(lanes - 1);
+                }
+            }
+        }
+    }
+}
+
+// the policy net's decision, a batch of one
+void mlpTick() {
+    double start = millisSinceLaunch();
+    gameObservation(mlpObs);
+    mlpForward(mlpNet, mlpObs, mlpLogits, 1, mlpScratchBuf);
+    int action;
+    mlpArgmax(mlpLogits, NUM_ACTIONS, 1, &action);
+    autopilotMicros += (millisSinceLaunch() - start) * 1000.0;
+    ++autopilotDecisions;
+
+    switch (action) {
+        case ACT_LEFT:       specialKeyboard(GLUT_KEY_LEFT, 0, 0);  break;
+        case ACT_RIGHT:      specialKeyboard(GLUT_KEY_RIGHT, 0, 0); break;
+        case ACT_SCORE_X2:   keyboard('e', 0, 0); break;
+        case ACT_SLOW_HALF:  keyboard('r', 0, 0); break;
+        case ACT_INVINCIBLE: keyboard('t', 0, 0); break;
+        default: break;
+    }
+}
+
+void attractStart(int value) {
+    (void)value;
+    attractPending = false;
+    if (!autopilotOn || gameState == STATE_PLAYING || gameState == STATE_CRASHED)
+        return;
+    currentCharacter = (CharacterType)(rand() % 3);
+    resetGame();
+    setGameState(STATE_PLAYING);
+}
+
+// a new run in a while, if the autopilot is on and nothing is running
+void attractSchedule() {
+    if (!autopilotOn || attractPending || raceMode || spectating || stressMode)
+        return;
+    if (gameState == STATE_PLAYING || gameState == STATE_CRASHED)
+        return;
+    attractPending = true;
+    glutTimerFunc(ATTRACT_DELAY_MS, attractStart, 0);
+}
+
+// ------------- RECORDING -------------
+// The row for the tick just run: the snapshot taken after the one before
+// (what was on screen while the inputs came in), the inputs, and how it
+// turned out. Then the snapshot for the next row.
+void recordTick(float dt) {
+    double start = millisSinceLaunch();
+    if (recordHaveObs && recorderBegin(recorder)) {
+        int action = ACT_STAY;
+        if (recordObs[OBS_POWERUP_OFFERED] > 0.0f && activePowerup != PWR_NONE)
+            action = ACT_SCORE_X2 + (activePowerup - PWR_SCORE_X2);
+        else if (playerLane < recordLane)
+            action = ACT_LEFT;
+        else if (playerLane > recordLane)
+            action = ACT_RIGHT;
+
+        recorderU32(recorder, REC_COL_RUN,     recordRun);
+        recorderU32(recorder, REC_COL_TICK,    recordTickIndex++);
+        recorderF32(recorder, REC_COL_TIME,    recordTime);
+        recorderF32(recorder, REC_COL_DT,      dt);
+        recorderU32(recorder, REC_COL_SCORE,   (uint32_t)score);
+        recorderU8 (recorder, REC_COL_ACTION,  (uint8_t)action);
+        recorderU8 (recorder, REC_COL_KEYS,    (uint8_t)recordKeys);
+        recorderF32(recorder, REC_COL_MOUSE_X, recordMouseX);
+        recorderU8 (recorder, REC_COL_DRIVER,  autopilotOn ? (mlpPath ? 2 : 1) : 0);
+        recorderU8 (recorder, REC_COL_DONE,    gameState != STATE_PLAYING);
+        for (int k = 0; k < vecEnvObsSize(laneSim->lanes); ++k)
+            recorderF32(recorder, REC_COL_OBS + k, recordObs[k]);
+        recorderEnd(recorder);
+    }
+
+    recordHaveObs = gameState == STATE_PLAYING;
+    if (recordHaveObs) {
+        gameObservation(recordObs);
+        recordLane = playerLane;
+        recordTime = elapsedTime;
+    }
+    recordKeys   = 0;
+    recordMouseX = -1.0f;
+
+    recordMicros += (millisSinceLaunch() - start) * 1000.0;
+    ++recordRows;
+}
+
+void recordClose() {
+    if (!recording) return;
+    recording = false;
+    RecorderStats st = recorderClose(recorder);
+    printf("record: %s, %llu rows (%llu dropped), %.1f MB -> %.1f MB\n",
+           recordPath, (unsigned long long)st.rows, (unsigned long long)st.dropped,
+           st.rawBytes / 1e6, st.fileBytes / 1e6);
+}
+
 // ------------- UPDATE -------------
 void update(int value) {
     (void)value;
@@ -1455,14 +3303,36 @@ void update(int value) {
     if (dt < 0.0f) dt = 0.0f;
     lastTimeMs = currentTimeMs;
 
-    if (gameState == STATE_PLAYING) {
+    if (spectating) {
+        spectateUpdate(dt);
+    } else if (gameState == STATE_PLAYING && stressMode) {
+        stressTick(dt);
+    } else if (gameState == STATE_PLAYING && raceMode) {
+        raceUpdate(dt);
+    } else if (gameState == STATE_CRASHED) {
+        // the world stands still while the crash burns out; a race keeps
+        // sending, the peer may still need our last inputs
+        ARENA_NO_HEAP_BEGIN();
+        if (raceMode)
+            netSync(raceSession, millisSinceLaunch());
+        particlesUpdate(particles, dt);
+        crashTimer -= dt;
+        if (crashTimer <= 0.0f)
+            setGameState(STATE_GAMEOVER);
+        ARENA_NO_HEAP_END();
+    } else if (gameState == STATE_PLAYING) {
+        if (autopilotOn && mlpPath)
+            mlpTick();
+        else if (autopilotOn)
+            autopilotTick(dt);
+
+        // the tick works on session memory only (see arena.h)
+        ARENA_NO_HEAP_BEGIN();
         elapsedTime += dt;
 
         // ---------- HEART/SHIELD SPAWN (every 20..40 seconds) ----------
-        if (!heartPickup.active && elapsedTime >= nextHeartSpawnTime) {
-            heartPickup.active = true;
-            heartPickup.lane   = rand() % NUM_LANES;
-            heartPickup.z      = -80.0f;  // far ahead
+        if (elapsedTime >= nextHeartSpawnTime) {
+            spawnPickup(KIND_SHIELD);
 
             // schedule next spawn between 20 and 40 seconds from now
             float interval = 20.0f + (float)(rand() % 21); // 20..40
@@ -1487,14 +3357,11 @@ void update(int value) {
 
         // ---------- ANIMATIONS ----------
         animTime += dt;
-        carBob   = 0.12f * sinf(animTime * 12.0f);
-        legSwing = 40.0f  * sinf(animTime * 10.0f);
 
         // road treadmill offset
-        float stripeSpacing = 6.0f;
         roadOffset += gameSpeed * dt;
-        if (roadOffset > stripeSpacing)
-            roadOffset = fmod(roadOffset, stripeSpacing);
+        if (roadOffset > STRIPE_SPACING)
+            roadOffset = fmod(roadOffset, STRIPE_SPACING);
 
         // ---------- SCORE (interval halves every 30s) ----------
         int level = (int)(elapsedTime / 30.0f);
@@ -1525,21 +3392,26 @@ void update(int value) {
             lastSpawnIncreaseTime += 30.0f;
         }
 
-        // ---------- MOVE OBSTACLES ----------
-        for (int i = 0; i < MAX_OBS; ++i) {
-            if (!obstacles[i].active) continue;
-            obstacles[i].z += gameSpeed * dt;
-            if (obstacles[i].z > 25.0f)
-                obstacles[i].active = false;
-        }
+        // ---------- MOVE ENTITIES + FIND HITS ----------
+        // small grace period so we don't lose multiple shields instantly
+        bool recentlyHit = (elapsedTime - lastShieldHitTime < 0.4f);
+        bool canBeHurt   = activePowerup != PWR_INVINCIBLE && !recentlyHit;
 
-        // ---------- MOVE SHIELD PICKUP ----------
-        if (heartPickup.active) {
-            heartPickup.z += gameSpeed * dt;
-            if (heartPickup.z > 25.0f) {
-                heartPickup.active = false; // went past player
-            }
-        }
+        LaneStep step;
+        step.dz          = gameSpeed * dt;
+        step.despawnZ    = ENTITY_DESPAWN_Z;   // went past player
+        step.recycleSpan = 0.0f;
+        step.playerLane  = playerLane;
+        step.hitFlags    = ENTITY_COLLECTIBLE | (canBeHurt ? ENTITY_HARMFUL : 0);
+        entityHitRange(obstacleLength, step.hitMinZ[ARCH_OBSTACLE], step.hitMaxZ[ARCH_OBSTACLE]);
+        entityHitRange(PICKUP_LENGTH,  step.hitMinZ[ARCH_PICKUP],   step.hitMaxZ[ARCH_PICKUP]);
+
+        const int MAX_HITS = 16;
+        LaneHit hits[MAX_HITS];
+        int hitCount = laneSim->step(entities, step, hits, MAX_HITS);   // resolved below
+        spectateTravel += step.dz;
+
+        particlesUpdate(particles, dt);
 
         // ---------- SPAWN NEW OBSTACLES ----------
         spawnTimer -= dt;
@@ -1548,54 +3420,64 @@ void update(int value) {
             spawnTimer = spawnInterval;
         }
 
-        // ---------- SHIELD PICKUP COLLISION ----------
-        if (heartPickup.active && heartPickup.lane == playerLane) {
-            float halfPlayer = playerSize * 0.5f;
-            float pickupLen  = 1.5f;
-            float halfPick   = pickupLen * 0.5f;
-
-            float minZ = playerZ - halfPlayer - halfPick;
-            float maxZ = playerZ + halfPlayer + halfPick;
-
-            if (heartPickup.z >= minZ && heartPickup.z <= maxZ) {
+        // ---------- COLLISIONS ----------
+        // pickups are all collected, and come first (LANE_HIT_ORDER) so a
+        // shield picked up this tick can absorb a hit; only the first
+        // harmful hit counts
+        bool hurt = false;
+        for (int i = 0; i < hitCount; ++i) {
+            const EntityRef &ref = entityRef(entities, hits[i].id);
+            int arch = ref.arch, index = ref.index;
+            const EntityChunk *c = entityChunk(entities, arch, index);
+            int   slot  = index & (ENTITY_CHUNK_SIZE - 1);
+            int   flags = c->flags[slot];
+            float hitX  = laneSim->laneX[c->lane[slot]];
+            float hitZ  = c->z[slot];
+
+            if (flags & ENTITY_COLLECTIBLE) {
                 if (heartCount < MAX_HEARTS) {
                     heartCount++;
                 }
-                heartPickup.active = false;
-            }
-        }
-
-        // ---------- OBSTACLE COLLISION (USE SHIELDS) ----------
-        if (activePowerup != PWR_INVINCIBLE) {
-            // small grace period so we don't lose multiple shields instantly
-            bool recentlyHit = (elapsedTime - lastShieldHitTime < 0.4f);
-
-            if (!recentlyHit) {
-                for (int i = 0; i < MAX_OBS; ++i) {
-                    if (!obstacles[i].active) continue;
-
-                    if (checkCollision(obstacles[i])) {
-
-                        if (heartCount > 0) {
-                            // use one shield instead of dying
-                            heartCount--;
-                            lastShieldHitTime = elapsedTime;  // remember when we got hit
-                            obstacles[i].active = false;
-                            // optional: small effect here
-                        } else {
-                            // no shields -> game over
-                            gameState = STATE_GAMEOVER;
-                        }
-
-                        break;  // stop checking more obstacles this frame
-                    }
+                entityDestroy(entities, arch, index);
+                effectPickup(hitX, hitZ);
+                audioPlay(SFX_SHIELD_PICKUP);
+            } else if ((flags & ENTITY_HARMFUL) && !hurt) {
+                hurt = true;
+                if (heartCount > 0) {
+                    // use one shield instead of dying
+                    heartCount--;
+                    lastShieldHitTime = elapsedTime;  // remember when we got hit
+                    entityDestroy(entities, arch, index);
+                    effectShieldBreak(hitX, hitZ);
+                    audioPlay(SFX_COLLISION, 0.7f);
+                } else {
+                    // no shields -> crash, then game over
+                    effectCrash(playerX, playerY, playerZ);
+                    audioPlay(SFX_COLLISION);
+                    crashTimer = CRASH_SECONDS;
+                    setGameState(STATE_CRASHED);
                 }
             }
         }
+
+        // rows go into buffers set aside at open, no allocation here
+        if (recording)
+            recordTick(dt);
+        ARENA_NO_HEAP_END();
     }
 
-    glutPostRedisplay();
-    glutTimerFunc(16, update, 0);
+    // after the tick, outside the no-heap section: viewers come and go here
+    if (spectateServing)
+        spectatePublish();
+    if (shmExporting)
+        shmPublish();
+
+    if (windowVisible)
+        glutPostRedisplay();
+    if (needsGameLoop())
+        glutTimerFunc(16, update, 0);
+    else
+        loopRunning = false;
 }
 
 
@@ -1606,15 +3488,32 @@ void keyboard(unsigned char key, int x, int y) {
 
     // ESC always quits
     if (key == 27) {
+#ifdef ARENA_CHECKS
+        arenaReportSession(sessionArena);
+#endif
         exit(0);
     }
 
-    // SPACE on game over -> back to character select
-    if (gameState == STATE_GAMEOVER && key == ' ') {
-        gameState = STATE_CHAR_SELECT;
+    // A: autopilot on / off, in a run or (attract mode) in the menus
+    if ((key == 'a' || key == 'A') && !raceMode && !spectating) {
+        autopilotOn = !autopilotOn;
+        attractSchedule();
+        requestRedraw();
+        return;
+    }
+
+    // SPACE on game over -> back to character select (a race is one-off)
+    if (gameState == STATE_GAMEOVER && key == ' ' && !raceMode && !spectating) {
+        setGameState(STATE_CHAR_SELECT);
         return;
     }
 
+    if (gameState == STATE_PLAYING) {
+        if (key == 'e' || key == 'E') recordKeys |= REC_KEY_E;
+        if (key == 'r' || key == 'R') recordKeys |= REC_KEY_R;
+        if (key == 't' || key == 'T') recordKeys |= REC_KEY_T;
+    }
+
     // -------- POWERUP KEYBINDS (E, R, T) --------
     if (gameState == STATE_PLAYING &&
         choosingPowerup &&
@@ -1634,6 +3533,7 @@ void keyboard(unsigned char key, int x, int y) {
             activePowerup   = chosen;
             choosingPowerup = false;
             powerupTimer    = 0.0f;
+            audioPlay(SFX_POWERUP);
             // cooldown is handled when it expires in update()
             return;
         }
@@ -1643,15 +3543,24 @@ void keyboard(unsigned char key, int x, int y) {
 
 void specialKeyboard(int key, int x, int y) {
     (void)x; (void)y;
-    if (gameState != STATE_PLAYING) return;
+
+    if (key == GLUT_KEY_F3) {
+        showProfiler = !showProfiler;
+        requestRedraw();
+        return;
+    }
+
+    if (gameState != STATE_PLAYING || spectating) return;
 
     if (key == GLUT_KEY_LEFT) {
+        recordKeys |= REC_KEY_LEFT;
         if (playerLane > 0) {
             playerLane--;
             recalcPlayerX();
         }
     } else if (key == GLUT_KEY_RIGHT) {
-        if (playerLane < NUM_LANES - 1) {
+        recordKeys |= REC_KEY_RIGHT;
+        if (playerLane < laneSim->lanes - 1) {
             playerLane++;
             recalcPlayerX();
         }
@@ -1667,6 +3576,8 @@ void mouse(int button, int state, int x, int y)
     int mx = (int)gx;
     int my = (int)(WINDOW_HEIGHT - gy); // flip Y for game coords
 
+    if (spectating) return;             // the stream has the controls
+
     // ----------------- PLAYING STATE (lanes + powerups) -----------------
     if (gameState == STATE_PLAYING) {
         if (button == GLUT_LEFT_BUTTON && state == GLUT_DOWN) {
@@ -1699,6 +3610,7 @@ void mouse(int button, int state, int x, int y)
                         activePowerup   = chosen;
                         choosingPowerup = false;
                         powerupTimer    = 0.0f;
+                        audioPlay(SFX_POWERUP);
                         return;   // do NOT start dragging if we clicked a powerup
                     }
                 }
@@ -1734,7 +3646,7 @@ void mouse(int button, int state, int x, int y)
         // START -> character select
         if (mx >= startX && mx <= startX + btnW &&
             my >= startY && my <= startY + btnH) {
-            gameState = STATE_CHAR_SELECT;
+            setGameState(STATE_CHAR_SELECT);
             return;
         }
 
@@ -1767,7 +3679,7 @@ void mouse(int button, int state, int x, int y)
             my >= cardY  && my <= cardY  + cardH) {
             currentCharacter = CHAR_CAR;
             resetGame();
-            gameState = STATE_PLAYING;
+            setGameState(STATE_PLAYING);
             return;
         }
         // DINO
@@ -1775,7 +3687,7 @@ void mouse(int button, int state, int x, int y)
             my >= cardY  && my <= cardY  + cardH) {
             currentCharacter = CHAR_DINO;
             resetGame();
-            gameState = STATE_PLAYING;
+            setGameState(STATE_PLAYING);
             return;
         }
         // CAT
@@ -1783,7 +3695,7 @@ void mouse(int button, int state, int x, int y)
             my >= cardY  && my <= cardY  + cardH) {
             currentCharacter = CHAR_CAT;
             resetGame();
-            gameState = STATE_PLAYING;
+            setGameState(STATE_PLAYING);
             return;
         }
 
@@ -1810,7 +3722,7 @@ void mouse(int button, int state, int x, int y)
         if (mx >= restartX && mx <= restartX + btnW &&
             my >= restartY && my <= restartY + btnH) {
             resetGame();
-            gameState = STATE_CHAR_SELECT;   // or STATE_PLAYING if you prefer
+            setGameState(STATE_CHAR_SELECT);   // or STATE_PLAYING if you prefer
             return;
         }
 
@@ -1827,18 +3739,20 @@ void mouse(int button, int state, int x, int y)
 
 void mouseMotion(int x, int y) {
     (void)y;
-    if (!isDragging || gameState != STATE_PLAYING) return;
+    if (!isDragging || gameState != STATE_PLAYING || spectating) return;
 
     // scale real window pixels -> virtual 800 width
     float gx = (float)x * (float)WINDOW_WIDTH / (float)currentWindowWidth;
 
-    // map mouse X across *virtual* window to lane index 0..NUM_LANES-1
+    // map mouse X across *virtual* window to lane index 0..lanes-1
     float fx = gx / (float)WINDOW_WIDTH;   // 0..1
-    int lane = (int)(fx * NUM_LANES);
+    int lane = (int)(fx * laneSim->lanes);
 
     if (lane < 0) lane = 0;
-    if (lane >= NUM_LANES) lane = NUM_LANES - 1;
+    if (lane >= laneSim->lanes) lane = laneSim->lanes - 1;
 
+    recordKeys  |= REC_KEY_DRAG;
+    recordMouseX = fx;
     playerLane = lane;
     recalcPlayerX();
 }
@@ -1855,29 +3769,219 @@ void reshape(int w, int h) {
 
     // Keep using the same virtual 800x600 world
     // (so your HUD / buttons math using WINDOW_WIDTH/HEIGHT stays valid)
-    glMatrixMode(GL_PROJECTION);
-    glLoadIdentity();
-    gluOrtho2D(0, WINDOW_WIDTH, 0, WINDOW_HEIGHT);
-    glMatrixMode(GL_MODELVIEW);
-    glLoadIdentity();
+    set2D();
 }
 
 // ------------- MAIN -------------
 int main(int argc, char **argv) {
     srand((unsigned int)time(NULL));
 
+    // --audio-bench [seconds] [out.wav]: time the mixer headless and exit
+    if (argc > 1 && strcmp(argv[1], "--audio-bench") == 0) {
+        float seconds = (argc > 2) ? (float)atof(argv[2]) : 60.0f;
+        return audioRunBenchmark("assets/soundtrack.wav",
+                                 (argc > 3) ? argv[3] : NULL, seconds);
+    }
+
+    // --lane-bench [ticks]: time the lane kernels headless and exit
+    if (argc > 1 && strcmp(argv[1], "--lane-bench") == 0)
+        return lanesRunBenchmark((argc > 2) ? atoi(argv[2]) : 200000);
+
+    // --particle-bench [count]: time the particle kernel headless and exit
+    if (argc > 1 && strcmp(argv[1], "--particle-bench") == 0)
+        return particlesRunBenchmark((argc > 2) ? atoi(argv[2]) : 100000, 600);
+
+    // --spectate-bench [ticks]: encode / decode the spectator stream headless
+    if (argc > 1 && strcmp(argv[1], "--spectate-bench") == 0)
+        return specRunBenchmark((argc > 2) ? atoi(argv[2]) : 3600);
+
+    // --env-bench [runs] [steps]: step the batched bot environment headless
+    if (argc > 1 && strcmp(argv[1], "--env-bench") == 0)
+        return vecEnvRunBenchmark((argc > 2) ? atoi(argv[2]) : 4096,
+                                  (argc > 3) ? atoi(argv[3]) : 4000);
+
+    // --autopilot-bench [runs] [steps]: the lane planner driving batched runs
+    if (argc > 1 && strcmp(argv[1], "--autopilot-bench") == 0)
+        return autopilotRunBenchmark((argc > 2) ? atoi(argv[2]) : 256,
+                                     (argc > 3) ? atoi(argv[3]) : 20000);
+
+    // --mlp-bench [weights] [runs]: policy net inference, kernels and batching
+    if (argc > 1 && strcmp(argv[1], "--mlp-bench") == 0)
+        return mlpRunBenchmark((argc > 2) ? argv[2] : NULL,
+                               (argc > 3) ? atoi(argv[3]) : 4096);
+
+    // --record-bench [rows] [file]: record a planner run, read it back
+    if (argc > 1 && strcmp(argv[1], "--record-bench") == 0)
+        return recorderRunBenchmark((argc > 2) ? atoi(argv[2]) : 1000000,
+                                    (argc > 3) ? argv[3] : NULL);
+
+    // --bot-server PATH: serve batched environments on a Unix socket
+    // --bot-load PATH [seconds]: load-test a running bot server
+    if (argc > 2 && strcmp(argv[1], "--bot-server") == 0)
+        return botServerRun(argv[2]);
+    if (argc > 2 && strcmp(argv[1], "--bot-load") == 0)
+        return botLoadRun(argv[2], (argc > 3) ? atof(argv[3]) : 1.0);
+
+    // --net-test [ticks] [delay ms] [jitter ms] [loss %]: two rollback
+    // peers on localhost through the shim, headless
+    if (argc > 1 && strcmp(argv[1], "--net-test") == 0) {
+        NetShim shim = { (argc > 3) ? atoi(argv[3]) : 60,
+                         (argc > 4) ? atoi(argv[4]) : 20,
+                         (argc > 5) ? atoi(argv[5]) : 10 };
+        return netRunLoopbackTest((argc > 2) ? atoi(argv[2]) : 3600, shim);
+    }
+
+    // --lanes N: 3, 5, 7 or 9 lanes
+    // --obstacles N: obstacle capacity (default 40)
+    // --stress: ramp to 10k, 100k and 1M obstacles, report, exit
+    // --race P LOCALPORT HOST:PORT: head-to-head as player 0 or 1
+    //   --seed N, --net-delay MS, --net-jitter MS, --net-loss PCT
+    // --spectate-serve ADDRESS: stream the run to viewers
+    // --spectate ADDRESS: watch a run being streamed
+    // --shm-export NAME: publish every tick in shared memory (shmstate.h)
+    // --autopilot: the lane planner plays, attract mode in the menus
+    // --mlp FILE: as --autopilot, with a policy net (mlp.h) playing
+    // --record FILE: record every tick of single-player runs (recorder.h)
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--lanes") == 0 && i + 1 < argc)
+            laneSim = &laneOps(atoi(argv[++i]));
+        else if (strcmp(argv[i], "--obstacles") == 0 && i + 1 < argc)
+            maxObstacles = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--stress") == 0)
+            stressMode = true;
+        else if (strcmp(argv[i], "--race") == 0 && i + 3 < argc) {
+            raceMode      = true;
+            racePlayer    = atoi(argv[++i]) ? 1 : 0;
+            raceLocalPort = atoi(argv[++i]);
+            const char *peer  = argv[++i];
+            const char *colon = strrchr(peer, ':');
+            size_t hostLen = colon ? (size_t)(colon - peer) : strlen(peer);
+            if (hostLen >= sizeof(racePeerHost)) hostLen = sizeof(racePeerHost) - 1;
+            memcpy(racePeerHost, peer, hostLen);
+            racePeerHost[hostLen] = '\0';
+            racePeerPort = colon ? atoi(colon + 1) : 0;
+        }
+        else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc)
+            raceSeed = (unsigned)atoi(argv[++i]);
+        else if (strcmp(argv[i], "--net-delay") == 0 && i + 1 < argc)
+            raceShim.delayMs = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--net-jitter") == 0 && i + 1 < argc)
+            raceShim.jitterMs = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--net-loss") == 0 && i + 1 < argc)
+            raceShim.lossPercent = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--spectate-serve") == 0 && i + 1 < argc) {
+            spectateServing = true;
+            spectateAddress = argv[++i];
+        }
+        else if (strcmp(argv[i], "--spectate") == 0 && i + 1 < argc) {
+            spectating      = true;
+            spectateAddress = argv[++i];
+        }
+        else if (strcmp(argv[i], "--shm-export") == 0 && i + 1 < argc) {
+            shmExporting  = true;
+            shmExportName = argv[++i];
+        }
+        else if (strcmp(argv[i], "--autopilot") == 0)
+            autopilotOn = true;
+        else if (strcmp(argv[i], "--mlp") == 0 && i + 1 < argc) {
+            mlpPath     = argv[++i];
+            autopilotOn = true;
+        }
+        else if (strcmp(argv[i], "--record") == 0 && i + 1 < argc) {
+            recording  = true;
+            recordPath = argv[++i];
+        }
+    }
+    if (spectateServing && (raceMode || stressMode || spectating)) {
+        fprintf(stderr, "--spectate-serve streams single-player runs only\n");
+        spectateServing = false;
+    }
+    if (spectating && (raceMode || stressMode)) {
+        fprintf(stderr, "--spectate can't be combined with --race or --stress\n");
+        return 1;
+    }
+    if (maxObstacles < 1) maxObstacles = DEFAULT_MAX_OBS;
+    if (stressMode)
+        maxObstacles = STRESS_COUNTS[NUM_STRESS_STEPS - 1];
+
     glutInit(&argc, argv);
     glutInitDisplayMode(GLUT_DOUBLE | GLUT_RGBA | GLUT_DEPTH);
     glutInitWindowSize(WINDOW_WIDTH, WINDOW_HEIGHT);
     glutCreateWindow("Avoid the Obstacles - 3D Runner");
 
-    PlaySound(TEXT("assets/soundtrack.wav"),
-          NULL,
-          SND_FILENAME | SND_ASYNC | SND_LOOP);
+    loadBundle();
+    audioInit(createDefaultAudioBackend());
+    startMusic();
 
     glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
-
+    initRunwayMesh();
+    initObstacleBatch();
+    loadModels();
+    initWalkCycles();
+    initScene();
+
+    if (!arenaInit(sessionArena, sessionArenaBytes()))
+        return 1;
     resetGame();
+    if (stressMode)
+        gameState = STATE_PLAYING;
+    if (raceMode) {
+        if (!raceStart())
+            return 1;
+        gameState = STATE_PLAYING;
+    }
+    if (spectateServing && !specServerOpen(spectateServer, spectateAddress))
+        return 1;
+    if (spectating) {
+        if (!specViewerOpen(spectateViewer, spectateAddress))
+            return 1;
+        gameState = STATE_PLAYING;
+    }
+    if (shmExporting) {
+        int maxObjects = std::min(maxObstacles + MAX_PICKUPS, SHM_EXPORT_MAX_OBJECTS);
+        if (!shmExportOpen(shmExportName, maxObjects))
+            return 1;
+        atexit(shmExportClose);             // readers find it gone, not stale
+        shmPublish();
+    }
+    if (mlpPath) {
+        if (!mlpLoad(mlpNet, mlpPath))
+            return 1;
+        if (mlpNet.inputs != vecEnvObsSize(laneSim->lanes) || mlpNet.outputs < NUM_ACTIONS) {
+            fprintf(stderr, "mlp: %s is %d -> %d, %d lanes need %d inputs and %d actions\n",
+                    mlpPath, mlpNet.inputs, mlpNet.outputs, laneSim->lanes,
+                    vecEnvObsSize(laneSim->lanes), (int)NUM_ACTIONS);
+            return 1;
+        }
+        if (!arenaInit(mlpArena, mlpScratchBytes(mlpNet, 1) +
+                                 sizeof(float) * (size_t)(mlpNet.inputs + mlpNet.outputs) + 64))
+            return 1;
+        mlpScratchBuf = mlpScratch(mlpArena, mlpNet, 1);
+        mlpObs        = arenaNew<float>(mlpArena, mlpNet.inputs);
+        mlpLogits     = arenaNew<float>(mlpArena, mlpNet.outputs);
+        printf("mlp: %s, %s kernel\n", mlpPath, mlpKernelName(mlpNet.kernel));
+    }
+    if (recording) {
+        const int obsSize = vecEnvObsSize(laneSim->lanes);
+        RecorderColumn columns[REC_COL_OBS + VECENV_MAX_OBS] = {
+            { "run",     REC_U32 }, { "tick",    REC_U32 }, { "time",   REC_F32 },
+            { "dt",      REC_F32 }, { "score",   REC_U32 }, { "action", REC_U8  },
+            { "keys",    REC_U8  }, { "mouse_x", REC_F32 }, { "driver", REC_U8  },
+            { "done",    REC_U8  }
+        };
+        char names[VECENV_MAX_OBS][REC_NAME_LEN];
+        for (int k = 0; k < obsSize; ++k) {
+            sprintf(names[k], "obs_%d", k);
+            columns[REC_COL_OBS + k].name = names[k];
+            columns[REC_COL_OBS + k].type = REC_F32;
+        }
+        char description[64];
+        sprintf(description, "runner3d, %d lanes", laneSim->lanes);
+        if (!recorderOpen(recorder, recordPath, columns, REC_COL_OBS + obsSize, description))
+            return 1;
+        atexit(recordClose);                // the index and counts go in last
+    }
+    attractSchedule();                      // --autopilot from the menu
     lastTimeMs = glutGet(GLUT_ELAPSED_TIME);
 
     glutDisplayFunc(display);
@@ -1886,7 +3990,8 @@ int main(int argc, char **argv) {
     glutSpecialFunc(specialKeyboard);
     glutMouseFunc(mouse);
     glutMotionFunc(mouseMotion);
-    glutTimerFunc(16, update, 0);
+    glutVisibilityFunc(visibility);
+    startGameLoop();
 
     glutMainLoop();
     return 0;
@@ -0,0 +1,58 @@
+// Minimal 4x4 matrix helpers. Matrices are column-major float[16], the
+// layout glLoadMatrixf / glMultMatrixf take.
+#ifndef MAT4_H
+#define MAT4_H
+
+#include <math.h>
+#include <string.h>
+
+inline void mat4Identity(float m[16]) {
+    memset(m, 0, 16 * sizeof(float));
+    m[0] = m[5] = m[10] = m[15] = 1.0f;
+}
+
+// out = a * b (b applied first); out may alias a or b
+inline void mat4Multiply(const float a[16], const float b[16], float out[16]) {
+    float r[16];
+    for (int c = 0; c < 4; ++c)
+        for (int row = 0; row < 4; ++row)
+            r[c * 4 + row] = a[row]      * b[c * 4]     + a[4 + row]  * b[c * 4 + 1] +
+                             a[8 + row]  * b[c * 4 + 2] + a[12 + row] * b[c * 4 + 3];
+    memcpy(out, r, sizeof(r));
+}
+
+inline void mat4Translation(float m[16], float x, float y, float z) {
+    mat4Identity(m);
+    m[12] = x; m[13] = y; m[14] = z;
+}
+
+inline void mat4Scaling(float m[16], float x, float y, float z) {
+    mat4Identity(m);
+    m[0] = x; m[5] = y; m[10] = z;
+}
+
+// same as glRotatef(degrees, 1, 0, 0)
+inline void mat4RotationX(float m[16], float degrees) {
+    float a = degrees * 3.14159265f / 180.0f;
+    float c = cosf(a), s = sinf(a);
+    mat4Identity(m);
+    m[5] = c;  m[9]  = -s;
+    m[6] = s;  m[10] =  c;
+}
+
+// same as glRotatef(degrees, 0, 1, 0)
+inline void mat4RotationY(float m[16], float degrees) {
+    float a = degrees * 3.14159265f / 180.0f;
+    float c = cosf(a), s = sinf(a);
+    mat4Identity(m);
+    m[0] =  c;  m[8]  = s;
+    m[2] = -s;  m[10] = c;
+}
+
+// linear blend, for nearby keyframes
+inline void mat4Lerp(const float a[16], const float b[16], float t, float out[16]) {
+    for (int i = 0; i < 16; ++i)
+        out[i] = a[i] + (b[i] - a[i]) * t;
+}
+
+#endif // MAT4_H
@@ -0,0 +1,182 @@
+// Static GPU meshes, see mesh.h.
+#include "mesh.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <stddef.h>
+
+#ifndef APIENTRY
+#define APIENTRY
+#endif
+#ifndef GL_ARRAY_BUFFER
+#define GL_ARRAY_BUFFER         0x8892
+#define GL_ELEMENT_ARRAY_BUFFER 0x8893
+#define GL_STATIC_DRAW          0x88E4
+#endif
+
+typedef ptrdiff_t GLsizeiptrValue;
+
+typedef void (APIENTRY *GenBuffersFn)(GLsizei, GLuint *);
+typedef void (APIENTRY *DeleteBuffersFn)(GLsizei, const GLuint *);
+typedef void (APIENTRY *BindBufferFn)(GLenum, GLuint);
+typedef void (APIENTRY *BufferDataFn)(GLenum, GLsizeiptrValue, const void *, GLenum);
+
+static GenBuffersFn    pGenBuffers    = NULL;
+static DeleteBuffersFn pDeleteBuffers = NULL;
+static BindBufferFn    pBindBuffer    = NULL;
+static BufferDataFn    pBufferData    = NULL;
+
+static bool haveBuffers() {
+    return pGenBuffers && pDeleteBuffers && pBindBuffer && pBufferData;
+}
+
+void meshInitBuffers(void *(*getProcAddress)(const char *name)) {
+    // core GL 1.5 names first, then the ARB ones
+    static const char *names[4][2] = {
+        { "glGenBuffers",    "glGenBuffersARB"    },
+        { "glDeleteBuffers", "glDeleteBuffersARB" },
+        { "glBindBuffer",    "glBindBufferARB"    },
+        { "glBufferData",    "glBufferDataARB"    }
+    };
+    void *procs[4];
+    for (int i = 0; i < 4; ++i) {
+        procs[i] = getProcAddress(names[i][0]);
+        if (procs[i] == NULL) procs[i] = getProcAddress(names[i][1]);
+    }
+    pGenBuffers    = (GenBuffersFn)procs[0];
+    pDeleteBuffers = (DeleteBuffersFn)procs[1];
+    pBindBuffer    = (BindBufferFn)procs[2];
+    pBufferData    = (BufferDataFn)procs[3];
+}
+
+// ------------- UPLOAD -------------
+// Array pointers are either offsets into the bound VBO or real addresses
+// (display list compile); `base` is 0 for the former.
+static void setArrays(const unsigned char *base) {
+    glEnableClientState(GL_VERTEX_ARRAY);
+    glEnableClientState(GL_NORMAL_ARRAY);
+    glEnableClientState(GL_COLOR_ARRAY);
+    glVertexPointer(3, GL_FLOAT, sizeof(MeshVertex), base + offsetof(MeshVertex, pos));
+    glNormalPointer(GL_FLOAT, sizeof(MeshVertex), base + offsetof(MeshVertex, normal));
+    glColorPointer(4, GL_UNSIGNED_BYTE, sizeof(MeshVertex), base + offsetof(MeshVertex, color));
+}
+
+static void clearArrays() {
+    glDisableClientState(GL_COLOR_ARRAY);
+    glDisableClientState(GL_NORMAL_ARRAY);
+    glDisableClientState(GL_VERTEX_ARRAY);
+}
+
+static bool upload(Mesh &mesh, const MeshData &data) {
+    meshFree(mesh);
+
+    const MeshFileHeader *h = data.header;
+    mesh.partCount   = (int)h->partCount;
+    mesh.vertexCount = (int)h->vertexCount;
+    memcpy(mesh.parts, data.parts, h->partCount * sizeof(MeshPart));
+
+    if (haveBuffers()) {
+        GLuint ids[2];
+        pGenBuffers(2, ids);
+        mesh.vbo = ids[0];
+        mesh.ibo = ids[1];
+        pBindBuffer(GL_ARRAY_BUFFER, mesh.vbo);
+        pBufferData(GL_ARRAY_BUFFER, h->vertexCount * sizeof(MeshVertex),
+                    data.vertices, GL_STATIC_DRAW);
+        pBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh.ibo);
+        pBufferData(GL_ELEMENT_ARRAY_BUFFER, h->indexCount * sizeof(uint16_t),
+                    data.indices, GL_STATIC_DRAW);
+        pBindBuffer(GL_ARRAY_BUFFER, 0);
+        pBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+    } else {
+        // GL 1.1: arrays are copied into the lists at compile time
+        mesh.lists = glGenLists(mesh.partCount);
+        setArrays((const unsigned char *)data.vertices);
+        for (int i = 0; i < mesh.partCount; ++i) {
+            glNewList(mesh.lists + i, GL_COMPILE);
+            glDrawElements(GL_TRIANGLES, (GLsizei)mesh.parts[i].indexCount,
+                           GL_UNSIGNED_SHORT, data.indices + mesh.parts[i].firstIndex);
+            glEndList();
+        }
+        clearArrays();
+    }
+
+    if (glGetError() != GL_NO_ERROR) {
+        fprintf(stderr, "mesh: upload failed\n");
+        meshFree(mesh);
+        return false;
+    }
+    return true;
+}
+
+bool meshLoad(Mesh &mesh, const char *objPath) {
+    MeshData data;
+    bool parsed = false;
+    if (!meshLoadCached(objPath, data, &parsed)) return false;
+    return upload(mesh, data);
+}
+
+bool meshLoadBinary(Mesh &mesh, const void *bytes, size_t size) {
+    MeshData data;
+    if (!meshFromBinary(bytes, size, data)) {
+        fprintf(stderr, "mesh: bad binary mesh\n");
+        return false;
+    }
+    return upload(mesh, data);
+}
+
+void meshFree(Mesh &mesh) {
+    if (mesh.vbo && haveBuffers()) {
+        GLuint ids[2] = { mesh.vbo, mesh.ibo };
+        pDeleteBuffers(2, ids);
+    }
+    if (mesh.lists)
+        glDeleteLists(mesh.lists, mesh.partCount);
+    mesh.vbo = mesh.ibo = mesh.lists = 0;
+    mesh.partCount   = 0;
+    mesh.vertexCount = 0;
+}
+
+// ------------- DRAWING -------------
+bool meshLoaded(const Mesh &mesh) {
+    return mesh.partCount > 0;
+}
+
+int meshFindPart(const Mesh &mesh, const char *name) {
+    for (int i = 0; i < mesh.partCount; ++i)
+        if (strcmp(mesh.parts[i].name, name) == 0) return i;
+    return -1;
+}
+
+static void drawRange(const Mesh &mesh, uint32_t first, uint32_t count) {
+    pBindBuffer(GL_ARRAY_BUFFER, mesh.vbo);
+    pBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh.ibo);
+    setArrays(NULL);
+    glDrawElements(GL_TRIANGLES, (GLsizei)count, GL_UNSIGNED_SHORT,
+                   (const void *)(first * sizeof(uint16_t)));
+    clearArrays();
+    pBindBuffer(GL_ARRAY_BUFFER, 0);
+    pBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+}
+
+void meshDrawPart(const Mesh &mesh, int part) {
+    if (part < 0 || part >= mesh.partCount) return;
+
+    if (mesh.lists)
+        glCallList(mesh.lists + part);
+    else
+        drawRange(mesh, mesh.parts[part].firstIndex, mesh.parts[part].indexCount);
+}
+
+// parts are stored back to back, so the whole mesh is one draw call
+void meshDraw(const Mesh &mesh) {
+    if (mesh.partCount == 0) return;
+
+    if (mesh.lists) {
+        for (int i = 0; i < mesh.partCount; ++i)
+            glCallList(mesh.lists + i);
+    } else {
+        const MeshPart &last = mesh.parts[mesh.partCount - 1];
+        drawRange(mesh, 0, last.firstIndex + last.indexCount);
+    }
+}
@@ -0,0 +1,40 @@
+// Static GPU meshes for the 3D runner.
+//
+// A mesh is uploaded once (vertex + index buffer objects when the driver
+// has them, one display list per part otherwise) and then drawn with a
+// single call per part; no per-vertex work happens on the CPU per frame.
+// Vertex colors come from the mesh, so drawing one changes the current
+// GL color.
+#ifndef MESH_H
+#define MESH_H
+
+#include <GL/glut.h>
+#include "meshfile.h"
+
+struct Mesh {
+    int      partCount;
+    MeshPart parts[MESH_MAX_PARTS];
+    int      vertexCount;
+    GLuint   vbo, ibo;                 // buffer objects, or 0
+    GLuint   lists;                    // first display list (fallback), or 0
+};
+
+// Enables buffer objects if the driver exports them (GL 1.5 or
+// ARB_vertex_buffer_object). Call once after the window exists; without it
+// meshes fall back to display lists.
+void meshInitBuffers(void *(*getProcAddress)(const char *name));
+
+// .obj through its binary cache (see meshLoadCached), or a binary mesh in
+// memory (e.g. from the asset bundle). The source data is not needed after
+// these return.
+bool meshLoad(Mesh &mesh, const char *objPath);
+bool meshLoadBinary(Mesh &mesh, const void *data, size_t size);
+
+void meshFree(Mesh &mesh);
+
+bool meshLoaded(const Mesh &mesh);
+int  meshFindPart(const Mesh &mesh, const char *name);   // -1 if missing
+void meshDrawPart(const Mesh &mesh, int part);
+void meshDraw(const Mesh &mesh);
+
+#endif // MESH_H
@@ -0,0 +1,376 @@
+// OBJ-subset parser and binary mesh cache, see meshfile.h.
+#include "meshfile.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <sys/stat.h>
+#include <map>
+#include <string>
+
+// ------------- BINARY FORM -------------
+static size_t align4(size_t v) {
+    return (v + 3) & ~(size_t)3;
+}
+
+static size_t binarySize(uint32_t parts, uint32_t vertices, uint32_t indices) {
+    return sizeof(MeshFileHeader) + parts * sizeof(MeshPart) +
+           vertices * sizeof(MeshVertex) + align4(indices * sizeof(uint16_t));
+}
+
+size_t meshBinarySize(const MeshData &mesh) {
+    return binarySize(mesh.header->partCount, mesh.header->vertexCount,
+                      mesh.header->indexCount);
+}
+
+// Sets the section pointers after checking that everything is in range.
+static bool bindSections(const void *data, size_t size, MeshData &out) {
+    const unsigned char *p = (const unsigned char *)data;
+    const MeshFileHeader *h = (const MeshFileHeader *)p;
+
+    if (((uintptr_t)p & 3) != 0 || size < sizeof(MeshFileHeader) ||
+        h->magic != MESH_FILE_MAGIC || h->version != MESH_FILE_VERSION ||
+        h->partCount < 1 || h->partCount > (uint32_t)MESH_MAX_PARTS ||
+        h->vertexCount > 65536 || h->indexCount % 3 != 0 ||
+        size < binarySize(h->partCount, h->vertexCount, h->indexCount))
+        return false;
+
+    const MeshPart   *parts    = (const MeshPart *)(h + 1);
+    const MeshVertex *vertices = (const MeshVertex *)(parts + h->partCount);
+    const uint16_t   *indices  = (const uint16_t *)(vertices + h->vertexCount);
+
+    for (uint32_t i = 0; i < h->partCount; ++i) {
+        if (parts[i].firstIndex > h->indexCount ||
+            parts[i].indexCount > h->indexCount - parts[i].firstIndex ||
+            memchr(parts[i].name, 0, MESH_PART_NAME_LEN) == NULL)
+            return false;
+    }
+    for (uint32_t i = 0; i < h->indexCount; ++i)
+        if (indices[i] >= h->vertexCount) return false;
+
+    out.header   = h;
+    out.parts    = parts;
+    out.vertices = vertices;
+    out.indices  = indices;
+    return true;
+}
+
+bool meshFromBinary(const void *data, size_t size, MeshData &out) {
+    out.storage.clear();
+    return bindSections(data, size, out);
+}
+
+// ------------- OBJ PARSER -------------
+struct ObjMaterial {
+    std::string name;
+    uint8_t     color[4];
+};
+
+struct PartBuild {
+    std::string           name;
+    std::vector<uint16_t> indices;
+};
+
+// one output vertex per distinct (position, normal, color)
+struct CornerKey {
+    int      v;
+    int      n;        // normal index, or -1 - face for a flat normal
+    uint32_t color;
+
+    bool operator<(const CornerKey &o) const {
+        if (v != o.v) return v < o.v;
+        if (n != o.n) return n < o.n;
+        return color < o.color;
+    }
+};
+
+static uint8_t toByte(float c) {
+    if (c < 0.0f) c = 0.0f;
+    if (c > 1.0f) c = 1.0f;
+    return (uint8_t)(c * 255.0f + 0.5f);
+}
+
+static uint32_t packColor(const uint8_t c[4]) {
+    return (uint32_t)c[0] | ((uint32_t)c[1] << 8) | ((uint32_t)c[2] << 16) | ((uint32_t)c[3] << 24);
+}
+
+static std::string firstToken(const char *s) {
+    char tok[128];
+    if (sscanf(s, "%127s", tok) != 1) return std::string();
+    return tok;
+}
+
+static void loadMtl(const std::string &path, std::vector<ObjMaterial> &materials) {
+    FILE *f = fopen(path.c_str(), "r");
+    if (f == NULL) {
+        fprintf(stderr, "mesh: can't open %s\n", path.c_str());
+        return;
+    }
+
+    char line[256];
+    while (fgets(line, sizeof(line), f)) {
+        float r, g, b;
+        if (strncmp(line, "newmtl ", 7) == 0) {
+            ObjMaterial m;
+            m.name = firstToken(line + 7);
+            m.color[0] = m.color[1] = m.color[2] = m.color[3] = 255;
+            materials.push_back(m);
+        } else if (!materials.empty() && sscanf(line, " Kd %f %f %f", &r, &g, &b) == 3) {
+            ObjMaterial &m = materials.back();
+            m.color[0] = toByte(r);
+            m.color[1] = toByte(g);
+            m.color[2] = toByte(b);
+        }
+    }
+    fclose(f);
+}
+
+// "i", "i/j", "i//k" or "i/j/k", 1-based or negative (relative)
+static bool parseCorner(const char *tok, int numV, int numN, int &v, int &n) {
+    int t = 0;
+    n = 0;
+    if (sscanf(tok, "%d//%d", &v, &n) != 2 &&
+        sscanf(tok, "%d/%d/%d", &v, &t, &n) != 3 &&
+        sscanf(tok, "%d/%d", &v, &t) != 2 &&
+        sscanf(tok, "%d", &v) != 1)
+        return false;
+
+    v = (v < 0) ? numV + v : v - 1;
+    n = (n == 0) ? -1 : (n < 0) ? numN + n : n - 1;
+    return v >= 0 && v < numV && n < numN && (n >= 0 || n == -1);
+}
+
+static int findPart(std::vector<PartBuild> &parts, const std::string &name) {
+    for (size_t i = 0; i < parts.size(); ++i)
+        if (parts[i].name == name) return (int)i;
+    if (parts.size() >= (size_t)MESH_MAX_PARTS || name.size() >= (size_t)MESH_PART_NAME_LEN)
+        return -1;
+    PartBuild p;
+    p.name = name;
+    parts.push_back(p);
+    return (int)parts.size() - 1;
+}
+
+bool meshParseObj(const char *path, MeshData &out) {
+    FILE *f = fopen(path, "r");
+    if (f == NULL) {
+        fprintf(stderr, "mesh: can't open %s\n", path);
+        return false;
+    }
+
+    std::string dir(path);
+    size_t slash = dir.find_last_of("/\\");
+    dir = (slash == std::string::npos) ? std::string() : dir.substr(0, slash + 1);
+
+    std::vector<float>       pos, nrm;
+    std::vector<uint32_t>    posColor;   // 0 = no vertex color
+    std::vector<ObjMaterial> materials;
+    std::vector<PartBuild>   parts;
+    std::vector<MeshVertex>  vertices;
+    std::map<CornerKey, uint16_t> corners;
+
+    uint8_t white[4]  = { 255, 255, 255, 255 };
+    uint32_t material = packColor(white);
+    int  part   = findPart(parts, "default");
+    int  lineNo = 0, faceNo = 0;
+    bool ok = true;
+    char line[512];
+
+    while (ok && fgets(line, sizeof(line), f)) {
+        ++lineNo;
+        float x, y, z, r = 1.0f, g = 1.0f, b = 1.0f;
+
+        if (line[0] == 'v' && line[1] == ' ') {
+            int n = sscanf(line + 2, "%f %f %f %f %f %f", &x, &y, &z, &r, &g, &b);
+            if (n < 3) { ok = false; break; }
+            pos.push_back(x); pos.push_back(y); pos.push_back(z);
+            uint8_t c[4] = { toByte(r), toByte(g), toByte(b), 255 };
+            posColor.push_back(n == 6 ? packColor(c) : 0);
+        } else if (sscanf(line, "vn %f %f %f", &x, &y, &z) == 3) {
+            nrm.push_back(x); nrm.push_back(y); nrm.push_back(z);
+        } else if ((line[0] == 'g' || line[0] == 'o') && line[1] == ' ') {
+            std::string name = firstToken(line + 2);
+            part = findPart(parts, name.empty() ? std::string("default") : name);
+            if (part < 0) {
+                fprintf(stderr, "mesh: %s:%d: more than %d parts or name too long\n",
+                        path, lineNo, MESH_MAX_PARTS);
+                ok = false;
+            }
+        } else if (strncmp(line, "mtllib ", 7) == 0) {
+            loadMtl(dir + firstToken(line + 7), materials);
+        } else if (strncmp(line, "usemtl ", 7) == 0) {
+            std::string name = firstToken(line + 7);
+            material = packColor(white);
+            for (size_t i = 0; i < materials.size(); ++i)
+                if (materials[i].name == name) material = packColor(materials[i].color);
+        } else if (line[0] == 'f' && line[1] == ' ') {
+            int vi[32], ni[32], count = 0;
+            for (char *tok = strtok(line + 2, " \t\r\n"); tok && count < 32;
+                 tok = strtok(NULL, " \t\r\n")) {
+                if (!parseCorner(tok, (int)pos.size() / 3, (int)nrm.size() / 3,
+                                 vi[count], ni[count])) {
+                    fprintf(stderr, "mesh: %s:%d: bad face\n", path, lineNo);
+                    ok = false;
+                    break;
+                }
+                ++count;
+            }
+            if (!ok || count < 3) continue;
+
+            // flat normal for corners without one
+            const float *a = &pos[vi[0] * 3], *b = &pos[vi[1] * 3], *c = &pos[vi[2] * 3];
+            float ux = b[0] - a[0], uy = b[1] - a[1], uz = b[2] - a[2];
+            float vx = c[0] - a[0], vy = c[1] - a[1], vz = c[2] - a[2];
+            float fn[3] = { uy * vz - uz * vy, uz * vx - ux * vz, ux * vy - uy * vx };
+            float len = sqrtf(fn[0] * fn[0] + fn[1] * fn[1] + fn[2] * fn[2]);
+            if (len > 0.0f) { fn[0] /= len; fn[1] /= len; fn[2] /= len; }
+
+            uint16_t idx[32];
+            for (int k = 0; ok && k < count; ++k) {
+                CornerKey key;
+                key.v     = vi[k];
+                key.n     = (ni[k] >= 0) ? ni[k] : -1 - faceNo;
+                key.color = posColor[vi[k]] ? posColor[vi[k]] : material;
+
+                std::map<CornerKey, uint16_t>::iterator it = corners.find(key);
+                if (it != corners.end()) {
+                    idx[k] = it->second;
+                    continue;
+                }
+                if (vertices.size() >= 65536) {
+                    fprintf(stderr, "mesh: %s: more than 65536 vertices\n", path);
+                    ok = false;
+                    break;
+                }
+
+                MeshVertex mv;
+                const float *n = (ni[k] >= 0) ? &nrm[ni[k] * 3] : fn;
+                memcpy(mv.pos, &pos[vi[k] * 3], sizeof(mv.pos));
+                memcpy(mv.normal, n, sizeof(mv.normal));
+                for (int ch = 0; ch < 4; ++ch)
+                    mv.color[ch] = (uint8_t)(key.color >> (8 * ch));
+
+                idx[k] = (uint16_t)vertices.size();
+                corners[key] = idx[k];
+                vertices.push_back(mv);
+            }
+
+            std::vector<uint16_t> &tris = parts[part].indices;
+            for (int k = 1; ok && k + 1 < count; ++k) {
+                tris.push_back(idx[0]);
+                tris.push_back(idx[k]);
+                tris.push_back(idx[k + 1]);
+            }
+            ++faceNo;
+        }
+    }
+    fclose(f);
+
+    if (!ok) {
+        fprintf(stderr, "mesh: %s: parse failed at line %d\n", path, lineNo);
+        return false;
+    }
+
+    // drop empty parts (usually "default" when every face is in a group)
+    std::vector<PartBuild> used;
+    size_t indexCount = 0;
+    for (size_t i = 0; i < parts.size(); ++i) {
+        if (parts[i].indices.empty()) continue;
+        used.push_back(parts[i]);
+        indexCount += parts[i].indices.size();
+    }
+    if (used.empty()) {
+        fprintf(stderr, "mesh: %s: no faces\n", path);
+        return false;
+    }
+
+    // lay out the binary form
+    out.storage.assign(binarySize((uint32_t)used.size(), (uint32_t)vertices.size(),
+                                  (uint32_t)indexCount), 0);
+    unsigned char *p = &out.storage[0];
+
+    MeshFileHeader *h = (MeshFileHeader *)p;
+    h->magic       = MESH_FILE_MAGIC;
+    h->version     = MESH_FILE_VERSION;
+    h->vertexCount = (uint32_t)vertices.size();
+    h->indexCount  = (uint32_t)indexCount;
+    h->partCount   = (uint32_t)used.size();
+
+    MeshPart *outParts = (MeshPart *)(h + 1);
+    MeshVertex *outVerts = (MeshVertex *)(outParts + used.size());
+    uint16_t *outIndices = (uint16_t *)(outVerts + vertices.size());
+
+    memcpy(outVerts, &vertices[0], vertices.size() * sizeof(MeshVertex));
+    uint32_t first = 0;
+    for (size_t i = 0; i < used.size(); ++i) {
+        strcpy(outParts[i].name, used[i].name.c_str());
+        outParts[i].firstIndex = first;
+        outParts[i].indexCount = (uint32_t)used[i].indices.size();
+        memcpy(outIndices + first, &used[i].indices[0], used[i].indices.size() * sizeof(uint16_t));
+        first += outParts[i].indexCount;
+    }
+
+    return bindSections(&out.storage[0], out.storage.size(), out);
+}
+
+// ------------- CACHE -------------
+static bool readWholeFile(const std::string &path, std::vector<unsigned char> &data) {
+    FILE *f = fopen(path.c_str(), "rb");
+    if (f == NULL) return false;
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    data.resize(size > 0 ? (size_t)size : 0);
+    bool ok = size > 0 && fread(&data[0], 1, data.size(), f) == data.size();
+    fclose(f);
+    return ok;
+}
+
+static void writeCache(const std::string &path, const MeshData &mesh) {
+    // write then rename, so a crash never leaves a half-written cache
+    std::string tmp = path + ".tmp";
+    FILE *f = fopen(tmp.c_str(), "wb");
+    bool ok = f != NULL &&
+              fwrite(&mesh.storage[0], 1, mesh.storage.size(), f) == mesh.storage.size();
+    if (f) ok = (fclose(f) == 0) && ok;
+
+    remove(path.c_str());
+    if (!ok || rename(tmp.c_str(), path.c_str()) != 0) {
+        remove(tmp.c_str());
+        fprintf(stderr, "mesh: can't write cache %s\n", path.c_str());
+    }
+}
+
+bool meshLoadCached(const char *objPath, MeshData &out, bool *parsed) {
+    std::string cachePath = std::string(objPath) + ".bin";
+    struct stat st;
+    bool haveSource = (stat(objPath, &st) == 0);
+
+    if (parsed) *parsed = false;
+
+    if (readWholeFile(cachePath, out.storage) &&
+        bindSections(&out.storage[0], out.storage.size(), out)) {
+        if (!haveSource ||
+            (out.header->sourceSize == (uint64_t)st.st_size &&
+             out.header->sourceTime == (int64_t)st.st_mtime))
+            return true;
+    }
+
+    if (!haveSource) {
+        out.storage.clear();
+        return false;
+    }
+    if (!meshParseObj(objPath, out)) return false;
+
+    // stamp the source so a changed .obj invalidates the cache
+    MeshFileHeader *h = (MeshFileHeader *)&out.storage[0];
+    h->sourceSize = (uint64_t)st.st_size;
+    h->sourceTime = (int64_t)st.st_mtime;
+    writeCache(cachePath, out);
+    fprintf(stderr, "mesh: parsed %s (%u vertices, %u triangles), cache updated\n",
+            objPath, out.header->vertexCount, out.header->indexCount / 3);
+
+    if (parsed) *parsed = true;
+    return true;
+}
@@ -0,0 +1,75 @@
+// Mesh data without any GL: an OBJ-subset parser and the binary form
+// meshes are cached and bundled in. Shared by the game (mesh.h) and the
+// bundle builder.
+//
+// OBJ subset:
+//   v x y z [r g b]       position, optional vertex color (0..1)
+//   vn x y z              normal; faces without one get a flat normal
+//   f a b c ...           v, v/t, v//n or v/t/n; polygons are fanned
+//   g name / o name       starts a part (drawable on its own)
+//   mtllib / usemtl       only Kd is used, as the vertex color
+//
+// Binary layout, little-endian, every section 4-byte aligned:
+//   MeshFileHeader
+//   MeshPart[partCount]
+//   MeshVertex[vertexCount]      interleaved, ready for glVertexPointer etc.
+//   uint16 indices[indexCount]   triangles, padded to 4 bytes
+#ifndef MESHFILE_H
+#define MESHFILE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+const uint32_t MESH_FILE_MAGIC    = 0x4348534D;   // "MSHC"
+const uint32_t MESH_FILE_VERSION  = 1;
+const int      MESH_MAX_PARTS     = 8;
+const int      MESH_PART_NAME_LEN = 24;
+
+struct MeshVertex {
+    float   pos[3];
+    float   normal[3];
+    uint8_t color[4];   // RGBA
+};
+
+struct MeshPart {
+    char     name[MESH_PART_NAME_LEN];
+    uint32_t firstIndex;
+    uint32_t indexCount;
+};
+
+struct MeshFileHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t vertexCount;
+    uint32_t indexCount;
+    uint32_t partCount;
+    uint32_t reserved;
+    uint64_t sourceSize;    // of the .obj the cache was built from
+    int64_t  sourceTime;    // its modification time
+};
+
+// Points into a binary mesh; `storage` owns it unless it lives elsewhere
+// (e.g. in a mapped bundle).
+struct MeshData {
+    const MeshFileHeader *header;
+    const MeshPart       *parts;
+    const MeshVertex     *vertices;
+    const uint16_t       *indices;
+    std::vector<unsigned char> storage;
+};
+
+// Parses an OBJ into the binary layout (in out.storage).
+bool meshParseObj(const char *path, MeshData &out);
+
+// Uses a binary mesh in place after validating it; no copy is made.
+bool meshFromBinary(const void *data, size_t size, MeshData &out);
+
+// Loads `objPath` through its cache (`objPath` + ".bin"): the cache is used
+// when it matches the source's size and time (or the source is gone), and
+// is rewritten after a parse. `parsed` tells which one happened.
+bool meshLoadCached(const char *objPath, MeshData &out, bool *parsed);
+
+size_t meshBinarySize(const MeshData &mesh);
+
+#endif // MESHFILE_H
@@ -0,0 +1,559 @@
+// Small MLP inference and its kernels, see mlp.h.
+#include "mlp.h"
+#include "vecenv.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <vector>
+#include <algorithm>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define MLP_SSE 1
+#endif
+
+#if defined(__GNUC__) && !defined(__clang__)
+#define MLP_UNROLL _Pragma("GCC unroll 8")
+#else
+#define MLP_UNROLL
+#endif
+
+// AVX2 is compiled per function, so the binary still runs on older CPUs
+#if defined(MLP_SSE) && (defined(__GNUC__) || defined(__clang__)) && \
+    (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define MLP_AVX2 1
+#define MLP_TARGET_AVX2 __attribute__((target("avx2,fma")))
+#endif
+
+static int padded(int n) {
+    return (n + MLP_LANES - 1) & ~(MLP_LANES - 1);
+}
+
+static unsigned mlpRand(unsigned &rng) {
+    rng = rng * 1103515245u + 12345u;
+    return (rng >> 16) & 0x7FFF;
+}
+
+// ------------- BUILD / LOAD / SAVE -------------
+// Lays the net out from row-major layers: rows[i] is layer i's weights
+// [outputs][inputs], then its biases.
+static bool build(Mlp &net, const MlpLayerHeader *hdr, int layers,
+                  const std::vector<float> *rows) {
+    size_t bytes = 0;
+    for (int i = 0; i < layers; ++i) {
+        size_t stride = (size_t)padded((int)hdr[i].outputs);
+        bytes += (hdr[i].inputs * stride + stride) * sizeof(float) + 32;
+    }
+    if (!arenaInit(net.arena, bytes))
+        return false;
+
+    net.layerCount = layers;
+    net.inputs     = (int)hdr[0].inputs;
+    net.outputs    = (int)hdr[layers - 1].outputs;
+    net.widest     = 0;
+    net.kernel     = mlpBestKernel();
+    for (int i = 0; i < layers; ++i) {
+        MlpLayer &l = net.layers[i];
+        l.inputs     = (int)hdr[i].inputs;
+        l.outputs    = (int)hdr[i].outputs;
+        l.stride     = padded(l.outputs);
+        l.activation = (int)hdr[i].activation;
+        l.weights    = arenaNew<float>(net.arena, l.inputs * l.stride);
+        l.bias       = arenaNew<float>(net.arena, l.stride);
+        memset(l.weights, 0, sizeof(float) * (size_t)l.inputs * l.stride);
+        memset(l.bias, 0, sizeof(float) * (size_t)l.stride);
+
+        const float *w = &rows[i][0];
+        for (int o = 0; o < l.outputs; ++o)
+            for (int k = 0; k < l.inputs; ++k)
+                l.weights[(size_t)k * l.stride + o] = w[(size_t)o * l.inputs + k];
+        memcpy(l.bias, w + (size_t)l.outputs * l.inputs, sizeof(float) * (size_t)l.outputs);
+        if (l.stride > net.widest) net.widest = l.stride;
+    }
+    return true;
+}
+
+bool mlpRead(Mlp &net, FILE *f) {
+    memset(&net, 0, sizeof(net));
+    MlpFileHeader h;
+    if (fread(&h, sizeof(h), 1, f) != 1 || h.magic != MLP_MAGIC) {
+        fprintf(stderr, "mlp: not a weights file\n");
+        return false;
+    }
+    if (h.version != MLP_VERSION) {
+        fprintf(stderr, "mlp: weights file version %u, expected %u\n", h.version, MLP_VERSION);
+        return false;
+    }
+    if (h.layers < 1 || h.layers > (uint32_t)MLP_MAX_LAYERS ||
+        h.inputs < 1 || h.inputs > (uint32_t)MLP_MAX_WIDTH) {
+        fprintf(stderr, "mlp: %u layers of %u inputs is not supported\n", h.layers, h.inputs);
+        return false;
+    }
+
+    MlpLayerHeader    hdr[MLP_MAX_LAYERS];
+    std::vector<float> rows[MLP_MAX_LAYERS];
+    uint32_t inputs = h.inputs;
+    for (uint32_t i = 0; i < h.layers; ++i) {
+        if (fread(&hdr[i], sizeof(hdr[i]), 1, f) != 1) {
+            fprintf(stderr, "mlp: weights file ends in layer %u\n", i);
+            return false;
+        }
+        if (hdr[i].inputs != inputs || hdr[i].outputs < 1 ||
+            hdr[i].outputs > (uint32_t)MLP_MAX_WIDTH || hdr[i].activation > MLP_TANH) {
+            fprintf(stderr, "mlp: layer %u is %u -> %u (activation %u), expected %u inputs\n",
+                    i, hdr[i].inputs, hdr[i].outputs, hdr[i].activation, inputs);
+            return false;
+        }
+        size_t n = (size_t)hdr[i].outputs * (hdr[i].inputs + 1);
+        rows[i].resize(n);
+        if (fread(&rows[i][0], sizeof(float), n, f) != n) {
+            fprintf(stderr, "mlp: weights file ends in layer %u\n", i);
+            return false;
+        }
+        inputs = hdr[i].outputs;
+    }
+    return build(net, hdr, (int)h.layers, rows);
+}
+
+bool mlpLoad(Mlp &net, const char *path) {
+    FILE *f = fopen(path, "rb");
+    if (!f) {
+        memset(&net, 0, sizeof(net));
+        fprintf(stderr, "mlp: can't open %s\n", path);
+        return false;
+    }
+    bool ok = mlpRead(net, f);
+    fclose(f);
+    return ok;
+}
+
+bool mlpWrite(const Mlp &net, FILE *f) {
+    MlpFileHeader h = { MLP_MAGIC, MLP_VERSION, (uint32_t)net.layerCount, (uint32_t)net.inputs };
+    bool ok = fwrite(&h, sizeof(h), 1, f) == 1;
+    for (int i = 0; ok && i < net.layerCount; ++i) {
+        const MlpLayer &l = net.layers[i];
+        MlpLayerHeader lh = { (uint32_t)l.inputs, (uint32_t)l.outputs, (uint32_t)l.activation, 0 };
+        std::vector<float> w((size_t)l.outputs * l.inputs);
+        for (int o = 0; o < l.outputs; ++o)
+            for (int k = 0; k < l.inputs; ++k)
+                w[(size_t)o * l.inputs + k] = l.weights[(size_t)k * l.stride + o];
+        ok = fwrite(&lh, sizeof(lh), 1, f) == 1 &&
+             fwrite(&w[0], sizeof(float), w.size(), f) == w.size() &&
+             fwrite(l.bias, sizeof(float), (size_t)l.outputs, f) == (size_t)l.outputs;
+    }
+    return ok;
+}
+
+bool mlpSave(const Mlp &net, const char *path) {
+    FILE *f = fopen(path, "wb");
+    if (!f) {
+        fprintf(stderr, "mlp: can't write %s\n", path);
+        return false;
+    }
+    bool ok = mlpWrite(net, f);
+    if (fclose(f) != 0) ok = false;
+    if (!ok) fprintf(stderr, "mlp: writing %s failed\n", path);
+    return ok;
+}
+
+bool mlpInitRandom(Mlp &net, const int *sizes, int layers, unsigned seed) {
+    memset(&net, 0, sizeof(net));
+    if (layers < 1 || layers > MLP_MAX_LAYERS) return false;
+    MlpLayerHeader    hdr[MLP_MAX_LAYERS];
+    std::vector<float> rows[MLP_MAX_LAYERS];
+    unsigned rng = seed;
+    for (int i = 0; i < layers; ++i) {
+        if (sizes[i] < 1 || sizes[i + 1] < 1 || sizes[i] > MLP_MAX_WIDTH || sizes[i + 1] > MLP_MAX_WIDTH)
+            return false;
+        hdr[i].inputs     = (uint32_t)sizes[i];
+        hdr[i].outputs    = (uint32_t)sizes[i + 1];
+        hdr[i].activation = i + 1 < layers ? MLP_RELU : MLP_LINEAR;
+        hdr[i].reserved   = 0;
+        float scale = sqrtf(6.0f / (float)sizes[i]);
+        rows[i].assign((size_t)sizes[i + 1] * (sizes[i] + 1), 0.0f);
+        for (size_t k = 0; k < (size_t)sizes[i + 1] * sizes[i]; ++k)
+            rows[i][k] = ((float)mlpRand(rng) / 32767.0f * 2.0f - 1.0f) * scale;
+    }
+    return build(net, hdr, layers, rows);
+}
+
+void mlpFree(Mlp &net) {
+    arenaRelease(net.arena);
+    memset(&net, 0, sizeof(net));
+}
+
+// ------------- KERNELS -------------
+// Each computes y[r] = x[r] W + b for a layer, ReLU included. Rows of y
+// are l.stride apart; they and the weights are 16-byte aligned (arena
+// offsets are aligned, its base only as malloc's), so AVX loads unaligned.
+static void layerScalar(const MlpLayer &l, const float *x, int xStride, float *y, int batch) {
+    for (int r = 0; r < batch; ++r, x += xStride, y += l.stride) {
+        memcpy(y, l.bias, sizeof(float) * (size_t)l.stride);
+        const float *w = l.weights;
+        for (int k = 0; k < l.inputs; ++k, w += l.stride) {
+            float xk = x[k];
+            for (int j = 0; j < l.outputs; ++j)
+                y[j] += xk * w[j];
+        }
+        if (l.activation == MLP_RELU)
+            for (int j = 0; j < l.outputs; ++j)
+                if (y[j] < 0.0f) y[j] = 0.0f;
+    }
+}
+
+#ifdef MLP_SSE
+// ROWS rows at once, eight outputs at a time: each weight load serves
+// every row
+template <int ROWS>
+static void rowsSSE(const MlpLayer &l, const float *x, int xStride, float *y) {
+    const __m128 zero = _mm_setzero_ps();
+    for (int j = 0; j < l.stride; j += 8) {
+        __m128 acc[ROWS][2];
+        MLP_UNROLL
+        for (int r = 0; r < ROWS; ++r) {
+            acc[r][0] = _mm_load_ps(l.bias + j);
+            acc[r][1] = _mm_load_ps(l.bias + j + 4);
+        }
+        const float *w = l.weights + j;
+        for (int k = 0; k < l.inputs; ++k, w += l.stride) {
+            __m128 w0 = _mm_load_ps(w), w1 = _mm_load_ps(w + 4);
+            MLP_UNROLL
+            for (int r = 0; r < ROWS; ++r) {
+                __m128 xk = _mm_set1_ps(x[r * xStride + k]);
+                acc[r][0] = _mm_add_ps(acc[r][0], _mm_mul_ps(xk, w0));
+                acc[r][1] = _mm_add_ps(acc[r][1], _mm_mul_ps(xk, w1));
+            }
+        }
+        MLP_UNROLL
+        for (int r = 0; r < ROWS; ++r) {
+            if (l.activation == MLP_RELU) {
+                acc[r][0] = _mm_max_ps(acc[r][0], zero);
+                acc[r][1] = _mm_max_ps(acc[r][1], zero);
+            }
+            _mm_store_ps(y + r * l.stride + j, acc[r][0]);
+            _mm_store_ps(y + r * l.stride + j + 4, acc[r][1]);
+        }
+    }
+}
+
+static void layerSSE(const MlpLayer &l, const float *x, int xStride, float *y, int batch) {
+    int r = 0;
+    for (; r + 4 <= batch; r += 4)
+        rowsSSE<4>(l, x + (size_t)r * xStride, xStride, y + (size_t)r * l.stride);
+    const float *xr = x + (size_t)r * xStride;
+    float       *yr = y + (size_t)r * l.stride;
+    switch (batch - r) {
+        case 3: rowsSSE<3>(l, xr, xStride, yr); break;
+        case 2: rowsSSE<2>(l, xr, xStride, yr); break;
+        case 1: rowsSSE<1>(l, xr, xStride, yr); break;
+    }
+}
+#endif
+
+#ifdef MLP_AVX2
+// ROWS rows by VECS x 8 outputs, starting at output j
+template <int ROWS, int VECS>
+MLP_TARGET_AVX2 static inline void blockAVX2(const MlpLayer &l, const float *x, int xStride,
+                                             float *y, int j) {
+    __m256 acc[ROWS][VECS];
+    MLP_UNROLL
+    for (int v = 0; v < VECS; ++v) {
+        __m256 b = _mm256_loadu_ps(l.bias + j + 8 * v);
+        MLP_UNROLL
+        for (int r = 0; r < ROWS; ++r) acc[r][v] = b;
+    }
+    const float *w = l.weights + j;
+    for (int k = 0; k < l.inputs; ++k, w += l.stride) {
+        __m256 wk[VECS];
+        MLP_UNROLL
+        for (int v = 0; v < VECS; ++v) wk[v] = _mm256_loadu_ps(w + 8 * v);
+        MLP_UNROLL
+        for (int r = 0; r < ROWS; ++r) {
+            __m256 xk = _mm256_broadcast_ss(x + r * xStride + k);
+            MLP_UNROLL
+            for (int v = 0; v < VECS; ++v)
+                acc[r][v] = _mm256_fmadd_ps(xk, wk[v], acc[r][v]);
+        }
+    }
+    const __m256 zero = _mm256_setzero_ps();
+    MLP_UNROLL
+    for (int r = 0; r < ROWS; ++r)
+        MLP_UNROLL
+        for (int v = 0; v < VECS; ++v) {
+            if (l.activation == MLP_RELU) acc[r][v] = _mm256_max_ps(acc[r][v], zero);
+            _mm256_storeu_ps(y + r * l.stride + j + 8 * v, acc[r][v]);
+        }
+}
+
+template <int ROWS>
+MLP_TARGET_AVX2 static void rowsAVX2(const MlpLayer &l, const float *x, int xStride, float *y) {
+    // a lone row takes 32 outputs at a time, four chains to hide the FMA latency
+    const int WIDE = ROWS == 1 ? 4 : 2;
+    int j = 0;
+    for (; j + 8 * WIDE <= l.stride; j += 8 * WIDE)
+        blockAVX2<ROWS, WIDE>(l, x, xStride, y, j);
+    for (; j < l.stride; j += 8)
+        blockAVX2<ROWS, 1>(l, x, xStride, y, j);
+}
+
+MLP_TARGET_AVX2 static void layerAVX2(const MlpLayer &l, const float *x, int xStride,
+                                      float *y, int batch) {
+    int r = 0;
+    for (; r + 4 <= batch; r += 4)
+        rowsAVX2<4>(l, x + (size_t)r * xStride, xStride, y + (size_t)r * l.stride);
+    const float *xr = x + (size_t)r * xStride;
+    float       *yr = y + (size_t)r * l.stride;
+    switch (batch - r) {
+        case 3: rowsAVX2<3>(l, xr, xStride, yr); break;
+        case 2: rowsAVX2<2>(l, xr, xStride, yr); break;
+        case 1: rowsAVX2<1>(l, xr, xStride, yr); break;
+    }
+}
+#endif
+
+MlpKernel mlpBestKernel() {
+#ifdef MLP_AVX2
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+        return MLP_KERNEL_AVX2;
+#endif
+#ifdef MLP_SSE
+    return MLP_KERNEL_SSE;
+#else
+    return MLP_KERNEL_SCALAR;
+#endif
+}
+
+const char *mlpKernelName(MlpKernel k) {
+    switch (k) {
+        case MLP_KERNEL_AVX2: return "avx2";
+        case MLP_KERNEL_SSE:  return "sse";
+        default:              return "scalar";
+    }
+}
+
+// ------------- FORWARD -------------
+size_t mlpScratchBytes(const Mlp &net, int batch) {
+    int rows = batch < MLP_TILE ? batch : MLP_TILE;
+    return 2 * sizeof(float) * (size_t)rows * net.widest;
+}
+
+float *mlpScratch(Arena &a, const Mlp &net, int batch) {
+    return (float *)arenaAlloc(a, mlpScratchBytes(net, batch));
+}
+
+// one tile of rows through every layer
+static void forwardTile(const Mlp &net, const float *in, float *out, int batch, float *scratch) {
+    size_t       half    = (size_t)batch * net.widest;
+    const float *x       = in;
+    int          xStride = net.inputs;
+    for (int i = 0; i < net.layerCount; ++i) {
+        const MlpLayer &l = net.layers[i];
+        float *y = scratch + (i & 1) * half;
+        switch (net.kernel) {
+#ifdef MLP_AVX2
+            case MLP_KERNEL_AVX2: layerAVX2(l, x, xStride, y, batch); break;
+#endif
+#ifdef MLP_SSE
+            case MLP_KERNEL_SSE:  layerSSE(l, x, xStride, y, batch); break;
+#endif
+            default:              layerScalar(l, x, xStride, y, batch); break;
+        }
+        if (l.activation == MLP_TANH)
+            for (int r = 0; r < batch; ++r)
+                for (int j = 0; j < l.outputs; ++j)
+                    y[(size_t)r * l.stride + j] = tanhf(y[(size_t)r * l.stride + j]);
+        x       = y;
+        xStride = l.stride;
+    }
+    for (int r = 0; r < batch; ++r)
+        memcpy(out + (size_t)r * net.outputs, x + (size_t)r * xStride,
+               sizeof(float) * (size_t)net.outputs);
+}
+
+void mlpForward(const Mlp &net, const float *in, float *out, int batch, float *scratch) {
+    for (int r = 0; r < batch; r += MLP_TILE)
+        forwardTile(net, in + (size_t)r * net.inputs, out + (size_t)r * net.outputs,
+                    batch - r < MLP_TILE ? batch - r : MLP_TILE, scratch);
+}
+
+void mlpArgmax(const float *out, int outputs, int batch, int *best) {
+    for (int r = 0; r < batch; ++r, out += outputs) {
+        int b = 0;
+        for (int j = 1; j < outputs; ++j)
+            if (out[j] > out[b]) b = j;
+        best[r] = b;
+    }
+}
+
+// ------------- BENCHMARK -------------
+static double flopsPerInput(const Mlp &net) {
+    double f = 0.0;
+    for (int i = 0; i < net.layerCount; ++i)
+        f += 2.0 * net.layers[i].inputs * net.layers[i].outputs;
+    return f;
+}
+
+int mlpRunBenchmark(const char *path, int runs) {
+    const int LANES = 5;
+    if (runs < 1) runs = 1;
+
+    Mlp net;
+    if (path) {
+        if (!mlpLoad(net, path)) return 1;
+    } else {
+        // through a file and back, so the loader is part of the run
+        int sizes[] = { vecEnvObsSize(LANES), 64, 64, NUM_ACTIONS };
+        Mlp made;
+        bool ok = mlpInitRandom(made, sizes, 3, 7u);
+        FILE *f = ok ? tmpfile() : NULL;
+        ok = f && mlpWrite(made, f);
+        if (ok) {
+            rewind(f);
+            ok = mlpRead(net, f);
+        }
+        if (f) fclose(f);
+        mlpFree(made);
+        if (!ok) return 1;
+    }
+
+    printf("mlp bench: %d", net.inputs);
+    for (int i = 0; i < net.layerCount; ++i) printf(" -> %d", net.layers[i].outputs);
+    printf(" (%s), %.1f kFLOP per input\n", path ? path : "random weights", flopsPerInput(net) / 1000.0);
+
+    MlpKernel kernels[3];
+    int kernelCount = 0;
+    for (int k = MLP_KERNEL_SCALAR; k <= (int)mlpBestKernel(); ++k) {
+#ifndef MLP_SSE
+        if (k == MLP_KERNEL_SSE) continue;
+#endif
+        kernels[kernelCount++] = (MlpKernel)k;
+    }
+#ifndef MLP_AVX2
+    printf("  (built without AVX2 support, the best kernel is %s)\n", mlpKernelName(mlpBestKernel()));
+#endif
+
+    const int MAX_BATCH = runs > 4096 ? runs : 4096;
+    Arena a;
+    if (!arenaInit(a, mlpScratchBytes(net, MAX_BATCH) + 64)) {
+        mlpFree(net);
+        return 1;
+    }
+    float *scratch = mlpScratch(a, net, MAX_BATCH);
+    std::vector<float> in((size_t)MAX_BATCH * net.inputs), out((size_t)MAX_BATCH * net.outputs);
+    std::vector<float> ref((size_t)MAX_BATCH * net.outputs);
+    unsigned rng = 11u;
+    for (size_t i = 0; i < in.size(); ++i) in[i] = (float)mlpRand(rng) / 32767.0f;
+
+    // every kernel against the scalar one
+    const int CHECK = 1027;            // not a multiple of four rows
+    bool agree = true;
+    net.kernel = MLP_KERNEL_SCALAR;
+    mlpForward(net, &in[0], &ref[0], CHECK, scratch);
+    for (int k = 1; k < kernelCount; ++k) {
+        net.kernel = kernels[k];
+        mlpForward(net, &in[0], &out[0], CHECK, scratch);
+        float worst = 0.0f, largest = 0.0f;
+        for (size_t i = 0; i < (size_t)CHECK * net.outputs; ++i) {
+            float d = fabsf(out[i] - ref[i]);
+            if (d > worst) worst = d;
+            if (fabsf(ref[i]) > largest) largest = fabsf(ref[i]);
+        }
+        bool ok = worst <= 1e-4f * (1.0f + largest);
+        agree = agree && ok;
+        printf("  %-6s vs scalar: max difference %.2g (%s)\n", mlpKernelName(kernels[k]), worst,
+               ok ? "ok" : "MISMATCH");
+    }
+
+    // one input at a time, as a single bot in the game would run it
+    printf("  single input, ns per forward:\n");
+    const int CALLS = 100000;
+    std::vector<double> each((size_t)CALLS);
+    for (int k = 0; k < kernelCount; ++k) {
+        net.kernel = kernels[k];
+        double start = vecEnvSeconds();
+        for (int c = 0; c < CALLS; ++c) {
+            double t0 = vecEnvSeconds();
+            mlpForward(net, &in[(size_t)(c & 1023) * net.inputs], &out[0], 1, scratch);
+            each[(size_t)c] = vecEnvSeconds() - t0;
+        }
+        double total = vecEnvSeconds() - start;
+        std::sort(each.begin(), each.end());
+        printf("    %-6s avg %7.1f  p50 %7.1f  p99 %7.1f\n", mlpKernelName(kernels[k]),
+               total * 1e9 / CALLS, each[(size_t)CALLS / 2] * 1e9, each[(size_t)CALLS * 99 / 100] * 1e9);
+    }
+
+    // batched: inputs a second for each batch size, each case ~0.2 s
+    const int BATCHES[] = { 1, 4, 16, 64, 256, 1024, 4096 };
+    printf("  batched, M inputs/s:\n    batch");
+    for (int k = 0; k < kernelCount; ++k) printf("  %8s", mlpKernelName(kernels[k]));
+    printf("\n");
+    double bestRate = 0.0;
+    for (size_t b = 0; b < sizeof(BATCHES) / sizeof(BATCHES[0]); ++b) {
+        int batch = BATCHES[b];
+        printf("    %5d", batch);
+        for (int k = 0; k < kernelCount; ++k) {
+            net.kernel = kernels[k];
+            long   done  = 0;
+            double start = vecEnvSeconds(), elapsed = 0.0;
+            while (elapsed < 0.2) {
+                mlpForward(net, &in[0], &out[0], batch, scratch);
+                done   += batch;
+                elapsed = vecEnvSeconds() - start;
+            }
+            double rate = done / elapsed;
+            if (rate > bestRate) bestRate = rate;
+            printf("  %8.3f", rate / 1e6);
+        }
+        printf("\n");
+    }
+    printf("  peak %.2f GFLOP/s\n", bestRate * flopsPerInput(net) / 1e9);
+
+    // the net choosing every run's action, one forward for the whole batch
+    net.kernel = mlpBestKernel();
+    if (net.inputs == vecEnvObsSize(LANES) && net.outputs >= NUM_ACTIONS) {
+        Arena envArena;
+        VecEnv v;
+        if (arenaInit(envArena, vecEnvBytes(runs, LANES)) &&
+            vecEnvInit(v, envArena, runs, LANES, 5u, 0)) {
+            const int STEPS = 300;
+            std::vector<float>         obs((size_t)runs * net.inputs), rewards((size_t)runs);
+            std::vector<float>         logits((size_t)runs * net.outputs);
+            std::vector<int>           actions((size_t)runs);
+            std::vector<unsigned char> dones((size_t)runs);
+            for (int mode = 0; mode < 2; ++mode) {
+                vecEnvReset(v, &obs[0]);
+                double policy = 0.0, env = 0.0;
+                for (int s = 0; s < STEPS; ++s) {
+                    double t0 = vecEnvSeconds();
+                    if (mode == 0) {
+                        mlpForward(net, &obs[0], &logits[0], runs, scratch);
+                    } else {
+                        for (int i = 0; i < runs; ++i)
+                            mlpForward(net, &obs[(size_t)i * net.inputs],
+                                       &logits[(size_t)i * net.outputs], 1, scratch);
+                    }
+                    mlpArgmax(&logits[0], net.outputs, runs, &actions[0]);
+                    double t1 = vecEnvSeconds();
+                    vecEnvStep(v, &actions[0], &obs[0], &rewards[0], &dones[0]);
+                    policy += t1 - t0;
+                    env    += vecEnvSeconds() - t1;
+                }
+                double steps = (double)runs * STEPS;
+                printf("  %d runs, %s: %.2f M decisions/s, %.0f ns policy + %.0f ns env per run step\n",
+                       runs, mode == 0 ? "one batch" : "one at a time", steps / policy / 1e6,
+                       policy * 1e9 / steps, env * 1e9 / steps);
+            }
+        }
+        arenaRelease(envArena);
+    } else {
+        printf("  (the net isn't %d -> %d, the VecEnv run is skipped)\n",
+               vecEnvObsSize(LANES), (int)NUM_ACTIONS);
+    }
+
+    arenaRelease(a);
+    mlpFree(net);
+    return agree ? 0 : 1;
+}
@@ -0,0 +1,114 @@
+// Small MLP inference for learned bot policies, inside the game binary.
+//
+// A net is a stack of dense layers, each y = act(W x + b). One call runs a
+// whole batch of inputs (one per run of a VecEnv, say) through it, so
+// every layer is a matrix multiply over the batch and its weights are read
+// once per four rows instead of once per run. Rows go through all layers
+// MLP_TILE at a time, so the activations in between stay in L1.
+//
+// Weights are kept transposed, [inputs][stride] with the outputs padded
+// to a multiple of MLP_LANES, so a kernel broadcasts one input and updates
+// eight outputs with one multiply-add. There are three kernels: scalar,
+// SSE2 (where the compiler targets it), and AVX2 + FMA, built with a
+// target attribute and only used if the CPU has it (GCC / clang on x86).
+// mlpLoad() picks the best one the CPU runs; Mlp::kernel can be changed
+// after, as the benchmark does.
+//
+// File layout (little-endian, what mlpSave() writes):
+//   MlpFileHeader                       magic "MLP1", version, layers, inputs
+//   per layer: MlpLayerHeader           inputs, outputs, activation
+//              float weights[outputs][inputs]   row-major, as torch.nn.Linear
+//              float bias[outputs]
+#ifndef MLP_H
+#define MLP_H
+
+#include "arena.h"
+
+#include <stdint.h>
+#include <stdio.h>
+
+const uint32_t MLP_MAGIC      = 0x31504C4D;   // "MLP1"
+const uint32_t MLP_VERSION    = 1;
+const int      MLP_MAX_LAYERS = 8;
+const int      MLP_MAX_WIDTH  = 4096;
+const int      MLP_LANES      = 8;            // outputs are padded to this
+const int      MLP_TILE       = 32;           // rows per pass through the layers
+
+enum MlpActivation {
+    MLP_LINEAR,
+    MLP_RELU,
+    MLP_TANH
+};
+
+enum MlpKernel {
+    MLP_KERNEL_SCALAR,
+    MLP_KERNEL_SSE,
+    MLP_KERNEL_AVX2
+};
+
+struct MlpFileHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t layers;
+    uint32_t inputs;
+};
+
+struct MlpLayerHeader {
+    uint32_t inputs;
+    uint32_t outputs;
+    uint32_t activation;
+    uint32_t reserved;                 // 0
+};
+
+struct MlpLayer {
+    int    inputs, outputs;
+    int    stride;                     // outputs rounded up to MLP_LANES
+    int    activation;
+    float *weights;                    // [inputs][stride], transposed
+    float *bias;                       // [stride], zero past outputs
+};
+
+struct Mlp {
+    Arena     arena;                   // owns the weights
+    int       layerCount;
+    int       inputs, outputs;
+    int       widest;                  // largest stride
+    MlpKernel kernel;
+    MlpLayer  layers[MLP_MAX_LAYERS];
+};
+
+// false (and logs) on a missing or malformed file.
+bool mlpLoad(Mlp &net, const char *path);
+bool mlpRead(Mlp &net, FILE *f);
+bool mlpSave(const Mlp &net, const char *path);
+bool mlpWrite(const Mlp &net, FILE *f);
+
+// sizes[0] inputs, then each layer's outputs; ReLU between layers and a
+// linear last layer, weights uniform at the He scale. For tests and
+// benchmarks.
+bool mlpInitRandom(Mlp &net, const int *sizes, int layers, unsigned seed);
+void mlpFree(Mlp &net);
+
+// The best kernel this CPU runs, and its name.
+MlpKernel   mlpBestKernel();
+const char *mlpKernelName(MlpKernel k);
+
+// Scratch for batches of up to `batch` rows; mlpScratch() takes it from
+// an arena.
+size_t mlpScratchBytes(const Mlp &net, int batch);
+float *mlpScratch(Arena &a, const Mlp &net, int batch);
+
+// in: [batch][inputs], out: [batch][outputs]. Doesn't allocate, so it can
+// run inside the tick.
+void mlpForward(const Mlp &net, const float *in, float *out, int batch, float *scratch);
+
+// best[i]: the index of the largest of row i's outputs.
+void mlpArgmax(const float *out, int outputs, int batch, int *best);
+
+// --mlp-bench [weights] [runs]: the kernels' agreement, single-input
+// latency, batched throughput by batch size, and a net choosing every
+// action for a batch of runs (vecenv.h). Without a file it uses a random
+// net of the default shape.
+int  mlpRunBenchmark(const char *path, int runs);
+
+#endif // MLP_H
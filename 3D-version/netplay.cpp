@@ -0,0 +1,404 @@
+// UDP rollback session for head-to-head races, see netplay.h.
+#include "netplay.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+#include <vector>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+typedef int socklen_t;
+#define closeSocket closesocket
+#else
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netdb.h>
+#include <fcntl.h>
+#include <unistd.h>
+#define closeSocket close
+#endif
+
+// Packet, all integers little-endian:
+//   magic (4) | player (1) | ack tick (4) | first tick (4) | count (1) | inputs (count)
+// `ack` is the last tick of the receiver's inputs the sender has; the
+// inputs are the sender's, for ticks first .. first + count - 1.
+const unsigned NET_MAGIC       = 0x31524E52;   // "RNR1"
+const int      NET_HEADER      = 14;
+const int      NET_MAX_INPUTS  = NET_RING;
+
+static double nowMillis() {
+    using namespace std::chrono;
+    return duration_cast<duration<double, std::milli> >(
+        steady_clock::now().time_since_epoch()).count();
+}
+
+static void put32(unsigned char *b, unsigned v) {
+    b[0] = (unsigned char)v;         b[1] = (unsigned char)(v >> 8);
+    b[2] = (unsigned char)(v >> 16); b[3] = (unsigned char)(v >> 24);
+}
+
+static unsigned get32(const unsigned char *b) {
+    return b[0] | (b[1] << 8) | (b[2] << 16) | ((unsigned)b[3] << 24);
+}
+
+// ------------- SOCKET -------------
+bool netOpen(NetSession &n, int localPlayer, int localPort,
+             const char *peerHost, int peerPort,
+             unsigned seed, int lanes, const NetShim &shim) {
+#ifdef _WIN32
+    static bool wsaReady = false;
+    if (!wsaReady) {
+        WSADATA wsa;
+        if (WSAStartup(MAKEWORD(2, 2), &wsa) != 0) {
+            fprintf(stderr, "net: WSAStartup failed\n");
+            return false;
+        }
+        wsaReady = true;
+    }
+#endif
+    memset(&n, 0, sizeof(n));
+    n.sock = -1;
+
+    struct addrinfo hints, *res = NULL;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family   = AF_INET;
+    hints.ai_socktype = SOCK_DGRAM;
+    char port[16];
+    snprintf(port, sizeof(port), "%d", peerPort);
+    if (getaddrinfo(peerHost, port, &hints, &res) != 0 || res == NULL ||
+        res->ai_addrlen > sizeof(n.peerAddr)) {
+        fprintf(stderr, "net: can't resolve %s:%d\n", peerHost, peerPort);
+        if (res) freeaddrinfo(res);
+        return false;
+    }
+    memcpy(n.peerAddr, res->ai_addr, res->ai_addrlen);
+    n.peerAddrLen = (int)res->ai_addrlen;
+    freeaddrinfo(res);
+
+    intptr_t s = (intptr_t)socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (s < 0) {
+        fprintf(stderr, "net: socket() failed\n");
+        return false;
+    }
+
+    struct sockaddr_in local;
+    memset(&local, 0, sizeof(local));
+    local.sin_family      = AF_INET;
+    local.sin_addr.s_addr = htonl(INADDR_ANY);
+    local.sin_port        = htons((unsigned short)localPort);
+    if (bind(s, (struct sockaddr *)&local, sizeof(local)) != 0) {
+        fprintf(stderr, "net: can't bind UDP port %d\n", localPort);
+        closeSocket(s);
+        return false;
+    }
+
+#ifdef _WIN32
+    u_long nonBlocking = 1;
+    ioctlsocket(s, FIONBIO, &nonBlocking);
+#else
+    fcntl(s, F_SETFL, fcntl(s, F_GETFL, 0) | O_NONBLOCK);
+#endif
+
+    n.sock         = s;
+    n.localPlayer  = localPlayer;
+    n.remotePlayer = 1 - localPlayer;
+    raceInit(n.state, seed, lanes);
+    n.initialInput = (RaceInput)(lanes / 2);
+    for (int p = 0; p < RACE_PLAYERS; ++p)
+        n.confirmed[p] = -1;
+    n.peerAck      = -1;
+    n.rollbackFrom = -1;
+    n.shim         = shim;
+    n.shimRng      = 0x9E3779B9u ^ (unsigned)localPlayer;
+    return true;
+}
+
+void netClose(NetSession &n) {
+    if (n.sock >= 0) closeSocket(n.sock);
+    n.sock = -1;
+}
+
+// ------------- SHIM -------------
+static unsigned shimRand(NetSession &n) {
+    n.shimRng = n.shimRng * 1664525u + 1013904223u;
+    return n.shimRng >> 8;
+}
+
+static void sendNow(NetSession &n, const unsigned char *data, int len) {
+    sendto(n.sock, (const char *)data, len, 0,
+           (const struct sockaddr *)n.peerAddr, (socklen_t)n.peerAddrLen);
+}
+
+static void sendPacket(NetSession &n, const unsigned char *data, int len, double now) {
+    ++n.stats.sent;
+    if (n.shim.lossPercent > 0 && (int)(shimRand(n) % 100) < n.shim.lossPercent) {
+        ++n.stats.dropped;
+        return;
+    }
+    if ((n.shim.delayMs <= 0 && n.shim.jitterMs <= 0) || n.delayedCount >= NET_SHIM_QUEUE) {
+        sendNow(n, data, len);
+        return;
+    }
+
+    NetDelayed &d = n.delayed[n.delayedCount++];
+    d.due = now + n.shim.delayMs;
+    if (n.shim.jitterMs > 0) d.due += (double)(shimRand(n) % (unsigned)(n.shim.jitterMs + 1));
+    d.len = len;
+    memcpy(d.data, data, (size_t)len);
+}
+
+static void flushDelayed(NetSession &n, double now) {
+    int kept = 0;
+    for (int i = 0; i < n.delayedCount; ++i) {
+        if (n.delayed[i].due <= now) sendNow(n, n.delayed[i].data, n.delayed[i].len);
+        else                         n.delayed[kept++] = n.delayed[i];
+    }
+    n.delayedCount = kept;
+}
+
+// ------------- INPUTS -------------
+static RaceInput predictRemote(const NetSession &n) {
+    int c = n.confirmed[n.remotePlayer];
+    return (c >= 0) ? n.inputs[n.remotePlayer][c % NET_RING] : n.initialInput;
+}
+
+static void handlePacket(NetSession &n, const unsigned char *b, int len) {
+    if (len < NET_HEADER || get32(b) != NET_MAGIC || b[4] != n.remotePlayer) return;
+    int ack   = (int)get32(b + 5);
+    int first = (int)get32(b + 9);
+    int count = b[13];
+    if (len < NET_HEADER + count) return;
+    ++n.stats.received;
+
+    if (ack > n.peerAck) n.peerAck = ack;
+
+    // inputs come in order from the peer's last ack, so anything but the
+    // next tick is either already known or past a gap (a later packet
+    // fills it)
+    const int r = n.remotePlayer;
+    for (int k = 0; k < count; ++k) {
+        int t = first + k;
+        if (t != n.confirmed[r] + 1) continue;
+
+        RaceInput in = b[NET_HEADER + k];
+        RaceInput &slot = n.inputs[r][t % NET_RING];
+        if (t < n.frame && slot != in &&
+            (n.rollbackFrom < 0 || t < n.rollbackFrom))
+            n.rollbackFrom = t;
+        slot = in;
+        n.confirmed[r] = t;
+    }
+}
+
+static void receive(NetSession &n) {
+    unsigned char buf[NET_MAX_PACKET * 2];
+    for (;;) {
+        int len = (int)recvfrom(n.sock, (char *)buf, sizeof(buf), 0, NULL, NULL);
+        if (len <= 0) break;           // would block (or an ICMP error, peer not up yet)
+        handlePacket(n, buf, len);
+    }
+}
+
+static void sendInputs(NetSession &n, double now) {
+    int first = n.peerAck + 1;
+    int last  = n.confirmed[n.localPlayer];
+    int count = last - first + 1;
+    if (count < 0) count = 0;
+    if (count > NET_MAX_INPUTS) count = NET_MAX_INPUTS;
+
+    unsigned char b[NET_MAX_PACKET];
+    put32(b, NET_MAGIC);
+    b[4] = (unsigned char)n.localPlayer;
+    put32(b + 5, (unsigned)n.confirmed[n.remotePlayer]);
+    put32(b + 9, (unsigned)first);
+    b[13] = (unsigned char)count;
+    for (int k = 0; k < count; ++k)
+        b[NET_HEADER + k] = n.inputs[n.localPlayer][(first + k) % NET_RING];
+
+    sendPacket(n, b, NET_HEADER + count, now);
+}
+
+// ------------- SIMULATION -------------
+// Simulates tick n.frame, predicting the remote input if it isn't known.
+static void simulate(NetSession &n) {
+    int f = n.frame;
+    if (f > n.confirmed[n.remotePlayer])
+        n.inputs[n.remotePlayer][f % NET_RING] = predictRemote(n);
+
+    n.snapshots[f % NET_RING] = n.state;
+    RaceInput in[RACE_PLAYERS];
+    for (int p = 0; p < RACE_PLAYERS; ++p)
+        in[p] = n.inputs[p][f % NET_RING];
+    raceTick(n.state, in);
+    ++n.frame;
+}
+
+static void rollback(NetSession &n) {
+    n.stats.lastRollback = 0;
+    if (n.rollbackFrom < 0) return;
+
+    double t0 = nowMillis();
+    int to = n.frame;
+    n.frame = n.rollbackFrom;
+    n.state = n.snapshots[n.frame % NET_RING];
+    while (n.frame < to)
+        simulate(n);
+    double ms = nowMillis() - t0;
+
+    int depth = to - n.rollbackFrom;
+    n.rollbackFrom = -1;
+
+    NetStats &st = n.stats;
+    st.lastRollback = depth;
+    st.lastResimMs  = ms;
+    if (depth > st.maxRollback) st.maxRollback = depth;
+    if (ms > st.maxResimMs)     st.maxResimMs  = ms;
+    st.totalResimMs += ms;
+    st.resimTicks   += depth;
+    ++st.rollbacks;
+}
+
+void netSync(NetSession &n, double nowMs) {
+    receive(n);
+    rollback(n);
+    n.stats.ahead = n.frame - 1 - n.confirmed[n.remotePlayer];
+    sendInputs(n, nowMs);
+    flushDelayed(n, nowMs);
+}
+
+bool netAdvance(NetSession &n, RaceInput local, double nowMs) {
+    receive(n);
+    rollback(n);
+
+    bool advanced = false;
+    if (n.frame - 1 - n.confirmed[n.remotePlayer] >= NET_MAX_PREDICTION) {
+        ++n.stats.stalls;
+    } else {
+        n.inputs[n.localPlayer][n.frame % NET_RING] = local;
+        n.confirmed[n.localPlayer] = n.frame;
+        simulate(n);
+        advanced = true;
+    }
+
+    n.stats.ahead = n.frame - 1 - n.confirmed[n.remotePlayer];
+    sendInputs(n, nowMs);
+    flushDelayed(n, nowMs);
+    return advanced;
+}
+
+bool netConfirmed(const NetSession &n) {
+    return n.rollbackFrom < 0 && n.confirmed[n.remotePlayer] >= n.frame - 1;
+}
+
+// ------------- LOOPBACK TEST -------------
+// A player that dodges: leaves its lane for a free neighbour when an
+// obstacle is coming. Decided on the (possibly predicted) local state,
+// like a human would; the inputs are recorded for the offline replay.
+static RaceInput botInput(const RaceState &s, int player) {
+    int lane = s.players[player].lane;
+    bool blocked[16] = { false };
+    for (int i = 0; i < s.objectCount; ++i) {
+        const RaceObject &o = s.objects[i];
+        if (o.kind == RACE_OBSTACLE && o.z > -25.0f && o.z < 3.0f && o.lane < 16)
+            blocked[o.lane] = true;
+    }
+    if (!blocked[lane]) {
+        // wander to a random free lane now and then, so there is
+        // something to mispredict
+        if (s.tick % 45 == 0) {
+            unsigned h = (unsigned)(s.tick / 45) * 2654435761u + (unsigned)player * 40503u;
+            int l = (int)((h >> 16) % (unsigned)s.lanes);
+            if (!blocked[l]) return (RaceInput)l;
+        }
+        return (RaceInput)lane;
+    }
+    int order[2] = { (player == 0) ? -1 : 1, (player == 0) ? 1 : -1 };
+    for (int k = 0; k < 2; ++k) {
+        int l = lane + order[k];
+        if (l >= 0 && l < s.lanes && !blocked[l]) return (RaceInput)l;
+    }
+    return (RaceInput)lane;
+}
+
+int netRunLoopbackTest(int ticks, const NetShim &shim) {
+    const int      PORT_A = 47811, PORT_B = 47812;
+    const unsigned SEED   = 2024;
+    const int      LANES  = 5;
+    const double   FRAME_MS = 1000.0 / RACE_TICK_RATE;
+
+    static NetSession peers[2];        // large; keep them off the stack
+    if (!netOpen(peers[0], 0, PORT_A, "127.0.0.1", PORT_B, SEED, LANES, shim) ||
+        !netOpen(peers[1], 1, PORT_B, "127.0.0.1", PORT_A, SEED, LANES, shim)) {
+        netClose(peers[0]);
+        return 1;
+    }
+
+    std::vector<RaceInput> recorded[2];
+    recorded[0].resize((size_t)ticks);
+    recorded[1].resize((size_t)ticks);
+
+    std::vector<int> depthHist(NET_RING + 1, 0);
+    double resimSum = 0.0;
+    long   frames   = 0;
+
+    // virtual clock: each peer advances once per 60 Hz frame; the shim's
+    // delay is measured on the same clock, the socket itself is instant
+    double now = 0.0;
+    while (peers[0].frame < ticks || peers[1].frame < ticks) {
+        for (int p = 0; p < 2; ++p) {
+            NetSession &n = peers[p];
+            if (n.frame >= ticks) { netSync(n, now); continue; }
+
+            RaceInput in = botInput(n.state, p);
+            int f = n.frame;
+            if (netAdvance(n, in, now)) recorded[p][(size_t)f] = in;
+
+            ++depthHist[(size_t)n.stats.lastRollback];
+            resimSum += n.stats.lastResimMs;
+            ++frames;
+        }
+        now += FRAME_MS;
+    }
+
+    // let the last inputs arrive (and the last rollbacks happen)
+    for (int i = 0; i < 1000 && !(netConfirmed(peers[0]) && netConfirmed(peers[1])); ++i) {
+        netSync(peers[0], now);
+        netSync(peers[1], now);
+        now += FRAME_MS;
+    }
+
+    // the same race without a network
+    static RaceState offline;
+    raceInit(offline, SEED, LANES);
+    for (int f = 0; f < ticks; ++f) {
+        RaceInput in[RACE_PLAYERS] = { recorded[0][(size_t)f], recorded[1][(size_t)f] };
+        raceTick(offline, in);
+    }
+
+    unsigned sumA = raceChecksum(peers[0].state);
+    unsigned sumB = raceChecksum(peers[1].state);
+    unsigned sumO = raceChecksum(offline);
+    bool ok = netConfirmed(peers[0]) && netConfirmed(peers[1]) && sumA == sumB && sumA == sumO;
+
+    printf("net loopback: %d ticks, shim delay %d ms + jitter %d ms, loss %d%%\n",
+           ticks, shim.delayMs, shim.jitterMs, shim.lossPercent);
+    for (int p = 0; p < 2; ++p) {
+        const NetStats &st = peers[p].stats;
+        printf("  peer %d: %ld rollbacks, %ld ticks re-simulated, max depth %d, "
+               "resim max %.3f ms, %ld stalls, packets %ld sent / %ld dropped / %ld received\n",
+               p, st.rollbacks, st.resimTicks, st.maxRollback, st.maxResimMs,
+               st.stalls, st.sent, st.dropped, st.received);
+    }
+    printf("  rollback depth per frame:");
+    for (int d = 0; d <= NET_RING; ++d)
+        if (depthHist[(size_t)d]) printf("  %d:%d", d, depthHist[(size_t)d]);
+    printf("\n  resim cost per frame: avg %.4f ms\n", frames ? resimSum / frames : 0.0);
+    printf("  race: tick %d, winner %d; checksums %08x %08x, offline %08x: %s\n",
+           offline.tick, offline.winner, sumA, sumB, sumO, ok ? "in sync" : "DESYNC");
+
+    netClose(peers[0]);
+    netClose(peers[1]);
+    return ok ? 0 : 2;
+}
@@ -0,0 +1,98 @@
+// Rollback session for two-player races (race.h) over UDP.
+//
+// Each peer simulates the race locally and never waits for the other's
+// input: ticks run with the remote player's input predicted (their last
+// known lane). Every tick's state is kept in a ring of snapshots. When the
+// real input for an already simulated tick arrives and differs from the
+// prediction, the session restores the snapshot of that tick and
+// re-simulates up to the present with what is now known. A peer that gets
+// more than NET_MAX_PREDICTION ticks ahead of the other's inputs stalls
+// until they catch up.
+//
+// Packets carry every local input the peer hasn't acknowledged yet, so a
+// lost packet is covered by the next one. A send-side shim can delay,
+// jitter and drop packets to test all of this on localhost.
+#ifndef NETPLAY_H
+#define NETPLAY_H
+
+#include <stdint.h>
+#include "race.h"
+
+const int NET_RING           = 64;    // ticks of snapshots and inputs kept
+const int NET_MAX_PREDICTION = 12;    // ticks run on predicted input at most
+const int NET_SHIM_QUEUE     = 256;   // packets held back by the shim
+const int NET_MAX_PACKET     = 128;   // bytes
+
+struct NetShim {
+    int delayMs;                       // one way
+    int jitterMs;                      // + 0..jitterMs, so packets reorder
+    int lossPercent;
+};
+
+struct NetStats {
+    int    lastRollback;               // ticks re-simulated in the last advance
+    int    maxRollback;
+    long   rollbacks;                  // advances that had to re-simulate
+    long   resimTicks;
+    double lastResimMs;                // cost of the last re-simulation
+    double maxResimMs;
+    double totalResimMs;
+    long   stalls;                     // advances that waited for the peer
+    int    ahead;                      // ticks currently running on prediction
+    long   sent, dropped, received;
+};
+
+struct NetDelayed {
+    double        due;                 // ms, on the clock passed to netAdvance
+    int           len;
+    unsigned char data[NET_MAX_PACKET];
+};
+
+struct NetSession {
+    intptr_t      sock;
+    unsigned char peerAddr[32];        // sockaddr_in
+    int           peerAddrLen;
+    int           localPlayer;
+    int           remotePlayer;
+
+    RaceState     state;
+    int           frame;                            // ticks simulated (state.tick stops at the finish)
+    RaceState     snapshots[NET_RING];              // state before tick t, at t % NET_RING
+    RaceInput     inputs[RACE_PLAYERS][NET_RING];   // input for tick t, at t % NET_RING
+    int           confirmed[RACE_PLAYERS];          // last tick whose input is known, -1 if none
+    RaceInput     initialInput;                     // predicted before any is known
+    int           peerAck;                          // last local tick the peer has
+    int           rollbackFrom;                     // earliest mispredicted tick, -1 if none
+
+    NetShim       shim;
+    unsigned      shimRng;
+    NetDelayed    delayed[NET_SHIM_QUEUE];
+    int           delayedCount;
+
+    NetStats      stats;
+};
+
+// Binds localPort and sends to peerHost:peerPort. Both peers must use the
+// same seed and lane count.
+bool netOpen(NetSession &n, int localPlayer, int localPort,
+             const char *peerHost, int peerPort,
+             unsigned seed, int lanes, const NetShim &shim);
+void netClose(NetSession &n);
+
+// One frame: receives, rolls back if needed, then simulates the next tick
+// with `local` as this player's input. Returns false if it stalled waiting
+// for the peer (nothing was simulated). `nowMs` is any monotonic clock.
+bool netAdvance(NetSession &n, RaceInput local, double nowMs);
+
+// Receives, rolls back and sends, without simulating a new tick.
+void netSync(NetSession &n, double nowMs);
+
+// True when the current state used no predicted input, i.e. it is final.
+bool netConfirmed(const NetSession &n);
+
+// --net-test: both peers in this process on localhost, scripted inputs,
+// through the shim. Checks they end on the same state as an offline run
+// and prints rollback depth and re-simulation cost.
+int netRunLoopbackTest(int ticks, const NetShim &shim);
+
+#endif // NETPLAY_H
@@ -0,0 +1,362 @@
+// SoA particle pool and its update kernel, see particles.h.
+#include "particles.h"
+
+#include <stdio.h>
+#include <math.h>
+#include <chrono>
+#include <vector>
+#include <algorithm>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define PARTICLES_SSE 1
+#endif
+
+const float PARTICLE_BOUNCE = 0.35f;   // vertical speed kept after a bounce
+
+static int padded(int n) {
+    return (n + PARTICLE_SIMD_WIDTH - 1) & ~(PARTICLE_SIMD_WIDTH - 1);
+}
+
+size_t particlesBytes(int capacity) {
+    // nine arrays, each rounded up to the arena's 16-byte alignment
+    size_t array = ((size_t)padded(capacity) * sizeof(float) + 15) & ~(size_t)15;
+    return 9 * array;
+}
+
+bool particlesInit(ParticleSystem &ps, Arena &a, int capacity) {
+    int n = padded(capacity);
+    ps.x     = arenaNew<float>(a, n);
+    ps.y     = arenaNew<float>(a, n);
+    ps.z     = arenaNew<float>(a, n);
+    ps.vx    = arenaNew<float>(a, n);
+    ps.vy    = arenaNew<float>(a, n);
+    ps.vz    = arenaNew<float>(a, n);
+    ps.life  = arenaNew<float>(a, n);
+    ps.fade  = arenaNew<float>(a, n);
+    ps.color = arenaNew<unsigned>(a, n);
+
+    ps.count    = 0;
+    ps.gravity  = 9.0f;
+    ps.drag     = 0.8f;
+    ps.floorY   = 0.0f;
+    ps.seed     = 12345u;
+    ps.dropped  = 0;
+
+    if (!ps.x || !ps.y || !ps.z || !ps.vx || !ps.vy || !ps.vz ||
+        !ps.life || !ps.fade || !ps.color) {
+        ps.capacity = 0;
+        return false;
+    }
+
+    // the kernel runs over the padding too; keep it finite
+    ps.capacity = capacity;
+    float *arrays[8] = { ps.x, ps.y, ps.z, ps.vx, ps.vy, ps.vz, ps.life, ps.fade };
+    for (int i = 0; i < 8; ++i)
+        memset(arrays[i], 0, sizeof(float) * (size_t)n);
+    return true;
+}
+
+void particlesClear(ParticleSystem &ps) {
+    ps.count = 0;
+}
+
+// ------------- EMIT -------------
+static float randUnit(unsigned &seed) {           // [0, 1)
+    seed = seed * 1664525u + 1013904223u;
+    return (seed >> 8) * (1.0f / 16777216.0f);
+}
+
+static unsigned char toByte(float v) {
+    if (v <= 0.0f) return 0;
+    if (v >= 1.0f) return 255;
+    return (unsigned char)(v * 255.0f + 0.5f);
+}
+
+int particlesEmit(ParticleSystem &ps, const ParticleBurst &b) {
+    int room = ps.capacity - ps.count;
+    int n    = (b.count < room) ? b.count : room;
+    if (n < 0) n = 0;
+    ps.dropped += b.count - n;
+
+    unsigned char rgba[4] = { toByte(b.r), toByte(b.g), toByte(b.b), 255 };
+    unsigned color;
+    memcpy(&color, rgba, sizeof(color));
+
+    for (int k = 0; k < n; ++k) {
+        int i = ps.count++;
+
+        // random direction in the unit cube, pushed out to the sphere's
+        // shell; cheaper than normalizing and looks the same
+        float dx = randUnit(ps.seed) * 2.0f - 1.0f;
+        float dy = randUnit(ps.seed) * 2.0f - 1.0f;
+        float dz = randUnit(ps.seed) * 2.0f - 1.0f;
+        float len2 = dx * dx + dy * dy + dz * dz + 1e-6f;
+        float s = b.speed * (0.5f + randUnit(ps.seed)) / sqrtf(len2);
+
+        float life = b.life * (0.75f + 0.5f * randUnit(ps.seed));
+
+        ps.x[i]     = b.x;
+        ps.y[i]     = b.y;
+        ps.z[i]     = b.z;
+        ps.vx[i]    = dx * s;
+        ps.vy[i]    = dy * s + b.upward * b.speed;
+        ps.vz[i]    = dz * s;
+        ps.life[i]  = life;
+        ps.fade[i]  = 1.0f / life;
+        ps.color[i] = color;
+    }
+    return n;
+}
+
+// ------------- UPDATE -------------
+// Both kernels do the same per particle:
+//   v *= keep; vy -= g dt; p += v dt; life -= dt
+//   below the floor: back on it, vy reflected and damped
+static void updateScalar(ParticleSystem &ps, float dt, int n) {
+    const float keep  = 1.0f - ps.drag * dt;
+    const float gdt   = ps.gravity * dt;
+    const float floor = ps.floorY;
+
+    for (int i = 0; i < n; ++i) {
+        float vx = ps.vx[i] * keep;
+        float vy = ps.vy[i] * keep - gdt;
+        float vz = ps.vz[i] * keep;
+        float y  = ps.y[i] + vy * dt;
+        if (y < floor) {
+            y  = floor;
+            vy = -vy * PARTICLE_BOUNCE;
+        }
+        ps.x[i]  += vx * dt;
+        ps.y[i]   = y;
+        ps.z[i]  += vz * dt;
+        ps.vx[i]  = vx;
+        ps.vy[i]  = vy;
+        ps.vz[i]  = vz;
+        ps.life[i] -= dt;
+    }
+}
+
+#ifdef PARTICLES_SSE
+static void updateSSE(ParticleSystem &ps, float dt, int n) {
+    const __m128 vdt    = _mm_set1_ps(dt);
+    const __m128 keep   = _mm_set1_ps(1.0f - ps.drag * dt);
+    const __m128 gdt    = _mm_set1_ps(ps.gravity * dt);
+    const __m128 floor  = _mm_set1_ps(ps.floorY);
+    const __m128 bounce = _mm_set1_ps(-PARTICLE_BOUNCE);
+
+    for (int i = 0; i < n; i += 4) {
+        __m128 vx = _mm_mul_ps(_mm_load_ps(ps.vx + i), keep);
+        __m128 vy = _mm_sub_ps(_mm_mul_ps(_mm_load_ps(ps.vy + i), keep), gdt);
+        __m128 vz = _mm_mul_ps(_mm_load_ps(ps.vz + i), keep);
+        __m128 y  = _mm_add_ps(_mm_load_ps(ps.y + i), _mm_mul_ps(vy, vdt));
+
+        // bounce without a branch: select the reflected vy where y < floor
+        __m128 under = _mm_cmplt_ps(y, floor);
+        vy = _mm_or_ps(_mm_and_ps(under, _mm_mul_ps(vy, bounce)),
+                       _mm_andnot_ps(under, vy));
+        y  = _mm_max_ps(y, floor);
+
+        _mm_store_ps(ps.x + i, _mm_add_ps(_mm_load_ps(ps.x + i), _mm_mul_ps(vx, vdt)));
+        _mm_store_ps(ps.y + i, y);
+        _mm_store_ps(ps.z + i, _mm_add_ps(_mm_load_ps(ps.z + i), _mm_mul_ps(vz, vdt)));
+        _mm_store_ps(ps.vx + i, vx);
+        _mm_store_ps(ps.vy + i, vy);
+        _mm_store_ps(ps.vz + i, vz);
+        _mm_store_ps(ps.life + i, _mm_sub_ps(_mm_load_ps(ps.life + i), vdt));
+    }
+}
+#endif
+
+static void moveParticle(ParticleSystem &ps, int to, int from) {
+    ps.x[to]     = ps.x[from];
+    ps.y[to]     = ps.y[from];
+    ps.z[to]     = ps.z[from];
+    ps.vx[to]    = ps.vx[from];
+    ps.vy[to]    = ps.vy[from];
+    ps.vz[to]    = ps.vz[from];
+    ps.life[to]  = ps.life[from];
+    ps.fade[to]  = ps.fade[from];
+    ps.color[to] = ps.color[from];
+}
+
+// Swap-removes expired particles. Groups of four with nothing expired
+// (the common case) cost one compare; a moved-in particle is checked
+// again before moving on.
+static void removeExpired(ParticleSystem &ps) {
+    int n = ps.count;
+    int i = 0;
+    while (i < n) {
+#ifdef PARTICLES_SSE
+        if ((i & 3) == 0 && i + 4 <= n &&
+            _mm_movemask_ps(_mm_cmple_ps(_mm_load_ps(ps.life + i), _mm_setzero_ps())) == 0) {
+            i += 4;
+            continue;
+        }
+#endif
+        if (ps.life[i] <= 0.0f) moveParticle(ps, i, --n);
+        else                    ++i;
+    }
+    ps.count = n;
+}
+
+static void updateWith(ParticleSystem &ps, float dt, bool simd) {
+    int n = padded(ps.count);
+#ifdef PARTICLES_SSE
+    if (simd) updateSSE(ps, dt, n);
+    else      updateScalar(ps, dt, n);
+#else
+    (void)simd;
+    updateScalar(ps, dt, n);
+#endif
+    removeExpired(ps);
+}
+
+void particlesUpdate(ParticleSystem &ps, float dt) {
+    updateWith(ps, dt, true);
+}
+
+// ------------- VERTICES -------------
+static void setVertexColor(ParticleVertex &v, unsigned color, float alpha) {
+    memcpy(&v.r, &color, 3);
+    v.a = toByte(alpha);
+}
+
+int particlesBuildPoints(const ParticleSystem &ps, ParticleVertex *out, int maxVertices) {
+    int n = (ps.count < maxVertices) ? ps.count : maxVertices;
+    for (int i = 0; i < n; ++i) {
+        ParticleVertex &v = out[i];
+        v.x = ps.x[i];
+        v.y = ps.y[i];
+        v.z = ps.z[i];
+        setVertexColor(v, ps.color[i], ps.life[i] * ps.fade[i]);
+    }
+    return n;
+}
+
+int particlesBuildQuads(const ParticleSystem &ps, const float right[3], const float up[3],
+                        float size, ParticleVertex *out, int maxVertices) {
+    // corner offsets, shared by every particle
+    float h = size * 0.5f;
+    float c[4][3];
+    for (int k = 0; k < 3; ++k) {
+        c[0][k] = (-right[k] - up[k]) * h;
+        c[1][k] = ( right[k] - up[k]) * h;
+        c[2][k] = ( right[k] + up[k]) * h;
+        c[3][k] = (-right[k] + up[k]) * h;
+    }
+
+    int n = ps.count;
+    if (n > maxVertices / 4) n = maxVertices / 4;
+    for (int i = 0; i < n; ++i) {
+        ParticleVertex *q = out + i * 4;
+        for (int k = 0; k < 4; ++k) {
+            q[k].x = ps.x[i] + c[k][0];
+            q[k].y = ps.y[i] + c[k][1];
+            q[k].z = ps.z[i] + c[k][2];
+            setVertexColor(q[k], ps.color[i], ps.life[i] * ps.fade[i]);
+        }
+    }
+    return n * 4;
+}
+
+// ------------- BENCHMARK -------------
+static double nowMicros() {
+    using namespace std::chrono;
+    return duration_cast<duration<double, std::micro> >(
+        steady_clock::now().time_since_epoch()).count();
+}
+
+static const float BENCH_DT     = 1.0f / 60.0f;
+static const float BENCH_LIFE   = 2.0f;
+static const float BUDGET_MS    = 1.0f;
+
+// Keeps the pool near `count`: the expired are replaced every tick from a
+// few emitters, like a busy screen would.
+static void benchRefill(ParticleSystem &ps, int count) {
+    ParticleBurst b = { 0.0f, 1.0f, -20.0f, 0, 8.0f, 0.5f, BENCH_LIFE, 1.0f, 0.6f, 0.2f };
+    while (ps.count < count) {
+        b.count = count - ps.count;
+        if (b.count > 1000) b.count = 1000;
+        b.x = (float)((ps.count / 1000) % 5 - 2) * 4.0f;
+        particlesEmit(ps, b);
+    }
+}
+
+struct BenchTimes {
+    std::vector<double> update;        // ms per tick
+    double build;                      // ms per points build
+};
+
+static void benchRun(ParticleSystem &ps, int count, int ticks, bool simd,
+                     ParticleVertex *verts, BenchTimes &t) {
+    particlesClear(ps);
+    ps.seed = 1;
+    benchRefill(ps, count);
+    // spread the lives out so expiry is steady, not one wave
+    for (int i = 0; i < 120; ++i) {
+        updateWith(ps, BENCH_DT, simd);
+        benchRefill(ps, count);
+    }
+
+    t.update.assign((size_t)ticks, 0.0);
+    double buildUs = 0.0;
+    for (int k = 0; k < ticks; ++k) {
+        double t0 = nowMicros();
+        updateWith(ps, BENCH_DT, simd);
+        t.update[(size_t)k] = (nowMicros() - t0) / 1000.0;
+        benchRefill(ps, count);
+
+        t0 = nowMicros();
+        particlesBuildPoints(ps, verts, ps.capacity);
+        buildUs += nowMicros() - t0;
+    }
+    t.build = buildUs / 1000.0 / ticks;
+}
+
+static void benchPrint(const char *name, BenchTimes &t) {
+    std::vector<double> s = t.update;
+    std::sort(s.begin(), s.end());
+    double sum = 0.0;
+    for (size_t i = 0; i < s.size(); ++i) sum += s[i];
+    printf("  %-7s update avg %.3f  p50 %.3f  p99 %.3f  max %.3f   points %.3f\n",
+           name, sum / s.size(), s[s.size() / 2], s[s.size() * 99 / 100], s.back(), t.build);
+}
+
+int particlesRunBenchmark(int count, int ticks) {
+    if (count < 1) count = 1;
+    if (ticks < 1) ticks = 1;
+
+    Arena arena;
+    if (!arenaInit(arena, particlesBytes(count) + sizeof(ParticleVertex) * (size_t)count + 64))
+        return 1;
+    ParticleSystem ps;
+    particlesInit(ps, arena, count);
+    ParticleVertex *verts = arenaNew<ParticleVertex>(arena, count);
+
+    printf("particles: %d live, %d ticks of %.1f ms (times in ms per tick)\n",
+           count, ticks, BENCH_DT * 1000.0f);
+
+    BenchTimes simd, scalar;
+#ifdef PARTICLES_SSE
+    benchRun(ps, count, ticks, true, verts, simd);
+    benchPrint("sse", simd);
+#else
+    printf("  (built without SSE2, the scalar kernel is used)\n");
+#endif
+    benchRun(ps, count, ticks, false, verts, scalar);
+    benchPrint("scalar", scalar);
+
+#ifdef PARTICLES_SSE
+    std::vector<double> &u = simd.update;
+#else
+    std::vector<double> &u = scalar.update;
+#endif
+    std::sort(u.begin(), u.end());
+    double p99 = u[u.size() * 99 / 100];
+    printf("  budget %.2f ms: %s (p99 %.3f ms)\n", BUDGET_MS,
+           p99 <= BUDGET_MS ? "met" : "MISSED", p99);
+
+    arenaRelease(arena);
+    return p99 <= BUDGET_MS ? 0 : 2;
+}
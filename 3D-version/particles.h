@@ -0,0 +1,75 @@
+// Particle effects for the 3D runner (shield breaks, pickups, crashes).
+//
+// Particles live in one pool per session, carved from an arena, with each
+// attribute in its own array (SoA): position, velocity, life, fade rate
+// and color. The pool is dense: live particles are 0..count-1 and a dying
+// particle is replaced by the last one. The update kernel therefore walks
+// plain arrays four particles at a time (SSE, scalar fallback) without a
+// per-particle branch, and rendering copies the live range into one vertex
+// array that is drawn with a single call.
+//
+// Nothing here touches GL; main.cpp owns the draw.
+#ifndef PARTICLES_H
+#define PARTICLES_H
+
+#include "arena.h"
+
+const int PARTICLE_SIMD_WIDTH = 4;     // arrays are padded to a multiple
+
+struct ParticleSystem {
+    float    *x, *y, *z;
+    float    *vx, *vy, *vz;
+    float    *life;                    // seconds left
+    float    *fade;                    // 1 / starting life, for alpha
+    unsigned *color;                   // RGBA8, byte order r g b a
+    int       count;
+    int       capacity;
+    float     gravity;                 // world units / s^2, pulls -Y
+    float     drag;                    // fraction of velocity lost per second
+    float     floorY;                  // particles bounce off this plane
+    unsigned  seed;
+    int       dropped;                 // particles that didn't fit, this session
+};
+
+// One effect: `count` particles from a point, in random directions.
+struct ParticleBurst {
+    float x, y, z;
+    int   count;
+    float speed;                       // initial speed, +-50% per particle
+    float upward;                      // added to vy, times speed
+    float life;                        // seconds, +-25% per particle
+    float r, g, b;
+};
+
+// what the renderer uploads; 16 bytes
+struct ParticleVertex {
+    float         x, y, z;
+    unsigned char r, g, b, a;
+};
+
+// arena bytes particlesInit() takes for this capacity
+size_t particlesBytes(int capacity);
+
+bool particlesInit(ParticleSystem &ps, Arena &a, int capacity);
+void particlesClear(ParticleSystem &ps);
+
+// Returns how many particles were added; the rest are counted as dropped.
+int  particlesEmit(ParticleSystem &ps, const ParticleBurst &burst);
+
+// Integrates every live particle and removes the ones that expired.
+void particlesUpdate(ParticleSystem &ps, float dt);
+
+// One vertex per particle (GL_POINTS), alpha fading with life. Returns the
+// vertex count, at most maxVertices.
+int  particlesBuildPoints(const ParticleSystem &ps, ParticleVertex *out, int maxVertices);
+
+// Four vertices per particle (GL_QUADS) facing the camera; `right` and `up`
+// are the camera's axes in world space. Returns the vertex count.
+int  particlesBuildQuads(const ParticleSystem &ps, const float right[3], const float up[3],
+                         float size, ParticleVertex *out, int maxVertices);
+
+// --particle-bench: times update and vertex building at `count` live
+// particles, SIMD against scalar, headless.
+int  particlesRunBenchmark(int count, int ticks);
+
+#endif // PARTICLES_H
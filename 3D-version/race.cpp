@@ -0,0 +1,128 @@
+// Deterministic head-to-head race rules, see race.h.
+#include "race.h"
+
+#include <string.h>
+
+const float RACE_SPAWN_Z      = -80.0f;
+const float RACE_DESPAWN_Z    = 25.0f;
+const float RACE_PLAYER_SIZE  = 1.2f;
+const float RACE_OBSTACLE_LEN = 2.5f;
+const float RACE_SHIELD_LEN   = 1.5f;
+const int   RACE_MAX_SHIELDS  = 3;
+const int   RACE_GRACE_TICKS  = RACE_TICK_RATE * 4 / 10;   // 0.4 s
+
+static unsigned raceRand(RaceState &s) {
+    s.rng = s.rng * 1103515245u + 12345u;
+    return (s.rng >> 16) & 0x7FFF;
+}
+
+static void addObject(RaceState &s, int kind) {
+    if (s.objectCount >= RACE_MAX_OBJECTS) return;
+    RaceObject &o = s.objects[s.objectCount++];
+    o.z    = RACE_SPAWN_Z;
+    o.lane = (int)(raceRand(s) % (unsigned)s.lanes);
+    o.kind = kind;
+}
+
+static void removeObject(RaceState &s, int i) {
+    s.objects[i] = s.objects[--s.objectCount];
+}
+
+void raceInit(RaceState &s, unsigned seed, int lanes) {
+    memset(&s, 0, sizeof(s));          // padding too, for raceChecksum
+    s.rng            = seed;
+    s.lanes          = lanes;
+    s.speed          = 10.0f;
+    s.spawnInterval  = 1.0f;
+    s.nextShieldTick = (20 + (int)(raceRand(s) % 21)) * RACE_TICK_RATE;
+    s.winner         = -1;
+    for (int p = 0; p < RACE_PLAYERS; ++p) {
+        s.players[p].lane  = lanes / 2;
+        s.players[p].alive = 1;
+    }
+}
+
+static bool overlaps(const RaceObject &o, const RacePlayer &p) {
+    float half = (RACE_PLAYER_SIZE + (o.kind == RACE_OBSTACLE ? RACE_OBSTACLE_LEN
+                                                              : RACE_SHIELD_LEN)) * 0.5f;
+    return o.lane == p.lane && o.z >= -half && o.z <= half;
+}
+
+void raceTick(RaceState &s, const RaceInput inputs[RACE_PLAYERS]) {
+    if (s.finished) return;
+    ++s.tick;
+
+    // speed +2 every 15 s, spawns 1.5x as often every 30 s
+    if (s.tick % (15 * RACE_TICK_RATE) == 0) s.speed += 2.0f;
+    if (s.tick % (30 * RACE_TICK_RATE) == 0) {
+        s.spawnInterval /= 1.5f;
+        if (s.spawnInterval < 0.1f) s.spawnInterval = 0.1f;
+    }
+
+    for (int p = 0; p < RACE_PLAYERS; ++p) {
+        RacePlayer &pl = s.players[p];
+        if (!pl.alive) continue;
+        if (inputs[p] < s.lanes) pl.lane = inputs[p];
+        if (pl.graceTicks > 0) --pl.graceTicks;
+        ++pl.score;
+    }
+
+    float dz = s.speed * RACE_TICK_SECONDS;
+    for (int i = s.objectCount - 1; i >= 0; --i) {
+        s.objects[i].z += dz;
+        if (s.objects[i].z > RACE_DESPAWN_Z) removeObject(s, i);
+    }
+
+    s.spawnTimer -= RACE_TICK_SECONDS;
+    if (s.spawnTimer <= 0.0f) {
+        addObject(s, RACE_OBSTACLE);
+        s.spawnTimer = s.spawnInterval;
+    }
+    if (s.tick >= s.nextShieldTick) {
+        addObject(s, RACE_SHIELD);
+        s.nextShieldTick = s.tick + (20 + (int)(raceRand(s) % 21)) * RACE_TICK_RATE;
+    }
+
+    // players in index order, so a shared pickup goes to player 0 on a tie
+    for (int p = 0; p < RACE_PLAYERS; ++p) {
+        RacePlayer &pl = s.players[p];
+        if (!pl.alive) continue;
+
+        for (int i = s.objectCount - 1; i >= 0; --i) {
+            const RaceObject &o = s.objects[i];
+            if (!overlaps(o, pl)) continue;
+
+            if (o.kind == RACE_SHIELD) {
+                if (pl.shields < RACE_MAX_SHIELDS) ++pl.shields;
+                removeObject(s, i);
+            } else if (pl.graceTicks == 0) {
+                if (pl.shields > 0) {
+                    --pl.shields;
+                    pl.graceTicks = RACE_GRACE_TICKS;
+                    removeObject(s, i);
+                } else {
+                    pl.alive = 0;
+                    break;
+                }
+            }
+        }
+    }
+
+    int alive = 0, last = -1;
+    for (int p = 0; p < RACE_PLAYERS; ++p)
+        if (s.players[p].alive) { ++alive; last = p; }
+    if (alive < RACE_PLAYERS) {
+        s.finished = 1;
+        s.winner   = (alive == 1) ? last : -1;
+    }
+}
+
+unsigned raceChecksum(const RaceState &s) {
+    const unsigned char *b = (const unsigned char *)&s;
+    unsigned h = 2166136261u;
+    for (size_t i = 0; i < sizeof(s); ++i) {
+        h ^= b[i];
+        h *= 16777619u;
+    }
+    return h;
+}
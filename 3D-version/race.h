@@ -0,0 +1,66 @@
+// Two-player head-to-head race, simulated in fixed ticks.
+//
+// Both players run on the same seeded track: same obstacles, same shield
+// pickups, each with their own lane and shields. The rules follow the
+// single-player game (speed-ups, spawn rate, shields, grace period), but
+// everything is driven by the tick count and a random generator kept in
+// the state, so the same seed and inputs always give the same race. That
+// is what lets netplay.h roll back and re-simulate.
+//
+// RaceState is plain data of fixed size: a snapshot is a copy.
+#ifndef RACE_H
+#define RACE_H
+
+const int   RACE_PLAYERS       = 2;
+const int   RACE_MAX_OBJECTS   = 128;   // obstacles + pickups on the track
+const int   RACE_TICK_RATE     = 60;
+const float RACE_TICK_SECONDS  = 1.0f / RACE_TICK_RATE;
+
+// A player's input for one tick: the lane they want to be in. Being a
+// state rather than a key press, a repeated (predicted) input is almost
+// always right and a lost one is corrected by the next.
+typedef unsigned char RaceInput;
+
+enum RaceObjectKind {
+    RACE_OBSTACLE,
+    RACE_SHIELD
+};
+
+struct RaceObject {
+    float z;
+    int   lane;
+    int   kind;
+};
+
+struct RacePlayer {
+    int lane;
+    int shields;
+    int alive;
+    int graceTicks;                    // after a shield is used
+    int score;
+};
+
+struct RaceState {
+    int        tick;
+    unsigned   rng;
+    int        lanes;
+    float      speed;
+    float      spawnInterval;
+    float      spawnTimer;
+    int        nextShieldTick;
+    int        finished;               // both players know the result
+    int        winner;                 // player index, -1 for a draw
+    int        objectCount;
+    RaceObject objects[RACE_MAX_OBJECTS];
+    RacePlayer players[RACE_PLAYERS];
+};
+
+void raceInit(RaceState &s, unsigned seed, int lanes);
+
+// Advances one tick; does nothing once the race is finished.
+void raceTick(RaceState &s, const RaceInput inputs[RACE_PLAYERS]);
+
+// For comparing peers' states (FNV-1a over the whole struct).
+unsigned raceChecksum(const RaceState &s);
+
+#endif // RACE_H
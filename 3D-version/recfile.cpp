@@ -0,0 +1,330 @@
+// Columnar recording files: the column codec and the mapped reader, see
+// recfile.h.
+#include "recfile.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define RECFILE_SSE 1
+#endif
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+size_t recTypeSize(uint32_t type) {
+    switch (type) {
+        case REC_U8:  return 1;
+        case REC_U32:
+        case REC_F32: return 4;
+        default:      return 0;
+    }
+}
+
+// ------------- CODEC -------------
+// Byte runs: a control byte below 64 is followed by that many + 1 literal
+// bytes; 64..191 stands for (control - 63) zeros; from 192 up the next byte
+// repeats (control - 189) times.
+static size_t packRuns(const unsigned char *in, size_t n, unsigned char *out) {
+    size_t i = 0, o = 0;
+    while (i < n) {
+        size_t run = 1;
+        size_t most = in[i] == 0 ? 128 : 66;
+        while (i + run < n && in[i + run] == in[i] && run < most) ++run;
+        if (in[i] == 0 && (run >= 2 || i + run == n)) {
+            out[o++] = (unsigned char)(63 + run);
+            i += run;
+            continue;
+        }
+        if (run >= 3) {
+            out[o++] = (unsigned char)(189 + run);
+            out[o++] = in[i];
+            i += run;
+            continue;
+        }
+        // literals, up to the next run
+        size_t start = i, len = 0;
+        while (i < n && len < 64) {
+            if (i + 1 < n && in[i] == 0 && in[i + 1] == 0) break;
+            if (i + 2 < n && in[i + 1] == in[i] && in[i + 2] == in[i]) break;
+            ++i;
+            ++len;
+        }
+        out[o++] = (unsigned char)(len - 1);
+        memcpy(out + o, in + start, len);
+        o += len;
+    }
+    return o;
+}
+
+static bool unpackRuns(const unsigned char *in, size_t n, unsigned char *out, size_t want) {
+    size_t i = 0, o = 0;
+    while (i < n) {
+        unsigned c = in[i++];
+        if (c < 64) {
+            size_t len = c + 1;
+            if (i + len > n || o + len > want) return false;
+            memcpy(out + o, in + i, len);
+            i += len;
+            o += len;
+        } else if (c < 192) {
+            size_t len = c - 63;
+            if (o + len > want) return false;
+            memset(out + o, 0, len);
+            o += len;
+        } else {
+            size_t len = c - 189;
+            if (i >= n || o + len > want) return false;
+            memset(out + o, in[i++], len);
+            o += len;
+        }
+    }
+    return o == want;
+}
+
+// values -> deltas, one byte plane after another
+static void toPlanes(const void *values, int rows, uint32_t type, unsigned char *planes) {
+    const unsigned char *v = (const unsigned char *)values;
+    if (type == REC_U8) {
+        unsigned char prev = 0;
+        for (int i = 0; i < rows; ++i) {
+            planes[i] = (unsigned char)(v[i] - prev);
+            prev = v[i];
+        }
+        return;
+    }
+    unsigned char *p0 = planes, *p1 = p0 + rows, *p2 = p1 + rows, *p3 = p2 + rows;
+    uint32_t prev = 0;
+    for (int i = 0; i < rows; ++i) {
+        uint32_t x, d;
+        memcpy(&x, v + 4 * (size_t)i, 4);
+        d    = type == REC_F32 ? x ^ prev : x - prev;
+        prev = x;
+        p0[i] = (unsigned char)d;
+        p1[i] = (unsigned char)(d >> 8);
+        p2[i] = (unsigned char)(d >> 16);
+        p3[i] = (unsigned char)(d >> 24);
+    }
+}
+
+#ifdef RECFILE_SSE
+// sixteen values at a time: the planes interleaved back into words, then
+// a running XOR or sum across the vector and on from the last one
+static inline __m128i runOn(__m128i d, __m128i &carry, bool xorDeltas) {
+    if (xorDeltas) {
+        d = _mm_xor_si128(d, _mm_slli_si128(d, 4));
+        d = _mm_xor_si128(d, _mm_slli_si128(d, 8));
+        d = _mm_xor_si128(d, carry);
+    } else {
+        d = _mm_add_epi32(d, _mm_slli_si128(d, 4));
+        d = _mm_add_epi32(d, _mm_slli_si128(d, 8));
+        d = _mm_add_epi32(d, carry);
+    }
+    carry = _mm_shuffle_epi32(d, 0xFF);
+    return d;
+}
+
+static int fromPlanesSSE(const unsigned char *planes, int rows, bool xorDeltas,
+                         unsigned char *v, uint32_t &prev) {
+    const unsigned char *p0 = planes, *p1 = p0 + rows, *p2 = p1 + rows, *p3 = p2 + rows;
+    __m128i carry = _mm_setzero_si128();
+    int i = 0;
+    for (; i + 16 <= rows; i += 16) {
+        __m128i b0 = _mm_loadu_si128((const __m128i *)(p0 + i));
+        __m128i b1 = _mm_loadu_si128((const __m128i *)(p1 + i));
+        __m128i b2 = _mm_loadu_si128((const __m128i *)(p2 + i));
+        __m128i b3 = _mm_loadu_si128((const __m128i *)(p3 + i));
+        __m128i lo01 = _mm_unpacklo_epi8(b0, b1), hi01 = _mm_unpackhi_epi8(b0, b1);
+        __m128i lo23 = _mm_unpacklo_epi8(b2, b3), hi23 = _mm_unpackhi_epi8(b2, b3);
+        __m128i *out = (__m128i *)(v + 4 * (size_t)i);
+        _mm_storeu_si128(out + 0, runOn(_mm_unpacklo_epi16(lo01, lo23), carry, xorDeltas));
+        _mm_storeu_si128(out + 1, runOn(_mm_unpackhi_epi16(lo01, lo23), carry, xorDeltas));
+        _mm_storeu_si128(out + 2, runOn(_mm_unpacklo_epi16(hi01, hi23), carry, xorDeltas));
+        _mm_storeu_si128(out + 3, runOn(_mm_unpackhi_epi16(hi01, hi23), carry, xorDeltas));
+    }
+    prev = (uint32_t)_mm_cvtsi128_si32(carry);
+    return i;
+}
+#endif
+
+static void fromPlanes(const unsigned char *planes, int rows, uint32_t type, void *values) {
+    unsigned char *v = (unsigned char *)values;
+    if (type == REC_U8) {
+        unsigned char prev = 0;
+        for (int i = 0; i < rows; ++i)
+            v[i] = prev = (unsigned char)(prev + planes[i]);
+        return;
+    }
+    const unsigned char *p0 = planes, *p1 = p0 + rows, *p2 = p1 + rows, *p3 = p2 + rows;
+    uint32_t prev = 0;
+    int      i    = 0;
+#ifdef RECFILE_SSE
+    i = fromPlanesSSE(planes, rows, type == REC_F32, v, prev);
+#endif
+    if (type == REC_F32) {
+        for (; i < rows; ++i) {
+            prev ^= (uint32_t)p0[i] | (uint32_t)p1[i] << 8 | (uint32_t)p2[i] << 16 | (uint32_t)p3[i] << 24;
+            memcpy(v + 4 * (size_t)i, &prev, 4);
+        }
+    } else {
+        for (; i < rows; ++i) {
+            prev += (uint32_t)p0[i] | (uint32_t)p1[i] << 8 | (uint32_t)p2[i] << 16 | (uint32_t)p3[i] << 24;
+            memcpy(v + 4 * (size_t)i, &prev, 4);
+        }
+    }
+}
+
+size_t recEncodeBound(int rows, uint32_t type) {
+    size_t raw = (size_t)rows * recTypeSize(type);
+    return raw + raw / 64 + 1;
+}
+
+size_t recEncode(const void *values, int rows, uint32_t type, unsigned char *out,
+                 unsigned char *scratch) {
+    toPlanes(values, rows, type, scratch);
+    return packRuns(scratch, (size_t)rows * recTypeSize(type), out);
+}
+
+bool recDecode(const unsigned char *data, size_t bytes, int rows, uint32_t type,
+               void *values, unsigned char *scratch) {
+    if (recTypeSize(type) == 0 ||
+        !unpackRuns(data, bytes, scratch, (size_t)rows * recTypeSize(type)))
+        return false;
+    fromPlanes(scratch, rows, type, values);
+    return true;
+}
+
+// ------------- MAPPING -------------
+static bool mapFile(RecFile &f, const char *path) {
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL,
+                              OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (file == INVALID_HANDLE_VALUE) return false;
+
+    LARGE_INTEGER size;
+    HANDLE mapping = NULL;
+    const void *base = NULL;
+    if (GetFileSizeEx(file, &size) && size.QuadPart > 0)
+        mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (mapping != NULL)
+        base = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (base == NULL) {
+        if (mapping) CloseHandle(mapping);
+        CloseHandle(file);
+        return false;
+    }
+    f.file    = file;
+    f.mapping = mapping;
+    f.base    = (const unsigned char *)base;
+    f.size    = (size_t)size.QuadPart;
+    return true;
+#else
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return false;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        close(fd);
+        return false;
+    }
+    void *p = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);   // the mapping keeps the file alive
+    if (p == MAP_FAILED) return false;
+    madvise(p, (size_t)st.st_size, MADV_SEQUENTIAL);
+
+    f.base = (const unsigned char *)p;
+    f.size = (size_t)st.st_size;
+    return true;
+#endif
+}
+
+void recFileClose(RecFile &f) {
+    if (f.base != NULL) {
+#ifdef _WIN32
+        UnmapViewOfFile(f.base);
+        CloseHandle((HANDLE)f.mapping);
+        CloseHandle((HANDLE)f.file);
+#else
+        munmap((void *)f.base, f.size);
+#endif
+    }
+    memset(&f, 0, sizeof(f));
+}
+
+// ------------- READER -------------
+bool recFileOpen(RecFile &f, const char *path) {
+    memset(&f, 0, sizeof(f));
+    if (!mapFile(f, path)) {
+        fprintf(stderr, "recfile: can't map %s\n", path);
+        return false;
+    }
+
+    const RecFileHeader *h = (const RecFileHeader *)f.base;
+    const char *problem = NULL;
+    if (f.size < sizeof(RecFileHeader) || h->magic != REC_MAGIC)
+        problem = "not a recording";
+    else if (h->version != REC_VERSION)
+        problem = "unsupported version";
+    else if (h->columnCount < 1 || h->columnCount > (uint32_t)REC_MAX_COLUMNS || h->chunkRows < 1 ||
+             h->headerBytes < sizeof(RecFileHeader) + h->columnCount * sizeof(RecColumn) ||
+             h->headerBytes % REC_ALIGN != 0 || h->headerBytes > f.size)
+        problem = "bad header";
+    if (problem == NULL) {
+        const RecColumn *c = (const RecColumn *)(h + 1);
+        for (uint32_t i = 0; i < h->columnCount; ++i)
+            if (recTypeSize(c[i].type) == 0 || memchr(c[i].name, 0, REC_NAME_LEN) == NULL)
+                problem = "bad column";
+    }
+    if (problem) {
+        fprintf(stderr, "recfile: %s: %s\n", path, problem);
+        recFileClose(f);
+        return false;
+    }
+
+    f.header      = h;
+    f.columns     = (const RecColumn *)(h + 1);
+    f.columnCount = (int)h->columnCount;
+    f.complete    = h->chunkCount > 0 && h->indexOffset % 8 == 0 &&
+                    h->indexOffset + (uint64_t)h->chunkCount * 8 <= f.size;
+    return true;
+}
+
+int recFileColumn(const RecFile &f, const char *name) {
+    for (int i = 0; i < f.columnCount; ++i)
+        if (strcmp(f.columns[i].name, name) == 0) return i;
+    return -1;
+}
+
+const RecChunkHeader *recFileChunk(const RecFile &f, uint64_t offset) {
+    size_t table = sizeof(RecChunkHeader) + sizeof(uint32_t) * (size_t)f.columnCount;
+    if (offset % REC_ALIGN != 0 || offset + table > f.size) return NULL;
+
+    const RecChunkHeader *c = (const RecChunkHeader *)(f.base + offset);
+    if (c->magic != REC_CHUNK_MAGIC || c->rows < 1 || c->rows > f.header->chunkRows ||
+        c->bytes < table || c->bytes % REC_ALIGN != 0 || offset + c->bytes > f.size)
+        return NULL;
+    const uint32_t *sizes = (const uint32_t *)(c + 1);
+    uint64_t data = 0;
+    for (int i = 0; i < f.columnCount; ++i) data += sizes[i];
+    return table + data <= c->bytes ? c : NULL;
+}
+
+uint32_t recFileColumnBytes(const RecChunkHeader *c, int column) {
+    return ((const uint32_t *)(c + 1))[column];
+}
+
+bool recFileDecode(const RecFile &f, const RecChunkHeader *c, int column, void *values,
+                   unsigned char *scratch) {
+    const uint32_t      *sizes = (const uint32_t *)(c + 1);
+    const unsigned char *data  = (const unsigned char *)(sizes + f.columnCount);
+    for (int i = 0; i < column; ++i) data += sizes[i];
+    return recDecode(data, sizes[column], (int)c->rows, f.columns[column].type, values, scratch);
+}
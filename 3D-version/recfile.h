@@ -0,0 +1,116 @@
+// Columnar recording files: what --record writes (recorder.h) and
+// recread reads.
+//
+// A recording is a table with one row per tick. Rows are stored in chunks
+// of up to chunkRows, and inside a chunk each column's values are stored
+// together and compressed on their own. Layout (all little-endian):
+//   RecFileHeader
+//   RecColumn[columnCount]                    the schema
+//   chunks, each starting on a REC_ALIGN boundary (the first at headerBytes):
+//     RecChunkHeader
+//     uint32 columnBytes[columnCount]          compressed size of each
+//     the columns' data, back to back
+//   uint64 chunkOffset[chunkCount] at indexOffset
+//
+// The counts and the index are filled in when the recording is closed; a
+// recording that didn't end cleanly has them at 0, and its chunks can
+// still be walked from the first one by their sizes. Everything is at
+// fixed offsets, so a reader maps the file and decodes chunks in place.
+//
+// Each column is coded as deltas from the value before (XOR of the bits
+// for floats, a difference for integers), split into byte planes (every
+// value's low byte, then the next byte, ...), with runs of a repeated
+// byte packed. Values that change slowly, steadily or not at all cost next
+// to nothing and decoding is a linear pass.
+#ifndef RECFILE_H
+#define RECFILE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+const uint32_t REC_MAGIC       = 0x31434552;   // "REC1"
+const uint32_t REC_CHUNK_MAGIC = 0x4B4E4843;   // "CHNK"
+const uint32_t REC_VERSION     = 1;
+const uint32_t REC_ALIGN       = 64;
+const int      REC_NAME_LEN    = 24;
+const int      REC_MAX_COLUMNS = 64;
+
+enum RecType {
+    REC_U8  = 1,
+    REC_U32 = 2,
+    REC_F32 = 3
+};
+
+struct RecFileHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t headerBytes;              // header and schema, padded: the first chunk
+    uint32_t columnCount;
+    uint32_t chunkRows;                // rows per chunk, the last may have fewer
+    uint32_t chunkCount;               // 0 until closed
+    uint64_t rowCount;                 // 0 until closed
+    uint64_t indexOffset;              // 0 until closed
+    char     description[64];          // what recorded it, free text
+};
+
+struct RecColumn {
+    char     name[REC_NAME_LEN];
+    uint32_t type;                     // RecType
+    uint32_t reserved;
+};
+
+struct RecChunkHeader {
+    uint32_t magic;
+    uint32_t rows;
+    uint32_t bytes;                    // to the next chunk, padding included
+    uint32_t reserved;
+    uint64_t firstRow;
+};
+
+size_t recTypeSize(uint32_t type);
+
+// ------------- CODEC -------------
+// Largest encoding of `rows` values of a type.
+size_t recEncodeBound(int rows, uint32_t type);
+
+// Encodes rows values into out (recEncodeBound() bytes) and returns the
+// size. scratch holds rows values of the type.
+size_t recEncode(const void *values, int rows, uint32_t type, unsigned char *out,
+                 unsigned char *scratch);
+
+// false if `bytes` of data don't decode to exactly `rows` values.
+bool   recDecode(const unsigned char *data, size_t bytes, int rows, uint32_t type,
+                 void *values, unsigned char *scratch);
+
+// ------------- READER -------------
+struct RecFile {
+    const unsigned char *base;         // the whole file, mapped
+    size_t               size;
+    const RecFileHeader *header;
+    const RecColumn     *columns;
+    int                  columnCount;
+    bool                 complete;     // closed cleanly: counts and index are set
+#ifdef _WIN32
+    void                *file, *mapping;
+#endif
+};
+
+// false (and logs) if the file can't be mapped or isn't a recording.
+bool recFileOpen(RecFile &f, const char *path);
+void recFileClose(RecFile &f);
+
+int  recFileColumn(const RecFile &f, const char *name);   // -1 if missing
+
+// The chunk at `offset`, or NULL past the last one or if it doesn't check
+// out. The first is at header->headerBytes, the next at offset + bytes.
+const RecChunkHeader *recFileChunk(const RecFile &f, uint64_t offset);
+
+// One column of a chunk into values (rows of the column's type); scratch
+// is as large.
+bool recFileDecode(const RecFile &f, const RecChunkHeader *c, int column, void *values,
+                   unsigned char *scratch);
+
+// Compressed size of one column of a chunk.
+uint32_t recFileColumnBytes(const RecChunkHeader *c, int column);
+
+#endif // RECFILE_H
@@ -0,0 +1,431 @@
+// Columnar tick recorder and its compression thread, see recorder.h.
+#include "recorder.h"
+#include "vecenv.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+struct RecorderJob {
+    int      buffer;
+    int      rows;
+    uint64_t firstRow;
+};
+
+struct RecorderWorker {
+    std::thread             thread;
+    std::mutex              lock;              // only for waiting on `wake`
+    std::condition_variable wake;
+    std::atomic<bool>       stop;
+
+    // single producer / single consumer rings, as the audio command queue:
+    // full buffers to the worker, empty ones back to the game
+    RecorderJob             jobs[RECORDER_BUFFERS];
+    std::atomic<unsigned>   jobHead, jobTail;
+    int                     spare[RECORDER_BUFFERS];
+    std::atomic<unsigned>   spareHead, spareTail;
+
+    // the worker's own until it is joined
+    FILE                   *file;
+    RecFileHeader           header;
+    uint64_t                offset;            // where the next chunk goes
+    std::vector<uint64_t>   index;
+    unsigned char          *encoded;
+    unsigned char          *scratch;
+
+    std::atomic<long>       chunks;
+    std::atomic<int64_t>    encodeNs;
+    std::atomic<uint64_t>   rawBytes, fileBytes;
+    std::atomic<bool>       failed;
+};
+
+static size_t alignUp(size_t n, size_t to) {
+    return (n + to - 1) & ~(to - 1);
+}
+
+// ------------- WORKER -------------
+static void writeChunk(Recorder &r, const RecorderJob &job) {
+    RecorderWorker *w = r.worker;
+    double start = vecEnvSeconds();
+
+    RecChunkHeader *h     = (RecChunkHeader *)w->encoded;
+    uint32_t       *sizes = (uint32_t *)(h + 1);
+    size_t at  = sizeof(RecChunkHeader) + sizeof(uint32_t) * (size_t)r.columnCount;
+    size_t raw = 0;
+    for (int c = 0; c < r.columnCount; ++c) {
+        sizes[c] = (uint32_t)recEncode(r.buffers[job.buffer] + r.columnOffset[c], job.rows,
+                                       r.types[c], w->encoded + at, w->scratch);
+        at  += sizes[c];
+        raw += (size_t)job.rows * recTypeSize(r.types[c]);
+    }
+    size_t bytes = alignUp(at, REC_ALIGN);
+    memset(w->encoded + at, 0, bytes - at);
+    h->magic    = REC_CHUNK_MAGIC;
+    h->rows     = (uint32_t)job.rows;
+    h->bytes    = (uint32_t)bytes;
+    h->reserved = 0;
+    h->firstRow = job.firstRow;
+    w->encodeNs += (int64_t)((vecEnvSeconds() - start) * 1e9);
+
+    if (w->failed.load(std::memory_order_relaxed))
+        return;
+    // flushed per chunk, so whatever was written is readable after a crash
+    if (fwrite(w->encoded, 1, bytes, w->file) != bytes || fflush(w->file) != 0) {
+        fprintf(stderr, "recorder: write failed, the recording stops here\n");
+        w->failed.store(true);
+        return;
+    }
+    w->index.push_back(w->offset);
+    w->offset += bytes;
+    w->rawBytes += raw;
+    w->fileBytes += bytes;
+    ++w->chunks;
+}
+
+static void workerMain(Recorder *r) {
+    RecorderWorker *w = r->worker;
+    const unsigned MASK = RECORDER_BUFFERS - 1;
+    for (;;) {
+        bool stopping = w->stop.load(std::memory_order_acquire);
+        unsigned tail = w->jobTail.load(std::memory_order_relaxed);
+        if (tail != w->jobHead.load(std::memory_order_acquire)) {
+            RecorderJob job = w->jobs[tail & MASK];
+            writeChunk(*r, job);
+            w->jobTail.store(tail + 1, std::memory_order_release);
+
+            unsigned head = w->spareHead.load(std::memory_order_relaxed);
+            w->spare[head & MASK] = job.buffer;
+            w->spareHead.store(head + 1, std::memory_order_release);
+            continue;
+        }
+        if (stopping) break;
+        // the game doesn't lock to notify, so a wakeup can be missed: the
+        // timeout bounds how long a chunk waits then
+        std::unique_lock<std::mutex> lock(w->lock);
+        w->wake.wait_for(lock, std::chrono::milliseconds(20));
+    }
+}
+
+// ------------- GAME THREAD -------------
+static bool takeSpare(Recorder &r) {
+    RecorderWorker *w = r.worker;
+    unsigned tail = w->spareTail.load(std::memory_order_relaxed);
+    if (tail == w->spareHead.load(std::memory_order_acquire))
+        return false;
+    r.filling = w->spare[tail & (RECORDER_BUFFERS - 1)];
+    r.row     = 0;
+    w->spareTail.store(tail + 1, std::memory_order_release);
+    return true;
+}
+
+// there are as many ring slots as buffers, so this never finds it full
+static void handOff(Recorder &r) {
+    RecorderWorker *w = r.worker;
+    unsigned head = w->jobHead.load(std::memory_order_relaxed);
+    RecorderJob &job = w->jobs[head & (RECORDER_BUFFERS - 1)];
+    job.buffer   = r.filling;
+    job.rows     = r.row;
+    job.firstRow = r.rows - (uint64_t)r.row;
+    w->jobHead.store(head + 1, std::memory_order_release);
+    w->wake.notify_one();
+    r.filling = -1;
+}
+
+bool recorderBegin(Recorder &r) {
+    if (r.worker == NULL) return false;
+    if (r.filling < 0 && !takeSpare(r)) {
+        ++r.dropped;                   // drop rather than block the frame
+        return false;
+    }
+    return true;
+}
+
+void recorderEnd(Recorder &r) {
+    ++r.row;
+    ++r.rows;
+    if (r.row == r.chunkRows)
+        handOff(r);
+}
+
+// ------------- OPEN / CLOSE -------------
+bool recorderOpen(Recorder &r, const char *path, const RecorderColumn *columns, int count,
+                  const char *description, int chunkRows) {
+    memset(&r, 0, sizeof(r));
+    r.filling = -1;
+    if (count < 1 || count > REC_MAX_COLUMNS || chunkRows < 1) {
+        fprintf(stderr, "recorder: need 1..%d columns\n", REC_MAX_COLUMNS);
+        return false;
+    }
+    for (int c = 0; c < count; ++c)
+        if (strlen(columns[c].name) >= (size_t)REC_NAME_LEN || recTypeSize(columns[c].type) == 0) {
+            fprintf(stderr, "recorder: bad column %s\n", columns[c].name);
+            return false;
+        }
+
+    // the chunk buffers: one array per column, 16-byte aligned
+    size_t bufferBytes = 0, encodedBytes = sizeof(RecChunkHeader) + REC_ALIGN;
+    for (int c = 0; c < count; ++c) {
+        r.types[c]        = (uint32_t)columns[c].type;
+        r.columnOffset[c] = bufferBytes;
+        bufferBytes  += alignUp((size_t)chunkRows * recTypeSize(r.types[c]), 16);
+        encodedBytes += sizeof(uint32_t) + recEncodeBound(chunkRows, r.types[c]);
+    }
+    size_t scratchBytes = (size_t)chunkRows * 4;
+    if (!arenaInit(r.arena, RECORDER_BUFFERS * (bufferBytes + 16) + encodedBytes + scratchBytes + 64))
+        return false;
+    for (int i = 0; i < RECORDER_BUFFERS; ++i)
+        r.buffers[i] = (unsigned char *)arenaAlloc(r.arena, bufferBytes);
+    r.columnCount = count;
+    r.chunkRows   = chunkRows;
+
+    FILE *f = fopen(path, "wb");
+    if (!f) {
+        fprintf(stderr, "recorder: can't create %s\n", path);
+        arenaRelease(r.arena);
+        return false;
+    }
+
+    // the header and schema; the counts are written at close
+    RecFileHeader h;
+    memset(&h, 0, sizeof(h));
+    h.magic       = REC_MAGIC;
+    h.version     = REC_VERSION;
+    h.headerBytes = (uint32_t)alignUp(sizeof(RecFileHeader) + sizeof(RecColumn) * (size_t)count, REC_ALIGN);
+    h.columnCount = (uint32_t)count;
+    h.chunkRows   = (uint32_t)chunkRows;
+    strncpy(h.description, description ? description : "", sizeof(h.description) - 1);
+    std::vector<unsigned char> head(h.headerBytes, 0);
+    memcpy(&head[0], &h, sizeof(h));
+    RecColumn *schema = (RecColumn *)(&head[0] + sizeof(h));
+    for (int c = 0; c < count; ++c) {
+        strcpy(schema[c].name, columns[c].name);
+        schema[c].type = r.types[c];
+    }
+    if (fwrite(&head[0], 1, head.size(), f) != head.size() || fflush(f) != 0) {
+        fprintf(stderr, "recorder: can't write %s\n", path);
+        fclose(f);
+        arenaRelease(r.arena);
+        return false;
+    }
+
+    RecorderWorker *w = new RecorderWorker();
+    w->stop.store(false);
+    w->jobHead.store(0);
+    w->jobTail.store(0);
+    for (int i = 0; i < RECORDER_BUFFERS; ++i) w->spare[i] = i;
+    w->spareHead.store(RECORDER_BUFFERS);
+    w->spareTail.store(0);
+    w->file     = f;
+    w->header   = h;
+    w->offset   = h.headerBytes;
+    w->encoded  = (unsigned char *)arenaAlloc(r.arena, encodedBytes);
+    w->scratch  = (unsigned char *)arenaAlloc(r.arena, scratchBytes);
+    w->chunks.store(0);
+    w->encodeNs.store(0);
+    w->rawBytes.store(0);
+    w->fileBytes.store(0);
+    w->failed.store(false);
+    r.worker = w;
+    w->thread = std::thread(workerMain, &r);
+    return true;
+}
+
+bool recorderActive(const Recorder &r) {
+    return r.worker != NULL;
+}
+
+RecorderStats recorderClose(Recorder &r) {
+    RecorderWorker *w = r.worker;
+    if (w == NULL) return recorderStats(r);
+    if (r.filling >= 0 && r.row > 0)
+        handOff(r);
+    w->stop.store(true, std::memory_order_release);
+    w->wake.notify_one();
+    w->thread.join();
+
+    // the index after the last chunk, then the counts in the header
+    if (!w->failed.load()) {
+        RecFileHeader &h = w->header;
+        h.chunkCount  = (uint32_t)w->index.size();
+        h.rowCount    = r.rows;
+        h.indexOffset = w->offset;
+        bool ok = w->index.empty() ||
+                  fwrite(&w->index[0], sizeof(uint64_t), w->index.size(), w->file) == w->index.size();
+        ok = ok && fseek(w->file, 0, SEEK_SET) == 0 && fwrite(&h, sizeof(h), 1, w->file) == 1;
+        if (!ok) fprintf(stderr, "recorder: can't finish the file, it reads as unfinished\n");
+    }
+    fclose(w->file);
+    w->file = NULL;
+
+    RecorderStats s = recorderStats(r);
+    r.worker = NULL;
+    delete w;
+    arenaRelease(r.arena);
+    return s;
+}
+
+RecorderStats recorderStats(const Recorder &r) {
+    RecorderStats s;
+    memset(&s, 0, sizeof(s));
+    s.rows    = r.rows;
+    s.dropped = r.dropped;
+    if (r.worker) {
+        const RecorderWorker *w = r.worker;
+        s.chunks       = w->chunks.load(std::memory_order_relaxed);
+        s.rawBytes     = w->rawBytes.load(std::memory_order_relaxed);
+        s.fileBytes    = w->fileBytes.load(std::memory_order_relaxed);
+        s.encodeMicros = s.chunks ? (double)w->encodeNs.load(std::memory_order_relaxed) / 1000.0 / s.chunks : 0.0;
+        s.failed       = w->failed.load(std::memory_order_relaxed);
+    }
+    return s;
+}
+
+// ------------- BENCHMARK -------------
+enum BenchColumn {
+    BENCH_TICK,
+    BENCH_ACTION,
+    BENCH_REWARD,
+    BENCH_DONE,
+    BENCH_OBS                          // + feature
+};
+
+// the run, one row per tick: the observation, then what came of the action
+struct BenchRun {
+    Arena         arena;
+    VecEnv        v;
+    float         obs[VECENV_MAX_OBS], next[VECENV_MAX_OBS];
+    int           action;
+    float         reward;
+    unsigned char done;
+};
+
+static bool benchStart(BenchRun &b, int lanes) {
+    if (!arenaInit(b.arena, vecEnvBytes(1, lanes)) || !vecEnvInit(b.v, b.arena, 1, lanes, 3u, 0))
+        return false;
+    vecEnvReset(b.v, b.next);
+    return true;
+}
+
+static void benchStep(BenchRun &b) {
+    memcpy(b.obs, b.next, sizeof(b.obs));
+    vecEnvAutopilot(b.v, &b.action);
+    vecEnvStep(b.v, &b.action, b.next, &b.reward, &b.done);
+}
+
+int recorderRunBenchmark(int rows, const char *path) {
+    const int LANES = 5;
+    const int OBS   = vecEnvObsSize(LANES);
+    if (rows < 1) rows = 1;
+    const char *file = path ? path : "record-bench.rec";
+
+    RecorderColumn columns[REC_MAX_COLUMNS] = {
+        { "tick", REC_U32 }, { "action", REC_U8 }, { "reward", REC_F32 }, { "done", REC_U8 }
+    };
+    char names[VECENV_MAX_OBS][REC_NAME_LEN];
+    for (int k = 0; k < OBS; ++k) {
+        sprintf(names[k], "obs_%d", k);
+        columns[BENCH_OBS + k].name = names[k];
+        columns[BENCH_OBS + k].type = REC_F32;
+    }
+    const int COLUMNS = BENCH_OBS + OBS;
+
+    BenchRun run;
+    Recorder rec;
+    if (!benchStart(run, LANES) || !recorderOpen(rec, file, columns, COLUMNS, "runner3d --record-bench"))
+        return 1;
+    printf("record bench: %d rows of %d columns (a %d-lane run, the planner playing) to %s\n",
+           rows, COLUMNS, LANES, file);
+
+    // rows come far faster than a 60 Hz game makes them; when every buffer
+    // is queued the bench waits for the worker, the game would drop the row
+    std::vector<double> each((size_t)rows);
+    long   waits = 0;
+    double start = vecEnvSeconds();
+    for (int i = 0; i < rows; ++i) {
+        benchStep(run);
+        double t0 = vecEnvSeconds();
+        while (!recorderBegin(rec)) {
+            std::this_thread::yield();
+            ++waits;
+            t0 = vecEnvSeconds();
+        }
+        recorderU32(rec, BENCH_TICK, (uint32_t)i);
+        recorderU8(rec, BENCH_ACTION, (uint8_t)run.action);
+        recorderF32(rec, BENCH_REWARD, run.reward);
+        recorderU8(rec, BENCH_DONE, run.done);
+        for (int k = 0; k < OBS; ++k)
+            recorderF32(rec, BENCH_OBS + k, run.obs[k]);
+        recorderEnd(rec);
+        each[(size_t)i] = vecEnvSeconds() - t0;
+    }
+    double t0 = vecEnvSeconds();
+    RecorderStats s = recorderClose(rec);
+    double closing = vecEnvSeconds() - t0, total = vecEnvSeconds() - start;
+    arenaRelease(run.arena);
+
+    std::sort(each.begin(), each.end());
+    printf("  recording thread: p50 %.0f ns  p99 %.0f ns  max %.1f us per row, %ld waits for a buffer\n",
+           each[each.size() / 2] * 1e9, each[each.size() * 99 / 100] * 1e9, each.back() * 1e6, waits);
+    printf("  worker: %ld chunks, %.0f us each, %.0f MB/s of rows; close %.1f ms\n",
+           s.chunks, s.encodeMicros, s.chunks ? s.rawBytes / (s.encodeMicros * s.chunks) : 0.0,
+           closing * 1000.0);
+    printf("  %.1f MB of rows -> %.2f MB on disk (%.1fx), %.1f bytes a row, %.2f s in all\n",
+           s.rawBytes / 1e6, s.fileBytes / 1e6, s.fileBytes ? (double)s.rawBytes / s.fileBytes : 0.0,
+           (double)s.fileBytes / rows, total);
+
+    // read it back against the same run played again
+    RecFile f;
+    if (!recFileOpen(f, file)) return 1;
+    bool ok = f.complete && f.header->rowCount == (uint64_t)rows && !s.failed;
+    std::vector<unsigned char> scratch((size_t)f.header->chunkRows * 4);
+    std::vector<float>         obs((size_t)f.header->chunkRows * OBS), reward(f.header->chunkRows);
+    std::vector<uint32_t>      tick(f.header->chunkRows);
+    std::vector<unsigned char> action(f.header->chunkRows), done(f.header->chunkRows);
+    const uint64_t *index = (const uint64_t *)(f.base + f.header->indexOffset);
+    int checked = 0;
+    if (ok && benchStart(run, LANES)) {
+        for (uint32_t c = 0; ok && c < f.header->chunkCount; ++c) {
+            const RecChunkHeader *ch = recFileChunk(f, index[c]);
+            ok = ch && recFileDecode(f, ch, BENCH_TICK, &tick[0], &scratch[0]) &&
+                 recFileDecode(f, ch, BENCH_ACTION, &action[0], &scratch[0]) &&
+                 recFileDecode(f, ch, BENCH_REWARD, &reward[0], &scratch[0]) &&
+                 recFileDecode(f, ch, BENCH_DONE, &done[0], &scratch[0]);
+            for (int k = 0; ok && k < OBS; ++k)
+                ok = recFileDecode(f, ch, BENCH_OBS + k, &obs[(size_t)k * f.header->chunkRows], &scratch[0]);
+            for (uint32_t i = 0; ok && i < ch->rows; ++i, ++checked) {
+                benchStep(run);
+                ok = tick[i] == (uint32_t)checked && action[i] == run.action &&
+                     reward[i] == run.reward && done[i] == run.done;
+                for (int k = 0; ok && k < OBS; ++k)
+                    ok = obs[(size_t)k * f.header->chunkRows + i] == run.obs[k];
+            }
+        }
+        arenaRelease(run.arena);
+    }
+    printf("  read back: %d of %d rows match%s\n", ok ? checked : checked - 1, rows,
+           ok && checked == rows ? "" : "  MISMATCH");
+    ok = ok && checked == rows;
+
+    // decoding every column of every chunk, walked the way an unfinished
+    // file would be
+    double decodeStart = vecEnvSeconds();
+    uint64_t decoded = 0;
+    for (uint64_t at = f.header->headerBytes; const RecChunkHeader *ch = recFileChunk(f, at); at += ch->bytes)
+        for (int c = 0; c < f.columnCount; ++c) {
+            recFileDecode(f, ch, c, &obs[0], &scratch[0]);
+            decoded += ch->rows * recTypeSize(f.columns[c].type);
+        }
+    double decodeSeconds = vecEnvSeconds() - decodeStart;
+    printf("  decode: %.0f MB/s of rows, %.0f MB/s of file\n", decoded / decodeSeconds / 1e6,
+           s.fileBytes / decodeSeconds / 1e6);
+
+    recFileClose(f);
+    if (!path) remove(file);
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,81 @@
+// Records a table of one row per tick into a columnar file (recfile.h)
+// without slowing the tick down.
+//
+// The game thread writes rows straight into a chunk buffer, one array per
+// column. When a chunk is full it goes to a worker thread, which
+// compresses and writes it, and the game carries on in the next free
+// buffer. Buffers are handed over through two single-producer rings, so
+// the game thread never waits or allocates; if the worker falls behind
+// and none is free, rows are dropped and counted instead.
+#ifndef RECORDER_H
+#define RECORDER_H
+
+#include "arena.h"
+#include "recfile.h"
+
+const int RECORDER_BUFFERS    = 4;
+const int RECORDER_CHUNK_ROWS = 4096;  // about a minute at 60 Hz
+
+struct RecorderColumn {
+    const char *name;
+    RecType     type;
+};
+
+struct RecorderStats {
+    uint64_t rows, dropped;
+    long     chunks;                   // written
+    uint64_t rawBytes, fileBytes;      // of the chunks written
+    double   encodeMicros;             // per chunk, on the worker
+    bool     failed;                   // a write failed, nothing more is written
+};
+
+struct RecorderWorker;                 // the compression thread, recorder.cpp
+
+struct Recorder {
+    Arena          arena;              // chunk buffers, the worker's buffers
+    int            columnCount;
+    int            chunkRows;
+    uint32_t       types[REC_MAX_COLUMNS];
+    size_t         columnOffset[REC_MAX_COLUMNS];   // in a chunk buffer
+    unsigned char *buffers[RECORDER_BUFFERS];
+    int            filling;            // buffer being filled, -1 if none was free
+    int            row;                // next row in it
+    uint64_t       rows, dropped;
+    RecorderWorker *worker;
+};
+
+// Creates the file and starts the worker; false (and logs) if it can't.
+// The worker keeps a pointer to r, so it mustn't move until closed.
+bool recorderOpen(Recorder &r, const char *path, const RecorderColumn *columns, int count,
+                  const char *description, int chunkRows = RECORDER_CHUNK_ROWS);
+
+// Writes what is left, the index and the counts; waits for the worker.
+// Returns the final stats.
+RecorderStats recorderClose(Recorder &r);
+bool recorderActive(const Recorder &r);
+
+// A row is recorderBegin(), a value for each column, recorderEnd().
+// recorderBegin() returns false if the row is dropped; skip the rest then.
+bool recorderBegin(Recorder &r);
+void recorderEnd(Recorder &r);
+
+inline void recorderU8(Recorder &r, int column, uint8_t v) {
+    r.buffers[r.filling][r.columnOffset[column] + r.row] = v;
+}
+inline void recorderU32(Recorder &r, int column, uint32_t v) {
+    memcpy(r.buffers[r.filling] + r.columnOffset[column] + 4 * (size_t)r.row, &v, 4);
+}
+inline void recorderF32(Recorder &r, int column, float v) {
+    memcpy(r.buffers[r.filling] + r.columnOffset[column] + 4 * (size_t)r.row, &v, 4);
+}
+
+RecorderStats recorderStats(const Recorder &r);
+
+// --record-bench [rows] [file]: records a run of the batched environment
+// (vecenv.h) with the planner playing, reads it back and checks it; prints
+// the cost of a row on the recording thread, the worker's throughput and
+// the compression ratio. Without a file it writes record-bench.rec and
+// removes it after.
+int  recorderRunBenchmark(int rows, const char *path);
+
+#endif // RECORDER_H
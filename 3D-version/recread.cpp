@@ -0,0 +1,182 @@
+// Reads a recording made with --record (recfile.h).
+//
+//   recread <file.rec>                        the schema, sizes and ratios
+//   recread <file.rec> -csv [column ...]      rows as CSV, all columns or those
+//   recread <file.rec> -b                     read speed: the file, then decoded
+//
+// A recording that didn't end cleanly is read up to its last whole chunk.
+#include "recfile.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <vector>
+
+static const char *typeNames[] = { "?", "u8", "u32", "f32" };
+
+static double nowSeconds() {
+    using namespace std::chrono;
+    return duration<double>(steady_clock::now().time_since_epoch()).count();
+}
+
+// the chunks in order: through the index when the file was closed, else
+// chained by their sizes from the first
+struct ChunkWalk {
+    const RecFile *f;
+    uint32_t       next;
+    uint64_t       offset;
+};
+
+static ChunkWalk walkStart(const RecFile &f) {
+    ChunkWalk w = { &f, 0, f.header->headerBytes };
+    return w;
+}
+
+static const RecChunkHeader *walkNext(ChunkWalk &w) {
+    const RecFile &f = *w.f;
+    if (f.complete) {
+        if (w.next >= f.header->chunkCount) return NULL;
+        const uint64_t *index = (const uint64_t *)(f.base + f.header->indexOffset);
+        return recFileChunk(f, index[w.next++]);
+    }
+    const RecChunkHeader *c = recFileChunk(f, w.offset);
+    if (c) w.offset += c->bytes;
+    return c;
+}
+
+// ------------- SUMMARY -------------
+static int summary(const RecFile &f) {
+    const RecFileHeader &h = *f.header;
+    std::vector<uint64_t> packed(f.columnCount, 0);
+    uint64_t rows = 0, chunks = 0;
+    ChunkWalk w = walkStart(f);
+    while (const RecChunkHeader *c = walkNext(w)) {
+        for (int i = 0; i < f.columnCount; ++i)
+            packed[i] += recFileColumnBytes(c, i);
+        rows += c->rows;
+        ++chunks;
+    }
+
+    printf("%.*s\n", (int)sizeof(h.description), h.description);
+    printf("%llu rows in %llu chunks of up to %u, %.2f MB%s\n",
+           (unsigned long long)rows, (unsigned long long)chunks, h.chunkRows, f.size / 1e6,
+           f.complete ? "" : ", unfinished");
+    uint64_t raw = 0, total = 0;
+    for (int i = 0; i < f.columnCount; ++i) {
+        const RecColumn &col = f.columns[i];
+        uint64_t bytes = rows * recTypeSize(col.type);
+        raw   += bytes;
+        total += packed[i];
+        printf("  %-24s %-3s %10llu B  %6.1fx\n", col.name, typeNames[col.type],
+               (unsigned long long)packed[i], packed[i] ? (double)bytes / packed[i] : 0.0);
+    }
+    printf("  %-24s     %10llu B  %6.1fx\n", "all columns",
+           (unsigned long long)total, total ? (double)raw / total : 0.0);
+    return 0;
+}
+
+// ------------- CSV -------------
+static int dumpCsv(const RecFile &f, char **names, int nameCount) {
+    std::vector<int> picked;
+    for (int i = 0; i < nameCount; ++i) {
+        int c = recFileColumn(f, names[i]);
+        if (c < 0) {
+            fprintf(stderr, "recread: no column %s\n", names[i]);
+            return 1;
+        }
+        picked.push_back(c);
+    }
+    if (picked.empty())
+        for (int c = 0; c < f.columnCount; ++c) picked.push_back(c);
+
+    const size_t chunkRows = f.header->chunkRows;
+    std::vector<unsigned char> values(picked.size() * chunkRows * 4), scratch(chunkRows * 4);
+    for (size_t i = 0; i < picked.size(); ++i)
+        printf("%s%s", i ? "," : "", f.columns[picked[i]].name);
+    printf("\n");
+
+    ChunkWalk w = walkStart(f);
+    while (const RecChunkHeader *c = walkNext(w)) {
+        for (size_t i = 0; i < picked.size(); ++i)
+            if (!recFileDecode(f, c, picked[i], &values[i * chunkRows * 4], &scratch[0])) {
+                fprintf(stderr, "recread: chunk at row %llu doesn't decode\n",
+                        (unsigned long long)c->firstRow);
+                return 1;
+            }
+        for (uint32_t r = 0; r < c->rows; ++r)
+            for (size_t i = 0; i < picked.size(); ++i) {
+                const unsigned char *v = &values[i * chunkRows * 4];
+                const char *sep = i + 1 < picked.size() ? "," : "\n";
+                switch (f.columns[picked[i]].type) {
+                    case REC_U8:  printf("%u%s", v[r], sep); break;
+                    case REC_U32: printf("%u%s", ((const uint32_t *)v)[r], sep); break;
+                    default:      printf("%.9g%s", ((const float *)v)[r], sep); break;
+                }
+            }
+    }
+    return 0;
+}
+
+// ------------- BENCHMARK -------------
+// The file read straight through, then every column of every chunk
+// decoded from the mapping; the second should keep up with the first.
+static int benchmark(const RecFile &f, const char *path) {
+    std::vector<unsigned char> block(1 << 20);
+    FILE *in = fopen(path, "rb");
+    if (in == NULL) {
+        fprintf(stderr, "recread: can't open %s\n", path);
+        return 1;
+    }
+    double start = nowSeconds();
+    size_t read = 0, got;
+    while ((got = fread(&block[0], 1, block.size(), in)) > 0)
+        read += got;
+    double readSeconds = nowSeconds() - start;
+    fclose(in);
+
+    const size_t chunkRows = f.header->chunkRows;
+    std::vector<unsigned char> values(chunkRows * 4), scratch(chunkRows * 4);
+    uint64_t decoded = 0, rows = 0;
+    bool ok = true;
+    start = nowSeconds();
+    ChunkWalk w = walkStart(f);
+    while (const RecChunkHeader *c = walkNext(w)) {
+        for (int i = 0; i < f.columnCount; ++i) {
+            ok = ok && recFileDecode(f, c, i, &values[0], &scratch[0]);
+            decoded += c->rows * recTypeSize(f.columns[i].type);
+        }
+        rows += c->rows;
+    }
+    double decodeSeconds = nowSeconds() - start;
+
+    printf("read   %.1f MB in %.1f ms, %.0f MB/s\n", read / 1e6, readSeconds * 1e3,
+           read / readSeconds / 1e6);
+    printf("decode %llu rows, %.1f MB in %.1f ms, %.0f MB/s of file, %.0f MB/s of rows%s\n",
+           (unsigned long long)rows, decoded / 1e6, decodeSeconds * 1e3,
+           f.size / decodeSeconds / 1e6, decoded / decodeSeconds / 1e6,
+           ok ? "" : "  (some chunks didn't decode)");
+    return ok ? 0 : 1;
+}
+
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        fprintf(stderr, "usage: %s <file.rec> [-csv [column ...] | -b]\n", argv[0]);
+        return 2;
+    }
+
+    RecFile f;
+    if (!recFileOpen(f, argv[1]))
+        return 1;
+
+    int result;
+    if (argc > 2 && strcmp(argv[2], "-csv") == 0)
+        result = dumpCsv(f, argv + 3, argc - 3);
+    else if (argc > 2 && strcmp(argv[2], "-b") == 0)
+        result = benchmark(f, argv[1]);
+    else
+        result = summary(f);
+
+    recFileClose(f);
+    return result;
+}
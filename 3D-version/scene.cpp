@@ -0,0 +1,54 @@
+// Scene graph with cached world matrices, see scene.h.
+#include "scene.h"
+#include "mat4.h"
+
+#include <string.h>
+
+void sceneInit(SceneGraph &g) {
+    g.count          = 0;
+    g.lastRecomputed = 0;
+}
+
+int sceneAddNode(SceneGraph &g, int parent) {
+    if (g.count >= SCENE_MAX_NODES || parent >= g.count) return -1;
+
+    SceneNode &n = g.nodes[g.count];
+    n.parent = parent;
+    n.dirty  = true;
+    n.moved  = false;
+    mat4Identity(n.local);
+    mat4Identity(n.world);
+    return g.count++;
+}
+
+void sceneSetLocal(SceneGraph &g, int node, const float m[16]) {
+    SceneNode &n = g.nodes[node];
+    if (memcmp(n.local, m, sizeof(n.local)) == 0) return;
+    memcpy(n.local, m, sizeof(n.local));
+    n.dirty = true;
+}
+
+void sceneSetTranslation(SceneGraph &g, int node, float x, float y, float z) {
+    float m[16];
+    mat4Translation(m, x, y, z);
+    sceneSetLocal(g, node, m);
+}
+
+void sceneUpdate(SceneGraph &g) {
+    int recomputed = 0;
+
+    for (int i = 0; i < g.count; ++i) {
+        SceneNode &n = g.nodes[i];
+        const SceneNode *p = (n.parent >= 0) ? &g.nodes[n.parent] : 0;
+
+        n.moved = n.dirty || (p && p->moved);
+        if (!n.moved) continue;
+
+        if (p) mat4Multiply(p->world, n.local, n.world);
+        else   memcpy(n.world, n.local, sizeof(n.world));
+        n.dirty = false;
+        ++recomputed;
+    }
+
+    g.lastRecomputed = recomputed;
+}
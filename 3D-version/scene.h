@@ -0,0 +1,46 @@
+// Lightweight scene graph for the 3D runner.
+//
+// Nodes hold a local matrix (relative to their parent) and a cached world
+// matrix. Setting a local matrix only marks the node dirty; sceneUpdate()
+// then recomputes the world matrices of dirty nodes and everything below
+// them, and nothing else. Draw code takes the world matrices as they are
+// (glMultMatrixf) instead of rebuilding them on the GL matrix stack.
+//
+// Nodes live in one fixed array and a parent is always added before its
+// children, so an update is a single pass in index order.
+#ifndef SCENE_H
+#define SCENE_H
+
+const int SCENE_MAX_NODES = 256;
+
+struct SceneNode {
+    int   parent;          // -1 for top-level nodes
+    bool  dirty;           // local changed since the last update
+    bool  moved;           // world recomputed by the last update
+    float local[16];       // column-major
+    float world[16];
+};
+
+struct SceneGraph {
+    SceneNode nodes[SCENE_MAX_NODES];
+    int       count;
+    int       lastRecomputed;   // world matrices rebuilt by the last update
+};
+
+void sceneInit(SceneGraph &g);
+
+// Returns the node index, or -1 when the graph is full. The new node
+// starts with an identity local matrix.
+int sceneAddNode(SceneGraph &g, int parent);
+
+// Both skip the dirty flag if the matrix doesn't actually change.
+void sceneSetLocal(SceneGraph &g, int node, const float m[16]);
+void sceneSetTranslation(SceneGraph &g, int node, float x, float y, float z);
+
+void sceneUpdate(SceneGraph &g);
+
+inline const float *sceneWorld(const SceneGraph &g, int node) {
+    return g.nodes[node].world;
+}
+
+#endif // SCENE_H
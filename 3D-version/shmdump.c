@@ -0,0 +1,127 @@
+/* Prints the state a running game exports with --shm-export (shmstate.h).
+ *
+ *   shmdump <name>                  the latest frame
+ *   shmdump <name> -f               every frame as it arrives, until ^C
+ *   shmdump <name> -b [seconds]     snapshot cost and retries while the game runs
+ *
+ * Also the reference for using shmreader.c from another tool. */
+#define _POSIX_C_SOURCE 199309L
+#include "shmstate.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+static const char *stateNames[] = { "menu", "character select", "playing", "crashed", "game over" };
+static const char *powerupNames[] = { "none", "x2 score", "half speed", "invincible" };
+
+static double nowSeconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void sleepMs(int ms) {
+    struct timespec ts;
+    ts.tv_sec = ms / 1000;
+    ts.tv_nsec = (long)(ms % 1000) * 1000000L;
+    nanosleep(&ts, NULL);
+}
+
+static void printFrame(const ShmFrame *f) {
+    uint32_t i, obstacles = 0, shields = 0, nearest = (uint32_t)-1;
+    for (i = 0; i < f->objectCount; i++) {
+        const ShmObject *o = &f->objects[i];
+        if (o->kind == SHM_SHIELD) shields++;
+        else obstacles++;
+        /* the nearest thing still ahead in the player's lane */
+        if (o->lane == f->playerLane && o->z < 0.0f &&
+            (nearest == (uint32_t)-1 || o->z > f->objects[nearest].z))
+            nearest = i;
+    }
+
+    printf("frame %llu  %s  score %d  shields %d  lane %d/%d  speed %.1f  t %.1fs\n",
+           (unsigned long long)f->frame,
+           f->state >= 0 && f->state <= SHM_STATE_GAMEOVER ? stateNames[f->state] : "?",
+           f->score, f->shields, f->playerLane + 1, f->lanes, f->speed, f->elapsed);
+    printf("  powerup %s (%.1fs)%s  next offer %.1fs  next shield %.1fs  spawn every %.2fs\n",
+           f->powerup >= 0 && f->powerup <= 3 ? powerupNames[f->powerup] : "?",
+           f->powerupTimer, f->choosingPowerup ? ", choosing" : "",
+           f->nextPowerupTime, f->nextShieldTime, f->spawnInterval);
+    printf("  %u objects (%u exported): %u obstacles, %u shields",
+           f->totalObjects, f->objectCount, obstacles, shields);
+    if (nearest != (uint32_t)-1)
+        printf(", nearest in lane %.1f away", -f->objects[nearest].z);
+    printf("\n");
+}
+
+int main(int argc, char **argv) {
+    ShmReader reader;
+    ShmFrame *frame;
+    int follow = 0, bench = 0;
+    double seconds = 5.0;
+
+    if (argc < 2 || (argc > 2 && strcmp(argv[2], "-f") && strcmp(argv[2], "-b"))) {
+        fprintf(stderr, "usage: %s <name> [-f | -b [seconds]]\n", argv[0]);
+        return 2;
+    }
+    follow = argc > 2 && !strcmp(argv[2], "-f");
+    bench = argc > 2 && !strcmp(argv[2], "-b");
+    if (bench && argc > 3)
+        seconds = atof(argv[3]);
+
+    if (shmReaderOpen(&reader, argv[1]) != 0) {
+        fprintf(stderr, "shmdump: no state export called %s (is the game running with --shm-export?)\n", argv[1]);
+        return 1;
+    }
+    frame = (ShmFrame *)malloc(shmReaderFrameBytes(&reader));
+    if (!frame) {
+        shmReaderClose(&reader);
+        return 1;
+    }
+    printf("%s: writer pid %d, %u slots of %u bytes, up to %u objects a frame\n",
+           argv[1], reader.header->writerPid, reader.header->slotCount,
+           reader.header->slotSize, reader.header->maxObjects);
+
+    if (bench) {
+        /* back to back snapshots, as a worst case for contention */
+        unsigned long reads = 0, fails = 0, empty = 0;
+        double start = nowSeconds(), end = start + seconds, now = start;
+        uint64_t first = 0, last = 0;
+        while (now < end) {
+            int got = shmReaderSnapshot(&reader, frame);
+            if (got > 0) {
+                if (!first) first = frame->frame;
+                last = frame->frame;
+            }
+            else if (got < 0) fails++;
+            else empty++;
+            reads++;
+            if ((reads & 255) == 0) now = nowSeconds();
+        }
+        now = nowSeconds();
+        printf("%lu snapshots in %.2fs: %.0f ns each, %lu retries, %lu failed, %lu before the first frame\n",
+               reads, now - start, (now - start) * 1e9 / (reads ? reads : 1),
+               reader.retries, fails, empty);
+        printf("frames %llu..%llu went by (%.1f a second)\n", (unsigned long long)first,
+               (unsigned long long)last, (double)(last - first) / (now - start));
+    } else {
+        uint64_t seen = 0;
+        do {
+            int got = shmReaderSnapshot(&reader, frame);
+            if (got > 0 && frame->frame != seen) {
+                seen = frame->frame;
+                printFrame(frame);
+                fflush(stdout);
+            } else if (got == 0 && !follow) {
+                printf("nothing published yet\n");
+            }
+            if (follow) sleepMs(5);
+        } while (follow);
+    }
+
+    free(frame);
+    shmReaderClose(&reader);
+    return 0;
+}
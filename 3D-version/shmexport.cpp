@@ -0,0 +1,123 @@
+// Shared memory state export, see shmexport.h.
+#include "shmexport.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#ifdef _WIN32
+
+bool shmExportOpen(const char *name, int maxObjects) {
+    (void)name; (void)maxObjects;
+    fprintf(stderr, "shm export: needs POSIX shared memory\n");
+    return false;
+}
+
+void      shmExportClose() {}
+bool      shmExportActive() { return false; }
+int       shmExportMaxObjects() { return 0; }
+ShmFrame *shmExportBegin() { return NULL; }
+void      shmExportEnd() {}
+
+#else
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+const int SLOT_ALIGN = 64;             // slots don't share cache lines
+
+static unsigned char *shmBase = NULL;
+static size_t         shmSize = 0;
+static ShmHeader     *shmHeader = NULL;
+static char           shmPath[256];
+static uint64_t       shmFrame = 0;    // last one begun
+static uint64_t      *shmSeq = NULL;   // its slot's sequence counter
+
+bool shmExportOpen(const char *name, int maxObjects) {
+    shmExportClose();
+    if (maxObjects < 1)
+        maxObjects = 1;
+    snprintf(shmPath, sizeof(shmPath), "%s%s", name[0] == '/' ? "" : "/", name);
+
+    size_t headerSize = (sizeof(ShmHeader) + SLOT_ALIGN - 1) / SLOT_ALIGN * SLOT_ALIGN;
+    size_t slotSize = (16 + SHM_FRAME_BYTES(maxObjects) + SLOT_ALIGN - 1) / SLOT_ALIGN * SLOT_ALIGN;
+    size_t size = headerSize + SHM_SLOTS * slotSize;
+
+    // a fresh object each time, so a reader still holding an old one never
+    // sees this one's header being filled in
+    shm_unlink(shmPath);
+    int fd = shm_open(shmPath, O_CREAT | O_EXCL | O_RDWR, 0644);
+    if (fd < 0) {
+        perror("shm export: shm_open");
+        return false;
+    }
+    if (ftruncate(fd, (off_t)size) != 0) {
+        perror("shm export: ftruncate");
+        close(fd);
+        shm_unlink(shmPath);
+        return false;
+    }
+    void *base = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) {
+        perror("shm export: mmap");
+        shm_unlink(shmPath);
+        return false;
+    }
+
+    shmBase = (unsigned char *)base;
+    shmSize = size;
+    shmHeader = (ShmHeader *)base;
+    shmHeader->version = SHM_VERSION;
+    shmHeader->headerSize = (uint16_t)headerSize;
+    shmHeader->slotCount = SHM_SLOTS;
+    shmHeader->slotSize = (uint32_t)slotSize;
+    shmHeader->frameSize = sizeof(ShmFrame);
+    shmHeader->objectSize = sizeof(ShmObject);
+    shmHeader->maxObjects = (uint32_t)maxObjects;
+    shmHeader->writerPid = (int32_t)getpid();
+    shmHeader->latest = 0;
+    __atomic_store_n(&shmHeader->magic, SHM_MAGIC, __ATOMIC_RELEASE);
+    shmFrame = 0;
+    shmSeq = NULL;
+    return true;
+}
+
+void shmExportClose() {
+    if (!shmBase)
+        return;
+    munmap(shmBase, shmSize);
+    shm_unlink(shmPath);
+    shmBase = NULL;
+    shmHeader = NULL;
+    shmSeq = NULL;
+}
+
+bool shmExportActive() { return shmBase != NULL; }
+
+int shmExportMaxObjects() { return shmHeader ? (int)shmHeader->maxObjects : 0; }
+
+ShmFrame *shmExportBegin() {
+    if (!shmBase)
+        return NULL;
+    uint64_t frame = ++shmFrame;
+    unsigned char *slot = shmBase + shmHeader->headerSize +
+                          (size_t)(frame % SHM_SLOTS) * shmHeader->slotSize;
+    shmSeq = (uint64_t *)slot;
+    // odd before any of the frame changes
+    __atomic_store_n(shmSeq, 2 * frame + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    ShmFrame *f = (ShmFrame *)(slot + 16);
+    f->frame = frame;
+    return f;
+}
+
+void shmExportEnd() {
+    if (!shmSeq)
+        return;
+    __atomic_store_n(shmSeq, 2 * shmFrame + 2, __ATOMIC_RELEASE);
+    __atomic_store_n(&shmHeader->latest, shmFrame, __ATOMIC_RELEASE);
+    shmSeq = NULL;
+}
+
+#endif // _WIN32
@@ -0,0 +1,27 @@
+// Writer side of the shared memory state export (layout in shmstate.h).
+//
+// The game fills frames in place: shmExportBegin() hands out the next slot
+// of the ring, already marked as being written, and shmExportEnd() marks it
+// complete and makes it the latest. Neither call waits for anything, so a
+// reader that stalls or dies costs the game nothing.
+#ifndef SHMEXPORT_H
+#define SHMEXPORT_H
+
+#include "shmstate.h"
+
+// Creates (or replaces) the shared memory object NAME sized for frames of
+// up to maxObjects objects; false if that fails.
+bool      shmExportOpen(const char *name, int maxObjects);
+
+// Unmaps and unlinks it; readers that have it mapped keep the last frames.
+void      shmExportClose();
+
+bool      shmExportActive();
+int       shmExportMaxObjects();
+
+// The frame to fill, with frame already set; only valid until
+// shmExportEnd(). NULL if no export is open.
+ShmFrame *shmExportBegin();
+void      shmExportEnd();
+
+#endif // SHMEXPORT_H
@@ -0,0 +1,113 @@
+/* Reader side of the shared memory state export, see shmstate.h.
+ * Plain C so tools in any language with a C FFI can use it. */
+#define _POSIX_C_SOURCE 200112L
+#include "shmstate.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#ifdef _WIN32
+
+int shmReaderOpen(ShmReader *r, const char *name) {
+    (void)name;
+    memset(r, 0, sizeof(*r));
+    fprintf(stderr, "shm reader: needs POSIX shared memory\n");
+    return -1;
+}
+
+void shmReaderClose(ShmReader *r) { memset(r, 0, sizeof(*r)); }
+
+size_t shmReaderFrameBytes(const ShmReader *r) { (void)r; return 0; }
+
+int shmReaderSnapshot(ShmReader *r, ShmFrame *out) { (void)r; (void)out; return 0; }
+
+#else
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define SHM_READ_TRIES 16
+
+int shmReaderOpen(ShmReader *r, const char *name) {
+    char path[256];
+    struct stat st;
+    const ShmHeader *h;
+    void *base;
+    int fd;
+
+    memset(r, 0, sizeof(*r));
+    snprintf(path, sizeof(path), "%s%s", name[0] == '/' ? "" : "/", name);
+    fd = shm_open(path, O_RDONLY, 0);
+    if (fd < 0)
+        return -1;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(ShmHeader)) {
+        close(fd);
+        return -1;
+    }
+    base = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED)
+        return -1;
+
+    h = (const ShmHeader *)base;
+    if (__atomic_load_n(&h->magic, __ATOMIC_ACQUIRE) != SHM_MAGIC || h->version != SHM_VERSION ||
+        h->objectSize != sizeof(ShmObject) || h->frameSize < offsetof(ShmFrame, objects) ||
+        h->slotCount == 0 || h->slotSize < 16 + SHM_FRAME_BYTES(h->maxObjects) ||
+        h->headerSize + (size_t)h->slotCount * h->slotSize > (size_t)st.st_size) {
+        fprintf(stderr, "shm reader: %s is not a version %d state export\n", path, SHM_VERSION);
+        munmap(base, (size_t)st.st_size);
+        return -1;
+    }
+    r->base = (const unsigned char *)base;
+    r->size = (size_t)st.st_size;
+    r->header = h;
+    return 0;
+}
+
+void shmReaderClose(ShmReader *r) {
+    if (r->base)
+        munmap((void *)r->base, r->size);
+    memset(r, 0, sizeof(*r));
+}
+
+size_t shmReaderFrameBytes(const ShmReader *r) {
+    return SHM_FRAME_BYTES(r->header->maxObjects);
+}
+
+int shmReaderSnapshot(ShmReader *r, ShmFrame *out) {
+    const ShmHeader *h = r->header;
+    int tries;
+
+    for (tries = 0; tries < SHM_READ_TRIES; tries++) {
+        uint64_t latest = __atomic_load_n(&h->latest, __ATOMIC_ACQUIRE);
+        const unsigned char *slot;
+        const uint64_t *seq;
+        uint64_t before, after;
+        uint32_t count;
+
+        if (latest == 0)
+            return 0;
+        slot = r->base + h->headerSize + (size_t)(latest % h->slotCount) * h->slotSize;
+        seq = (const uint64_t *)slot;
+        before = __atomic_load_n(seq, __ATOMIC_ACQUIRE);
+        if (before == 2 * latest + 2) {
+            /* the count is copied first so a torn one can't overrun `out` */
+            memcpy(out, slot + 16, offsetof(ShmFrame, objects));
+            count = out->objectCount;
+            if (count > h->maxObjects)
+                count = h->maxObjects;
+            memcpy(out->objects, slot + 16 + offsetof(ShmFrame, objects), count * sizeof(ShmObject));
+            __atomic_thread_fence(__ATOMIC_ACQUIRE);
+            after = __atomic_load_n(seq, __ATOMIC_RELAXED);
+            if (after == before)
+                return 1;
+        }
+        /* the writer lapped the ring while we were copying */
+        r->retries++;
+    }
+    return -1;
+}
+
+#endif /* _WIN32 */
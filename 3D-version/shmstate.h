@@ -0,0 +1,124 @@
+/* Live game state in shared memory, for overlays and other tools.
+ *
+ * With --shm-export NAME the game publishes its state every tick into a
+ * POSIX shared memory object (/dev/shm/NAME on Linux). The game never
+ * waits for readers and readers never block the game: the state goes into
+ * a ring of SHM_SLOTS slots, each guarded by a sequence counter (a
+ * seqlock). A reader copies the newest slot and checks its counter didn't
+ * move meanwhile; with SHM_SLOTS ticks (about 130 ms) before a slot is
+ * written again that almost never needs a retry.
+ *
+ * Layout (host byte order, everything naturally aligned):
+ *   ShmHeader                            at 0
+ *   slot[SHM_SLOTS], each slotSize bytes at header.headerSize
+ *     uint64_t seq                       odd while being written,
+ *                                        2 * frame + 2 once frame is complete
+ *     uint64_t pad
+ *     ShmFrame                           then objectCount ShmObjects
+ * Readers should check magic, version and the sizes in the header, and
+ * use them rather than sizeof: later versions only add fields at the end.
+ *
+ * This header is C and C++. The reader is shmreader.c; shmdump.c is a
+ * small tool built on it (ShmDump.cbp). The writer is shmexport.h. */
+#ifndef SHMSTATE_H
+#define SHMSTATE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define SHM_MAGIC   0x4D485352u        /* "RSHM" */
+#define SHM_VERSION 1
+#define SHM_SLOTS   8
+
+/* ShmFrame.state */
+enum ShmGameState {
+    SHM_STATE_MENU,
+    SHM_STATE_CHAR_SELECT,
+    SHM_STATE_PLAYING,
+    SHM_STATE_CRASHED,
+    SHM_STATE_GAMEOVER
+};
+
+/* ShmObject.kind; flags are 1 = harmful, 2 = collectible */
+enum ShmObjectKind {
+    SHM_OBSTACLE,
+    SHM_SHIELD
+};
+
+typedef struct ShmHeader {
+    uint32_t magic;                    /* written last, once the rest is valid */
+    uint16_t version;
+    uint16_t headerSize;               /* slots start here */
+    uint32_t slotCount;
+    uint32_t slotSize;
+    uint32_t frameSize;                /* sizeof(ShmFrame) of the writer */
+    uint32_t objectSize;
+    uint32_t maxObjects;               /* per frame */
+    int32_t  writerPid;
+    uint64_t latest;                   /* newest complete frame, 0 = none yet */
+} ShmHeader;
+
+typedef struct ShmObject {
+    float    z;                        /* world units, the player is at 0 */
+    float    x;                        /* lane centre */
+    int32_t  id;                       /* stable while the object lives */
+    uint8_t  lane;
+    uint8_t  kind;
+    uint8_t  flags;
+    uint8_t  pad;
+} ShmObject;
+
+typedef struct ShmFrame {
+    uint64_t  frame;                   /* ticks published, from 1; slot frame % slotCount */
+    int32_t   state;                   /* ShmGameState */
+    int32_t   lanes;
+    int32_t   playerLane;
+    int32_t   score;
+    int32_t   shields;
+    int32_t   powerup;                 /* 0 none, 1 x2 score, 2 half speed, 3 invincible */
+    int32_t   choosingPowerup;         /* one is on offer */
+    uint32_t  totalObjects;            /* on the track; objectCount may be fewer */
+    float     speed;                   /* world units per second */
+    float     elapsed;                 /* seconds into the run */
+    float     powerupTimer;            /* seconds the active powerup has run, of 5 */
+    float     nextPowerupTime;         /* elapsed time of the next offer */
+    float     nextShieldTime;          /* elapsed time of the next shield pickup */
+    float     spawnInterval;           /* seconds between obstacles */
+    float     spawnTimer;              /* seconds to the next obstacle */
+    uint32_t  objectCount;
+    ShmObject objects[1];              /* objectCount of them */
+} ShmFrame;
+
+/* bytes a frame with n objects takes */
+#define SHM_FRAME_BYTES(n) (offsetof(ShmFrame, objects) + (size_t)(n) * sizeof(ShmObject))
+
+/* ------------- READER (shmreader.c) ------------- */
+typedef struct ShmReader {
+    const unsigned char *base;
+    size_t               size;
+    const ShmHeader     *header;
+    unsigned long        retries;      /* snapshots that had to be read again */
+} ShmReader;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Maps NAME read-only; 0 on success, -1 if it isn't there or doesn't
+ * look like a version this reader understands. */
+int    shmReaderOpen(ShmReader *r, const char *name);
+void   shmReaderClose(ShmReader *r);
+
+/* what a snapshot may need: SHM_FRAME_BYTES(header->maxObjects) */
+size_t shmReaderFrameBytes(const ShmReader *r);
+
+/* Copies the newest complete frame into `out` (shmReaderFrameBytes()
+ * bytes). Returns 1, 0 if nothing has been published yet, -1 if the
+ * writer kept overtaking the reader. */
+int    shmReaderSnapshot(ShmReader *r, ShmFrame *out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SHMSTATE_H */
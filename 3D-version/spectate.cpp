@@ -0,0 +1,981 @@
+// Spectator stream: codec, publisher and viewer, see spectate.h.
+#include "spectate.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <chrono>
+#include <vector>
+#include <algorithm>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+typedef int socklen_t;
+#define closeSocket closesocket
+#define SEND_FLAGS 0
+#else
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <netdb.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <unistd.h>
+#define closeSocket close
+#ifdef MSG_NOSIGNAL
+#define SEND_FLAGS MSG_NOSIGNAL        // a viewer that left must not kill the game
+#else
+#define SEND_FLAGS 0
+#endif
+#endif
+
+// Stream: frames, each a varint length followed by
+//   'K' | tick | run state | lanes | score | shields | lane | powerup | speed | elapsed ms
+//       | count | count x (id | kind << 4 | lane | z)
+//   'D' | mask | the fields in mask, in DELTA_* order
+// Deltas are for the tick after the previous frame's. Z is sent in 1/64
+// units when an object appears, after that everything moves by the
+// frame's travel (1/1024 units); speed is in 1/16 units.
+const int Z_SCALE      = 64;
+const int TRAVEL_SCALE = 1024;
+const int SPEED_SCALE  = 16;
+const int MATCH_SLACK  = TRAVEL_SCALE / 16;   // further off and it's resent
+
+enum DeltaField {
+    DELTA_RUN_STATE = 1 << 0,
+    DELTA_SCORE     = 1 << 1,          // zigzag difference
+    DELTA_SHIELDS   = 1 << 2,
+    DELTA_LANE      = 1 << 3,
+    DELTA_POWERUP   = 1 << 4,
+    DELTA_SPEED     = 1 << 5,          // absolute
+    DELTA_ELAPSED   = 1 << 6,          // ms since the last frame
+    DELTA_TRAVEL    = 1 << 7,          // zigzag, applied to every object
+    DELTA_DESPAWNS  = 1 << 8,          // count | ids
+    DELTA_SPAWNS    = 1 << 9           // count | (id | kind << 4 | lane | z)...
+};
+
+static double nowMicros() {
+    using namespace std::chrono;
+    return duration_cast<duration<double, std::micro> >(
+        steady_clock::now().time_since_epoch()).count();
+}
+
+// ------------- VARINTS -------------
+struct Writer {
+    unsigned char *p;
+    int            len, cap;
+    bool           full;
+};
+
+static void putByte(Writer &w, unsigned v) {
+    if (w.len >= w.cap) { w.full = true; return; }
+    w.p[w.len++] = (unsigned char)v;
+}
+
+static void putVar(Writer &w, unsigned v) {
+    while (v >= 0x80) {
+        putByte(w, (v & 0x7F) | 0x80);
+        v >>= 7;
+    }
+    putByte(w, v);
+}
+
+static void putSigned(Writer &w, int v) {
+    putVar(w, ((unsigned)v << 1) ^ (unsigned)(v >> 31));   // zigzag
+}
+
+struct Reader {
+    const unsigned char *p;
+    int                  len, pos;
+    bool                 bad;
+};
+
+static unsigned getByte(Reader &r) {
+    if (r.pos >= r.len) { r.bad = true; return 0; }
+    return r.p[r.pos++];
+}
+
+static unsigned getVar(Reader &r) {
+    unsigned v = 0;
+    for (int shift = 0; shift < 35; shift += 7) {
+        unsigned b = getByte(r);
+        v |= (b & 0x7F) << shift;
+        if (!(b & 0x80)) return v;
+    }
+    r.bad = true;
+    return 0;
+}
+
+static int getSigned(Reader &r) {
+    unsigned v = getVar(r);
+    return (int)(v >> 1) ^ -(int)(v & 1);
+}
+
+// a delta applied with wraparound: a malformed frame mustn't overflow
+static int addDelta(int v, int delta) {
+    return (int)((unsigned)v + (unsigned)delta);
+}
+
+// length of the varint at b, 0 if incomplete
+static int varLength(const unsigned char *b, int avail, unsigned *value) {
+    unsigned v = 0;
+    for (int i = 0; i < avail && i < 5; ++i) {
+        v |= (unsigned)(b[i] & 0x7F) << (7 * i);
+        if (!(b[i] & 0x80)) { *value = v; return i + 1; }
+    }
+    return 0;
+}
+
+// ------------- ENCODER -------------
+static bool validObject(const SpecObject &o) {
+    return o.id >= 0 && o.id < SPEC_MAX_IDS;
+}
+
+static int quantize(float v, int scale) {
+    return (int)lrintf(v * (float)scale);
+}
+
+void specEncoderInit(SpecEncoder &e) {
+    memset(&e, 0, sizeof(e));
+    e.model.tick    = -1;
+    e.forceKeyframe = true;
+}
+
+static void modelRemove(SpecEncoder &e, int id) {
+    int i    = e.slotOf[id] - 1;
+    int last = e.model.objectCount - 1;
+    e.slotOf[id] = 0;
+    if (i != last) {
+        e.model.objects[i] = e.model.objects[last];
+        e.modelZ[i]        = e.modelZ[last];
+        e.slotOf[e.model.objects[i].id] = i + 1;
+    }
+    e.model.objectCount = last;
+}
+
+static void modelAdd(SpecEncoder &e, const SpecObject &o, int zQ) {
+    int i = e.model.objectCount++;
+    e.model.objects[i]     = o;
+    e.model.objects[i].z   = (float)zQ / Z_SCALE;
+    e.modelZ[i]            = zQ * (TRAVEL_SCALE / Z_SCALE);
+    e.slotOf[o.id]         = i + 1;
+}
+
+static void putObject(Writer &w, const SpecObject &o, int zQ) {
+    putVar(w, (unsigned)o.id);
+    putByte(w, (unsigned)((o.kind & 15) << 4 | (o.lane & 15)));
+    putSigned(w, zQ);
+}
+
+static void encodeKeyframe(SpecEncoder &e, const SpecState &s, Writer &w) {
+    for (int i = 0; i < e.model.objectCount; ++i)
+        e.slotOf[e.model.objects[i].id] = 0;
+    e.model.objectCount = 0;
+
+    for (int i = 0; i < s.objectCount; ++i) {
+        const SpecObject &o = s.objects[i];
+        if (validObject(o) && !e.slotOf[o.id])
+            modelAdd(e, o, quantize(o.z, Z_SCALE));
+    }
+
+    const SpecState &m = e.model;
+    putByte(w, 'K');
+    putVar(w, (unsigned)s.tick);
+    putVar(w, (unsigned)s.runState);
+    putVar(w, (unsigned)s.lanes);
+    putSigned(w, s.score);
+    putVar(w, (unsigned)s.shields);
+    putVar(w, (unsigned)s.lane);
+    putVar(w, (unsigned)s.powerup);
+    putSigned(w, quantize(s.speed, SPEED_SCALE));
+    putVar(w, (unsigned)e.elapsedMs);
+    putVar(w, (unsigned)m.objectCount);
+    for (int i = 0; i < m.objectCount; ++i)
+        putObject(w, m.objects[i], e.modelZ[i] / (TRAVEL_SCALE / Z_SCALE));
+    e.sentTravel    = llround(s.travel * TRAVEL_SCALE);
+    e.sinceKeyframe = 0;
+}
+
+static void encodeDelta(SpecEncoder &e, const SpecState &s, Writer &w) {
+    SpecState &m = e.model;
+    unsigned mask = 0;
+
+    // the travel that brings the viewers' Z closest to the real one
+    long long travelQ = llround(s.travel * TRAVEL_SCALE);
+    int dz = (int)(travelQ - e.sentTravel);
+    if (dz != 0) {
+        mask |= DELTA_TRAVEL;
+        e.sentTravel = travelQ;
+        for (int i = 0; i < m.objectCount; ++i) {
+            e.modelZ[i]      += dz;
+            m.objects[i].z    = (float)e.modelZ[i] / TRAVEL_SCALE;
+        }
+    }
+
+    // what the viewers have and still matches stays; everything else is
+    // despawned, and sent again as a spawn if it is still there
+    for (int j = 0; j < m.objectCount; ++j)
+        e.matched[j] = 0;
+    int spawns = 0;
+    for (int i = 0; i < s.objectCount; ++i) {
+        const SpecObject &o = s.objects[i];
+        if (!validObject(o)) continue;
+        int j = e.slotOf[o.id] - 1;
+        if (j >= 0 && e.matched[j]) continue;   // ids are unique; drop repeats
+        if (j >= 0 &&
+            m.objects[j].kind == o.kind && m.objects[j].lane == o.lane &&
+            abs(e.modelZ[j] - quantize(o.z, TRAVEL_SCALE)) <= MATCH_SLACK)
+            e.matched[j] = 1;
+        else
+            e.spawnList[spawns++] = i;
+    }
+    int despawns = 0;
+    for (int j = 0; j < m.objectCount; ++j)
+        if (!e.matched[j]) e.despawnList[despawns++] = m.objects[j].id;
+
+    int ms = e.elapsedMs;
+    e.elapsedMs = (int)lrintf(s.elapsed * 1000.0f);
+    int speedQ  = quantize(s.speed, SPEED_SCALE);
+
+    if (s.runState != m.runState)            mask |= DELTA_RUN_STATE;
+    if (s.score    != m.score)               mask |= DELTA_SCORE;
+    if (s.shields  != m.shields)             mask |= DELTA_SHIELDS;
+    if (s.lane     != m.lane)                mask |= DELTA_LANE;
+    if (s.powerup  != m.powerup)             mask |= DELTA_POWERUP;
+    if (speedQ != quantize(m.speed, SPEED_SCALE)) mask |= DELTA_SPEED;
+    if (e.elapsedMs != ms)                   mask |= DELTA_ELAPSED;
+    if (despawns)                            mask |= DELTA_DESPAWNS;
+    if (spawns)                              mask |= DELTA_SPAWNS;
+
+    putByte(w, 'D');
+    putVar(w, mask);
+    if (mask & DELTA_RUN_STATE) putVar(w, (unsigned)s.runState);
+    if (mask & DELTA_SCORE)     putSigned(w, s.score - m.score);
+    if (mask & DELTA_SHIELDS)   putVar(w, (unsigned)s.shields);
+    if (mask & DELTA_LANE)      putVar(w, (unsigned)s.lane);
+    if (mask & DELTA_POWERUP)   putVar(w, (unsigned)s.powerup);
+    if (mask & DELTA_SPEED)     putSigned(w, speedQ);
+    if (mask & DELTA_ELAPSED)   putSigned(w, e.elapsedMs - ms);
+    if (mask & DELTA_TRAVEL)    putSigned(w, dz);
+    if (mask & DELTA_DESPAWNS) {
+        putVar(w, (unsigned)despawns);
+        for (int k = 0; k < despawns; ++k) {
+            putVar(w, (unsigned)e.despawnList[k]);
+            modelRemove(e, e.despawnList[k]);
+        }
+    }
+    if (mask & DELTA_SPAWNS) {
+        putVar(w, (unsigned)spawns);
+        for (int k = 0; k < spawns; ++k) {
+            const SpecObject &o = s.objects[e.spawnList[k]];
+            int zQ = quantize(o.z, Z_SCALE);
+            putObject(w, o, zQ);
+            modelAdd(e, o, zQ);
+        }
+    }
+    ++e.sinceKeyframe;
+}
+
+int specEncode(SpecEncoder &e, const SpecState &s, unsigned char *out, int cap, bool *keyframe) {
+    const int PREFIX = 3;              // room for the length; frames stay under 2 MB
+    if (cap <= PREFIX) return 0;
+
+    bool key = e.forceKeyframe || e.sinceKeyframe >= SPEC_KEYFRAME_TICKS ||
+               s.tick != e.model.tick + 1 || s.lanes != e.model.lanes;
+    Writer w = { out + PREFIX, 0, cap - PREFIX, false };
+    if (key) {
+        e.elapsedMs = (int)lrintf(s.elapsed * 1000.0f);
+        encodeKeyframe(e, s, w);
+    } else {
+        encodeDelta(e, s, w);
+    }
+
+    SpecState &m = e.model;
+    m.tick     = s.tick;
+    m.runState = s.runState;
+    m.lanes    = s.lanes;
+    m.score    = s.score;
+    m.shields  = s.shields;
+    m.lane     = s.lane;
+    m.powerup  = s.powerup;
+    m.speed    = (float)quantize(s.speed, SPEED_SCALE) / SPEED_SCALE;
+    m.elapsed  = e.elapsedMs / 1000.0f;
+
+    // the model has moved on already: a frame that didn't fit can only be
+    // followed by a keyframe
+    e.forceKeyframe = w.full;
+    if (w.full) return 0;
+
+    Writer head = { out, 0, PREFIX, false };
+    putVar(head, (unsigned)w.len);
+    if (head.len < PREFIX) memmove(out + head.len, out + PREFIX, (size_t)w.len);
+    if (keyframe) *keyframe = key;
+    return head.len + w.len;
+}
+
+// ------------- DECODER -------------
+void specDecoderInit(SpecDecoder &d) {
+    memset(&d, 0, sizeof(d));
+}
+
+static void stateRemove(SpecDecoder &d, int id) {
+    int i = d.slotOf[id] - 1;
+    if (i < 0) return;
+    int last = d.state.objectCount - 1;
+    d.slotOf[id] = 0;
+    if (i != last) {
+        d.state.objects[i] = d.state.objects[last];
+        d.stateZ[i]        = d.stateZ[last];
+        d.slotOf[d.state.objects[i].id] = i + 1;
+    }
+    d.state.objectCount = last;
+}
+
+static bool readObject(SpecDecoder &d, Reader &r) {
+    SpecObject o;
+    unsigned id = getVar(r);
+    unsigned kl = getByte(r);
+    int zQ = getSigned(r);
+    if (r.bad || id >= (unsigned)SPEC_MAX_IDS) return false;   // slotOf is indexed by it
+    o.id = (int)id;
+    o.kind = (unsigned char)(kl >> 4);
+    o.lane = (unsigned char)(kl & 15);
+    o.z    = (float)zQ / Z_SCALE;
+
+    stateRemove(d, o.id);              // an id is only ever on screen once
+    if (d.state.objectCount >= SPEC_MAX_OBJECTS) return false;
+    int i = d.state.objectCount++;
+    d.state.objects[i] = o;
+    d.stateZ[i]        = (int)((unsigned)zQ * (TRAVEL_SCALE / Z_SCALE));   // wraps, as addDelta
+    d.slotOf[o.id]     = i + 1;
+    return true;
+}
+
+bool specDecode(SpecDecoder &d, const unsigned char *frame, int len) {
+    Reader r = { frame, len, 0, false };
+    SpecState &s = d.state;
+    unsigned type = getByte(r);
+
+    if (type == 'K') {
+        for (int i = 0; i < s.objectCount; ++i)
+            d.slotOf[s.objects[i].id] = 0;
+        s.objectCount = 0;
+
+        s.tick       = (int)getVar(r);
+        s.runState   = (int)getVar(r);
+        s.lanes      = (int)getVar(r);
+        s.score      = getSigned(r);
+        s.shields    = (int)getVar(r);
+        s.lane       = (int)getVar(r);
+        s.powerup    = (int)getVar(r);
+        s.speed      = (float)getSigned(r) / SPEED_SCALE;
+        d.elapsedMs  = (int)getVar(r);
+        int count    = (int)getVar(r);
+        if (r.bad || count > SPEC_MAX_OBJECTS) return false;
+        for (int k = 0; k < count; ++k)
+            if (!readObject(d, r)) return false;
+        d.synced = true;
+    } else if (type == 'D') {
+        if (!d.synced) return true;    // wait for a keyframe
+        unsigned mask = getVar(r);
+        ++s.tick;
+        if (mask & DELTA_RUN_STATE) s.runState = (int)getVar(r);
+        if (mask & DELTA_SCORE)     s.score    = addDelta(s.score, getSigned(r));
+        if (mask & DELTA_SHIELDS)   s.shields  = (int)getVar(r);
+        if (mask & DELTA_LANE)      s.lane     = (int)getVar(r);
+        if (mask & DELTA_POWERUP)   s.powerup  = (int)getVar(r);
+        if (mask & DELTA_SPEED)     s.speed    = (float)getSigned(r) / SPEED_SCALE;
+        if (mask & DELTA_ELAPSED)   d.elapsedMs = addDelta(d.elapsedMs, getSigned(r));
+        if (mask & DELTA_TRAVEL) {
+            int dz = getSigned(r);
+            for (int i = 0; i < s.objectCount; ++i) {
+                d.stateZ[i]      = addDelta(d.stateZ[i], dz);
+                s.objects[i].z   = (float)d.stateZ[i] / TRAVEL_SCALE;
+            }
+        }
+        if (mask & DELTA_DESPAWNS) {
+            int count = (int)getVar(r);
+            for (int k = 0; k < count && !r.bad; ++k) {
+                unsigned id = getVar(r);
+                if (id < (unsigned)SPEC_MAX_IDS) stateRemove(d, (int)id);
+            }
+        }
+        if (mask & DELTA_SPAWNS) {
+            int count = (int)getVar(r);
+            for (int k = 0; k < count && !r.bad; ++k)
+                if (!readObject(d, r)) return false;
+        }
+    } else {
+        return false;
+    }
+    s.elapsed = d.elapsedMs / 1000.0f;
+    return !r.bad;
+}
+
+// ------------- SOCKETS -------------
+struct SpecAddress {
+    bool unixSocket;
+    char path[108];
+    char host[64];
+    int  port;
+};
+
+static bool allDigits(const char *s) {
+    if (!*s) return false;
+    for (; *s; ++s)
+        if (*s < '0' || *s > '9') return false;
+    return true;
+}
+
+static bool parseAddress(const char *a, SpecAddress &out) {
+    memset(&out, 0, sizeof(out));
+    strcpy(out.host, "127.0.0.1");
+    if (strncmp(a, "unix:", 5) == 0 || (strncmp(a, "tcp:", 4) != 0 && !allDigits(a))) {
+        if (strncmp(a, "unix:", 5) == 0) a += 5;
+        if (!*a || strlen(a) >= sizeof(out.path)) return false;
+        out.unixSocket = true;
+        strcpy(out.path, a);
+        return true;
+    }
+    if (strncmp(a, "tcp:", 4) == 0) a += 4;
+    const char *colon = strrchr(a, ':');
+    if (colon) {
+        size_t hostLen = (size_t)(colon - a);
+        if (hostLen == 0 || hostLen >= sizeof(out.host)) return false;
+        memcpy(out.host, a, hostLen);
+        out.host[hostLen] = '\0';
+        a = colon + 1;
+    }
+    out.port = atoi(a);
+    return out.port > 0 && out.port < 65536;
+}
+
+static bool socketsReady() {
+#ifdef _WIN32
+    static bool wsaReady = false;
+    if (!wsaReady) {
+        WSADATA wsa;
+        if (WSAStartup(MAKEWORD(2, 2), &wsa) != 0) {
+            fprintf(stderr, "spectate: WSAStartup failed\n");
+            return false;
+        }
+        wsaReady = true;
+    }
+#endif
+    return true;
+}
+
+static void setNonBlocking(intptr_t s) {
+#ifdef _WIN32
+    u_long nonBlocking = 1;
+    ioctlsocket(s, FIONBIO, &nonBlocking);
+#else
+    fcntl(s, F_SETFL, fcntl(s, F_GETFL, 0) | O_NONBLOCK);
+#endif
+}
+
+static bool wouldBlock() {
+#ifdef _WIN32
+    return WSAGetLastError() == WSAEWOULDBLOCK;
+#else
+    return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+#endif
+}
+
+// ------------- SERVER -------------
+bool specServerOpen(SpecServer &s, const char *address) {
+    memset(&s, 0, sizeof(s));
+    s.listenSock = -1;
+    for (int c = 0; c < SPEC_MAX_CLIENTS; ++c)
+        s.clients[c].sock = -1;
+    specEncoderInit(s.encoder);
+
+    SpecAddress addr;
+    if (!parseAddress(address, addr)) {
+        fprintf(stderr, "spectate: bad address '%s'\n", address);
+        return false;
+    }
+    if (!socketsReady()) return false;
+
+    intptr_t l;
+    if (addr.unixSocket) {
+#ifdef _WIN32
+        fprintf(stderr, "spectate: unix sockets aren't supported here, use tcp:PORT\n");
+        return false;
+#else
+        struct sockaddr_un un;
+        memset(&un, 0, sizeof(un));
+        un.sun_family = AF_UNIX;
+        if (strlen(addr.path) >= sizeof(un.sun_path)) {
+            fprintf(stderr, "spectate: path too long: %s\n", addr.path);
+            return false;
+        }
+        memcpy(un.sun_path, addr.path, strlen(addr.path) + 1);
+        l = (intptr_t)socket(AF_UNIX, SOCK_STREAM, 0);
+        unlink(addr.path);             // left over from a run that crashed
+        if (l < 0 || bind(l, (struct sockaddr *)&un, sizeof(un)) != 0) {
+            fprintf(stderr, "spectate: can't bind %s\n", addr.path);
+            if (l >= 0) closeSocket(l);
+            return false;
+        }
+        strcpy(s.unixPath, addr.path);
+#endif
+    } else {
+        struct sockaddr_in in;
+        memset(&in, 0, sizeof(in));
+        in.sin_family      = AF_INET;
+        in.sin_addr.s_addr = htonl(INADDR_ANY);
+        in.sin_port        = htons((unsigned short)addr.port);
+        l = (intptr_t)socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+        int yes = 1;
+        if (l >= 0)
+            setsockopt(l, SOL_SOCKET, SO_REUSEADDR, (const char *)&yes, sizeof(yes));
+        if (l < 0 || bind(l, (struct sockaddr *)&in, sizeof(in)) != 0) {
+            fprintf(stderr, "spectate: can't bind TCP port %d\n", addr.port);
+            if (l >= 0) closeSocket(l);
+            return false;
+        }
+    }
+    if (listen(l, SPEC_MAX_CLIENTS) != 0) {
+        fprintf(stderr, "spectate: listen() failed\n");
+        closeSocket(l);
+        return false;
+    }
+    setNonBlocking(l);
+    s.listenSock = l;
+    return true;
+}
+
+static void dropClient(SpecServer &s, SpecClient &c, const char *why) {
+    closeSocket(c.sock);
+    c.sock = -1;
+    --s.stats.clients;
+    printf("spectate: viewer %s, %d left\n", why, s.stats.clients);
+}
+
+void specServerClose(SpecServer &s) {
+    for (int c = 0; c < SPEC_MAX_CLIENTS; ++c)
+        if (s.clients[c].sock >= 0) closeSocket(s.clients[c].sock);
+    if (s.listenSock >= 0) closeSocket(s.listenSock);
+#ifndef _WIN32
+    if (s.unixPath[0]) unlink(s.unixPath);
+#endif
+    s.listenSock = -1;
+}
+
+static bool queueBytes(SpecClient &c, const unsigned char *data, int len) {
+    if (c.pendingStart > 0) {
+        memmove(c.pending, c.pending + c.pendingStart, (size_t)c.pendingLen);
+        c.pendingStart = 0;
+    }
+    if (c.pendingLen + len > SPEC_CLIENT_BUFFER) return false;
+    memcpy(c.pending + c.pendingLen, data, (size_t)len);
+    c.pendingLen += len;
+    return true;
+}
+
+// false once the viewer is gone
+static bool flushClient(SpecClient &c) {
+    while (c.pendingLen > 0) {
+        int n = (int)send(c.sock, (const char *)c.pending + c.pendingStart,
+                          c.pendingLen, SEND_FLAGS);
+        if (n < 0 && wouldBlock()) return true;
+        if (n <= 0) return false;
+        c.pendingStart += n;
+        c.pendingLen   -= n;
+    }
+    c.pendingStart = 0;
+    return true;
+}
+
+void specServerPublish(SpecServer &s, const SpecState &state, double nowMs) {
+    if (s.listenSock < 0) return;
+    static unsigned char frame[SPEC_CATCHUP_BUFFER];
+
+    double t0 = nowMicros();
+    bool key = false;
+    int len = specEncode(s.encoder, state, frame, (int)sizeof(frame), &key);
+    s.stats.encodeMicros += nowMicros() - t0;
+    if (len == 0) return;              // too big; next tick is a keyframe
+
+    ++s.stats.frames;
+    if (key) ++s.stats.keyframes;
+    s.stats.bytes         += len;
+    s.stats.lastFrameBytes = len;
+    s.windowBytes         += len;
+    if (nowMs - s.windowStartMs >= 1000.0) {
+        if (s.windowStartMs > 0.0)
+            s.stats.bytesPerSecond = s.windowBytes * 1000.0 / (nowMs - s.windowStartMs);
+        s.windowStartMs = nowMs;
+        s.windowBytes   = 0;
+    }
+
+    // late joiners get the last keyframe and every delta since
+    if (key) s.catchupLen = 0;
+    if (s.catchupLen >= 0 && s.catchupLen + len <= SPEC_CATCHUP_BUFFER) {
+        memcpy(s.catchup + s.catchupLen, frame, (size_t)len);
+        s.catchupLen += len;
+    } else {
+        s.catchupLen = -1;             // joiners wait for the next keyframe
+        s.encoder.forceKeyframe = true;
+    }
+
+    for (int i = 0; i < SPEC_MAX_CLIENTS; ++i) {
+        SpecClient &c = s.clients[i];
+        if (c.sock < 0) continue;
+        if (!queueBytes(c, frame, len))
+            dropClient(s, c, "fell behind");
+        else if (!flushClient(c))
+            dropClient(s, c, "left");
+    }
+
+    for (;;) {
+        intptr_t a = (intptr_t)accept(s.listenSock, NULL, NULL);
+        if (a < 0) break;
+        SpecClient *c = NULL;
+        for (int i = 0; i < SPEC_MAX_CLIENTS && !c; ++i)
+            if (s.clients[i].sock < 0) c = &s.clients[i];
+        if (!c || s.catchupLen < 0) {   // full, or nothing to start from
+            closeSocket(a);
+            continue;
+        }
+        setNonBlocking(a);
+        c->sock         = a;
+        c->pendingStart = 0;
+        c->pendingLen   = 0;
+        ++s.stats.clients;
+        printf("spectate: viewer joined, %d watching\n", s.stats.clients);
+        if (!queueBytes(*c, s.catchup, s.catchupLen))
+            dropClient(s, *c, "couldn't catch up");
+        else if (!flushClient(*c))
+            dropClient(s, *c, "left");
+    }
+}
+
+// ------------- VIEWER -------------
+bool specViewerOpen(SpecViewer &v, const char *address) {
+    memset(&v, 0, sizeof(v));
+    v.sock = -1;
+    specDecoderInit(v.decoder);
+
+    SpecAddress addr;
+    if (!parseAddress(address, addr)) {
+        fprintf(stderr, "spectate: bad address '%s'\n", address);
+        return false;
+    }
+    if (!socketsReady()) return false;
+
+    intptr_t s = -1;
+    if (addr.unixSocket) {
+#ifdef _WIN32
+        fprintf(stderr, "spectate: unix sockets aren't supported here, use tcp:HOST:PORT\n");
+        return false;
+#else
+        struct sockaddr_un un;
+        memset(&un, 0, sizeof(un));
+        un.sun_family = AF_UNIX;
+        if (strlen(addr.path) >= sizeof(un.sun_path)) {
+            fprintf(stderr, "spectate: path too long: %s\n", addr.path);
+            return false;
+        }
+        memcpy(un.sun_path, addr.path, strlen(addr.path) + 1);
+        s = (intptr_t)socket(AF_UNIX, SOCK_STREAM, 0);
+        if (s >= 0 && connect(s, (struct sockaddr *)&un, sizeof(un)) != 0) {
+            closeSocket(s);
+            s = -1;
+        }
+#endif
+    } else {
+        struct addrinfo hints, *res = NULL;
+        memset(&hints, 0, sizeof(hints));
+        hints.ai_family   = AF_INET;
+        hints.ai_socktype = SOCK_STREAM;
+        char port[16];
+        snprintf(port, sizeof(port), "%d", addr.port);
+        if (getaddrinfo(addr.host, port, &hints, &res) == 0 && res) {
+            s = (intptr_t)socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+            if (s >= 0 && connect(s, res->ai_addr, (socklen_t)res->ai_addrlen) != 0) {
+                closeSocket(s);
+                s = -1;
+            }
+        }
+        if (res) freeaddrinfo(res);
+    }
+    if (s < 0) {
+        fprintf(stderr, "spectate: can't connect to %s\n", address);
+        return false;
+    }
+    setNonBlocking(s);
+    v.sock = s;
+    return true;
+}
+
+void specViewerClose(SpecViewer &v) {
+    if (v.sock >= 0) closeSocket(v.sock);
+    v.sock = -1;
+}
+
+int specViewerPoll(SpecViewer &v, double nowMs) {
+    if (v.sock < 0) return -1;
+
+    bool gone = false;
+    while (v.bufferLen < SPEC_CLIENT_BUFFER) {
+        int n = (int)recv(v.sock, (char *)v.buffer + v.bufferLen,
+                          SPEC_CLIENT_BUFFER - v.bufferLen, 0);
+        if (n < 0 && wouldBlock()) break;
+        if (n <= 0) { gone = true; break; }
+        v.bufferLen   += n;
+        v.bytes       += n;
+        v.windowBytes += n;
+    }
+    if (nowMs - v.windowStartMs >= 1000.0) {
+        if (v.windowStartMs > 0.0)
+            v.bytesPerSecond = v.windowBytes * 1000.0 / (nowMs - v.windowStartMs);
+        v.windowStartMs = nowMs;
+        v.windowBytes   = 0;
+    }
+
+    int frames = 0, pos = 0;
+    for (;;) {
+        unsigned len = 0;
+        int head = varLength(v.buffer + pos, v.bufferLen - pos, &len);
+        if (head == 0) break;
+        if (len > (unsigned)(SPEC_CLIENT_BUFFER - head)) { gone = true; break; }
+        if (pos + head + (int)len > v.bufferLen) break;
+        if (!specDecode(v.decoder, v.buffer + pos + head, (int)len)) {
+            fprintf(stderr, "spectate: bad frame, disconnecting\n");
+            gone = true;
+            break;
+        }
+        pos += head + (int)len;
+        ++frames;
+    }
+    memmove(v.buffer, v.buffer + pos, (size_t)(v.bufferLen - pos));
+    v.bufferLen -= pos;
+
+    if (gone) {
+        specViewerClose(v);
+        return frames > 0 ? frames : -1;
+    }
+    return frames;
+}
+
+// ------------- BENCHMARK -------------
+// A run like the game's, at a chosen number of objects on the track:
+// objects appear at the far end in random lanes and scroll past, some are
+// picked up on the way, the player changes lanes now and then.
+struct BenchRun {
+    SpecState         state;
+    std::vector<int>  freeIds;
+    unsigned          rng;
+    float             spawnDebt;
+};
+
+static unsigned benchRand(BenchRun &b) {
+    b.rng = b.rng * 1103515245u + 12345u;
+    return (b.rng >> 16) & 0x7FFF;
+}
+
+static void benchSpawn(BenchRun &b, float z) {
+    SpecState &s = b.state;
+    if (s.objectCount >= SPEC_MAX_OBJECTS || b.freeIds.empty()) return;
+    SpecObject &o = s.objects[s.objectCount++];
+    o.id   = b.freeIds.back();
+    b.freeIds.pop_back();
+    o.kind = (benchRand(b) % 20 == 0) ? 1 : 0;
+    o.lane = (unsigned char)(benchRand(b) % 5);
+    o.z    = z;
+}
+
+static void benchRemove(BenchRun &b, int i) {
+    SpecState &s = b.state;
+    b.freeIds.push_back(s.objects[i].id);
+    s.objects[i] = s.objects[--s.objectCount];
+}
+
+static void benchInit(BenchRun &b, int density) {
+    static const SpecState blank = SpecState();
+    b.state = blank;
+    b.state.speed = 10.0f;
+    b.state.lanes = 5;
+    b.state.lane  = 2;
+    b.rng         = 2024u + (unsigned)density;
+    b.spawnDebt   = 0.0f;
+    b.freeIds.clear();
+    for (int id = SPEC_MAX_OBJECTS - 1; id >= 0; --id)
+        b.freeIds.push_back(id);
+    for (int k = 0; k < density; ++k)
+        benchSpawn(b, -80.0f + 105.0f * (float)k / (float)density);
+}
+
+static void benchTick(BenchRun &b, int density) {
+    SpecState &s = b.state;
+    float dt = (15.0f + (float)(benchRand(b) % 4)) / 1000.0f;   // uneven frames
+    float dz = s.speed * dt;
+
+    ++s.tick;
+    s.elapsed += dt;
+    s.travel  += dz;
+    if (s.tick % 900 == 0) s.speed += 2.0f;
+    if (s.tick % 40 == 0) ++s.score;
+    if (benchRand(b) % 45 == 0) s.lane = (int)(benchRand(b) % 5);
+    if (benchRand(b) % 600 == 0) s.shields = (s.shields + 1) % 4;
+    if (benchRand(b) % 900 == 0) s.powerup = (int)(benchRand(b) % 4);
+
+    for (int i = s.objectCount - 1; i >= 0; --i) {
+        s.objects[i].z += dz;
+        bool pickedUp = s.objects[i].kind == 1 && s.objects[i].z > -1.0f;
+        if (s.objects[i].z > 25.0f || pickedUp) benchRemove(b, i);
+    }
+    // as many spawns as leave the far end, keeps the density
+    b.spawnDebt += density * dz / 105.0f;
+    while (b.spawnDebt >= 1.0f) {
+        benchSpawn(b, -80.0f);
+        b.spawnDebt -= 1.0f;
+    }
+}
+
+// does the decoder show what the encoder thinks the viewers have, and is
+// that within quantization of the real state?
+static bool benchCheck(const SpecDecoder &d, const SpecEncoder &e, const SpecState &real) {
+    const SpecState &v = d.state;
+    if (v.objectCount != real.objectCount || v.tick != real.tick ||
+        v.score != real.score || v.lane != real.lane || v.shields != real.shields ||
+        v.powerup != real.powerup || v.runState != real.runState ||
+        v.lanes != real.lanes ||
+        fabsf(v.elapsed - real.elapsed) > 0.001f || fabsf(v.speed - real.speed) > 0.04f)
+        return false;
+    for (int i = 0; i < real.objectCount; ++i) {
+        const SpecObject &o = real.objects[i];
+        int j = d.slotOf[o.id] - 1, k = e.slotOf[o.id] - 1;
+        if (j < 0 || k < 0 || d.stateZ[j] != e.modelZ[k]) return false;
+        if (v.objects[j].kind != o.kind || v.objects[j].lane != o.lane ||
+            fabsf(v.objects[j].z - o.z) > 1.0f / Z_SCALE)
+            return false;
+    }
+    return true;
+}
+
+static double percentile(std::vector<double> &v, double p) {
+    if (v.empty()) return 0.0;
+    size_t k = (size_t)(p * (double)(v.size() - 1));
+    std::nth_element(v.begin(), v.begin() + (long)k, v.end());
+    return v[k];
+}
+
+static bool benchSocketLoopback(int ticks) {
+    static SpecServer server;
+    static SpecViewer viewer;
+    static BenchRun   run;
+#ifdef _WIN32
+    const char *address = "tcp:47831";
+#else
+    char address[64];
+    snprintf(address, sizeof(address), "unix:/tmp/runner3d-spectate-%d.sock", (int)getpid());
+#endif
+    if (!specServerOpen(server, address)) return false;
+
+    benchInit(run, 40);
+    bool ok = true, joined = false;
+    double now = 0.0;
+    for (int t = 0; t < ticks; ++t) {
+        benchTick(run, 40);
+        if (t == ticks / 3)             // late, between keyframes
+            joined = specViewerOpen(viewer, address);
+        specServerPublish(server, run.state, now);
+        if (joined && specViewerPoll(viewer, now) < 0) { ok = false; break; }
+        now += 1000.0 / 60.0;
+    }
+    if (joined) {
+        if (!benchCheck(viewer.decoder, server.encoder, run.state)) ok = false;
+        printf("  socket loopback: late viewer got %ld bytes, in sync at the end: %s\n",
+               viewer.bytes, ok ? "yes" : "NO");
+    }
+    specViewerClose(viewer);
+    specServerClose(server);
+    return ok && joined;
+}
+
+int specRunBenchmark(int ticks) {
+    static const int DENSITIES[] = { 40, 400, 4000 };
+    static SpecEncoder enc;
+    static SpecDecoder dec, late;
+    static BenchRun    run;
+    static unsigned char frame[SPEC_CATCHUP_BUFFER];
+    if (ticks < 2 * SPEC_KEYFRAME_TICKS) ticks = 2 * SPEC_KEYFRAME_TICKS;
+
+    printf("spectate bench: %d ticks at 60 Hz per density, keyframe every %d ticks\n",
+           ticks, SPEC_KEYFRAME_TICKS);
+    printf("  objects   B/s    delta B  key B   raw B/s   encode us/tick avg / p99   decode us\n");
+
+    bool allOk = true;
+    for (size_t di = 0; di < sizeof(DENSITIES) / sizeof(DENSITIES[0]); ++di) {
+        int density = DENSITIES[di];
+        benchInit(run, density);
+        specEncoderInit(enc);
+        specDecoderInit(dec);
+        specDecoderInit(late);
+
+        std::vector<double> encodeUs;
+        encodeUs.reserve((size_t)ticks);
+        std::vector<unsigned char> catchup;
+        double decodeUs = 0.0, rawBytes = 0.0;
+        long   bytes = 0, keyBytes = 0, keys = 0;
+        bool   ok = true, lateJoined = false;
+
+        for (int t = 0; t < ticks && ok; ++t) {
+            benchTick(run, density);
+
+            bool key = false;
+            double t0 = nowMicros();
+            int len = specEncode(enc, run.state, frame, (int)sizeof(frame), &key);
+            encodeUs.push_back(nowMicros() - t0);
+            if (len == 0) { ok = false; break; }
+
+            bytes += len;
+            if (key) { keyBytes += len; ++keys; catchup.clear(); }
+            catchup.insert(catchup.end(), frame, frame + len);
+            // what a frame would be without any of this: every object every tick
+            rawBytes += 32.0 + run.state.objectCount * (double)sizeof(SpecObject);
+
+            unsigned flen = 0;
+            int head = varLength(frame, len, &flen);
+            t0 = nowMicros();
+            ok = specDecode(dec, frame + head, (int)flen);
+            decodeUs += nowMicros() - t0;
+            ok = ok && benchCheck(dec, enc, run.state);
+
+            // a second viewer joins late and is sent the catch-up frames
+            if (t == ticks / 2 + SPEC_KEYFRAME_TICKS / 3) {
+                for (size_t pos = 0; pos < catchup.size() && ok; ) {
+                    head = varLength(&catchup[pos], (int)(catchup.size() - pos), &flen);
+                    ok = specDecode(late, &catchup[pos + (size_t)head], (int)flen);
+                    pos += (size_t)head + flen;
+                }
+                ok = ok && benchCheck(late, enc, run.state);
+                lateJoined = true;
+            }
+        }
+
+        double sum = 0.0;
+        for (size_t i = 0; i < encodeUs.size(); ++i) sum += encodeUs[i];
+        double avg = encodeUs.empty() ? 0.0 : sum / (double)encodeUs.size();
+        double p99 = percentile(encodeUs, 0.99);
+        long   deltas = (long)encodeUs.size() - keys;
+        double perSecond = 60.0 / (double)(encodeUs.empty() ? 1 : encodeUs.size());
+
+        printf("  %7d %7.0f %8.1f %6ld %9.0f   %10.2f / %-10.2f   %8.2f   %s\n",
+               density, bytes * perSecond,
+               deltas > 0 ? (double)(bytes - keyBytes) / deltas : 0.0,
+               keys > 0 ? keyBytes / keys : 0L,
+               rawBytes * perSecond, avg, p99,
+               encodeUs.empty() ? 0.0 : decodeUs / (double)encodeUs.size(),
+               ok && lateJoined ? "in sync" : "MISMATCH");
+        allOk = allOk && ok && lateJoined;
+    }
+
+    allOk = benchSocketLoopback(600) && allOk;
+    return allOk ? 0 : 1;
+}
@@ -0,0 +1,150 @@
+// Live spectator stream for the 3D runner.
+//
+// The game publishes its state once per tick to any number of viewers over
+// a Unix socket (or TCP). Frames are deltas against what viewers already
+// have: objects spawned and despawned, one shared Z travel for everything
+// that moves, and the player fields that changed, all varint-packed. Every
+// SPEC_KEYFRAME_TICKS a keyframe carries the full state. A viewer that
+// connects late is sent the last keyframe and the deltas since, so it is in
+// sync from its first frame.
+//
+// The encoder keeps its own copy of the viewers' state (quantized exactly
+// as they decode it), so positions never drift: each frame's travel is
+// what brings the viewers' copy closest to the real one.
+//
+// Addresses: "unix:/path", "tcp:PORT" (publish) / "tcp:HOST:PORT" (view).
+// A bare path means unix:, a bare number tcp:.
+#ifndef SPECTATE_H
+#define SPECTATE_H
+
+#include <stdint.h>
+
+const int SPEC_MAX_OBJECTS    = 4096;   // per frame, the rest isn't streamed
+const int SPEC_MAX_IDS        = 1 << 16;
+const int SPEC_KEYFRAME_TICKS = 120;
+const int SPEC_MAX_CLIENTS    = 8;
+const int SPEC_CLIENT_BUFFER  = 64 * 1024;
+const int SPEC_CATCHUP_BUFFER = 256 * 1024;   // last keyframe + deltas since
+
+enum SpecRunState {
+    SPEC_RUN_PLAYING,
+    SPEC_RUN_CRASHED,
+    SPEC_RUN_OVER
+};
+
+struct SpecObject {
+    int           id;                  // stable while the object lives
+    unsigned char kind;                // 0..15
+    unsigned char lane;                // 0..15
+    float         z;
+};
+
+// What the game hands to the publisher each tick, and what a viewer sees.
+struct SpecState {
+    int        tick;
+    int        runState;               // SpecRunState
+    int        lanes;                  // keyframes only, changing it forces one
+    int        score;
+    int        shields;
+    int        lane;
+    int        powerup;
+    float      speed;
+    float      elapsed;                // seconds
+    double     travel;                 // total distance moved; publisher side only
+    int        objectCount;
+    SpecObject objects[SPEC_MAX_OBJECTS];
+};
+
+// ------------- CODEC -------------
+struct SpecEncoder {
+    SpecState model;                   // the viewers' copy; z kept in modelZ
+    int       modelZ[SPEC_MAX_OBJECTS];    // 1/1024 units
+    int       slotOf[SPEC_MAX_IDS];        // id -> model index + 1, 0 if absent
+    long long sentTravel;              // 1/1024 units
+    int       elapsedMs;
+    int       sinceKeyframe;
+    bool      forceKeyframe;
+    unsigned char matched[SPEC_MAX_OBJECTS];   // scratch for a delta
+    int       spawnList[SPEC_MAX_OBJECTS];
+    int       despawnList[SPEC_MAX_OBJECTS];
+};
+
+struct SpecDecoder {
+    SpecState state;                   // ready to draw
+    int       stateZ[SPEC_MAX_OBJECTS];
+    int       slotOf[SPEC_MAX_IDS];
+    int       elapsedMs;
+    bool      synced;                  // a keyframe has been applied
+};
+
+void specEncoderInit(SpecEncoder &e);
+
+// Appends one length-prefixed frame for `s` to out; returns its size, 0 if
+// `cap` is too small. *keyframe tells which kind it was.
+int  specEncode(SpecEncoder &e, const SpecState &s, unsigned char *out, int cap, bool *keyframe);
+
+void specDecoderInit(SpecDecoder &d);
+
+// Applies one frame (without its length prefix). Deltas before the first
+// keyframe are skipped. Returns false on malformed input.
+bool specDecode(SpecDecoder &d, const unsigned char *frame, int len);
+
+// ------------- SERVER / VIEWER -------------
+struct SpecStats {
+    long   frames;
+    long   keyframes;
+    long   bytes;                      // encoded, before fan-out
+    double encodeMicros;               // total
+    double bytesPerSecond;             // over the last second
+    int    lastFrameBytes;
+    int    clients;
+};
+
+struct SpecClient {
+    intptr_t      sock;                // -1 if unused
+    int           pendingStart, pendingLen;
+    unsigned char pending[SPEC_CLIENT_BUFFER];
+};
+
+struct SpecServer {
+    intptr_t      listenSock;
+    char          unixPath[108];       // removed again on close
+    SpecEncoder   encoder;
+    SpecClient    clients[SPEC_MAX_CLIENTS];
+    unsigned char catchup[SPEC_CATCHUP_BUFFER];
+    int           catchupLen;
+    SpecStats     stats;
+    double        windowStartMs;
+    long          windowBytes;
+};
+
+bool specServerOpen(SpecServer &s, const char *address);
+void specServerClose(SpecServer &s);
+
+// Encodes this tick, accepts new viewers and sends to all of them. Never
+// blocks; a viewer that falls SPEC_CLIENT_BUFFER behind is dropped.
+void specServerPublish(SpecServer &s, const SpecState &state, double nowMs);
+
+struct SpecViewer {
+    intptr_t      sock;
+    SpecDecoder   decoder;
+    unsigned char buffer[SPEC_CLIENT_BUFFER];
+    int           bufferLen;
+    long          bytes;
+    double        windowStartMs;
+    long          windowBytes;
+    double        bytesPerSecond;
+};
+
+bool specViewerOpen(SpecViewer &v, const char *address);
+void specViewerClose(SpecViewer &v);
+
+// Reads whatever arrived and applies every complete frame. Returns the
+// number of frames applied, or -1 once the publisher has gone.
+int  specViewerPoll(SpecViewer &v, double nowMs);
+
+// --spectate-bench: encodes synthetic runs at a few densities, decodes
+// them, checks the viewer's copy and reports bandwidth and encode cost.
+int  specRunBenchmark(int ticks);
+
+#endif // SPECTATE_H
@@ -0,0 +1,540 @@
+// Batched runner environment, see vecenv.h; C interface in vecenv_c.h.
+#include "vecenv.h"
+#include "vecenv_c.h"
+#include "autopilot.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+const float TICK_SECONDS     = 1.0f / VECENV_TICK_RATE;
+const float SPAWN_Z          = -80.0f;
+const float HIT_OBSTACLE     = (1.2f + 2.5f) * 0.5f;   // player + obstacle, half
+const float HIT_PICKUP       = (1.2f + 1.5f) * 0.5f;
+const float VIEW_DISTANCE    = 80.0f;                  // obs distances are / this
+const float REBASE_TRAVEL    = 1024.0f;                // keeps travel precise
+const int   MAX_SHIELDS      = 3;
+const int   GRACE_TICKS      = VECENV_TICK_RATE * 4 / 10;
+const int   POWERUP_TICKS    = 5 * VECENV_TICK_RATE;
+const int   POWERUP_COOLDOWN = 10 * VECENV_TICK_RATE;
+const int   SPEED_UP_TICKS   = 15 * VECENV_TICK_RATE;
+const int   SPAWN_UP_TICKS   = 30 * VECENV_TICK_RATE;  // score interval halves too
+
+// 1 s / 1.5 every 30 s, down to 0.1 s
+static const float SPAWN_INTERVALS[] = { 1.0f, 0.6667f, 0.4444f, 0.2963f, 0.1975f, 0.1317f, 0.1f };
+const int NUM_SPAWN_LEVELS = sizeof(SPAWN_INTERVALS) / sizeof(SPAWN_INTERVALS[0]);
+
+static unsigned envRand(unsigned &rng) {
+    rng = rng * 1103515245u + 12345u;
+    return (rng >> 16) & 0x7FFF;
+}
+
+// ------------- SETUP -------------
+size_t vecEnvBytes(int count, int lanes) {
+    const int ARRAYS = 19;
+    size_t perRun = 11 * sizeof(int) + sizeof(unsigned) + 3 * sizeof(float) + 1 +
+                    2 * (size_t)lanes + sizeof(float) * (size_t)lanes * VECENV_RING;
+    return perRun * (size_t)count + ARRAYS * 16;
+}
+
+bool vecEnvInit(VecEnv &v, Arena &a, int count, int lanes, unsigned seed, int maxSteps) {
+    memset(&v, 0, sizeof(v));
+    if (count < 1 || lanes < 3 || lanes > 9) {
+        fprintf(stderr, "vecenv: need at least one run and 3..9 lanes\n");
+        return false;
+    }
+    v.count        = count;
+    v.lanes        = lanes;
+    v.maxSteps     = maxSteps;
+    v.crashPenalty = 10.0f;
+
+    v.tick            = arenaNew<int>(a, count);
+    v.lane            = arenaNew<int>(a, count);
+    v.shields         = arenaNew<int>(a, count);
+    v.graceUntil      = arenaNew<int>(a, count);
+    v.lastScoreTick   = arenaNew<int>(a, count);
+    v.nextShieldTick  = arenaNew<int>(a, count);
+    v.nextPowerupTick = arenaNew<int>(a, count);
+    v.powerup         = arenaNew<int>(a, count);
+    v.powerupLeft     = arenaNew<int>(a, count);
+    v.obstacles       = arenaNew<int>(a, count);
+    v.pickupLane      = arenaNew<int>(a, count);
+    v.rng             = arenaNew<unsigned>(a, count);
+    v.travel          = arenaNew<float>(a, count);
+    v.spawnTimer      = arenaNew<float>(a, count);
+    v.pickupAt        = arenaNew<float>(a, count);
+    v.offered         = arenaNew<unsigned char>(a, count);
+    v.ringStart       = arenaNew<unsigned char>(a, count * lanes);
+    v.ringLen         = arenaNew<unsigned char>(a, count * lanes);
+    v.ring            = arenaNew<float>(a, count * lanes * VECENV_RING);
+    if (!v.ring || a.failures > 0) return false;
+
+    for (int i = 0; i < count; ++i)
+        v.rng[i] = seed ^ ((unsigned)i * 0x9E3779B9u);
+    return true;
+}
+
+// ------------- STEP -------------
+static void resetRun(VecEnv &v, int i) {
+    v.tick[i]            = 0;
+    v.lane[i]            = v.lanes / 2;
+    v.shields[i]         = 0;
+    v.graceUntil[i]      = 0;
+    v.lastScoreTick[i]   = 0;
+    v.nextShieldTick[i]  = 20 * VECENV_TICK_RATE;
+    v.nextPowerupTick[i] = 10 * VECENV_TICK_RATE;
+    v.powerup[i]         = 0;
+    v.powerupLeft[i]     = 0;
+    v.obstacles[i]       = 0;
+    v.pickupLane[i]      = -1;
+    v.travel[i]          = 0.0f;
+    v.spawnTimer[i]      = 0.0f;
+    v.offered[i]         = 0;
+    memset(v.ringStart + i * v.lanes, 0, (size_t)v.lanes);
+    memset(v.ringLen + i * v.lanes, 0, (size_t)v.lanes);
+}
+
+static void writeObs(const VecEnv &v, int i, float *o) {
+    int lanes = v.lanes;
+    int speedLevel = v.tick[i] / SPEED_UP_TICKS;
+    float speed = (10.0f + 2.0f * speedLevel) * (v.powerup[i] == ACT_SLOW_HALF ? 0.5f : 1.0f);
+
+    o[OBS_LANE]            = (float)v.lane[i] / (float)(lanes - 1);
+    o[OBS_SHIELDS]         = (float)v.shields[i] / MAX_SHIELDS;
+    o[OBS_SPEED]           = speed / 40.0f;
+    o[OBS_POWERUP_OFFERED] = v.offered[i];
+    o[OBS_SCORE_X2]        = v.powerup[i] == ACT_SCORE_X2;
+    o[OBS_SLOW_HALF]       = v.powerup[i] == ACT_SLOW_HALF;
+    o[OBS_INVINCIBLE]      = v.powerup[i] == ACT_INVINCIBLE;
+    o[OBS_POWERUP_LEFT]    = (float)v.powerupLeft[i] / POWERUP_TICKS;
+
+    float travel = v.travel[i];
+    if (v.pickupLane[i] >= 0) {
+        float d = -(SPAWN_Z + travel - v.pickupAt[i]) / VIEW_DISTANCE;
+        o[OBS_PICKUP_DISTANCE] = d < 0.0f ? 0.0f : d;
+        o[OBS_PICKUP_LANE]     = (float)v.pickupLane[i] / (float)(lanes - 1);
+    } else {
+        o[OBS_PICKUP_DISTANCE] = 1.0f;
+        o[OBS_PICKUP_LANE]     = 0.0f;
+    }
+
+    const float         *ring  = v.ring + (size_t)i * lanes * VECENV_RING;
+    const unsigned char *start = v.ringStart + i * lanes;
+    const unsigned char *len   = v.ringLen + i * lanes;
+    for (int l = 0; l < lanes; ++l) {
+        float d = 1.0f;
+        if (len[l]) {
+            d = -(SPAWN_Z + travel - ring[l * VECENV_RING + start[l]]) / VIEW_DISTANCE;
+            if (d < 0.0f) d = 0.0f;
+        }
+        o[OBS_LANE_DISTANCE + l] = d;
+    }
+}
+
+void vecEnvReset(VecEnv &v, float *obs) {
+    int obsSize = vecEnvObsSize(v.lanes);
+    for (int i = 0; i < v.count; ++i) {
+        resetRun(v, i);
+        writeObs(v, i, obs + (size_t)i * obsSize);
+    }
+}
+
+void vecEnvStep(VecEnv &v, const int *actions, float *obs, float *rewards,
+                unsigned char *dones, int begin, int end) {
+    const int lanes   = v.lanes;
+    const int obsSize = vecEnvObsSize(lanes);
+    if (end < 0 || end > v.count) end = v.count;
+
+    for (int i = begin; i < end; ++i) {
+        int t = ++v.tick[i];
+        int lane = v.lane[i];
+        int action = actions[i];
+        float reward = 0.0f;
+
+        if (action == ACT_LEFT && lane > 0) --lane;
+        else if (action == ACT_RIGHT && lane < lanes - 1) ++lane;
+        else if (action >= ACT_SCORE_X2 && action < NUM_ACTIONS && v.offered[i]) {
+            v.powerup[i]     = action;
+            v.powerupLeft[i] = POWERUP_TICKS;
+            v.offered[i]     = 0;
+        }
+        v.lane[i] = lane;
+
+        int powerup = v.powerup[i];
+        if (powerup) {
+            if (--v.powerupLeft[i] <= 0) {
+                v.powerup[i]         = 0;
+                v.nextPowerupTick[i] = t + POWERUP_COOLDOWN;
+            }
+        } else if (!v.offered[i] && t >= v.nextPowerupTick[i]) {
+            v.offered[i] = 1;
+        }
+
+        // ---------- SCORE / SPEED / MOVE ----------
+        int spawnLevel = t / SPAWN_UP_TICKS;
+        int scoreInterval = VECENV_TICK_RATE >> (spawnLevel < 5 ? spawnLevel : 5);
+        while (t - v.lastScoreTick[i] >= scoreInterval) {
+            reward += (powerup == ACT_SCORE_X2) ? 2.0f : 1.0f;
+            v.lastScoreTick[i] += scoreInterval;
+        }
+
+        float speed = (10.0f + 2.0f * (t / SPEED_UP_TICKS)) * (powerup == ACT_SLOW_HALF ? 0.5f : 1.0f);
+        float travel = v.travel[i] + speed * TICK_SECONDS;
+
+        float         *ring  = v.ring + (size_t)i * lanes * VECENV_RING;
+        unsigned char *start = v.ringStart + i * lanes;
+        unsigned char *len   = v.ringLen + i * lanes;
+        if (travel > REBASE_TRAVEL) {
+            travel -= REBASE_TRAVEL;
+            for (int l = 0; l < lanes; ++l)
+                for (int k = 0; k < len[l]; ++k)
+                    ring[l * VECENV_RING + ((start[l] + k) & (VECENV_RING - 1))] -= REBASE_TRAVEL;
+            v.pickupAt[i] -= REBASE_TRAVEL;
+        }
+        v.travel[i] = travel;
+
+        // obstacles the player is past can't hit any more
+        float passedAt = travel - HIT_OBSTACLE + SPAWN_Z;   // spawned before this
+        int obstacles = v.obstacles[i];
+        for (int l = 0; l < lanes; ++l) {
+            while (len[l] && ring[l * VECENV_RING + start[l]] < passedAt) {
+                start[l] = (unsigned char)((start[l] + 1) & (VECENV_RING - 1));
+                --len[l];
+                --obstacles;
+            }
+        }
+
+        // ---------- SPAWN ----------
+        v.spawnTimer[i] -= TICK_SECONDS;
+        if (v.spawnTimer[i] <= 0.0f) {
+            int l = (int)(envRand(v.rng[i]) % (unsigned)lanes);
+            if (obstacles < VECENV_MAX_OBS && len[l] < VECENV_RING) {
+                ring[l * VECENV_RING + ((start[l] + len[l]) & (VECENV_RING - 1))] = travel;
+                ++len[l];
+                ++obstacles;
+            }
+            v.spawnTimer[i] = SPAWN_INTERVALS[spawnLevel < NUM_SPAWN_LEVELS ? spawnLevel
+                                                                           : NUM_SPAWN_LEVELS - 1];
+        }
+        if (t >= v.nextShieldTick[i]) {
+            v.pickupLane[i]     = (int)(envRand(v.rng[i]) % (unsigned)lanes);
+            v.pickupAt[i]       = travel;
+            v.nextShieldTick[i] = t + (20 + (int)(envRand(v.rng[i]) % 21)) * VECENV_TICK_RATE;
+        }
+
+        // ---------- COLLISIONS ----------
+        if (v.pickupLane[i] >= 0) {
+            float z = SPAWN_Z + travel - v.pickupAt[i];
+            if (v.pickupLane[i] == lane && z >= -HIT_PICKUP && z <= HIT_PICKUP) {
+                if (v.shields[i] < MAX_SHIELDS) ++v.shields[i];
+                v.pickupLane[i] = -1;
+            } else if (z > HIT_PICKUP) {
+                v.pickupLane[i] = -1;
+            }
+        }
+
+        bool crashed = false;
+        if (len[lane] && powerup != ACT_INVINCIBLE && t >= v.graceUntil[i] &&
+            SPAWN_Z + travel - ring[lane * VECENV_RING + start[lane]] >= -HIT_OBSTACLE) {
+            if (v.shields[i] > 0) {
+                --v.shields[i];
+                v.graceUntil[i] = t + GRACE_TICKS;
+                start[lane] = (unsigned char)((start[lane] + 1) & (VECENV_RING - 1));
+                --len[lane];
+                --obstacles;
+            } else {
+                crashed = true;
+                reward -= v.crashPenalty;
+            }
+        }
+        v.obstacles[i] = obstacles;
+
+        bool done = crashed || (v.maxSteps > 0 && t >= v.maxSteps);
+        if (done) resetRun(v, i);
+        rewards[i] = reward;
+        dones[i]   = done;
+        writeObs(v, i, obs + (size_t)i * obsSize);
+    }
+}
+
+// ------------- AUTOPILOT -------------
+void vecEnvAutopilot(const VecEnv &v, int *actions, int begin, int end) {
+    const int lanes = v.lanes;
+    if (end < 0 || end > v.count) end = v.count;
+
+    for (int i = begin; i < end; ++i) {
+        // as the next step will see it
+        int   t     = v.tick[i] + 1;
+        float speed = (10.0f + 2.0f * (t / SPEED_UP_TICKS)) * (v.powerup[i] == ACT_SLOW_HALF ? 0.5f : 1.0f);
+        float travel = v.travel[i];
+
+        int safeTicks = v.graceUntil[i] - t;
+        if (v.powerup[i] == ACT_INVINCIBLE && v.powerupLeft[i] - 1 > safeTicks)
+            safeTicks = v.powerupLeft[i] - 1;
+
+        AutopilotGrid g;
+        autopilotClear(g, lanes, speed, TICK_SECONDS);
+        const float         *ring  = v.ring + (size_t)i * lanes * VECENV_RING;
+        const unsigned char *start = v.ringStart + i * lanes;
+        const unsigned char *len   = v.ringLen + i * lanes;
+        for (int l = 0; l < lanes; ++l)
+            for (int k = 0; k < len[l]; ++k)
+                autopilotAddObstacle(g, l, SPAWN_Z + travel - ring[l * VECENV_RING + ((start[l] + k) & (VECENV_RING - 1))],
+                                     HIT_OBSTACLE);
+        if (v.pickupLane[i] >= 0)
+            autopilotAddPickup(g, v.pickupLane[i], SPAWN_Z + travel - v.pickupAt[i], HIT_PICKUP);
+
+        int move = autopilotDecide(g, v.lane[i], v.shields[i], MAX_SHIELDS,
+                                   safeTicks > 0 ? safeTicks * speed * TICK_SECONDS : 0.0f);
+        if (move < 0)          actions[i] = ACT_LEFT;
+        else if (move > 0)     actions[i] = ACT_RIGHT;
+        else if (v.offered[i]) actions[i] = ACT_INVINCIBLE;
+        else                   actions[i] = ACT_STAY;
+    }
+}
+
+void vecEnvGreedy(const VecEnv &v, const float *obs, int *actions, int begin, int end) {
+    int obsSize = vecEnvObsSize(v.lanes);
+    if (end < 0 || end > v.count) end = v.count;
+
+    for (int i = begin; i < end; ++i) {
+        const float *o = obs + (size_t)i * obsSize;
+        if (o[OBS_POWERUP_OFFERED] > 0.0f) { actions[i] = ACT_INVINCIBLE; continue; }
+
+        int lane = v.lane[i];
+        int best = ACT_STAY;
+        float clear = o[OBS_LANE_DISTANCE + lane];
+        if (lane > 0 && o[OBS_LANE_DISTANCE + lane - 1] > clear + 0.05f) {
+            best  = ACT_LEFT;
+            clear = o[OBS_LANE_DISTANCE + lane - 1];
+        }
+        if (lane < v.lanes - 1 && o[OBS_LANE_DISTANCE + lane + 1] > clear + 0.05f)
+            best = ACT_RIGHT;
+        actions[i] = best;
+    }
+}
+
+// ------------- C INTERFACE -------------
+struct vecenv {
+    Arena  arena;
+    VecEnv env;
+};
+
+extern "C" {
+
+vecenv *vecenv_create(int count, int lanes, unsigned seed, int max_steps) {
+    if (count < 1 || lanes < 3 || lanes > 9) return NULL;
+    vecenv *e = (vecenv *)calloc(1, sizeof(vecenv));
+    if (!e) return NULL;
+    if (!arenaInit(e->arena, vecEnvBytes(count, lanes)) ||
+        !vecEnvInit(e->env, e->arena, count, lanes, seed, max_steps)) {
+        vecenv_destroy(e);
+        return NULL;
+    }
+    return e;
+}
+
+void vecenv_destroy(vecenv *env) {
+    if (!env) return;
+    arenaRelease(env->arena);
+    free(env);
+}
+
+int vecenv_count(const vecenv *env) {
+    return env->env.count;
+}
+
+int vecenv_obs_size(const vecenv *env) {
+    return vecEnvObsSize(env->env.lanes);
+}
+
+void vecenv_set_crash_penalty(vecenv *env, float penalty) {
+    env->env.crashPenalty = penalty;
+}
+
+void vecenv_reset(vecenv *env, float *obs) {
+    vecEnvReset(env->env, obs);
+}
+
+void vecenv_step(vecenv *env, const int *actions, float *obs,
+                 float *rewards, unsigned char *dones) {
+    vecEnvStep(env->env, actions, obs, rewards, dones);
+}
+
+void vecenv_step_range(vecenv *env, int begin, int end, const int *actions,
+                       float *obs, float *rewards, unsigned char *dones) {
+    vecEnvStep(env->env, actions, obs, rewards, dones, begin, end);
+}
+
+void vecenv_autopilot(const vecenv *env, int *actions) {
+    vecEnvAutopilot(env->env, actions);
+}
+
+} // extern "C"
+
+// ------------- BENCHMARK -------------
+double vecEnvSeconds() {
+    using namespace std::chrono;
+    return duration_cast<duration<double> >(steady_clock::now().time_since_epoch()).count();
+}
+
+enum BenchPolicy {
+    POLICY_RANDOM,
+    POLICY_DODGE                       // vecEnvGreedy
+};
+
+static void choose(const VecEnv &v, BenchPolicy policy, const float *obs,
+                   int *actions, unsigned &rng, int begin, int end) {
+    if (policy == POLICY_DODGE) {
+        vecEnvGreedy(v, obs, actions, begin, end);
+        return;
+    }
+    for (int i = begin; i < end; ++i)
+        actions[i] = (int)(envRand(rng) % NUM_ACTIONS);
+}
+
+struct BenchBuffers {
+    std::vector<float>         obs, rewards;
+    std::vector<int>           actions;
+    std::vector<unsigned char> dones;
+};
+
+static void allocBuffers(BenchBuffers &b, const VecEnv &v) {
+    b.obs.assign((size_t)v.count * vecEnvObsSize(v.lanes), 0.0f);
+    b.rewards.assign((size_t)v.count, 0.0f);
+    b.actions.assign((size_t)v.count, 0);
+    b.dones.assign((size_t)v.count, 0);
+}
+
+struct BenchResult {
+    double stepSeconds;                // in vecEnvStep only
+    long   episodes;
+    double returns;                    // summed over finished episodes
+    long   ticks;                      // in finished episodes
+};
+
+// runs [begin, end) for `steps` ticks; one of these per thread
+static void runShard(VecEnv &v, BenchBuffers &b, BenchPolicy policy, int steps,
+                     int begin, int end, BenchResult &r) {
+    unsigned rng = 77u + (unsigned)begin;
+    std::vector<double> episodeReturn((size_t)(end - begin), 0.0);
+    std::vector<int>    episodeTicks((size_t)(end - begin), 0);
+    memset(&r, 0, sizeof(r));
+
+    for (int s = 0; s < steps; ++s) {
+        choose(v, policy, &b.obs[0], &b.actions[0], rng, begin, end);
+        double t0 = vecEnvSeconds();
+        vecEnvStep(v, &b.actions[0], &b.obs[0], &b.rewards[0], &b.dones[0], begin, end);
+        r.stepSeconds += vecEnvSeconds() - t0;
+
+        for (int i = begin; i < end; ++i) {
+            size_t k = (size_t)(i - begin);
+            episodeReturn[k] += b.rewards[(size_t)i];
+            ++episodeTicks[k];
+            if (!b.dones[(size_t)i]) continue;
+            ++r.episodes;
+            r.returns += episodeReturn[k];
+            r.ticks   += episodeTicks[k];
+            episodeReturn[k] = 0.0;
+            episodeTicks[k]  = 0;
+        }
+    }
+}
+
+static unsigned fnv(unsigned h, const void *data, size_t size) {
+    const unsigned char *b = (const unsigned char *)data;
+    for (size_t i = 0; i < size; ++i) {
+        h ^= b[i];
+        h *= 16777619u;
+    }
+    return h;
+}
+
+// same seed and actions give the same outputs, stepped whole or in halves
+static bool checkDeterminism(int count, int lanes) {
+    unsigned hashes[2];
+    for (int pass = 0; pass < 2; ++pass) {
+        Arena a;
+        VecEnv v;
+        BenchBuffers b;
+        if (!arenaInit(a, vecEnvBytes(count, lanes))) return false;
+        vecEnvInit(v, a, count, lanes, 1234u, 3000);
+        allocBuffers(b, v);
+        vecEnvReset(v, &b.obs[0]);
+
+        unsigned rng = 5u, h = 2166136261u;
+        for (int s = 0; s < 4000; ++s) {
+            choose(v, POLICY_RANDOM, &b.obs[0], &b.actions[0], rng, 0, count);
+            if (pass == 0) {
+                vecEnvStep(v, &b.actions[0], &b.obs[0], &b.rewards[0], &b.dones[0]);
+            } else {
+                vecEnvStep(v, &b.actions[0], &b.obs[0], &b.rewards[0], &b.dones[0], count / 2, -1);
+                vecEnvStep(v, &b.actions[0], &b.obs[0], &b.rewards[0], &b.dones[0], 0, count / 2);
+            }
+            h = fnv(h, &b.obs[0], b.obs.size() * sizeof(float));
+            h = fnv(h, &b.rewards[0], b.rewards.size() * sizeof(float));
+            h = fnv(h, &b.dones[0], b.dones.size());
+        }
+        hashes[pass] = h;
+        arenaRelease(a);
+    }
+    return hashes[0] == hashes[1];
+}
+
+int vecEnvRunBenchmark(int count, int steps) {
+    const int LANES = 5;
+    int threads = (int)std::thread::hardware_concurrency();
+    if (threads < 1) threads = 1;
+    if (count < threads) count = threads;
+
+    printf("env bench: %d runs x %d steps, %d lanes, %d obs floats per run\n",
+           count, steps, LANES, vecEnvObsSize(LANES));
+
+    Arena a;
+    if (!arenaInit(a, vecEnvBytes(count, LANES))) return 1;
+    VecEnv v;
+    BenchBuffers b;
+    if (!vecEnvInit(v, a, count, LANES, 2024u, 0)) return 1;
+    allocBuffers(b, v);
+
+    const char *names[] = { "random", "dodge" };
+    for (int p = 0; p < 2; ++p) {
+        vecEnvReset(v, &b.obs[0]);
+        BenchResult r;
+        runShard(v, b, (BenchPolicy)p, steps, 0, count, r);
+        double rate = (double)count * steps / r.stepSeconds;
+        printf("  %-6s policy, 1 thread:  %6.1f M steps/s, %ld crashes",
+               names[p], rate / 1e6, r.episodes);
+        if (r.episodes)
+            printf(", %.0f ticks and %.1f return per run", (double)r.ticks / r.episodes,
+                   r.returns / r.episodes);
+        printf("\n");
+    }
+
+    // one shard per core, each stepping its own runs like a rollout worker
+    vecEnvReset(v, &b.obs[0]);
+    std::vector<BenchResult> results((size_t)threads);
+    std::vector<std::thread> workers;
+    double t0 = vecEnvSeconds();
+    for (int t = 0; t < threads; ++t) {
+        int begin = count * t / threads, end = count * (t + 1) / threads;
+        workers.push_back(std::thread(runShard, std::ref(v), std::ref(b), POLICY_DODGE,
+                                      steps, begin, end, std::ref(results[(size_t)t])));
+    }
+    for (size_t t = 0; t < workers.size(); ++t) workers[t].join();
+    double wall = vecEnvSeconds() - t0;
+    double stepTime = 0.0;
+    for (int t = 0; t < threads; ++t)
+        if (results[(size_t)t].stepSeconds > stepTime) stepTime = results[(size_t)t].stepSeconds;
+    printf("  dodge  policy, %d cores:   %6.1f M steps/s in the env (%.1f M/s with the policy)\n",
+           threads, (double)count * steps / stepTime / 1e6, (double)count * steps / wall / 1e6);
+
+    bool same = checkDeterminism(256, LANES);
+    printf("  deterministic (whole batch vs. two ranges): %s\n", same ? "yes" : "NO");
+
+    arenaRelease(a);
+    return same ? 0 : 1;
+}
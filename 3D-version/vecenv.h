@@ -0,0 +1,115 @@
+// Batched runner environment for training lane-switching bots.
+//
+// Holds `count` independent single-player runs and steps all of them with
+// one call, in fixed 60 Hz ticks and without any drawing. The rules are
+// the game's: speed-ups every 15 s, faster spawns every 30 s, shield
+// pickups, the three powerups, the grace period after a shield is used.
+//
+// State is kept per field across all runs (SoA). Obstacles don't move:
+// everything on the track moves at the same speed, so each lane is a FIFO
+// of the distance travelled when the obstacle appeared, and its Z follows
+// from the run's travel. A step only looks at the head of each lane.
+//
+// Observations, rewards and done flags are written to caller-owned
+// contiguous buffers: obs is [count][vecEnvObsSize(lanes)] floats. A run
+// that ends is reset in the same step; its obs are then the new run's.
+//
+// vecenv_c.h is the same API for C and anything with a C FFI.
+#ifndef VECENV_H
+#define VECENV_H
+
+#include "arena.h"
+
+const int VECENV_RING      = 16;       // obstacles per lane at most
+const int VECENV_MAX_OBS   = 40;       // on the track, as in the game
+const int VECENV_TICK_RATE = 60;
+
+enum VecEnvAction {
+    ACT_STAY,
+    ACT_LEFT,
+    ACT_RIGHT,
+    ACT_SCORE_X2,                      // the powerups, when one is offered
+    ACT_SLOW_HALF,
+    ACT_INVINCIBLE,
+    NUM_ACTIONS
+};
+
+// one run's observation: these, then one distance per lane
+enum VecEnvObs {
+    OBS_LANE,                          // 0 = leftmost .. 1 = rightmost
+    OBS_SHIELDS,                       // 0..1 of the 3
+    OBS_SPEED,                         // / 40
+    OBS_POWERUP_OFFERED,               // 1 while one can be picked
+    OBS_SCORE_X2,                      // active powerup, one-hot
+    OBS_SLOW_HALF,
+    OBS_INVINCIBLE,
+    OBS_POWERUP_LEFT,                  // 1 = just picked, 0 = run out
+    OBS_PICKUP_DISTANCE,               // nearest shield pickup, 1 = none
+    OBS_PICKUP_LANE,
+    OBS_LANE_DISTANCE,                 // + lane: nearest obstacle ahead, 1 = none
+};
+
+inline int vecEnvObsSize(int lanes) { return OBS_LANE_DISTANCE + lanes; }
+
+struct VecEnv {
+    int       count, lanes, maxSteps;  // maxSteps 0 = runs only end in a crash
+    float     crashPenalty;
+
+    // per run
+    int      *tick;
+    int      *lane;
+    int      *shields;
+    int      *graceUntil;              // tick the shield grace period ends
+    int      *lastScoreTick;
+    int      *nextShieldTick;
+    int      *nextPowerupTick;
+    int      *powerup;                 // ACT_SCORE_X2.. while active, else 0
+    int      *powerupLeft;             // ticks
+    int      *obstacles;
+    int      *pickupLane;              // -1 if no pickup on the track
+    unsigned *rng;
+    float    *travel;
+    float    *spawnTimer;
+    float    *pickupAt;                // travel when the pickup appeared
+    unsigned char *offered;
+
+    // per run and lane
+    unsigned char *ringStart;
+    unsigned char *ringLen;
+    float         *ring;               // [run][lane][VECENV_RING], travel at spawn
+};
+
+size_t vecEnvBytes(int count, int lanes);
+
+// lanes 3..9. Runs are seeded from `seed` and their index.
+bool vecEnvInit(VecEnv &v, Arena &a, int count, int lanes, unsigned seed, int maxSteps);
+
+// Starts every run over and writes its first observation.
+void vecEnvReset(VecEnv &v, float *obs);
+
+// One tick of runs [begin, end) (end -1: all) with actions[i] for run i.
+// rewards are the points scored this tick, minus crashPenalty on a crash.
+// Disjoint ranges can be stepped from different threads.
+void vecEnvStep(VecEnv &v, const int *actions, float *obs, float *rewards,
+                unsigned char *dones, int begin = 0, int end = -1);
+
+// The lane planner's actions (autopilot.h) for runs [begin, end) (end -1:
+// all). It sees everything on the track, not just the observation, and
+// takes the invincible powerup when one is offered and nothing needs
+// dodging. A baseline, or a teacher for imitation.
+void vecEnvAutopilot(const VecEnv &v, int *actions, int begin = 0, int end = -1);
+
+// The greedy baseline for runs [begin, end) (end -1: all), from the
+// observation alone: toward the clearest of the lanes in reach, or the
+// invincible powerup when one is offered.
+void vecEnvGreedy(const VecEnv &v, const float *obs, int *actions,
+                  int begin = 0, int end = -1);
+
+// Seconds on the steady clock, for the timings of the env and its users.
+double vecEnvSeconds();
+
+// --env-bench: steps/s single-threaded and on every core, with a random
+// and a simple dodging policy, and a determinism check.
+int  vecEnvRunBenchmark(int count, int steps);
+
+#endif // VECENV_H
@@ -0,0 +1,43 @@
+/* C interface to the batched runner environment (vecenv.h).
+ *
+ * Build it as a shared library:
+ *   g++ -O2 -shared -fPIC vecenv.cpp arena.cpp autopilot.cpp -o librunnerenv.so
+ *
+ * All buffers belong to the caller and are reused every step:
+ *   obs      count * vecenv_obs_size() floats
+ *   actions  count ints (VecEnvAction: 0 stay, 1 left, 2 right, 3..5 powerups)
+ *   rewards  count floats
+ *   dones    count bytes */
+#ifndef VECENV_C_H
+#define VECENV_C_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct vecenv vecenv;
+
+/* NULL if lanes isn't 3..9 or memory runs out. max_steps 0: no limit. */
+vecenv *vecenv_create(int count, int lanes, unsigned seed, int max_steps);
+void    vecenv_destroy(vecenv *env);
+
+int     vecenv_count(const vecenv *env);
+int     vecenv_obs_size(const vecenv *env);
+void    vecenv_set_crash_penalty(vecenv *env, float penalty);
+
+void    vecenv_reset(vecenv *env, float *obs);
+void    vecenv_step(vecenv *env, const int *actions, float *obs,
+                    float *rewards, unsigned char *dones);
+
+/* runs [begin, end) only; disjoint ranges may run on different threads */
+void    vecenv_step_range(vecenv *env, int begin, int end, const int *actions,
+                          float *obs, float *rewards, unsigned char *dones);
+
+/* what the lane planner would do in every run (vecEnvAutopilot) */
+void    vecenv_autopilot(const vecenv *env, int *actions);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* VECENV_C_H */